@@ -0,0 +1,156 @@
+#include "BGZFReader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "third/samtools/bgzf.h"
+
+static inline BGZF* handle(void* fp) { return (BGZF*)fp; }
+
+BGZFReader::BGZFReader(size_t cacheSize)
+    : fp(NULL),
+      cacheSize(cacheSize),
+      cacheUsed(0),
+      cacheHit(0),
+      cacheMiss(0),
+      block(NULL),
+      blockOffset(0) {}
+
+BGZFReader::~BGZFReader() { this->close(); }
+
+int BGZFReader::open(const std::string& fileName) {
+  this->close();
+  this->fp = bgzf_open(fileName.c_str(), "r");
+  if (!this->fp) {
+    return -1;
+  }
+  return this->loadBlock(0);
+}
+
+void BGZFReader::close() {
+  if (this->fp) {
+    bgzf_close(handle(this->fp));
+    this->fp = NULL;
+  }
+  this->blocks.clear();
+  this->blockIndex.clear();
+  this->cacheUsed = 0;
+  this->block = NULL;
+  this->blockOffset = 0;
+}
+
+int BGZFReader::seek(uint64_t offset) {
+  if (!this->fp) return -1;
+  if (loadBlock(offset >> 16)) return -1;
+  this->blockOffset = offset & 0xFFFF;
+  return 0;
+}
+
+uint64_t BGZFReader::tell() const {
+  if (!this->block) return 0;
+  // a fully read block points to the beginning of the next one
+  if (this->blockOffset >= (int)this->block->data.size()) {
+    return this->block->nextAddress << 16;
+  }
+  return this->block->address << 16 | this->blockOffset;
+}
+
+int BGZFReader::read(void* buf, int len) {
+  if (!this->block) return -1;
+  char* dest = (char*)buf;
+  int nRead = 0;
+  while (nRead < len) {
+    if (this->blockOffset >= (int)this->block->data.size()) {
+      if (this->block->data.empty()) break;  // file end
+      if (loadBlock(this->block->nextAddress)) return -1;
+      continue;
+    }
+    int n = this->block->data.size() - this->blockOffset;
+    if (n > len - nRead) n = len - nRead;
+    memcpy(dest + nRead, this->block->data.data() + this->blockOffset, n);
+    this->blockOffset += n;
+    nRead += n;
+  }
+  return nRead;
+}
+
+bool BGZFReader::readLine(std::string* line) {
+  line->clear();
+  if (!this->block) return false;
+  while (true) {
+    if (this->blockOffset >= (int)this->block->data.size()) {
+      if (this->block->data.empty()) {  // file end
+        return !line->empty();
+      }
+      if (loadBlock(this->block->nextAddress)) return false;
+      continue;
+    }
+    const char* s = this->block->data.data() + this->blockOffset;
+    const int n = this->block->data.size() - this->blockOffset;
+    const char* p = (const char*)memchr(s, '\n', n);
+    if (p) {
+      line->append(s, p - s);
+      this->blockOffset += p - s + 1;
+      return true;
+    }
+    line->append(s, n);
+    this->blockOffset += n;
+  }
+}
+
+void BGZFReader::setCacheSize(size_t cacheSize) {
+  this->cacheSize = cacheSize;
+  evict();
+}
+
+double BGZFReader::getCacheHitRate() const {
+  const uint64_t n = this->cacheHit + this->cacheMiss;
+  return n ? (double)this->cacheHit / n : 0.0;
+}
+
+int BGZFReader::loadBlock(uint64_t address) {
+  this->blockOffset = 0;
+  std::unordered_map<uint64_t, std::list<Block>::iterator>::iterator it =
+      this->blockIndex.find(address);
+  if (it != this->blockIndex.end()) {
+    ++this->cacheHit;
+    this->blocks.splice(this->blocks.begin(), this->blocks, it->second);
+    this->block = &this->blocks.front();
+    return 0;
+  }
+
+  ++this->cacheMiss;
+  BGZF* f = handle(this->fp);
+  if (bgzf_seek(f, address << 16, SEEK_SET) < 0 || bgzf_read_block(f) < 0) {
+    fprintf(stderr, "Cannot read BGZF block at offset %llu\n",
+            (unsigned long long)address);
+    this->block = NULL;
+    return -1;
+  }
+  this->blocks.push_front(Block());
+  Block& b = this->blocks.front();
+  b.address = address;
+  if (f->block_length > 0) {
+    // BSIZE in the block header is the compressed block size minus 1
+    const uint8_t* header = (const uint8_t*)f->compressed_block;
+    b.nextAddress = address + (header[16] | header[17] << 8) + 1;
+    b.data.assign((const char*)f->uncompressed_block, f->block_length);
+  } else {
+    b.nextAddress = address;
+  }
+  this->blockIndex[address] = this->blocks.begin();
+  this->cacheUsed += b.data.size();
+  this->block = &b;
+  evict();
+  return 0;
+}
+
+void BGZFReader::evict() {
+  // keep the current block, which is always the first one
+  while (this->cacheUsed > this->cacheSize && this->blocks.size() > 1) {
+    const Block& b = this->blocks.back();
+    this->cacheUsed -= b.data.size();
+    this->blockIndex.erase(b.address);
+    this->blocks.pop_back();
+  }
+}
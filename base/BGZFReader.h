@@ -0,0 +1,96 @@
+#ifndef _BGZFREADER_H_
+#define _BGZFREADER_H_
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Read a bgzipped file through an LRU cache of decompressed BGZF blocks,
+ * keyed by the compressed offsets of the blocks.
+ *
+ * Neighbouring tabix regions usually start in a block that the previous
+ * region has already decompressed; such blocks are copied from the cache
+ * instead of being read and inflated again.
+ *
+ * Offsets are virtual file offsets as in bgzf_tell(): compressed block
+ * offset << 16 | offset inside the decompressed block.
+ */
+class BGZFReader {
+ public:
+  /**
+   * @param cacheSize memory budget (in bytes) of decompressed blocks; the
+   * current block is always kept
+   */
+  explicit BGZFReader(size_t cacheSize = DefaultCacheSize);
+  ~BGZFReader();
+
+  /**
+   * @return 0 if succeed
+   */
+  int open(const std::string& fileName);
+  void close();
+  bool isOpened() const { return this->fp != NULL; }
+
+  /**
+   * Move to virtual file offset @param offset
+   * @return 0 if succeed
+   */
+  int seek(uint64_t offset);
+  uint64_t tell() const;
+  /**
+   * Read up to @param len bytes to @param buf
+   * @return number of bytes read; -1 if error happens
+   */
+  int read(void* buf, int len);
+  /**
+   * Read a line (without the trailing '\n') into @param line, same as
+   * bgzf_getline()
+   * @return false at file end or if error happens
+   */
+  bool readLine(std::string* line);
+
+  void setCacheSize(size_t cacheSize);
+  size_t getCacheSize() const { return this->cacheSize; }
+  uint64_t getCacheHit() const { return this->cacheHit; }
+  uint64_t getCacheMiss() const { return this->cacheMiss; }
+  /**
+   * @return the fraction of block loads served by the cache
+   */
+  double getCacheHitRate() const;
+
+  static const size_t DefaultCacheSize = 64 * 1024 * 1024;
+
+ private:
+  struct Block {
+    uint64_t address;      // compressed offset of the block
+    uint64_t nextAddress;  // compressed offset of the next block
+    std::string data;      // decompressed content (empty at file end)
+  };
+  /**
+   * Make the block at compressed offset @param address the current block
+   * @return 0 if succeed
+   */
+  int loadBlock(uint64_t address);
+  void evict();
+
+  // don't copy
+  BGZFReader(const BGZFReader&);
+  BGZFReader& operator=(const BGZFReader&);
+
+ private:
+  void* fp;  // BGZF*, kept opaque as tabix and samtools both define BGZF
+  size_t cacheSize;
+  size_t cacheUsed;
+  uint64_t cacheHit;
+  uint64_t cacheMiss;
+  // most recently used blocks come first
+  std::list<Block> blocks;
+  std::unordered_map<uint64_t, std::list<Block>::iterator> blockIndex;
+
+  const Block* block;  // current block
+  int blockOffset;     // next unread position in the current block
+};
+
+#endif /* _BGZFREADER_H_ */
@@ -0,0 +1,159 @@
+#include "CSIIndex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "BGZFReader.h"
+
+namespace {
+// read a little-endian value of type T from @param p
+template <typename T>
+bool take(const std::string& data, size_t* p, T* v) {
+  if (*p + sizeof(T) > data.size()) return false;
+  memcpy(v, data.data() + *p, sizeof(T));
+  *p += sizeof(T);
+  return true;
+}
+
+// same as hts_bin_first() and hts_bin_parent() in htslib
+inline uint32_t binFirst(int level) {
+  return ((1u << (level * 3)) - 1) / 7;
+}
+inline uint32_t binParent(uint32_t bin) { return (bin - 1) >> 3; }
+
+// same as reg2bins() in htslib: bins overlapping [beg, end)
+void reg2bins(int64_t beg, int64_t end, int minShift, int depth,
+              std::vector<uint32_t>* bins) {
+  bins->clear();
+  if (beg >= end) return;
+  int s = minShift + depth * 3;
+  if (end >= 1LL << s) end = 1LL << s;
+  --end;
+  for (int l = 0; l <= depth; s -= 3, ++l) {
+    const uint32_t t = binFirst(l);
+    for (int64_t k = t + (beg >> s); k <= t + (end >> s); ++k)
+      bins->push_back(k);
+  }
+}
+
+bool chunkLessThan(const CSIIndex::Chunk& a, const CSIIndex::Chunk& b) {
+  return a.first < b.first;
+}
+}  // namespace
+
+int CSIIndex::open(const std::string& fileName) {
+  this->binIndex.clear();
+
+  BGZFReader fp(0);
+  if (fp.open(fileName + ".csi")) {
+    return -1;
+  }
+  std::string data;
+  char buf[65536];
+  int n;
+  while ((n = fp.read(buf, sizeof(buf))) > 0) {
+    data.append(buf, n);
+  }
+  if (n < 0) {
+    return -1;
+  }
+
+  // same layout as written by hts_idx_save(), in little-endian
+  size_t p = 0;
+  int32_t auxLen, nRef;
+  if (data.compare(0, 4, "CSI\1", 4)) {
+    fprintf(stderr, "Wrong magic number in CSI index %s.csi\n",
+            fileName.c_str());
+    return -1;
+  }
+  p = 4;
+  if (!take(data, &p, &this->minShift) || !take(data, &p, &this->depth) ||
+      !take(data, &p, &auxLen) || p + auxLen > data.size()) {
+    return -1;
+  }
+  p += auxLen;  // names of reference sequences for tabix-style indices
+  if (!take(data, &p, &nRef)) return -1;
+
+  this->binIndex.resize(nRef);
+  for (int i = 0; i < nRef; ++i) {
+    int32_t nBin, nChunk;
+    uint32_t bin;
+    if (!take(data, &p, &nBin)) return -1;
+    for (int j = 0; j < nBin; ++j) {
+      if (!take(data, &p, &bin)) return -1;
+      Bin& b = this->binIndex[i][bin];
+      if (!take(data, &p, &b.loffset) || !take(data, &p, &nChunk)) return -1;
+      b.chunk.resize(nChunk);
+      for (int k = 0; k < nChunk; ++k) {
+        if (!take(data, &p, &b.chunk[k].first) ||
+            !take(data, &p, &b.chunk[k].second))
+          return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+int CSIIndex::query(int tid, int beg, int end,
+                    std::vector<Chunk>* chunk) const {
+  chunk->clear();
+  if (tid < 0 || tid >= (int)this->binIndex.size()) return -1;
+  if (beg < 0) beg = 0;
+  if (beg > end) return -1;
+
+  // same as hts_itr_query(): records before the first one overlapping the
+  // smallest indexed bin at @param beg cannot overlap the region
+  const std::map<uint32_t, Bin>& index = this->binIndex[tid];
+  std::map<uint32_t, Bin>::const_iterator b = index.end();
+  uint32_t bin = binFirst(this->depth) + (beg >> this->minShift);
+  do {
+    b = index.find(bin);
+    if (b != index.end()) break;
+    const uint32_t first = (binParent(bin) << 3) + 1;
+    if (bin > first) {
+      --bin;
+    } else {
+      bin = binParent(bin);
+    }
+  } while (bin);
+  if (bin == 0) b = index.find(bin);
+  const uint64_t minOffset = b != index.end() ? b->second.loffset : 0;
+
+  std::vector<uint32_t> bins;
+  reg2bins(beg, end, this->minShift, this->depth, &bins);
+  std::vector<Chunk>& off = *chunk;
+  for (size_t i = 0; i < bins.size(); ++i) {
+    b = index.find(bins[i]);
+    if (b == index.end()) continue;
+    const std::vector<Chunk>& c = b->second.chunk;
+    for (size_t j = 0; j < c.size(); ++j) {
+      if (c[j].second > minOffset) off.push_back(c[j]);
+    }
+  }
+  if (off.empty()) return 0;
+
+  std::sort(off.begin(), off.end(), chunkLessThan);
+  // resolve completely contained adjacent blocks
+  size_t l = 0;
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[l].second < off[i].second) off[++l] = off[i];
+  }
+  off.resize(l + 1);
+  // resolve overlaps between adjacent blocks
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[i - 1].second >= off[i].first) off[i - 1].second = off[i].first;
+  }
+  // merge adjacent blocks
+  l = 0;
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[l].second >> 16 == off[i].first >> 16) {
+      off[l].second = off[i].second;
+    } else {
+      off[++l] = off[i];
+    }
+  }
+  off.resize(l + 1);
+  return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef _CSIINDEX_H_
+#define _CSIINDEX_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Coordinate-sorted index (.csi), as written by "bcftools index".
+ *
+ * This follows hts_idx_load() and hts_itr_query() in htslib. Reference
+ * sequences are identified by their position in the contig dictionary of the
+ * indexed file, as the index does not store their names.
+ *
+ * Usage:
+ *   CSIIndex idx; idx.open(fileName);
+ *   std::vector<CSIIndex::Chunk> chunk; idx.query(tid, beg, end, &chunk);
+ *   then read records from each chunk, and keep those overlapping [beg, end)
+ */
+class CSIIndex {
+ public:
+  typedef std::pair<uint64_t, uint64_t> Chunk;  // begin and end offsets
+
+ public:
+  CSIIndex() : minShift(0), depth(0) {}
+  /**
+   * Load the index of @param fileName (fileName + ".csi")
+   * @return 0 if succeed
+   */
+  int open(const std::string& fileName);
+  /**
+   * Find the chunks of virtual file offsets that may hold records of
+   * reference @param tid overlapping [@param beg, @param end) (0-based, half
+   * open) to @param chunk
+   * @return 0 if succeed; -1 if @param tid is not indexed or the range is
+   * invalid
+   */
+  int query(int tid, int beg, int end, std::vector<Chunk>* chunk) const;
+
+ private:
+  struct Bin {
+    uint64_t loffset;  // smallest offset of records overlapping the bin
+    std::vector<Chunk> chunk;
+  };
+  int32_t minShift;
+  int32_t depth;
+  // per reference: bin => chunks
+  std::vector<std::map<uint32_t, Bin> > binIndex;
+};
+
+#endif /* _CSIINDEX_H_ */
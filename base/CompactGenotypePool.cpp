@@ -0,0 +1,226 @@
+#include "CompactGenotypePool.h"
+
+#include <stdio.h>
+#include <cassert>
+#include <cmath>
+
+CompactGenotypePool::CompactGenotypePool()
+    : headIndex_(0), numElementsInChunk_(0), numWord_(0) {}
+
+int CompactGenotypePool::allocate() {
+  if (spare_.empty()) {
+    chunks_.push_back(Chunk());
+  } else {
+    chunks_.push_back(Chunk());
+    chunks_.back().bits.swap(spare_.back().bits);
+    chunks_.back().q.swap(spare_.back().q);
+    spare_.pop_back();
+  }
+  Chunk& c = chunks_.back();
+  c.hardCall = true;
+  for (int i = 0; i < 4; ++i) {
+    c.table[i] = 0.f;
+    c.count[i] = 0;
+  }
+  c.count[0] = numElementsInChunk_;
+  c.offset = 0.f;
+  c.scale = 0.f;
+  c.sumQ = 0;
+  c.bits.assign(2 * numWord_, 0);
+  c.q.clear();
+  return headIndex_ + chunks_.size() - 1;
+}
+
+void CompactGenotypePool::deallocate(int idx) {
+  if (idx != headIndex_) {
+    fprintf(stderr,
+            "Cannot deallocate memory %d, headIndex = %d, tailIndex = %d\n",
+            idx, headIndex_, headIndex_ + (int)chunks_.size());
+    return;
+  }
+  spare_.push_back(Chunk());
+  spare_.back().bits.swap(chunks_.front().bits);
+  spare_.back().q.swap(chunks_.front().q);
+  chunks_.pop_front();
+  ++headIndex_;
+}
+
+void CompactGenotypePool::store(int idx, const float* values) {
+  Chunk& c = at(idx);
+  const size_t n = numElementsInChunk_;
+  if (n == 0) return;
+
+  // find up to 4 distinct values, the first value gets code 0
+  int numDistinct = 1;
+  c.table[0] = values[0];
+  for (size_t i = 1; i < n && numDistinct <= 4; ++i) {
+    int k = 0;
+    while (k < numDistinct && c.table[k] != values[i]) ++k;
+    if (k == numDistinct) {
+      if (numDistinct < 4) c.table[k] = values[i];
+      ++numDistinct;
+    }
+  }
+
+  if (numDistinct <= 4) {
+    c.hardCall = true;
+    for (int k = numDistinct; k < 4; ++k) {
+      c.table[k] = c.table[0];
+    }
+    for (int k = 0; k < 4; ++k) {
+      c.count[k] = 0;
+    }
+    c.bits.assign(2 * numWord_, 0);
+    c.q.clear();
+    for (size_t i = 0; i < n; ++i) {
+      int k = 0;
+      while (c.table[k] != values[i]) ++k;
+      ++c.count[k];
+      const uint64_t mask = (uint64_t)1 << (i & 63);
+      if (k & 1) c.bits[2 * (i >> 6)] |= mask;
+      if (k & 2) c.bits[2 * (i >> 6) + 1] |= mask;
+    }
+    return;
+  }
+
+  // quantize
+  c.hardCall = false;
+  c.bits.clear();
+  float minValue = values[0];
+  float maxValue = values[0];
+  for (size_t i = 1; i < n; ++i) {
+    if (values[i] < minValue) minValue = values[i];
+    if (values[i] > maxValue) maxValue = values[i];
+  }
+  c.offset = minValue;
+  c.scale = (maxValue - minValue) / 255.f;
+  c.q.resize(n);
+  c.sumQ = 0;
+  for (size_t i = 0; i < n; ++i) {
+    long v = lrintf((values[i] - minValue) / c.scale);
+    if (v < 0) v = 0;
+    if (v > 255) v = 255;
+    c.q[i] = (uint8_t)v;
+    c.sumQ += v;
+  }
+}
+
+void CompactGenotypePool::load(int idx, float* out) const {
+  const Chunk& c = at(idx);
+  const size_t n = numElementsInChunk_;
+  if (c.hardCall) {
+    for (size_t i = 0; i < n; ++i) {
+      const int lo = (c.bits[2 * (i >> 6)] >> (i & 63)) & 1;
+      const int hi = (c.bits[2 * (i >> 6) + 1] >> (i & 63)) & 1;
+      out[i] = c.table[lo | (hi << 1)];
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = c.offset + c.scale * c.q[i];
+    }
+  }
+}
+
+bool CompactGenotypePool::isHardCall(int idx) const {
+  return at(idx).hardCall;
+}
+
+double CompactGenotypePool::dot(int idx1, int idx2) const {
+  const Chunk& c1 = at(idx1);
+  const Chunk& c2 = at(idx2);
+  if (c1.hardCall && c2.hardCall) {
+    return dotHardCall(c1, c2);
+  }
+  if (!c1.hardCall && !c2.hardCall) {
+    return dotQuantized(c1, c2);
+  }
+  return c1.hardCall ? dotMixed(c1, c2) : dotMixed(c2, c1);
+}
+
+size_t CompactGenotypePool::size() const { return chunks_.size(); }
+
+void CompactGenotypePool::setChunkSize(const size_t s) {
+  numElementsInChunk_ = s;
+  numWord_ = (s + 63) / 64;
+  chunks_.clear();
+  spare_.clear();
+  headIndex_ = 0;
+}
+
+CompactGenotypePool::Chunk& CompactGenotypePool::at(int idx) {
+  assert(idx >= headIndex_ && idx < headIndex_ + (int)chunks_.size());
+  return chunks_[idx - headIndex_];
+}
+
+const CompactGenotypePool::Chunk& CompactGenotypePool::at(int idx) const {
+  assert(idx >= headIndex_ && idx < headIndex_ + (int)chunks_.size());
+  return chunks_[idx - headIndex_];
+}
+
+// write x = t[0] + sum_a d[a] * I(code == a), with d[a] = t[a] - t[0], then
+// x'y needs the code counts of x and y, and for a, b in {1, 2, 3} the
+// number of samples with code a in x and code b in y.
+double CompactGenotypePool::dotHardCall(const Chunk& c1,
+                                        const Chunk& c2) const {
+  long n[4][4] = {{0}};
+  for (size_t w = 0; w < numWord_; ++w) {
+    const uint64_t lo1 = c1.bits[2 * w];
+    const uint64_t hi1 = c1.bits[2 * w + 1];
+    const uint64_t lo2 = c2.bits[2 * w];
+    const uint64_t hi2 = c2.bits[2 * w + 1];
+    const uint64_t ind1[4] = {0, lo1 & ~hi1, hi1 & ~lo1, lo1 & hi1};
+    const uint64_t ind2[4] = {0, lo2 & ~hi2, hi2 & ~lo2, lo2 & hi2};
+    for (int a = 1; a < 4; ++a) {
+      if (!ind1[a]) continue;
+      for (int b = 1; b < 4; ++b) {
+        n[a][b] += __builtin_popcountll(ind1[a] & ind2[b]);
+      }
+    }
+  }
+
+  const double t1 = c1.table[0];
+  const double t2 = c2.table[0];
+  double ret = (double)numElementsInChunk_ * t1 * t2;
+  for (int a = 1; a < 4; ++a) {
+    const double d1 = (double)c1.table[a] - t1;
+    const double d2 = (double)c2.table[a] - t2;
+    ret += t2 * d1 * c1.count[a] + t1 * d2 * c2.count[a];
+    for (int b = 1; b < 4; ++b) {
+      ret += d1 * ((double)c2.table[b] - t2) * n[a][b];
+    }
+  }
+  return ret;
+}
+
+// x = o1 + s1 * q1, y = o2 + s2 * q2, so x'y reduces to integer sums
+double CompactGenotypePool::dotQuantized(const Chunk& c1,
+                                         const Chunk& c2) const {
+  const size_t n = numElementsInChunk_;
+  uint64_t sumQQ = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sumQQ += (uint32_t)c1.q[i] * c2.q[i];
+  }
+  return (double)n * c1.offset * c2.offset +
+         (double)c1.offset * c2.scale * c2.sumQ +
+         (double)c2.offset * c1.scale * c1.sumQ +
+         (double)c1.scale * c2.scale * (double)sumQQ;
+}
+
+double CompactGenotypePool::dotMixed(const Chunk& hard,
+                                     const Chunk& quant) const {
+  const size_t n = numElementsInChunk_;
+  // sum of q over samples of each code
+  uint64_t sumQ[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < n; ++i) {
+    const int lo = (hard.bits[2 * (i >> 6)] >> (i & 63)) & 1;
+    const int hi = (hard.bits[2 * (i >> 6) + 1] >> (i & 63)) & 1;
+    sumQ[lo | (hi << 1)] += quant.q[i];
+  }
+  double ret = 0.0;
+  for (int k = 0; k < 4; ++k) {
+    ret += (double)hard.table[k] *
+           ((double)quant.offset * hard.count[k] +
+            (double)quant.scale * (double)sumQ[k]);
+  }
+  return ret;
+}
@@ -0,0 +1,73 @@
+#ifndef _COMPACTGENOTYPEPOOL_H_
+#define _COMPACTGENOTYPEPOOL_H_
+
+#include <stdint.h>
+#include <cstddef>  // size_t definnition
+#include <deque>
+#include <vector>
+
+/**
+ * This class stores genotype vectors (one chunk per variant) compactly.
+ * Like RingMemoryPool, when allocate memory, you get a sereis of index:
+ * 0, 1, 2, 3..., and you will need to deallocate 0, 1, 2, 3, ... in the
+ * same order.
+ *
+ * A chunk with at most 4 distinct values (e.g. hard calls, possibly centered
+ * or with mean-imputed missing genotypes) is stored exactly as 2-bit codes
+ * and a 4-value table. Other chunks (e.g. dosages) are quantized to 8 bits as
+ * offset + scale * q, q = 0, 1, ..., 255, with scale = (max - min) / 255.
+ * Quantization is lossy: each value is rounded to the nearest level, an
+ * error of up to (max - min) / 510 (about 0.004 for dosages in [0, 2]).
+ */
+class CompactGenotypePool {
+ public:
+  CompactGenotypePool();
+  int allocate();
+  void deallocate(int idx);
+  /**
+   * Encode @param values (chunkSize elements) to chunk @param idx
+   */
+  void store(int idx, const float* values);
+  /**
+   * Decode chunk @param idx to @param out (chunkSize elements)
+   */
+  void load(int idx, float* out) const;
+  /**
+   * @return true if chunk @param idx is stored exactly as 2-bit codes
+   */
+  bool isHardCall(int idx) const;
+  /**
+   * @return inner product of chunk @param idx1 and chunk @param idx2.
+   * Hard-call chunks are multiplied by counting codes with popcount.
+   */
+  double dot(int idx1, int idx2) const;
+  size_t size() const;
+  // internal data will be reset
+  void setChunkSize(const size_t s);
+
+ private:
+  struct Chunk {
+    bool hardCall;
+    float table[4];  // value of each 2-bit code
+    int count[4];    // number of each 2-bit code
+    float offset;    // quantized value = offset + scale * q
+    float scale;
+    long sumQ;                   // sum of q
+    std::vector<uint64_t> bits;  // 2-bit codes as (low, high) bit planes
+    std::vector<uint8_t> q;      // 8-bit quantized values
+  };
+  Chunk& at(int idx);
+  const Chunk& at(int idx) const;
+  double dotHardCall(const Chunk& c1, const Chunk& c2) const;
+  double dotQuantized(const Chunk& c1, const Chunk& c2) const;
+  double dotMixed(const Chunk& hard, const Chunk& quant) const;
+
+ private:
+  std::deque<Chunk> chunks_;
+  std::vector<Chunk> spare_;  // deallocated chunks, for reusing memory
+  int headIndex_;             // index of chunks_.front()
+  size_t numElementsInChunk_;
+  size_t numWord_;  // number of 64-bit words in each bit plane
+};
+
+#endif /* _COMPACTGENOTYPEPOOL_H_ */
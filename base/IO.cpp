@@ -6,6 +6,12 @@
 #include "third/samtools/bgzf.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "base/TabixIndexBuilder.h"
 #include "base/Utils.h"
 
 //////////////////////////////////////////////////
@@ -273,7 +279,12 @@ class KnetFileReader : public AbstractFileReader {
 // BufferedReader
 //////////////////////////////////////////////////
 BufferedReader::BufferedReader(const char* fileName, int bufferCapacity)
-    : bufCap(0), bufEnd(0), bufPtr(0), buf(NULL), fp(NULL) {
+    : bufCap(0),
+      bufEnd(0),
+      bufPtr(0),
+      buf(NULL),
+      fp(NULL),
+      lineTerminated(true) {
 #ifdef IO_DEBUG
   fprintf(stderr, "BufferedReader open %s\n", fileName);
 #endif
@@ -287,7 +298,8 @@ BufferedReader::BufferedReader(const char* fileName, int bufferCapacity)
   } else {
     this->bufCap = (int)(bufferCapacity);
   }
-  this->buf = new char[this->bufCap];
+  // one extra byte to terminate a line ending at the buffer end
+  this->buf = new char[this->bufCap + 1];
   if (!this->buf) {
     fprintf(stderr, "Cannot allocate buffer for BufferedReader. - Exit!\n");
     exit(1);
@@ -428,97 +440,111 @@ int BufferedReader::read(void* pDest, int destLen) {
 #endif
 }
 
-int BufferedReader::search(int left, int right, const char* sep) {
-  assert(right <= bufEnd);
-  const char* p;
-  for (int i = left; i < right; ++i) {
-    p = ssechr(sep, buf[i]);
-    if (p != NULL) {
-      bufPtr = i + 1;
-      return i;
+bool BufferedReader::readLineView(char** line, int* len) {
+  assert(this->fp && line && len);
+
+  int lineBeg = bufPtr;
+  int scanBeg = bufPtr;
+  int lineEnd;
+  while (true) {
+    const char* p =
+        (const char*)memchr(buf + scanBeg, '\n', bufEnd - scanBeg);
+    if (p) {
+      lineEnd = p - buf;
+      bufPtr = lineEnd + 1;
+      lineTerminated = true;
+      break;
+    }
+
+    // the line continues past the buffered data: move the partial line to
+    // the front (or grow the buffer if it is already full) and read more
+    const int partial = bufEnd - lineBeg;
+    if (partial == bufCap) {
+      char* newBuf = new char[2 * bufCap + 1];
+      memcpy(newBuf, buf, partial);
+      delete[] buf;
+      buf = newBuf;
+      bufCap *= 2;
+    } else if (lineBeg > 0) {
+      memmove(buf, buf + lineBeg, partial);
     }
+    lineBeg = 0;
+    scanBeg = bufEnd = bufPtr = partial;
+    const int nRead = this->fp->read(buf + bufEnd, bufCap - bufEnd);
+    if (nRead <= 0) {  // file end
+      if (partial == 0) {
+        return false;
+      }
+      lineEnd = bufPtr = bufEnd;
+      lineTerminated = false;
+      break;
+    }
+    bufEnd += nRead;
   }
-  bufPtr = bufEnd;
-  assert(right == bufEnd);
-  return bufPtr;
-}
 
-int BufferedReader::search(int left, int right, const char* sep1,
-                           const char* sep2) {
-  assert(right <= bufEnd);
-  const char* p;
-  for (int i = left; i < right; ++i) {
-    p = ssechr(sep1, buf[i]);
-    if (p != NULL) {
-      bufPtr = i + 1;
-      return i;
-    }
-    p = ssechr(sep2, buf[i]);
-    if (p != NULL) {
-      bufPtr = i + 1;
-      return i;
-    }
-  }
-  bufPtr = bufEnd;
-  assert(right == bufEnd);
-  return bufPtr;
+  char* s = buf + lineBeg;
+  int n = lineEnd - lineBeg;
+  if (memchr(s, '\r', n)) {
+    n = std::remove(s, s + n, '\r') - s;
+  }
+  s[n] = '\0';
+  *line = s;
+  *len = n;
+  return true;
 }
 
 int BufferedReader::readLine(std::string* line) {
   assert(this->fp && line);
 
-  line->reserve(2048);
-  line->resize(0);
-
-  int oldPtr, ptr;
-  while (true) {
-    oldPtr = bufPtr;
-    ptr = search(bufPtr, bufEnd, "\r\n");
-    line->append(buf + oldPtr, ptr - oldPtr);
-    if (ptr == bufEnd) {  // not found
-      refill();
-      if (bufEnd == 0) {  // file end
-        return line->size();
-      }
-    } else if (buf[ptr] == '\r') {
-    } else if (buf[ptr] == '\n') {
-      return line->size();
-    }
+  char* s;
+  int n;
+  if (!readLineView(&s, &n)) {
+    line->resize(0);
+    return 0;
   }
-  assert(false);
-  return 0;
+  line->assign(s, n);
+  return n;
 }
 
 int BufferedReader::readLineBySep(std::vector<std::string>* fields,
                                   const char* sep) {
   assert(this->fp && fields && sep);
-  fields->reserve(128);
-  fields->resize(1);
-  fields->back().resize(0);
 
-  int oldPtr, ptr;
-  while (true) {
-    oldPtr = bufPtr;
-    ptr = search(bufPtr, bufEnd, sep, "\r\n");
-    std::string& field = fields->back();
-
-    field.append(buf + oldPtr, ptr - oldPtr);
-    if (ptr == bufEnd) {  // not found
-      refill();
-      if (bufEnd == 0) {               // reach file end
-        if (fields->back().empty()) {  // just appended an empty element
-          fields->resize(fields->size() - 1);
-        }
-        return fields->size();
-      }
-    } else if (ssechr(sep, buf[ptr])) {  // separator
-      fields->resize(fields->size() + 1);
-      fields->back().resize(0);
-    } else if (buf[ptr] == '\r') {
-    } else if (buf[ptr] == '\n') {
-      return fields->size();
-    }
+  const int nField = readLineViewBySep(&fieldView, sep);
+  fields->resize(nField);
+  for (int i = 0; i < nField; ++i) {
+    (*fields)[i].assign(fieldView[i]);
   }
+  return nField;
+}
+
+int BufferedReader::readLineViewBySep(std::vector<char*>* fields,
+                                      const char* sep) {
+  assert(this->fp && fields && sep);
+
+  char* s;
+  int n;
+  fields->resize(0);
+  if (!readLineView(&s, &n)) {
+    return 0;
+  }
+
+  bool isSep[256] = {false};
+  for (const char* p = sep; *p; ++p) {
+    isSep[(unsigned char)*p] = true;
+  }
+
+  fields->push_back(s);
+  for (int i = 0; i < n; ++i) {
+    if (!isSep[(unsigned char)s[i]]) continue;
+    s[i] = '\0';
+    fields->push_back(s + i + 1);
+  }
+  // an unterminated last line does not end with an empty field
+  if (!lineTerminated && *fields->back() == '\0') {
+    fields->pop_back();
+  }
+  return fields->size();
 }
 
 //////////////////////////////////////////////////
@@ -700,11 +726,77 @@ class BGZipFileWriter : public AbstractFileWriter {
   void close();
   int write(const char* s);
   int writeLine(const char* s);
+  int flush();
 
  private:
   BGZF* fp;
 };  // end BGZipFileWriter
 
+/**
+ * Write BGZF files like BGZipFileWriter (the output bytes are the same), but
+ * compress blocks in a pool of threads:
+ *  - the caller fills 64KB blocks, which are queued without waiting
+ *  - worker threads compress queued blocks in parallel, and write the
+ *    compressed blocks to the file in their original order
+ *  - flush() waits until all queued blocks are written; close() also writes
+ *    the BGZF EOF marker, so the file can be indexed by tabix
+ * With @param numThread = 0, blocks are compressed on the calling thread.
+ * With @param tabixIndex, a tabix index (fn + ".tbi") is built from the lines
+ * as they are written, and saved in close().
+ */
+class ParallelBGZipFileWriter : public AbstractFileWriter {
+ public:
+  ParallelBGZipFileWriter(const std::string& fn, int numThread,
+                          bool tabixIndex = false);
+  virtual ~ParallelBGZipFileWriter() {
+    this->close();
+    delete this->index;
+  }
+  int open(const char* fn, bool append = false);
+  void close();
+  int write(const char* s);
+  int writeLine(const char* s);
+  int flush();
+
+ private:
+  struct Block {
+    std::vector<uint8_t> data;        // uncompressed content
+    std::vector<uint8_t> compressed;  // one BGZF block
+    bool ready;                       // compressed
+  };
+  void submitBlock();
+  void workerLoop();
+  void compressQueuedBlock(Block* b);
+  void writeCompressedBlocks();
+  void indexBlock(const Block& b);
+  static int compressBlock(const uint8_t* src, int len,
+                           std::vector<uint8_t>* dst);
+
+ private:
+  // same block size as samtools bgzf, so compressBound(BlockSize) always
+  // fits in a block
+  static const int BlockSize = 0xff00;
+  static const int MaxBlockSize = 0x10000;
+  FILE* fp;
+  std::string fileName;
+  int numThread;
+  std::vector<std::thread> workers;
+  Block* current;                // block being filled
+  std::deque<Block*> queue;      // blocks to write, in order
+  size_t numClaimed;             // blocks in queue claimed by workers
+  std::vector<Block*> freeList;  // written blocks, for reuse
+  std::mutex lock;
+  std::mutex writeLock;  // serialize writes to fp
+  std::condition_variable hasWork;
+  std::condition_variable hasSpace;  // queue shrinks
+  bool stopping;
+  std::atomic<bool> hasError;  // set by workers and the writing thread
+  // below are only used while holding writeLock
+  uint64_t address;          // compressed bytes written
+  TabixIndexBuilder* index;  // NULL if not indexing
+  std::string partialLine;   // unfinished line of the indexed blocks
+};  // end ParallelBGZipFileWriter
+
 class StdoutWriter : public AbstractFileWriter {
  public:
   int open(const char* fn, bool append = false) { return 0; }
@@ -875,6 +967,16 @@ int removeEmptyField(std::vector<std::string>* fields) {
   return s;
 };
 
+static bool isEmptyField(const char* s) { return *s == '\0'; }
+
+int removeEmptyField(std::vector<char*>* fields) {
+  int s = fields->size();
+  fields->erase(std::remove_if(fields->begin(), fields->end(), isEmptyField),
+                fields->end());
+  s -= fields->size();
+  return s;
+};
+
 AbstractFileWriter::~AbstractFileWriter() {
 #ifdef IO_DEBUG
   fprintf(stderr, "AbstractFileWriter desc()\n");
@@ -904,6 +1006,295 @@ int BGZipFileWriter::writeLine(const char* s) {
   ret += bgzf_write(this->fp, "\n", 1);
   return (ret);
 };
+int BGZipFileWriter::flush() { return bgzf_flush(this->fp); }
+
+ParallelBGZipFileWriter::ParallelBGZipFileWriter(const std::string& fn,
+                                                 int numThread,
+                                                 bool tabixIndex)
+    : fp(NULL),
+      numThread(numThread < 0 ? 0 : numThread),
+      current(NULL),
+      numClaimed(0),
+      stopping(false),
+      hasError(false),
+      address(0),
+      index(tabixIndex ? new TabixIndexBuilder : NULL) {
+  if (this->open(fn.c_str())) {
+    fprintf(stderr, "Cannot create BGzip file %s\n", fn.c_str());
+  }
+}
+
+int ParallelBGZipFileWriter::open(const char* fn, bool append) {
+  if (append) fprintf(stderr, "Gzip does not support appending.\n");
+  this->fp = fopen(fn, "w");
+  if (!this->fp) {
+    fprintf(stderr, "ERROR: Cannot open %s for write\n", fn);
+    return -1;
+  }
+  this->fileName = fn;
+  if (this->index) {
+    // avoid leaving an outdated index if indexing fails
+    remove((this->fileName + ".tbi").c_str());
+  }
+  this->current = new Block;
+  this->current->data.reserve(BlockSize);
+  this->stopping = false;
+  for (int i = 0; i < this->numThread; ++i) {
+    this->workers.push_back(
+        std::thread(&ParallelBGZipFileWriter::workerLoop, this));
+  }
+  return 0;
+}
+
+void ParallelBGZipFileWriter::close() {
+  if (!this->fp) return;
+  this->flush();
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->stopping = true;
+  }
+  this->hasWork.notify_all();
+  for (size_t i = 0; i < this->workers.size(); ++i) {
+    this->workers[i].join();
+  }
+  this->workers.clear();
+
+  // an empty block marks the end of file
+  const uint64_t eofOffset = this->address << 16;
+  std::vector<uint8_t> eof;
+  if (compressBlock(NULL, 0, &eof) ||
+      fwrite(eof.data(), 1, eof.size(), this->fp) != eof.size()) {
+    this->hasError = true;
+  }
+  if (fclose(this->fp) || this->hasError) {
+    fprintf(stderr, "ERROR: Failed to write BGzip file\n");
+  }
+  this->fp = NULL;
+
+  if (this->index) {
+    if (!this->partialLine.empty()) {
+      this->index->addLine(this->partialLine, eofOffset);
+    }
+    if (this->hasError ||
+        this->index->save(this->fileName + ".tbi", eofOffset)) {
+      fprintf(stderr, "ERROR: Failed to create tabix index for %s\n",
+              this->fileName.c_str());
+    }
+    delete this->index;
+    this->index = NULL;
+  }
+
+  delete this->current;
+  this->current = NULL;
+  for (size_t i = 0; i < this->freeList.size(); ++i) {
+    delete this->freeList[i];
+  }
+  this->freeList.clear();
+}
+
+int ParallelBGZipFileWriter::write(const char* s) {
+  if (!this->fp) return -1;
+  int n = strlen(s);
+  const int ret = n;
+  while (n > 0) {
+    std::vector<uint8_t>& d = this->current->data;
+    const int len = std::min(n, BlockSize - (int)d.size());
+    d.insert(d.end(), s, s + len);
+    s += len;
+    n -= len;
+    if ((int)d.size() == BlockSize) {
+      this->submitBlock();
+    }
+  }
+  return ret;
+}
+
+int ParallelBGZipFileWriter::writeLine(const char* s) {
+  int ret = this->write(s);
+  ret += this->write("\n");
+  return ret;
+}
+
+int ParallelBGZipFileWriter::flush() {
+  if (!this->fp) return -1;
+  if (!this->current->data.empty()) {
+    this->submitBlock();
+  }
+  std::unique_lock<std::mutex> guard(this->lock);
+  while (!this->queue.empty()) {
+    this->hasSpace.wait(guard);
+  }
+  guard.unlock();
+  std::lock_guard<std::mutex> writeGuard(this->writeLock);
+  return (fflush(this->fp) || this->hasError) ? -1 : 0;
+}
+
+void ParallelBGZipFileWriter::submitBlock() {
+  Block* b = this->current;
+  Block* next = NULL;
+  {
+    std::unique_lock<std::mutex> guard(this->lock);
+    // bound the memory used by blocks not written yet
+    while (this->queue.size() >= 4 * (size_t)this->numThread &&
+           !this->workers.empty()) {
+      this->hasSpace.wait(guard);
+    }
+    b->ready = false;
+    this->queue.push_back(b);
+    if (this->workers.empty()) {
+      ++this->numClaimed;
+    }
+    if (!this->freeList.empty()) {
+      next = this->freeList.back();
+      this->freeList.pop_back();
+    }
+  }
+  if (this->workers.empty()) {
+    this->compressQueuedBlock(b);
+    this->writeCompressedBlocks();
+  } else {
+    this->hasWork.notify_one();
+  }
+  if (!next) {
+    next = new Block;
+    next->data.reserve(BlockSize);
+  }
+  next->data.clear();
+  this->current = next;
+}
+
+void ParallelBGZipFileWriter::workerLoop() {
+  while (true) {
+    Block* b;
+    {
+      std::unique_lock<std::mutex> guard(this->lock);
+      while (!this->stopping && this->numClaimed == this->queue.size()) {
+        this->hasWork.wait(guard);
+      }
+      if (this->numClaimed == this->queue.size()) {
+        return;  // stopping, and no work left
+      }
+      b = this->queue[this->numClaimed++];
+    }
+    this->compressQueuedBlock(b);
+    this->writeCompressedBlocks();
+  }
+}
+
+void ParallelBGZipFileWriter::compressQueuedBlock(Block* b) {
+  b->compressed.clear();
+  const int ret = compressBlock(b->data.data(), b->data.size(), &b->compressed);
+  std::lock_guard<std::mutex> guard(this->lock);
+  b->ready = true;
+  if (ret) {
+    b->compressed.clear();
+    this->hasError = true;
+  }
+}
+
+void ParallelBGZipFileWriter::writeCompressedBlocks() {
+  // only one thread writes, and it always writes the front of the queue
+  std::lock_guard<std::mutex> writeGuard(this->writeLock);
+  while (true) {
+    Block* b;
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      if (this->queue.empty() || !this->queue.front()->ready) {
+        break;
+      }
+      b = this->queue.front();
+    }
+    if (fwrite(b->compressed.data(), 1, b->compressed.size(), this->fp) !=
+        b->compressed.size()) {
+      this->hasError = true;
+    }
+    if (this->index) {
+      this->indexBlock(*b);
+    }
+    this->address += b->compressed.size();
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      this->queue.pop_front();
+      --this->numClaimed;
+      this->freeList.push_back(b);
+    }
+    this->hasSpace.notify_all();
+  }
+}
+
+/**
+ * Add lines ending in @param b to the index. The virtual offset after a line
+ * is the same as what bgzf_tell() gives after reading that line, i.e. the
+ * start of the next block if the line ends the block.
+ */
+void ParallelBGZipFileWriter::indexBlock(const Block& b) {
+  const char* data = (const char*)b.data.data();
+  const size_t len = b.data.size();
+  const uint64_t nextBlock = (this->address + b.compressed.size()) << 16;
+  size_t beg = 0;
+  while (beg < len) {
+    const char* p = (const char*)memchr(data + beg, '\n', len - beg);
+    if (!p) {
+      this->partialLine.append(data + beg, len - beg);
+      break;
+    }
+    const size_t end = p - data;
+    this->partialLine.append(data + beg, end - beg);
+    const uint64_t offset =
+        end + 1 == len ? nextBlock : (this->address << 16 | (end + 1));
+    this->index->addLine(this->partialLine, offset);
+    this->partialLine.clear();
+    beg = end + 1;
+  }
+}
+
+/**
+ * Compress @param len bytes of @param src to a BGZF block appended to
+ * @param dst, the same way as bgzf_write() in samtools.
+ * @return 0 if succeed
+ */
+int ParallelBGZipFileWriter::compressBlock(const uint8_t* src, int len,
+                                           std::vector<uint8_t>* dst) {
+  static const uint8_t header[18] = {31, 139, 8, 4, 0,   0, 0, 0, 0,
+                                     255, 6,  0, 'B', 'C', 2, 0, 0, 0};
+  const int headerLength = 18;
+  const int footerLength = 8;
+  const size_t offset = dst->size();
+  dst->resize(offset + MaxBlockSize);
+  uint8_t* out = dst->data() + offset;
+  z_stream zs;
+  zs.zalloc = NULL;
+  zs.zfree = NULL;
+  zs.opaque = NULL;
+  zs.next_in = (Bytef*)src;
+  zs.avail_in = len;
+  zs.next_out = out + headerLength;
+  zs.avail_out = MaxBlockSize - headerLength - footerLength;
+  // -15: raw deflate without zlib header/footer
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return -1;
+  }
+  if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+    deflateEnd(&zs);
+    return -1;
+  }
+  if (deflateEnd(&zs) != Z_OK) return -1;
+  const int blockLength = zs.total_out + headerLength + footerLength;
+
+  // integers are little-endian
+  memcpy(out, header, headerLength);
+  out[16] = (blockLength - 1) & 0xFF;
+  out[17] = (blockLength - 1) >> 8;
+  const uint32_t crc = crc32(crc32(0L, NULL, 0L), src, len);
+  uint8_t* footer = out + blockLength - footerLength;
+  for (int i = 0; i < 4; ++i) {
+    footer[i] = (crc >> (8 * i)) & 0xFF;
+    footer[4 + i] = ((uint32_t)len >> (8 * i)) & 0xFF;
+  }
+  dst->resize(offset + blockLength);
+  return 0;
+}
 
 bool fileExists(std::string fn) {
   FILE* fp = fopen(fn.c_str(), "r");
@@ -939,7 +1330,8 @@ FileWriter::FileWriter(const std::string& fileName, bool append) {
   this->createBuffer();
 }
 
-FileWriter::FileWriter(const std::string& fileName, FileType t) {
+FileWriter::FileWriter(const std::string& fileName, FileType t,
+                       int numThread, bool tabixIndex) {
   if (fileName == "stdout") {
     this->fp = new StdoutWriter();
     this->fpRaw = NULL;
@@ -954,6 +1346,9 @@ FileWriter::FileWriter(const std::string& fileName, FileType t) {
     this->fpRaw = new GzipFileWriter(fileName, append);
   } else if (BZIP2 == t) {
     this->fpRaw = new Bzip2FileWriter(fileName, append);
+  } else if (BGZIP == t && (numThread > 0 || tabixIndex)) {
+    this->fpRaw =
+        new ParallelBGZipFileWriter(fileName, numThread, tabixIndex);
   } else if (BGZIP == t) {
     this->fpRaw = new BGZipFileWriter(fileName, append);
   } else {
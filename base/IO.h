@@ -86,15 +86,24 @@ class BufferedReader : public AbstractFileReader {
   // @param dest.
   // return number of characters read (0: file end or @param len <= 0)
   int read(void* dest, int len);
+  // Read a line without copying it out of the buffer.
+  // @param line will point to the '\0'-terminated line ('\r' and '\n'
+  // removed) of @param len characters. The line may be modified in place and
+  // is valid until the next read.
+  // return false at file end
+  bool readLineView(char** line, int* len);
   // return number of characters read (0: file end)
   int readLine(std::string* line);
   // return chars read (0: file end)
   int readLineBySep(std::vector<std::string>* fields, const char* sep);
+  // zero-copy version of readLineBySep(): the line from readLineView() is
+  // split in place, and each field in @param fields is a '\0'-terminated
+  // pointer into the buffer, valid until the next read.
+  // return number of fields (0: file end)
+  int readLineViewBySep(std::vector<char*>* fields, const char* sep);
 
  private:
   void refill();
-  int search(int left, int right, const char* sep);
-  int search(int left, int right, const char* sep1, const char* sep2);
 
  private:
   int bufCap;  // capacity of the buffer
@@ -102,6 +111,8 @@ class BufferedReader : public AbstractFileReader {
   int bufPtr;  // points to next unread character
   char* buf;   // [0...bufEnd)
   AbstractFileReader* fp;
+  bool lineTerminated;  // whether the last line read ends with '\n'
+  std::vector<char*> fieldView;  // used by readLineBySep()
 };  // end BufferedReader
 
 /** Example code:
@@ -140,6 +151,12 @@ class LineReader {
     fprintf(stderr, "LineReader close\n");
 #endif
   }
+  // zero-copy version of readLine(), see BufferedReader::readLineView()
+  // return false at file end
+  bool readLineView(char** line, int* len) {
+    assert(this->fp && line && len);
+    return this->fp->readLineView(line, len);
+  }
   // return number of characters read.
   // when reading an empty line, will return 1, as we read '\n', however, line
   // will be empty
@@ -157,6 +174,13 @@ class LineReader {
     assert(this->fp && fields && sep);
     return this->fp->readLineBySep(fields, sep);
   }
+  // zero-copy version of readLineBySep(), see
+  // BufferedReader::readLineViewBySep()
+  // return number of fields read (0: file end)
+  int readLineViewBySep(std::vector<char*>* fields, const char* sep) {
+    assert(this->fp && fields && sep);
+    return this->fp->readLineViewBySep(fields, sep);
+  }
 
  private:
   BufferedReader* fp;
@@ -166,6 +190,7 @@ class LineReader {
  * @return number of empty elements filtered out
  */
 extern int removeEmptyField(std::vector<std::string>* fields);
+extern int removeEmptyField(std::vector<char*>* fields);
 
 //////////////////////////////////////////////////////////////////////
 // FileWriter related classes
@@ -176,6 +201,8 @@ class AbstractFileWriter {
   virtual void close() = 0;
   virtual int write(const char* s) = 0;
   virtual int writeLine(const char* s) = 0;
+  /// write out buffered contents; @return 0 if succeed
+  virtual int flush() { return 0; }
   virtual ~AbstractFileWriter() = 0;
 };
 
@@ -192,7 +219,15 @@ class AbstractFileWriter {
 class FileWriter {
  public:
   FileWriter(const std::string& fileName, bool append = false);
-  FileWriter(const std::string& fileName, FileType t);
+  /**
+   * When @param numThread > 0 and @param t is BGZIP, blocks are compressed
+   * asynchronously by @param numThread threads and written in order.
+   * When @param tabixIndex is true and @param t is BGZIP, a tabix index
+   * (fileName + ".tbi", same as tabixIndexFile() with default settings) is
+   * created while writing, and saved when the file is closed.
+   */
+  FileWriter(const std::string& fileName, FileType t, int numThread = 0,
+             bool tabixIndex = false);
   void createBuffer() {
     // create buffer for formatted string
     this->bufLen = 1024;
@@ -232,6 +267,16 @@ class FileWriter {
     this->fp->write("\n");
     return (ret + 1);
   }
+  /**
+   * Write out all contents so far, e.g. compressed blocks are on disk
+   */
+  int flush() {
+    int ret = this->fp->flush();
+    if (this->fpRaw) {
+      ret |= this->fpRaw->flush();
+    }
+    return ret;
+  }
   // if @param fileName ends with @param suffix, then return true;
   static bool checkSuffix(const char* fileName, const char* suffix) {
     int lf = strlen(fileName);
@@ -0,0 +1,524 @@
+#include "MetaCovBinary.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "base/TypeConversion.h"
+
+static const char kMagic[8] = {'R', 'V', 'M', 'C', 'O', 'V', 1, 0};
+static const char kIndexMagic[8] = {'R', 'V', 'M', 'C', 'I', 'D', 'X', 0};
+static const uint32_t kVersion = 1;
+static const uint32_t kFlagHalf = 1;
+// records are compressed in blocks of about this size
+static const size_t kBlockSize = 1 << 18;
+
+namespace {
+
+void putVarint(uint32_t v, std::string* s) {
+  while (v >= 0x80) {
+    s->push_back((char)((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  s->push_back((char)v);
+}
+
+void putSignedVarint(int32_t v, std::string* s) {
+  // zigzag encoding, so small negative numbers are short as well
+  putVarint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31), s);
+}
+
+bool getVarint(const std::string& s, size_t* pos, uint32_t* v) {
+  uint32_t ret = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*pos >= s.size()) return false;
+    const uint8_t c = (uint8_t)s[(*pos)++];
+    ret |= (uint32_t)(c & 0x7F) << shift;
+    if (!(c & 0x80)) {
+      *v = ret;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool getSignedVarint(const std::string& s, size_t* pos, int32_t* v) {
+  uint32_t u;
+  if (!getVarint(s, pos, &u)) return false;
+  *v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+  return true;
+}
+
+// IEEE 754 binary16, round to nearest even
+uint16_t floatToHalf(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  const uint16_t sign = (x >> 16) & 0x8000;
+  const int exponent = (int)((x >> 23) & 0xFF) - 127 + 15;
+  uint32_t mantissa = x & 0x7FFFFF;
+
+  if (((x >> 23) & 0xFF) == 0xFF) {  // inf or nan
+    return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+  }
+  if (exponent >= 0x1F) {  // overflow
+    return sign | 0x7C00;
+  }
+  if (exponent <= 0) {  // subnormal or zero
+    if (exponent < -10) return sign;
+    mantissa |= 0x800000;
+    const int shift = 14 - exponent;
+    uint32_t h = mantissa >> shift;
+    const uint32_t rest = mantissa & ((1u << shift) - 1);
+    const uint32_t half = 1u << (shift - 1);
+    if (rest > half || (rest == half && (h & 1))) ++h;
+    return sign | (uint16_t)h;
+  }
+  uint32_t h = ((uint32_t)exponent << 10) | (mantissa >> 13);
+  const uint32_t rest = mantissa & 0x1FFF;
+  if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) ++h;  // may carry to inf
+  return sign | (uint16_t)h;
+}
+
+float halfToFloat(uint16_t h) {
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1F;
+  uint32_t mantissa = h & 0x3FF;
+  uint32_t x;
+  if (exponent == 0x1F) {
+    x = sign | 0x7F800000 | (mantissa << 13);
+  } else if (exponent == 0) {
+    if (mantissa == 0) {
+      x = sign;
+    } else {
+      // normalize the subnormal number
+      exponent = 127 - 15 + 1;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      x = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+  } else {
+    x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// store byte k of every element together: [b0 b0 ...][b1 b1 ...]...
+void appendShuffled(const uint8_t* data, size_t n, size_t width,
+                    std::string* s) {
+  const size_t offset = s->size();
+  s->resize(offset + n * width);
+  char* out = &(*s)[offset];
+  for (size_t k = 0; k < width; ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      out[k * n + i] = data[i * width + k];
+    }
+  }
+}
+
+bool readShuffled(const std::string& s, size_t* pos, size_t n, size_t width,
+                  uint8_t* data) {
+  if (*pos + n * width > s.size()) return false;
+  const char* in = s.data() + *pos;
+  for (size_t k = 0; k < width; ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      data[i * width + k] = in[k * n + i];
+    }
+  }
+  *pos += n * width;
+  return true;
+}
+
+template <class T>
+void appendRaw(const std::vector<T>& v, std::string* s) {
+  if (v.empty()) return;
+  s->append((const char*)v.data(), v.size() * sizeof(T));
+}
+
+template <class T>
+bool readRaw(const std::string& s, size_t* pos, size_t n, std::vector<T>* v) {
+  if (*pos + n * sizeof(T) > s.size()) return false;
+  v->resize(n);
+  if (n) {
+    memcpy(v->data(), s.data() + *pos, n * sizeof(T));
+  }
+  *pos += n * sizeof(T);
+  return true;
+}
+
+template <class T>
+bool writeValue(FILE* fp, T v) {
+  return fwrite(&v, sizeof(T), 1, fp) == 1;
+}
+
+template <class T>
+bool readValue(FILE* fp, T* v) {
+  return fread(v, sizeof(T), 1, fp) == 1;
+}
+
+}  // namespace
+
+void appendMetaCovText(const MetaCovRecord& r, std::string* out) {
+  std::string& s = *out;
+  s += r.chrom;
+  s += '\t';
+  appendToString(r.getStartPos(), &s);
+  s += '\t';
+  appendToString(r.getEndPos(), &s);
+  s += '\t';
+  appendToString((int)r.position.size(), &s);
+  s += '\t';
+  for (size_t i = 0; i < r.position.size(); ++i) {
+    if (i) s += ',';
+    appendToString(r.position[i], &s);
+  }
+  s += '\t';
+  for (size_t i = 0; i < r.covXX.size(); ++i) {
+    if (i) s += ',';
+    appendFloatToString(r.covXX[i], &s);
+  }
+  if (r.hasCovariate) {
+    s += ':';
+    for (size_t i = 0; i < r.covXZ.size(); ++i) {
+      if (i) s += ',';
+      appendFloatToString(r.covXZ[i], &s);
+    }
+    s += ':';
+    for (size_t i = 0; i < r.covZZ.size(); ++i) {
+      if (i) s += ',';
+      appendFloatToString(r.covZZ[i], &s);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// MetaCovBinaryWriter
+MetaCovBinaryWriter::MetaCovBinaryWriter()
+    : fp(NULL),
+      useHalf(false),
+      blockChrom(-1),
+      blockStart(0),
+      blockEnd(0),
+      lastStart(0) {}
+
+MetaCovBinaryWriter::~MetaCovBinaryWriter() { close(); }
+
+int MetaCovBinaryWriter::open(const std::string& fileName, bool useHalf) {
+  close();
+  this->fp = fopen(fileName.c_str(), "wb");
+  if (!this->fp) {
+    return -1;
+  }
+  this->useHalf = useHalf;
+  fwrite(kMagic, 1, sizeof(kMagic), fp);
+  writeValue(fp, kVersion);
+  writeValue(fp, useHalf ? kFlagHalf : (uint32_t)0);
+  chroms.clear();
+  index.clear();
+  block.clear();
+  blockChrom = -1;
+  return 0;
+}
+
+int MetaCovBinaryWriter::getChromIndex(const std::string& chrom) {
+  // most records are on the chromosome of the current block
+  if (blockChrom >= 0 && chroms[blockChrom] == chrom) {
+    return blockChrom;
+  }
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    if (chroms[i] == chrom) return i;
+  }
+  chroms.push_back(chrom);
+  return chroms.size() - 1;
+}
+
+void MetaCovBinaryWriter::write(const MetaCovRecord& r) {
+  if (!fp || r.position.empty()) return;
+  const int chrom = getChromIndex(r.chrom);
+  if (chrom != blockChrom || block.size() >= kBlockSize) {
+    flushBlock();
+    blockChrom = chrom;
+    blockStart = r.getStartPos();
+    blockEnd = r.getStartPos();
+    lastStart = 0;
+  }
+  if (r.getStartPos() < blockStart) blockStart = r.getStartPos();
+  if (r.getStartPos() > blockEnd) blockEnd = r.getStartPos();
+
+  const size_t n = r.position.size();
+  putSignedVarint(r.getStartPos() - lastStart, &block);
+  lastStart = r.getStartPos();
+  putVarint(n, &block);
+  for (size_t i = 1; i < n; ++i) {
+    putSignedVarint(r.position[i] - r.position[i - 1], &block);
+  }
+
+  const size_t nXX = r.covXX.size();
+  putVarint(nXX, &block);
+  if (useHalf) {
+    shuffleBuffer.resize(nXX * sizeof(uint16_t));
+    uint16_t* h = (uint16_t*)shuffleBuffer.data();
+    for (size_t i = 0; i < nXX; ++i) {
+      h[i] = floatToHalf(r.covXX[i]);
+    }
+    appendShuffled(shuffleBuffer.data(), nXX, sizeof(uint16_t), &block);
+  } else {
+    appendShuffled((const uint8_t*)r.covXX.data(), nXX, sizeof(float), &block);
+  }
+
+  // 0: no covariate part; otherwise 1 + number of covariates
+  if (!r.hasCovariate) {
+    putVarint(0, &block);
+  } else {
+    putVarint(1 + r.covXZ.size(), &block);
+    putVarint(r.covZZ.size(), &block);
+    appendRaw(r.covXZ, &block);
+    appendRaw(r.covZZ, &block);
+  }
+}
+
+void MetaCovBinaryWriter::flushBlock() {
+  if (block.empty()) return;
+
+  uLongf len = compressBound(block.size());
+  compressed.resize(len);
+  if (compress2(compressed.data(), &len, (const Bytef*)block.data(),
+                block.size(), Z_BEST_SPEED) != Z_OK) {
+    fprintf(stderr, "Failed to compress MetaCov block\n");
+    block.clear();
+    return;
+  }
+
+  BlockIndex b;
+  b.chrom = blockChrom;
+  b.start = blockStart;
+  b.end = blockEnd;
+  b.offset = ftello(fp);
+  index.push_back(b);
+
+  writeValue(fp, (uint32_t)len);
+  writeValue(fp, (uint32_t)block.size());
+  fwrite(compressed.data(), 1, len, fp);
+  block.clear();
+}
+
+void MetaCovBinaryWriter::close() {
+  if (!fp) return;
+  flushBlock();
+
+  const uint64_t indexOffset = ftello(fp);
+  writeValue(fp, (uint32_t)chroms.size());
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    writeValue(fp, (uint32_t)chroms[i].size());
+    fwrite(chroms[i].data(), 1, chroms[i].size(), fp);
+  }
+  writeValue(fp, (uint64_t)index.size());
+  for (size_t i = 0; i < index.size(); ++i) {
+    writeValue(fp, index[i].chrom);
+    writeValue(fp, index[i].start);
+    writeValue(fp, index[i].end);
+    writeValue(fp, index[i].offset);
+  }
+  writeValue(fp, indexOffset);
+  fwrite(kIndexMagic, 1, sizeof(kIndexMagic), fp);
+  fclose(fp);
+  fp = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////
+// MetaCovBinaryReader
+MetaCovBinaryReader::MetaCovBinaryReader()
+    : fp(NULL),
+      useHalf(false),
+      hasRegion(false),
+      regionChrom(-1),
+      regionBeg(0),
+      regionEnd(0),
+      nextBlock(0),
+      blockPos(0),
+      blockChrom(-1),
+      lastStart(0) {}
+
+MetaCovBinaryReader::~MetaCovBinaryReader() { close(); }
+
+int MetaCovBinaryReader::open(const std::string& fileName) {
+  close();
+  fp = fopen(fileName.c_str(), "rb");
+  if (!fp) {
+    return -1;
+  }
+
+  char magic[8];
+  uint32_t version, flags;
+  if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+      memcmp(magic, kMagic, sizeof(magic)) || !readValue(fp, &version) ||
+      version != kVersion || !readValue(fp, &flags)) {
+    fprintf(stderr, "[ %s ] is not a binary MetaCov file\n", fileName.c_str());
+    close();
+    return -1;
+  }
+  useHalf = (flags & kFlagHalf) != 0;
+
+  // load index from the footer
+  uint64_t indexOffset;
+  if (fseeko(fp, -(off_t)(sizeof(indexOffset) + sizeof(kIndexMagic)),
+             SEEK_END) ||
+      !readValue(fp, &indexOffset) ||
+      fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+      memcmp(magic, kIndexMagic, sizeof(magic)) ||
+      fseeko(fp, indexOffset, SEEK_SET)) {
+    fprintf(stderr, "Binary MetaCov file [ %s ] is truncated\n",
+            fileName.c_str());
+    close();
+    return -1;
+  }
+  uint32_t numChrom;
+  readValue(fp, &numChrom);
+  chroms.resize(numChrom);
+  for (uint32_t i = 0; i < numChrom; ++i) {
+    uint32_t len = 0;
+    readValue(fp, &len);
+    chroms[i].resize(len);
+    if (len && fread(&chroms[i][0], 1, len, fp) != len) break;
+  }
+  uint64_t numBlock = 0;
+  readValue(fp, &numBlock);
+  index.resize(numBlock);
+  for (uint64_t i = 0; i < numBlock; ++i) {
+    readValue(fp, &index[i].chrom);
+    readValue(fp, &index[i].start);
+    readValue(fp, &index[i].end);
+    if (!readValue(fp, &index[i].offset)) {
+      fprintf(stderr, "Binary MetaCov file [ %s ] has a corrupted index\n",
+              fileName.c_str());
+      close();
+      return -1;
+    }
+  }
+
+  hasRegion = false;
+  nextBlock = 0;
+  block.clear();
+  blockPos = 0;
+  return 0;
+}
+
+void MetaCovBinaryReader::close() {
+  if (fp) {
+    fclose(fp);
+    fp = NULL;
+  }
+  chroms.clear();
+  index.clear();
+}
+
+void MetaCovBinaryReader::setRegion(const std::string& chrom, int beg,
+                                    int end) {
+  hasRegion = true;
+  regionChrom = -1;
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    if (chroms[i] == chrom) {
+      regionChrom = i;
+      break;
+    }
+  }
+  regionBeg = beg;
+  regionEnd = end;
+  nextBlock = 0;
+  block.clear();
+  blockPos = 0;
+}
+
+bool MetaCovBinaryReader::loadBlock(size_t blockIdx) {
+  if (fseeko(fp, index[blockIdx].offset, SEEK_SET)) return false;
+  uint32_t len, rawLen;
+  if (!readValue(fp, &len) || !readValue(fp, &rawLen)) return false;
+  compressed.resize(len);
+  if (fread(compressed.data(), 1, len, fp) != len) return false;
+  block.resize(rawLen);
+  uLongf destLen = rawLen;
+  if (uncompress((Bytef*)&block[0], &destLen, compressed.data(), len) !=
+          Z_OK ||
+      destLen != rawLen) {
+    fprintf(stderr, "Failed to decompress MetaCov block\n");
+    return false;
+  }
+  blockPos = 0;
+  blockChrom = index[blockIdx].chrom;
+  lastStart = 0;
+  return true;
+}
+
+bool MetaCovBinaryReader::readRecord(MetaCovRecord* r) {
+  if (!fp) return false;
+  while (true) {
+    if (blockPos >= block.size()) {
+      // skip blocks outside of the region
+      while (nextBlock < index.size() && hasRegion &&
+             ((int)index[nextBlock].chrom != regionChrom ||
+              index[nextBlock].start > regionEnd ||
+              index[nextBlock].end < regionBeg)) {
+        ++nextBlock;
+      }
+      if (nextBlock >= index.size()) return false;
+      if (!loadBlock(nextBlock++)) return false;
+    }
+    if (!decodeRecord(r)) {
+      fprintf(stderr, "Corrupted MetaCov record\n");
+      return false;
+    }
+    if (!hasRegion ||
+        (r->getStartPos() >= regionBeg && r->getStartPos() <= regionEnd)) {
+      return true;
+    }
+  }
+}
+
+bool MetaCovBinaryReader::decodeRecord(MetaCovRecord* r) {
+  int32_t delta;
+  uint32_t n;
+  if (!getSignedVarint(block, &blockPos, &delta) ||
+      !getVarint(block, &blockPos, &n) || n == 0) {
+    return false;
+  }
+  r->chrom = chroms[blockChrom];
+  r->position.resize(n);
+  lastStart += delta;
+  r->position[0] = lastStart;
+  for (uint32_t i = 1; i < n; ++i) {
+    if (!getSignedVarint(block, &blockPos, &delta)) return false;
+    r->position[i] = r->position[i - 1] + delta;
+  }
+
+  uint32_t nXX;
+  if (!getVarint(block, &blockPos, &nXX)) return false;
+  r->covXX.resize(nXX);
+  if (useHalf) {
+    std::vector<uint16_t> h(nXX);
+    if (!readShuffled(block, &blockPos, nXX, sizeof(uint16_t),
+                      (uint8_t*)h.data())) {
+      return false;
+    }
+    for (uint32_t i = 0; i < nXX; ++i) {
+      r->covXX[i] = halfToFloat(h[i]);
+    }
+  } else if (!readShuffled(block, &blockPos, nXX, sizeof(float),
+                           (uint8_t*)r->covXX.data())) {
+    return false;
+  }
+
+  uint32_t nXZ, nZZ;
+  if (!getVarint(block, &blockPos, &nXZ)) return false;
+  r->hasCovariate = nXZ > 0;
+  if (nXZ == 0) {
+    r->covXZ.clear();
+    r->covZZ.clear();
+    return true;
+  }
+  --nXZ;
+  return getVarint(block, &blockPos, &nZZ) &&
+         readRaw(block, &blockPos, nXZ, &r->covXZ) &&
+         readRaw(block, &blockPos, nZZ, &r->covZZ);
+}
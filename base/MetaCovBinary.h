@@ -0,0 +1,128 @@
+#ifndef _METACOVBINARY_H_
+#define _METACOVBINARY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Binary, indexed storage of MetaCov results.
+ *
+ * Each record is one row of the text format: the covariances between the
+ * first marker of a window and all markers in the window.
+ *
+ * File layout (integers in host byte order, i.e. little-endian on x86):
+ *   magic "RVMCOV\1\0", uint32 version, uint32 flags
+ *   blocks: uint32 compressed size, uint32 raw size, deflated records
+ *   index: chromosome names, then for each block its chromosome, smallest
+ *          and largest START_POS and file offset
+ *   footer: uint64 index offset, magic "RVMCIDX\0"
+ * Records in a block share one chromosome. Positions are delta-encoded
+ * varints; covariances are stored as float32 (or float16) with the bytes of
+ * the same significance grouped together to help compression.
+ */
+struct MetaCovRecord {
+  MetaCovRecord() : hasCovariate(false) {}
+  std::string chrom;
+  std::vector<int> position;  // MARKER_POS
+  std::vector<float> covXX;   // already scaled by 1/N
+  bool hasCovariate;          // whether covXZ and covZZ are printed
+  std::vector<float> covXZ;   // already scaled by 1/N
+  std::vector<double> covZZ;  // lower triangle, row by row
+  int getStartPos() const { return position.front(); }
+  int getEndPos() const { return position.back(); }
+};
+
+/**
+ * Append @param r to @param out as a line (without '\n') of the text
+ * MetaCov format, i.e. CHROM, START_POS, END_POS, NUM_MARKER, MARKER_POS and
+ * COV separated by tabs.
+ */
+void appendMetaCovText(const MetaCovRecord& r, std::string* out);
+
+class MetaCovBinaryWriter {
+ public:
+  MetaCovBinaryWriter();
+  ~MetaCovBinaryWriter();
+  /**
+   * @param useHalf store covXX as float16
+   * @return 0 if succeed
+   */
+  int open(const std::string& fileName, bool useHalf);
+  void write(const MetaCovRecord& r);
+  // flush the last block and write the index
+  void close();
+
+ private:
+  void flushBlock();
+  int getChromIndex(const std::string& chrom);
+
+ private:
+  FILE* fp;
+  bool useHalf;
+  std::vector<std::string> chroms;
+  std::string block;  // uncompressed records
+  std::vector<uint8_t> compressed;
+  int blockChrom;
+  int blockStart;
+  int blockEnd;  // largest START_POS in the block
+  int lastStart;  // START_POS of the previous record in the block
+  struct BlockIndex {
+    uint32_t chrom;
+    int32_t start;  // smallest START_POS in the block
+    int32_t end;    // largest START_POS in the block
+    uint64_t offset;
+  };
+  std::vector<BlockIndex> index;
+  std::vector<uint8_t> shuffleBuffer;
+};
+
+class MetaCovBinaryReader {
+ public:
+  MetaCovBinaryReader();
+  ~MetaCovBinaryReader();
+  // @return 0 if succeed
+  int open(const std::string& fileName);
+  void close();
+  /**
+   * Only read records whose START_POS is in [beg, end] on @param chrom (as
+   * tabix does for the text format). Without calling this function, all
+   * records are read.
+   */
+  void setRegion(const std::string& chrom, int beg, int end);
+  /**
+   * @return true if a record is read into @param r
+   */
+  bool readRecord(MetaCovRecord* r);
+
+ private:
+  bool loadBlock(size_t blockIdx);
+  bool decodeRecord(MetaCovRecord* r);
+
+ private:
+  FILE* fp;
+  bool useHalf;
+  std::vector<std::string> chroms;
+  struct BlockIndex {
+    uint32_t chrom;
+    int32_t start;  // smallest START_POS in the block
+    int32_t end;    // largest START_POS in the block
+    uint64_t offset;
+  };
+  std::vector<BlockIndex> index;
+  // region to read
+  bool hasRegion;
+  int regionChrom;
+  int regionBeg;
+  int regionEnd;
+  // current block
+  size_t nextBlock;
+  std::vector<uint8_t> compressed;
+  std::string block;
+  size_t blockPos;
+  int blockChrom;
+  int lastStart;
+};
+
+#endif /* _METACOVBINARY_H_ */
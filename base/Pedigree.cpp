@@ -138,11 +138,11 @@ int Pedigree::add(const std::string& family, const std::string& person,
 
 int loadPedigree(const std::string& fn, zhanxw::Pedigree* ped) {
   zhanxw::Pedigree& p = *ped;
-  std::vector<std::string> fd;
+  std::vector<char*> fd;
   LineReader lr(fn);
   int lineNo = 0;
   bool errorOccured = false;
-  while (lr.readLineBySep(&fd, " \t")) {
+  while (lr.readLineViewBySep(&fd, " \t")) {
     ++lineNo;
     removeEmptyField(&fd);
     if (fd.empty()) {
@@ -0,0 +1,127 @@
+#include "SiteList.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "base/IO.h"
+#include "base/TypeConversion.h"
+
+SiteList::SiteList()
+    : sorted(true), numSite(0), lastChromIndex(-1), cursor(0) {}
+
+int SiteList::loadSiteFile(const std::string& fn) {
+  if (fn.empty()) return 0;
+
+  const size_t n = size();
+  std::vector<std::string> fd;
+  LineReader lr(fn);
+  int pos;
+  while (lr.readLineBySep(&fd, "\t ")) {
+    if (fd.empty()) continue;
+    const size_t sep = fd[0].find(':');
+    if (sep != std::string::npos) {
+      if (str2int(fd[0].substr(sep + 1), &pos) && pos > 0) {
+        add(fd[0].substr(0, sep), pos);
+      }
+      continue;
+    }
+    if (fd.size() >= 2 && str2int(fd[1], &pos) && pos > 0) {
+      add(fd[0], pos);
+      continue;
+    }
+  }
+  return size() - n;
+}
+
+void SiteList::add(const std::string& chrom, int pos) {
+  std::map<std::string, int>::const_iterator it = chromIndex.find(chrom);
+  int idx;
+  if (it == chromIndex.end()) {
+    idx = position.size();
+    chromIndex[chrom] = idx;
+    position.resize(idx + 1);
+  } else {
+    idx = it->second;
+  }
+  std::vector<int>& p = position[idx];
+  if (!p.empty() && p.back() >= pos) {
+    this->sorted = false;  // also when there are duplicates
+  }
+  p.push_back(pos);
+  ++this->numSite;
+
+  // chromosome indices may have changed
+  this->lastChrom.clear();
+  this->lastChromIndex = -1;
+  this->cursor = 0;
+}
+
+size_t SiteList::size() const {
+  if (!this->sorted) {
+    sort();
+  }
+  return this->numSite;
+}
+
+// sort positions and remove duplicates
+void SiteList::sort() const {
+  this->numSite = 0;
+  for (size_t i = 0; i != position.size(); ++i) {
+    std::vector<int>& p = position[i];
+    std::sort(p.begin(), p.end());
+    p.erase(std::unique(p.begin(), p.end()), p.end());
+    this->numSite += p.size();
+  }
+  this->sorted = true;
+}
+
+int SiteList::getChromIndex(const char* chrom) const {
+  if (lastChromIndex >= 0 && lastChrom == chrom) {
+    return lastChromIndex;
+  }
+  std::map<std::string, int>::const_iterator it = chromIndex.find(chrom);
+  lastChrom = chrom;
+  lastChromIndex = (it == chromIndex.end()) ? -1 : it->second;
+  cursor = 0;
+  return lastChromIndex;
+}
+
+bool SiteList::contains(const char* chrom, int pos) const {
+  if (!this->sorted) {
+    sort();
+  }
+  const int idx = getChromIndex(chrom);
+  if (idx < 0) return false;
+
+  // find the first element >= pos, starting from the last query
+  const std::vector<int>& p = position[idx];
+  const size_t n = p.size();
+  size_t lo = 0;
+  size_t hi = n;
+  if (cursor < n && p[cursor] < pos) {
+    // gallop forward: p[lo - 1] < pos
+    size_t step = 1;
+    lo = cursor + 1;
+    while (cursor + step < n && p[cursor + step] < pos) {
+      lo = cursor + step + 1;
+      step <<= 1;
+    }
+    hi = std::min(cursor + step + 1, n);
+  } else if (cursor == 0 || p[cursor - 1] < pos) {
+    lo = hi = cursor;
+  } else {
+    hi = cursor;
+  }
+  cursor = std::lower_bound(p.begin() + lo, p.begin() + hi, pos) - p.begin();
+  return cursor < n && p[cursor] == pos;
+}
+
+void SiteList::clear() {
+  chromIndex.clear();
+  position.clear();
+  sorted = true;
+  numSite = 0;
+  lastChrom.clear();
+  lastChromIndex = -1;
+  cursor = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef _SITELIST_H_
+#define _SITELIST_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A set of sites (chromosome, position), e.g. loaded from --siteFile.
+ *
+ * Positions are stored as a sorted integer array per chromosome, so 10M
+ * sites take about 40MB. Queries remember where the last one ended, and a
+ * query further along the same chromosome gallops forward from there; so
+ * going through a sorted file costs amortized O(1) per site, while queries
+ * in any other order still take O(log n).
+ */
+class SiteList {
+ public:
+  SiteList();
+  /**
+   * Load sites from @param fn, where each line is either "chrom:pos" or
+   * "chrom pos" (separated by tab or space).
+   * @return number of sites loaded
+   */
+  int loadSiteFile(const std::string& fn);
+  void add(const std::string& chrom, int pos);
+  bool empty() const { return this->numSite == 0; }
+  size_t size() const;
+  bool contains(const char* chrom, int pos) const;
+  bool contains(const std::string& chrom, int pos) const {
+    return contains(chrom.c_str(), pos);
+  }
+  void clear();
+
+ private:
+  void sort() const;
+  int getChromIndex(const char* chrom) const;
+
+ private:
+  std::map<std::string, int> chromIndex;
+  // sorted positions of each chromosome (sorted lazily after add())
+  mutable std::vector<std::vector<int> > position;
+  mutable bool sorted;
+  mutable size_t numSite;
+
+  // the last query
+  mutable std::string lastChrom;
+  mutable int lastChromIndex;  // -1: chromosome not in the list
+  mutable size_t cursor;       // first position >= the last queried one
+};
+
+#endif /* _SITELIST_H_ */
@@ -0,0 +1,335 @@
+#include "TabixIndex.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "BGZFReader.h"
+
+// see index.c and tabix.h in tabix
+#define TAD_LIDX_SHIFT 14
+#define TI_PRESET_GENERIC 0
+#define TI_PRESET_SAM 1
+#define TI_PRESET_VCF 2
+#define TI_FLAG_UCSC 0x10000
+
+namespace {
+// read a little-endian value of type T from @param p
+template <typename T>
+bool take(const std::string& data, size_t* p, T* v) {
+  if (*p + sizeof(T) > data.size()) return false;
+  memcpy(v, data.data() + *p, sizeof(T));
+  *p += sizeof(T);
+  return true;
+}
+
+// same as reg2bins() in tabix: bins overlapping [beg, end)
+void reg2bins(uint32_t beg, uint32_t end, std::vector<uint32_t>* bins) {
+  bins->clear();
+  if (beg >= end) return;
+  if (end >= 1u << 29) end = 1u << 29;
+  --end;
+  bins->push_back(0);
+  for (uint32_t k = 1 + (beg >> 26); k <= 1 + (end >> 26); ++k)
+    bins->push_back(k);
+  for (uint32_t k = 9 + (beg >> 23); k <= 9 + (end >> 23); ++k)
+    bins->push_back(k);
+  for (uint32_t k = 73 + (beg >> 20); k <= 73 + (end >> 20); ++k)
+    bins->push_back(k);
+  for (uint32_t k = 585 + (beg >> 17); k <= 585 + (end >> 17); ++k)
+    bins->push_back(k);
+  for (uint32_t k = 4681 + (beg >> 14); k <= 4681 + (end >> 14); ++k)
+    bins->push_back(k);
+}
+
+bool chunkLessThan(const TabixIndex::Chunk& a, const TabixIndex::Chunk& b) {
+  return a.first < b.first;
+}
+}  // namespace
+
+int TabixIndex::open(const std::string& fileName) {
+  this->chromIndex.clear();
+  this->binIndex.clear();
+  this->linearIndex.clear();
+
+  BGZFReader fp(0);
+  if (fp.open(fileName + ".tbi")) {
+    return -1;
+  }
+  std::string data;
+  char buf[65536];
+  int n;
+  while ((n = fp.read(buf, sizeof(buf))) > 0) {
+    data.append(buf, n);
+  }
+  if (n < 0) {
+    return -1;
+  }
+
+  // same layout as written by ti_index_save(), in little-endian
+  size_t p = 0;
+  int32_t nChrom, nameLen;
+  if (data.compare(0, 4, "TBI\1", 4)) {
+    fprintf(stderr, "Wrong magic number in tabix index %s.tbi\n",
+            fileName.c_str());
+    return -1;
+  }
+  p = 4;
+  if (!take(data, &p, &nChrom)) return -1;
+  for (int i = 0; i < 6; ++i) {
+    if (!take(data, &p, &this->conf[i])) return -1;
+  }
+  if (!take(data, &p, &nameLen) || p + nameLen > data.size()) return -1;
+  for (size_t b = p, i = p; i < p + nameLen; ++i) {
+    if (data[i] == '\0') {
+      const int tid = this->chromIndex.size();
+      this->chromIndex[data.substr(b, i - b)] = tid;
+      b = i + 1;
+    }
+  }
+  p += nameLen;
+
+  this->binIndex.resize(nChrom);
+  this->linearIndex.resize(nChrom);
+  for (int i = 0; i < nChrom; ++i) {
+    int32_t nBin, nChunk, nOffset;
+    uint32_t bin;
+    if (!take(data, &p, &nBin)) return -1;
+    for (int j = 0; j < nBin; ++j) {
+      if (!take(data, &p, &bin) || !take(data, &p, &nChunk)) return -1;
+      std::vector<Chunk>& c = this->binIndex[i][bin];
+      c.resize(nChunk);
+      for (int k = 0; k < nChunk; ++k) {
+        if (!take(data, &p, &c[k].first) || !take(data, &p, &c[k].second))
+          return -1;
+      }
+    }
+    if (!take(data, &p, &nOffset)) return -1;
+    this->linearIndex[i].resize(nOffset);
+    for (int k = 0; k < nOffset; ++k) {
+      if (!take(data, &p, &this->linearIndex[i][k])) return -1;
+    }
+  }
+  return 0;
+}
+
+int TabixIndex::query(const std::string& chrom, int beg, int end,
+                      Iterator* iter) const {
+  // same as ti_parse_region()
+  std::map<std::string, int>::const_iterator it = this->chromIndex.find(chrom);
+  if (it == this->chromIndex.end()) return -1;
+  const int tid = it->second;
+  if (beg > 0) --beg;
+  if (beg > end) return -1;
+
+  iter->index = this;
+  iter->chrom = chrom;
+  iter->beg = beg;
+  iter->end = end;
+  iter->i = -1;
+  iter->currOffset = 0;
+  iter->chunk.clear();
+
+  // same as ti_iter_query()
+  const std::vector<uint64_t>& offset = this->linearIndex[tid];
+  uint64_t minOffset = 0;
+  if (!offset.empty()) {
+    const int n = beg >> TAD_LIDX_SHIFT;
+    minOffset = n >= (int)offset.size() ? offset.back() : offset[n];
+    if (minOffset == 0) {
+      // index files built by tabix prior to 0.1.4
+      for (int i = std::min(n, (int)offset.size()) - 1; i >= 0; --i) {
+        if (offset[i] != 0) {
+          minOffset = offset[i];
+          break;
+        }
+      }
+    }
+  }
+  std::vector<uint32_t> bins;
+  reg2bins(beg, end, &bins);
+  std::vector<Chunk>& off = iter->chunk;
+  const std::map<uint32_t, std::vector<Chunk> >& index = this->binIndex[tid];
+  for (size_t i = 0; i < bins.size(); ++i) {
+    std::map<uint32_t, std::vector<Chunk> >::const_iterator b =
+        index.find(bins[i]);
+    if (b == index.end()) continue;
+    for (size_t j = 0; j < b->second.size(); ++j) {
+      if (b->second[j].second > minOffset) off.push_back(b->second[j]);
+    }
+  }
+  if (off.empty()) return 0;
+
+  std::sort(off.begin(), off.end(), chunkLessThan);
+  // resolve completely contained adjacent blocks
+  size_t l = 0;
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[l].second < off[i].second) off[++l] = off[i];
+  }
+  off.resize(l + 1);
+  // resolve overlaps between adjacent blocks
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[i - 1].second >= off[i].first) off[i - 1].second = off[i].first;
+  }
+  // merge adjacent blocks
+  l = 0;
+  for (size_t i = 1; i < off.size(); ++i) {
+    if (off[l].second >> 16 == off[i].first >> 16) {
+      off[l].second = off[i].second;
+    } else {
+      off[++l] = off[i];
+    }
+  }
+  off.resize(l + 1);
+  return 0;
+}
+
+/**
+ * @param line needs to be '\0'-terminated
+ */
+int TabixIndex::parseInterval(const char* line, int len, const char** chrom,
+                              int* chromLen, int* beg, int* end) const {
+  const int preset = this->conf[0] & 0xffff;
+  // columns after the last used one are not scanned
+  int lastColumn = std::max(this->conf[1], this->conf[2]);
+  if (preset == TI_PRESET_GENERIC) {
+    lastColumn = std::max(lastColumn, this->conf[3]);
+  } else if (preset == TI_PRESET_SAM) {
+    lastColumn = std::max(lastColumn, 6);
+  } else if (preset == TI_PRESET_VCF) {
+    lastColumn = std::max(lastColumn, 8);
+  }
+  *chrom = NULL;
+  *beg = *end = -1;
+  for (int i = 0, b = 0, id = 1; i <= len && id <= lastColumn; ++i) {
+    if (line[i] != '\t' && line[i] != '\0') continue;
+    if (id == this->conf[1]) {
+      *chrom = line + b;
+      *chromLen = i - b;
+    } else if (id == this->conf[2]) {
+      // here beg is 0-based
+      *beg = *end = strtol(line + b, NULL, 0);
+      if (!(this->conf[0] & TI_FLAG_UCSC)) {
+        --*beg;
+      } else {
+        ++*end;
+      }
+      if (*beg < 0) *beg = 0;
+      if (*end < 1) *end = 1;
+    } else if (preset == TI_PRESET_GENERIC) {
+      if (id == this->conf[3]) *end = strtol(line + b, NULL, 0);
+    } else if (preset == TI_PRESET_SAM) {
+      if (id == 6) {  // CIGAR
+        int l = 0;
+        for (const char* s = line + b; s < line + i;) {
+          char* t;
+          long x = strtol(s, &t, 10);
+          int op = toupper(*t);
+          if (op == 'M' || op == 'D' || op == 'N') l += x;
+          s = t + 1;
+        }
+        if (l == 0) l = 1;
+        *end = *beg + l;
+      }
+    } else if (preset == TI_PRESET_VCF) {
+      if (id == 4) {  // REF
+        if (b < i) *end = *beg + (i - b);
+      } else if (id == 8) {  // INFO/END
+        const char* s = NULL;
+        if (i - b >= 4 && !strncmp(line + b, "END=", 4)) {
+          s = line + b + 4;
+        } else {
+          static const char key[] = ";END=";
+          const char* p = std::search(line + b, line + i, key, key + 5);
+          if (p != line + i) s = p + 5;
+        }
+        if (s) *end = strtol(s, NULL, 0);
+      }
+    }
+    b = i + 1;
+    ++id;
+  }
+  if (!*chrom || *beg < 0 || *end < 0) {
+    return -1;
+  }
+  return 0;
+}
+
+bool TabixIndex::Iterator::readLine(BGZFReader* fp, std::string* line) {
+  if (!this->index) return false;
+
+  // same as ti_iter_read()
+  const int nChunk = this->chunk.size();
+  while (nChunk > 0) {
+    if (this->currOffset == 0 ||
+        this->currOffset >= this->chunk[this->i].second) {
+      // jump to the next chunk
+      if (this->i == nChunk - 1) break;
+      if (this->i < 0 ||
+          this->chunk[this->i].second != this->chunk[this->i + 1].first) {
+        // not adjacent chunks
+        if (fp->seek(this->chunk[this->i + 1].first)) break;
+        this->currOffset = fp->tell();
+      }
+      ++this->i;
+    }
+    if (!fp->readLine(line)) break;  // end of file
+    this->currOffset = fp->tell();
+    if ((*line)[0] == this->index->getMetaChar()) continue;
+
+    const int ret = this->locate(*line);
+    if (ret > 0) break;  // no need to proceed
+    if (ret == 0) return true;
+  }
+  this->index = NULL;  // finished
+  return false;
+}
+
+bool TabixIndex::Iterator::readLine(BGZFReader* fp,
+                                    const std::vector<uint64_t>& offset,
+                                    std::string* line) {
+  if (!this->index) return false;
+
+  const int nChunk = this->chunk.size();
+  if (this->i < 0) this->i = 0;
+  while (this->i < nChunk) {
+    // the first record to read in the current chunk
+    const Chunk& c = this->chunk[this->i];
+    std::vector<uint64_t>::const_iterator next = std::lower_bound(
+        offset.begin(), offset.end(), std::max(this->currOffset, c.first));
+    if (next == offset.end()) break;
+    if (*next >= c.second) {
+      ++this->i;
+      continue;
+    }
+    if (fp->tell() != *next && fp->seek(*next)) break;
+    if (!fp->readLine(line)) break;  // end of file
+    this->currOffset = fp->tell();
+    if ((*line)[0] == this->index->getMetaChar()) continue;
+
+    const int ret = this->locate(*line);
+    if (ret > 0) break;  // no need to proceed
+    if (ret == 0) return true;
+  }
+  this->index = NULL;  // finished
+  return false;
+}
+
+int TabixIndex::Iterator::locate(const std::string& line) const {
+  const char* chrom;
+  int chromLen, b, e;
+  if (this->index->parseInterval(line.c_str(), line.size(), &chrom, &chromLen,
+                                 &b, &e)) {
+    fprintf(stderr, "The following line cannot be parsed and skipped: %s\n",
+            line.c_str());
+    return 1;
+  }
+  if (chromLen != (int)this->chrom.size() ||
+      this->chrom.compare(0, chromLen, chrom, chromLen) || b >= this->end) {
+    return 1;
+  }
+  return (e > this->beg && this->end > b) ? 0 : -1;
+}
@@ -0,0 +1,95 @@
+#ifndef _TABIXINDEX_H_
+#define _TABIXINDEX_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class BGZFReader;
+
+/**
+ * Tabix index (.tbi) and region queries on top of BGZFReader.
+ *
+ * This follows ti_index_load(), ti_iter_query() and ti_iter_read() in tabix,
+ * and returns the same lines, but the data blocks are read through the block
+ * cache of BGZFReader.
+ *
+ * Usage:
+ *   TabixIndex idx; idx.open(fileName);
+ *   TabixIndex::Iterator iter; idx.query(chrom, beg, end, &iter);
+ *   while (iter.readLine(&reader, &line)) ...
+ */
+class TabixIndex {
+ public:
+  typedef std::pair<uint64_t, uint64_t> Chunk;  // begin and end offsets
+
+  /**
+   * Lines overlapping one region, similar to ti_iter_t
+   */
+  class Iterator {
+   public:
+    Iterator() : index(NULL), beg(0), end(0), i(-1), currOffset(0) {}
+    /**
+     * Read the next line of the region into @param line
+     * @return false if the region is finished
+     */
+    bool readLine(BGZFReader* fp, std::string* line);
+    /**
+     * Same as readLine(), but only read the records starting at @param offset,
+     * a sorted list of virtual file offsets (e.g. from a site index); other
+     * records of the region are neither decompressed nor parsed
+     */
+    bool readLine(BGZFReader* fp, const std::vector<uint64_t>& offset,
+                  std::string* line);
+
+   private:
+    /**
+     * @return 0 if @param line overlaps the region; -1 if it is before the
+     * region; 1 if it is after the region or cannot be parsed
+     */
+    int locate(const std::string& line) const;
+
+   private:
+    friend class TabixIndex;
+    const TabixIndex* index;
+    std::string chrom;
+    int beg, end;  // 0-based, half open
+    std::vector<Chunk> chunk;
+    int i;  // current chunk
+    uint64_t currOffset;
+  };
+
+ public:
+  /**
+   * Load the index of @param fileName (fileName + ".tbi")
+   * @return 0 if succeed
+   */
+  int open(const std::string& fileName);
+  /**
+   * Prepare @param iter to read region @param chrom:@param beg-@param end
+   * (1-based, inclusive, the same as "chrom:beg-end" in tabix)
+   * @return 0 if succeed; -1 if @param chrom is not indexed or the range is
+   * invalid
+   */
+  int query(const std::string& chrom, int beg, int end, Iterator* iter) const;
+
+  /**
+   * Same as ti_get_intv(): parse chromosome and 0-based interval of @param
+   * line
+   * @return 0 if succeed
+   */
+  int parseInterval(const char* line, int len, const char** chrom,
+                    int* chromLen, int* beg, int* end) const;
+  char getMetaChar() const { return this->conf[4]; }
+
+ private:
+  int32_t conf[6];  // preset, chrom, startPos, endPos, meta, skip
+  std::map<std::string, int> chromIndex;
+  // per chromosome: bin => chunks
+  std::vector<std::map<uint32_t, std::vector<Chunk> > > binIndex;
+  std::vector<std::vector<uint64_t> > linearIndex;  // per chromosome
+};
+
+#endif /* _TABIXINDEX_H_ */
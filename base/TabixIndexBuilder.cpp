@@ -0,0 +1,266 @@
+#include "TabixIndexBuilder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "third/samtools/bgzf.h"
+#include "third/tabix/khash.h"
+
+// see index.c in tabix
+#define TAD_LIDX_SHIFT 14
+
+// bin number => index of its chunk list
+KHASH_MAP_INIT_INT(tbxbin, int)
+
+struct TabixIndexBuilder::BinIndex {
+  BinIndex() : hash(kh_init(tbxbin)) {}
+  ~BinIndex() { kh_destroy(tbxbin, hash); }
+  khash_t(tbxbin) * hash;
+  // chunks (begin and end virtual offsets) of each bin
+  std::vector<std::vector<std::pair<uint64_t, uint64_t> > > chunks;
+};
+
+static inline int reg2bin(uint32_t beg, uint32_t end) {
+  --end;
+  if (beg >> 14 == end >> 14) return 4681 + (beg >> 14);
+  if (beg >> 17 == end >> 17) return 585 + (beg >> 17);
+  if (beg >> 20 == end >> 20) return 73 + (beg >> 20);
+  if (beg >> 23 == end >> 23) return 9 + (beg >> 23);
+  if (beg >> 26 == end >> 26) return 1 + (beg >> 26);
+  return 0;
+}
+
+TabixIndexBuilder::TabixIndexBuilder(int skip, char meta, int chrom,
+                                     int startPos, int endPos)
+    : lineNo(0),
+      lastBin(0xffffffffu),
+      saveBin(0xffffffffu),
+      lastCoor(0xffffffffu),
+      lastTid(0xffffffffu),
+      saveTid(0xffffffffu),
+      saveOff(0),
+      lastOff(0),
+      offset0((uint64_t)-1),
+      error(false) {
+  // same layout as ti_conf_t, with the generic preset
+  conf[0] = 0;
+  conf[1] = chrom;
+  conf[2] = startPos;
+  conf[3] = endPos;
+  conf[4] = meta;
+  conf[5] = skip;
+}
+
+TabixIndexBuilder::~TabixIndexBuilder() {
+  for (size_t i = 0; i < binIndex.size(); ++i) {
+    delete binIndex[i];
+  }
+}
+
+int TabixIndexBuilder::getChromIndex(const std::string& chrom) {
+  std::map<std::string, int>::const_iterator it = chromIndex.find(chrom);
+  if (it != chromIndex.end()) return it->second;
+  const int tid = chroms.size();
+  chroms.push_back(chrom);
+  chromIndex[chrom] = tid;
+  binIndex.push_back(new BinIndex);
+  linearIndex.resize(linearIndex.size() + 1);
+  return tid;
+}
+
+/**
+ * Same as ti_get_intv() in tabix for the generic preset
+ * @return 0 if succeed
+ */
+int TabixIndexBuilder::parseInterval(const std::string& line, int* tid,
+                                     int* beg, int* end) {
+  const char* s = line.c_str();
+  const int len = line.size();
+  const char* chromBeg = NULL;
+  const char* chromEnd = NULL;
+  *beg = *end = -1;
+  for (int i = 0, b = 0, id = 1; i <= len; ++i) {
+    if (s[i] != '\t' && s[i] != '\0') continue;
+    if (id == conf[1]) {
+      chromBeg = s + b;
+      chromEnd = s + i;
+    } else if (id == conf[2]) {
+      // here beg is 0-based
+      *beg = *end = strtol(s + b, NULL, 0);
+      --*beg;
+      if (*beg < 0) *beg = 0;
+      if (*end < 1) *end = 1;
+    } else if (id == conf[3]) {
+      *end = strtol(s + b, NULL, 0);
+    }
+    b = i + 1;
+    ++id;
+  }
+  if (!chromBeg || *beg < 0 || *end < 0) {
+    return -1;
+  }
+  *tid = getChromIndex(std::string(chromBeg, chromEnd));
+  return 0;
+}
+
+void TabixIndexBuilder::addChunk(int tid, uint32_t bin, uint64_t beg,
+                                 uint64_t end) {
+  BinIndex& idx = *binIndex[tid];
+  int ret;
+  khint_t k = kh_put(tbxbin, idx.hash, bin, &ret);
+  if (ret) {  // a new bin
+    kh_value(idx.hash, k) = idx.chunks.size();
+    idx.chunks.resize(idx.chunks.size() + 1);
+  }
+  idx.chunks[kh_value(idx.hash, k)].push_back(std::make_pair(beg, end));
+}
+
+int TabixIndexBuilder::addLine(const std::string& line, uint64_t nextOffset) {
+  if (this->error) return -1;
+
+  ++lineNo;
+  if (lineNo <= (uint64_t)conf[5] || line[0] == conf[4]) {
+    lastOff = nextOffset;
+    return 0;
+  }
+  int tid, beg, end;
+  if (parseInterval(line, &tid, &beg, &end)) {
+    fprintf(stderr, "Cannot index line %llu: %s\n", (unsigned long long)lineNo,
+            line.c_str());
+    this->error = true;
+    return -1;
+  }
+  if (lastTid != tid) {  // change of chromosomes
+    if (lastTid > tid) {
+      fprintf(stderr,
+              "Cannot index line %llu: chromosomes are not continuous\n",
+              (unsigned long long)lineNo);
+      this->error = true;
+      return -1;
+    }
+    lastTid = tid;
+    lastBin = 0xffffffffu;
+  } else if (lastCoor > beg) {
+    fprintf(stderr, "Cannot index line %llu: positions are out of order\n",
+            (unsigned long long)lineNo);
+    this->error = true;
+    return -1;
+  }
+
+  // linear index
+  std::vector<uint64_t>& offset = linearIndex[tid];
+  const int lbeg = beg >> TAD_LIDX_SHIFT;
+  const int lend = (end - 1) >> TAD_LIDX_SHIFT;
+  if ((int)offset.size() < lend + 1) {
+    offset.resize(lend + 1, 0);
+  }
+  for (int i = lbeg; i <= lend; ++i) {
+    if (offset[i] == 0) offset[i] = lastOff;
+  }
+  if (lastOff == 0) {
+    offset0 = (uint64_t)lbeg << 32 | lend;
+  }
+
+  // binning index
+  const uint32_t bin = reg2bin(beg, end);
+  if (bin != lastBin) {
+    if (saveBin != 0xffffffffu) {
+      addChunk(saveTid, saveBin, saveOff, lastOff);
+    }
+    saveOff = lastOff;
+    saveBin = lastBin = bin;
+    saveTid = tid;
+  }
+  if (nextOffset <= lastOff) {
+    fprintf(stderr, "Cannot index line %llu: wrong file offset\n",
+            (unsigned long long)lineNo);
+    this->error = true;
+    return -1;
+  }
+  lastOff = nextOffset;
+  lastCoor = beg;
+  return 0;
+}
+
+int TabixIndexBuilder::save(const std::string& fileName, uint64_t eofOffset) {
+  if (this->error) return -1;
+
+  if (saveTid >= 0) {
+    addChunk(saveTid, saveBin, saveOff, eofOffset);
+  }
+  // merge adjacent chunks in the same BGZF block
+  for (size_t i = 0; i < binIndex.size(); ++i) {
+    for (size_t j = 0; j < binIndex[i]->chunks.size(); ++j) {
+      std::vector<std::pair<uint64_t, uint64_t> >& p = binIndex[i]->chunks[j];
+      size_t m = 0;
+      for (size_t l = 1; l < p.size(); ++l) {
+        if (p[m].second >> 16 == p[l].first >> 16) {
+          p[m].second = p[l].second;
+        } else {
+          p[++m] = p[l];
+        }
+      }
+      p.resize(m + 1);
+    }
+  }
+  // fill missing offsets in the linear index
+  for (size_t i = 0; i < linearIndex.size(); ++i) {
+    for (size_t j = 1; j < linearIndex[i].size(); ++j) {
+      if (linearIndex[i][j] == 0) linearIndex[i][j] = linearIndex[i][j - 1];
+    }
+  }
+  if (offset0 != (uint64_t)-1 && !linearIndex.empty()) {
+    const int beg = offset0 >> 32;
+    const int end = offset0 & 0xffffffffu;
+    for (int i = beg; i <= end; ++i) linearIndex[0][i] = 0;
+  }
+
+  // same content as ti_index_save(), in little-endian
+  std::string out("TBI\1", 4);
+  int32_t n = chroms.size();
+  out.append((const char*)&n, 4);
+  out.append((const char*)conf, sizeof(conf));
+  int32_t l = 0;
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    l += chroms[i].size() + 1;
+  }
+  out.append((const char*)&l, 4);
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    out.append(chroms[i].c_str(), chroms[i].size() + 1);
+  }
+  for (size_t i = 0; i < chroms.size(); ++i) {
+    const BinIndex& idx = *binIndex[i];
+    n = kh_size(idx.hash);
+    out.append((const char*)&n, 4);
+    for (khint_t k = kh_begin(idx.hash); k != kh_end(idx.hash); ++k) {
+      if (!kh_exist(idx.hash, k)) continue;
+      const uint32_t bin = kh_key(idx.hash, k);
+      const std::vector<std::pair<uint64_t, uint64_t> >& p =
+          idx.chunks[kh_value(idx.hash, k)];
+      n = p.size();
+      out.append((const char*)&bin, 4);
+      out.append((const char*)&n, 4);
+      for (size_t j = 0; j < p.size(); ++j) {
+        out.append((const char*)&p[j].first, 8);
+        out.append((const char*)&p[j].second, 8);
+      }
+    }
+    n = linearIndex[i].size();
+    out.append((const char*)&n, 4);
+    if (n) {
+      out.append((const char*)linearIndex[i].data(), 8 * n);
+    }
+  }
+
+  BGZF* fp = bgzf_open(fileName.c_str(), "w");
+  if (!fp) {
+    fprintf(stderr, "Cannot create index file %s\n", fileName.c_str());
+    return -1;
+  }
+  const int ret = bgzf_write(fp, out.data(), out.size());
+  if (bgzf_close(fp) || ret != (int)out.size()) {
+    return -1;
+  }
+  return 0;
+}
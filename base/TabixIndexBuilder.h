@@ -0,0 +1,67 @@
+#ifndef _TABIXINDEXBUILDER_H_
+#define _TABIXINDEXBUILDER_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Build a tabix index (.tbi) from lines as they are written to a BGZF file,
+ * so the file does not need to be read again after it is closed.
+ *
+ * This follows ti_index_core() in tabix line by line, and the saved index is
+ * identical to the one created by tabixIndexFile() with the same settings.
+ *
+ * Usage:
+ *   for each line: addLine(line, virtual offset after the line)
+ *   save(fileName + ".tbi", virtual offset at the end of the file)
+ */
+class TabixIndexBuilder {
+ public:
+  /**
+   * @param skip number of lines to skip
+   * @param meta lines starting with this character are skipped
+   * @param chrom, startPos, endPos 1-based columns (@param endPos = 0 means
+   * there is no end column)
+   */
+  TabixIndexBuilder(int skip = 0, char meta = '#', int chrom = 1,
+                    int startPos = 2, int endPos = 0);
+  ~TabixIndexBuilder();
+  /**
+   * Add the next line (without '\n') of the file. @param nextOffset is the
+   * virtual file offset of the line after it.
+   * @return 0 if succeed; -1 if the line cannot be indexed (e.g. the file is
+   * not sorted), then no index will be saved
+   */
+  int addLine(const std::string& line, uint64_t nextOffset);
+  /**
+   * Finish the index and write it to @param fileName.
+   * @param eofOffset is the virtual file offset of the end of the data
+   * @return 0 if succeed
+   */
+  int save(const std::string& fileName, uint64_t eofOffset);
+  bool hasError() const { return this->error; }
+
+ private:
+  int getChromIndex(const std::string& chrom);
+  int parseInterval(const std::string& line, int* tid, int* beg, int* end);
+  void addChunk(int tid, uint32_t bin, uint64_t beg, uint64_t end);
+
+ private:
+  struct BinIndex;
+  int32_t conf[6];  // preset, chrom, startPos, endPos, meta, skip
+  std::vector<std::string> chroms;
+  std::map<std::string, int> chromIndex;
+  std::vector<BinIndex*> binIndex;  // per chromosome
+  std::vector<std::vector<uint64_t> > linearIndex;  // per chromosome
+
+  // state of the indexing loop
+  uint64_t lineNo;
+  uint32_t lastBin, saveBin;
+  int32_t lastCoor, lastTid, saveTid;
+  uint64_t saveOff, lastOff, offset0;
+  bool error;
+};
+
+#endif /* _TABIXINDEXBUILDER_H_ */
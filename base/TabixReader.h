@@ -1,8 +1,9 @@
 #ifndef _TABIXREADER_H_
 #define _TABIXREADER_H_
 
+#include "BGZFReader.h"
 #include "RangeList.h"
-#include "third/tabix/tabix.h"
+#include "TabixIndex.h"
 
 class TabixReader {
  public:
@@ -10,29 +11,18 @@ class TabixReader {
   ~TabixReader() { close(); };
 
   bool openIndex(const std::string& fn) {
-    if ((this->tabixHandle = ti_open(fn.c_str(), 0)) == 0) {
-      // failed to open tabix index
+    // data blocks are read through the block cache of BGZFReader
+    if (this->index.open(fn) || this->reader.open(fn)) {
+      this->reader.close();
       this->hasIndex = false;
       return false;
-    } else {
-      if (ti_lazy_index_load(this->tabixHandle) != 0) {
-        // failed to open tabix index
-        this->hasIndex = false;
-        return false;
-      } else {
-        this->hasIndex = true;
-        return true;
-      }
     }
+    this->hasIndex = true;
     return true;
   };
   void closeIndex() {
-    if (this->iter) {
-      ti_iter_destroy(this->iter);
-      this->iter = 0;
-    }
-    ti_close(this->tabixHandle);
-    this->tabixHandle = 0;
+    this->iter = TabixIndex::Iterator();
+    this->reader.close();
   };
 
   bool readLine(std::string* line) {
@@ -45,56 +35,22 @@ class TabixReader {
       inReading = true;
     };
 
-    while (this->rangeIterator != this->rangeEnd) {
-      if (!this->ti_line) {  // last time does not read a valid line
-        // get range
-        char rangeBuffer[128];
-        snprintf(rangeBuffer, 128, "%s:%u-%u",
-                 this->rangeIterator.getChrom().c_str(),
-                 this->rangeIterator.getBegin(), this->rangeIterator.getEnd());
-        rangeBuffer[127] = '\0';
-#if 0
-        REprintf("Process range: %s\n", rangeBuffer);
-        // this->range.dump();
-#endif
-        // parse range
-        int tid, beg, end, len;
-        if (ti_parse_region(tabixHandle->idx, rangeBuffer, &tid, &beg, &end) !=
-            0) {
-#if 0
-          REprintf("Maybe non-existing range: %s, pass....\n", rangeBuffer);
-#endif
-          // continue to next rangeIdx
-          ti_iter_destroy(this->iter);
-          this->iter = 0;
-          ++this->rangeIterator;
-          continue;
-          // FATAL("Cannot ti_parse_region");
-        }
-        this->iter = ti_queryi(tabixHandle, tid, beg, end);
-        this->ti_line = ti_read(this->tabixHandle, iter, &len);
-        if (this->ti_line) {  // s is valid
-          (*line) = ti_line;
-          return true;
-        } else {
-          // continue to next rangeIdx
-          ti_iter_destroy(this->iter);
-          this->iter = 0;
-          ++this->rangeIterator;
-          continue;
-        }
-      } else {  // last time read a valid line
-        int len;
-        this->ti_line = ti_read(this->tabixHandle, iter, &len);
-        if (!this->ti_line) {
-          ++this->rangeIterator;
-          continue;
-        } else {
-          (*line) = ti_line;
-          return true;
-        }
+    // last time read a valid line
+    if (this->iter.readLine(&this->reader, line)) {
+      return true;
+    }
+    for (; this->rangeIterator != this->rangeEnd; ++this->rangeIterator) {
+      if (this->index.query(this->rangeIterator.getChrom(),
+                            this->rangeIterator.getBegin(),
+                            this->rangeIterator.getEnd(), &this->iter)) {
+        // maybe non-existing range, continue to next range
+        continue;
+      }
+      if (this->iter.readLine(&this->reader, line)) {
+        ++this->rangeIterator;
+        return true;
       }
-    }  // end while
+    }  // end for
     return false;
   };
 
@@ -114,11 +70,8 @@ class TabixReader {
   void mergeRange() { range.sort(); };
   int open(const std::string& fn) {
     inReading = false;
-    ti_line = 0;
 
     // open index
-    this->tabixHandle = 0;
-    this->iter = 0;
     this->hasIndex = this->openIndex(fn);
 
     // set up range iterator
@@ -155,9 +108,9 @@ class TabixReader {
   RangeList::iterator rangeIterator;
 
   // tabix part
-  tabix_t* tabixHandle;
-  ti_iter_t iter;
-  const char* ti_line;
+  TabixIndex index;
+  TabixIndex::Iterator iter;
+  BGZFReader reader;
 };
 
 #endif /* _TABIXREADER_H_ */
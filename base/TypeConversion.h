@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <set>
 #include <sstream>
+#include <string>
 #include <vector>
 
 ////////////////////////////////////////////////////////////////////////
@@ -120,6 +121,31 @@ inline std::string floatToString(std::vector<T>& i) {
   return ss.str();
 }
 
+// append toString(i) to @param out, without using std::stringstream
+inline void appendToString(int i, std::string* out) {
+  char buf[16];
+  char* p = buf + sizeof(buf);
+  unsigned int u = i < 0 ? 0u - (unsigned int)i : (unsigned int)i;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (i < 0) *--p = '-';
+  out->append(p, buf + sizeof(buf) - p);
+}
+
+// append floatToString(d) to @param out, without using std::stringstream
+inline void appendFloatToString(double d, std::string* out) {
+  // integers are printed as is by '%g'
+  if (d > -1e6 && d < 1e6 && d == (int)d && (d != 0.0 || !signbit(d))) {
+    appendToString((int)d, out);
+    return;
+  }
+  char buf[32];
+  const int n = snprintf(buf, sizeof(buf), "%g", d);
+  out->append(buf, n);
+}
+
 // convert int to comma-separated string type
 // e.g. -123456 => "-123,456"
 std::string toStringWithComma(int in);
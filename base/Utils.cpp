@@ -39,3 +39,84 @@ char const* ssechr(char const* s, char ch) {
 #pragma message "Disabled SSE2 => no optimized ssechr"
 #define ssechr strchr
 #endif
+
+/**
+ * Scanners for findAllChar(): each one compares a block of characters with
+ * both delimiters, then emits the offsets from the set bits of the mask
+ */
+typedef int (*FindAllCharFunc)(const char* s, int len, char c1, char c2,
+                               int* pos);
+
+static int findAllCharScalar(const char* s, int len, char c1, char c2,
+                             int* pos, int i) {
+  int n = 0;
+  for (; i < len; ++i) {
+    if (s[i] == c1 || s[i] == c2) pos[n++] = i;
+  }
+  return n;
+}
+
+static int findAllCharScalar(const char* s, int len, char c1, char c2,
+                             int* pos) {
+  return findAllCharScalar(s, len, c1, c2, pos, 0);
+}
+
+#ifdef __SSE2__
+static int findAllCharSSE2(const char* s, int len, char c1, char c2,
+                           int* pos) {
+  const __m128i x1 = _mm_set1_epi8(c1);
+  const __m128i x2 = _mm_set1_epi8(c2);
+  int n = 0;
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((__m128i const*)(s + i));
+    unsigned m = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(x, x1), _mm_cmpeq_epi8(x, x2)));
+    while (m) {
+      pos[n++] = i + __builtin_ctz(m);
+      m &= m - 1;
+    }
+  }
+  return n + findAllCharScalar(s, len, c1, c2, pos + n, i);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+__attribute__((target("avx2"))) static int findAllCharAVX2(
+    const char* s, int len, char c1, char c2, int* pos) {
+  const __m256i x1 = _mm256_set1_epi8(c1);
+  const __m256i x2 = _mm256_set1_epi8(c2);
+  int n = 0;
+  int i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((__m256i const*)(s + i));
+    unsigned m = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, x1), _mm256_cmpeq_epi8(x, x2)));
+    while (m) {
+      pos[n++] = i + __builtin_ctz(m);
+      m &= m - 1;
+    }
+  }
+  return n + findAllCharScalar(s, len, c1, c2, pos + n, i);
+}
+#endif
+
+static FindAllCharFunc chooseFindAllChar() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return findAllCharAVX2;
+  }
+#endif
+#ifdef __SSE2__
+  return findAllCharSSE2;
+#else
+  return findAllCharScalar;
+#endif
+}
+
+int findAllChar(const char* s, int len, char c1, char c2, int* pos) {
+  static const FindAllCharFunc func = chooseFindAllChar();
+  return func(s, len, c1, c2, pos);
+}
@@ -419,4 +419,12 @@ inline bool endsWith(const std::string& s, const std::string& tail) {
 
 extern char const* ssechr(char const* s, char ch);
 
+/**
+ * Store the offsets of all @param c1 and @param c2 among the first
+ * @param len characters of @param s to @param pos, which needs room for
+ * @param len elements. AVX2 or SSE2 is used when the CPU supports it.
+ * @return the number of offsets found
+ */
+int findAllChar(const char* s, int len, char c1, char c2, int* pos);
+
 #endif /* _UTILS_H_ */
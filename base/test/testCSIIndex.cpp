@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "base/CSIIndex.h"
+#include "bgzf.h"
+
+// append little-endian value @param v to @param s
+template <typename T>
+void put(std::string* s, T v) {
+  s->append((const char*)&v, sizeof(v));
+}
+
+void putBin(std::string* s, uint32_t bin, uint64_t loffset,
+            const std::vector<CSIIndex::Chunk>& chunk) {
+  put(s, bin);
+  put(s, loffset);
+  put(s, (int32_t)chunk.size());
+  for (size_t i = 0; i < chunk.size(); ++i) {
+    put(s, chunk[i].first);
+    put(s, chunk[i].second);
+  }
+}
+
+std::vector<CSIIndex::Chunk> makeChunk(uint64_t beg, uint64_t end) {
+  return std::vector<CSIIndex::Chunk>(1, CSIIndex::Chunk(beg, end));
+}
+
+int main() {
+  const char* fn = "test.csiIndex.bcf";
+  // min_shift = 14 and depth = 5, same as "bcftools index"
+  const uint32_t leaf = 4681;  // first bin of the deepest level
+  {
+    std::string s = "CSI\1";
+    put(&s, (int32_t)14);
+    put(&s, (int32_t)5);
+    put(&s, (int32_t)0);  // l_aux
+    put(&s, (int32_t)2);  // n_ref
+    // reference 0: records in [0, 16384), [16384, 32768) and a long one
+    put(&s, (int32_t)3);
+    putBin(&s, leaf, 0x10000, makeChunk(0x10000, 0x10100));
+    putBin(&s, leaf + 1, 0x10100, makeChunk(0x10100, 0x20000));
+    putBin(&s, 0, 0x10000, makeChunk(0x30000, 0x30100));
+    // reference 1: nothing indexed
+    put(&s, (int32_t)0);
+
+    BGZF* fp = bgzf_open((std::string(fn) + ".csi").c_str(), "w");
+    assert(fp);
+    assert(bgzf_write(fp, s.data(), s.size()) == (int)s.size());
+    bgzf_close(fp);
+  }
+
+  CSIIndex idx;
+  assert(0 == idx.open(fn));
+  std::vector<CSIIndex::Chunk> chunk;
+
+  // the first leaf bin and the root bin
+  assert(0 == idx.query(0, 0, 100, &chunk));
+  assert(chunk.size() == 2);
+  assert(chunk[0] == CSIIndex::Chunk(0x10000, 0x10100));
+  assert(chunk[1] == CSIIndex::Chunk(0x30000, 0x30100));
+
+  // adjacent chunks in the same block are merged
+  assert(0 == idx.query(0, 100, 20000, &chunk));
+  assert(chunk.size() == 2);
+  assert(chunk[0] == CSIIndex::Chunk(0x10000, 0x20000));
+  assert(chunk[1] == CSIIndex::Chunk(0x30000, 0x30100));
+
+  // records before the first leaf bin at the start are skipped
+  assert(0 == idx.query(0, 20000, 30000, &chunk));
+  assert(chunk.size() == 2);
+  assert(chunk[0] == CSIIndex::Chunk(0x10100, 0x20000));
+
+  // nothing indexed
+  assert(0 == idx.query(1, 0, 100, &chunk));
+  assert(chunk.empty());
+  assert(-1 == idx.query(2, 0, 100, &chunk));
+  assert(-1 == idx.query(0, 100, 0, &chunk));
+
+  // missing index
+  CSIIndex missing;
+  assert(0 != missing.open("test.csiIndex.missing"));
+  return 0;
+}
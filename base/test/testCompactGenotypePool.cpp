@@ -0,0 +1,107 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "base/CompactGenotypePool.h"
+
+double naiveDot(const std::vector<float>& x, const std::vector<float>& y) {
+  double s = 0.;
+  for (size_t i = 0; i < x.size(); ++i) {
+    s += (double)x[i] * y[i];
+  }
+  return s;
+}
+
+bool isClose(double a, double b, double tol) {
+  return fabs(a - b) <= tol * (1.0 + fabs(a) + fabs(b));
+}
+
+int main() {
+  const int n = 150;  // not a multiple of 64
+  std::vector<float> out(n);
+
+  {
+    // hard calls (centered, one imputed value) are stored exactly
+    CompactGenotypePool pool;
+    pool.setChunkSize(n);
+    std::vector<std::vector<float> > geno(8, std::vector<float>(n));
+    for (int k = 0; k < 8; ++k) {
+      for (int i = 0; i < n; ++i) {
+        geno[k][i] = (rand() % 7 == 0) + (rand() % 5 == 0) - 0.3f;
+      }
+      geno[k][k] = 0.123f;  // a mean-imputed missing genotype
+      int idx = pool.allocate();
+      assert(idx == k);
+      pool.store(idx, geno[k].data());
+      assert(pool.isHardCall(idx));
+    }
+    for (int k = 0; k < 8; ++k) {
+      pool.load(k, out.data());
+      for (int i = 0; i < n; ++i) {
+        assert(out[i] == geno[k][i]);
+      }
+      for (int j = 0; j < 8; ++j) {
+        assert(isClose(pool.dot(k, j), naiveDot(geno[k], geno[j]), 1e-12));
+      }
+    }
+    for (int k = 0; k < 8; ++k) {
+      pool.deallocate(k);
+    }
+    assert(pool.size() == 0);
+  }
+
+  {
+    // dosages are quantized to 8 bits
+    CompactGenotypePool pool;
+    pool.setChunkSize(n);
+    std::vector<float> dosage(n);
+    std::vector<float> hard(n);
+    for (int i = 0; i < n; ++i) {
+      dosage[i] = 2.0f * rand() / RAND_MAX;
+      hard[i] = rand() % 3;
+    }
+    int idx1 = pool.allocate();
+    int idx2 = pool.allocate();
+    int idx3 = pool.allocate();
+    pool.store(idx1, dosage.data());
+    pool.store(idx2, hard.data());
+    pool.store(idx3, dosage.data());
+    assert(!pool.isHardCall(idx1));
+    assert(pool.isHardCall(idx2));
+
+    pool.load(idx1, out.data());
+    for (int i = 0; i < n; ++i) {
+      assert(fabs(out[i] - dosage[i]) <= 2.0 / 255 / 2 + 1e-6);
+    }
+    // dot products agree with the decoded values
+    assert(isClose(pool.dot(idx1, idx3), naiveDot(out, out), 1e-6));
+    assert(isClose(pool.dot(idx1, idx2), naiveDot(out, hard), 1e-6));
+    assert(isClose(pool.dot(idx2, idx1), naiveDot(out, hard), 1e-6));
+    assert(isClose(pool.dot(idx1, idx3), naiveDot(dosage, dosage), 1e-2));
+  }
+
+  {
+    // chunks are reused after deallocation
+    CompactGenotypePool pool;
+    pool.setChunkSize(n);
+    std::vector<float> g(n);
+    for (int k = 0; k < 100; ++k) {
+      for (int i = 0; i < n; ++i) {
+        g[i] = (i + k) % 3;
+      }
+      int idx = pool.allocate();
+      pool.store(idx, g.data());
+      if (k >= 10) {
+        pool.deallocate(k - 10);
+      }
+      pool.load(idx, out.data());
+      for (int i = 0; i < n; ++i) {
+        assert(out[i] == g[i]);
+      }
+    }
+    assert(pool.size() == 10);
+  }
+  return 0;
+}
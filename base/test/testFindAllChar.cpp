@@ -0,0 +1,35 @@
+#include <stdlib.h>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "Utils.h"
+
+// compare findAllChar() with a plain loop for all lengths and alignments
+int main(int argc, char* argv[]) {
+  srand(1);
+  const char alphabet[] = "0/1|.:\t:\t";
+  std::string s;
+  for (int i = 0; i < 300; ++i) {
+    s.push_back(alphabet[rand() % (sizeof(alphabet) - 1)]);
+  }
+  std::vector<int> pos(s.size());
+  for (size_t b = 0; b < 40; ++b) {
+    for (size_t len = 0; b + len <= s.size(); ++len) {
+      const int n = findAllChar(s.data() + b, len, '\t', ':', pos.data());
+      int k = 0;
+      for (size_t i = 0; i < len; ++i) {
+        if (s[b + i] == '\t' || s[b + i] == ':') {
+          assert(k < n && pos[k] == (int)i);
+          ++k;
+        }
+      }
+      assert(k == n);
+    }
+  }
+
+  // no delimiters
+  s.assign(100, 'a');
+  assert(0 == findAllChar(s.data(), s.size(), '\t', ':', pos.data()));
+  return 0;
+}
@@ -0,0 +1,227 @@
+#include "IO.h"
+#include "Utils.h"
+
+#include <stdlib.h>
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+char a[] = "abc\ndef\nHAH!!DFDSLIJFDSO\nadfa";
+char buffer[1024];
+
+int main(int argc, char *argv[]) {
+  vector<string> t;
+  int ret = stringTokenize(a, '\n', &t);
+  assert(ret == 4);
+
+  {
+    char fn[] = "abc.txt";
+    FileWriter fw(fn);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::string ln;
+    int i = 0;
+    while (lr.readLine(&ln)) {
+      assert(0 == strcmp(t[i].c_str(), ln.c_str()));
+      i++;
+    }
+  }
+
+  {
+    char fn[] = "abc.txt.gz";
+    FileWriter fw(fn);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::string ln;
+    int i = 0;
+    while (lr.readLine(&ln)) {
+      assert(0 == strcmp(t[i].c_str(), ln.c_str()));
+      i++;
+    }
+  }
+
+  {
+    char fn[] = "abc.txt.bz2";
+    FileWriter fw(fn);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::string ln;
+    int i = 0;
+    while (lr.readLine(&ln)) {
+      assert(0 == strcmp(t[i].c_str(), ln.c_str()));
+      i++;
+    }
+  }
+
+  {
+    char fn[] = "abc.txt.bgzip.gz";
+    FileWriter fw(fn, BGZIP);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::string ln;
+    int i = 0;
+    while (lr.readLine(&ln)) {
+      assert(0 == strcmp(t[i].c_str(), ln.c_str()));
+      i++;
+    }
+  }
+
+  {
+    // multithreaded bgzip writer gives the same content as the single
+    // threaded one (bytes may differ, as samtools and tabix both provide
+    // bgzf_write() with different block sizes)
+    std::string content;
+    for (int i = 0; i < 50000; ++i) {
+      content += "line ";
+      content += toString(i);
+      content += '\n';
+    }
+    const char* fn[] = {"abc.txt.bgzip.1.gz", "abc.txt.bgzip.3.gz"};
+    for (int i = 0; i < 2; ++i) {
+      FileWriter fw(fn[i], BGZIP, i == 0 ? 0 : 3);
+      fw.write(content.substr(0, 100000).c_str());
+      fw.flush();
+      fw.write(content.substr(100000).c_str());
+      fw.close();
+    }
+    // ends with the empty BGZF block
+    const unsigned char eof[28] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255,
+                                   6,  0,   66, 67, 2, 0, 27, 0, 3, 0};
+    FILE* fp = fopen(fn[1], "rb");
+    assert(fp);
+    unsigned char tail[28];
+    assert(0 == fseek(fp, -28, SEEK_END));
+    assert(28 == fread(tail, 1, 28, fp));
+    fclose(fp);
+    assert(0 == memcmp(tail, eof, 28));
+
+    LineReader lr0(fn[0]);
+    LineReader lr(fn[1]);
+    std::string ln, ln0;
+    int i = 0;
+    while (lr.readLine(&ln)) {
+      ret = lr0.readLine(&ln0);
+      assert(ret && ln == ln0);
+      assert(ln == "line " + toString(i));
+      i++;
+    }
+    ret = lr0.readLine(&ln0);
+    assert(!ret);
+    assert(i == 50000);
+  }
+
+  {
+    char fn[] = "abc.txt";
+    FileWriter fw(fn);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::vector<std::string> fd;
+    int i = 0;
+    while (lr.readLineBySep(&fd, "\t")) {
+      assert(0 == strcmp(t[i].c_str(), fd[0].c_str()));
+      i++;
+    }
+  }
+
+  {
+    char a[] =
+        "r1c1 r1c2\n"
+        "r2c1\tr2c2\n"
+        "r3c1  r3c2\n"
+        "r4c1\t\tr4c2\n"
+        "r5c1 \t  r5c2 \n"
+        "r6c1 r6c2";
+    char fn[] = "abc.txt";
+    FileWriter fw(fn);
+    fw.write(a);
+    fw.close();
+
+    LineReader lr(fn);
+    std::vector<std::string> fd;
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 2);
+    assert(fd[0] == "r1c1");
+    assert(fd[1] == "r1c2");
+
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 2);
+    assert(fd[0] == "r2c1");
+    assert(fd[1] == "r2c2");
+
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 3);
+    assert(fd[0] == "r3c1");
+    assert(fd[2] == "r3c2");
+
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 3);
+    assert(fd[0] == "r4c1");
+    assert(fd[2] == "r4c2");
+
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 6);
+    assert(fd[0] == "r5c1");
+    assert(fd[4] == "r5c2");
+
+    assert(lr.readLineBySep(&fd, " \t"));
+    assert(fd.size() == 2);
+    assert(fd[0] == "r6c1");
+    assert(fd[1] == "r6c2");
+
+    assert(!lr.readLineBySep(&fd, " \t"));
+
+    // the same fields split in place
+    LineReader lv(fn);
+    std::vector<char*> fv;
+    const int numField[] = {2, 2, 3, 3, 6, 2};
+    const int numNonEmpty[] = {2, 2, 2, 2, 2, 2};
+    for (int i = 0; i < 6; ++i) {
+      assert(lv.readLineViewBySep(&fv, " \t") == numField[i]);
+      assert(fv[0][0] == 'r' && fv[0][1] == '1' + i);
+      assert(removeEmptyField(&fv) == numField[i] - numNonEmpty[i]);
+      assert(fv.size() == 2);
+      assert(0 == strcmp(fv[1] + 2, "c2"));
+    }
+    assert(!lv.readLineViewBySep(&fv, " \t"));
+    assert(fv.empty());
+  }
+
+  {
+    // line views across buffer refills: a small buffer forces lines to be
+    // moved to the front or the buffer to grow
+    std::string longLine(100, 'x');
+    std::string content = "ab\r\n\n" + longLine + "\ncd\r\nlast";
+    char fn[] = "abc.txt";
+    FileWriter fw(fn);
+    fw.write(content.c_str());
+    fw.close();
+
+    const char* expected[] = {"ab", "", longLine.c_str(), "cd", "last"};
+    for (int cap = 1; cap <= 16; ++cap) {
+      BufferedReader br(fn, cap);
+      char* line;
+      int len;
+      for (int i = 0; i < 5; ++i) {
+        assert(br.readLineView(&line, &len));
+        assert(len == (int)strlen(expected[i]));
+        assert(0 == strcmp(line, expected[i]));
+      }
+      assert(!br.readLineView(&line, &len));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "base/MetaCovBinary.h"
+
+MetaCovRecord makeRecord(const char* chrom, int start, int n, bool cov) {
+  MetaCovRecord r;
+  r.chrom = chrom;
+  int pos = start;
+  for (int i = 0; i < n; ++i) {
+    r.position.push_back(pos);
+    r.covXX.push_back((float)rand() / RAND_MAX - 0.5f);
+    pos += 1 + rand() % 1000;
+  }
+  r.hasCovariate = cov;
+  if (cov) {
+    r.covXZ.push_back(0.25f);
+    r.covXZ.push_back(-1.5e-3f);
+    r.covZZ.push_back(1.0);
+    r.covZZ.push_back(0.1);
+    r.covZZ.push_back(2.0);
+  }
+  return r;
+}
+
+int main() {
+  const char* fn = "testMetaCovBinary.bin";
+  std::vector<MetaCovRecord> records;
+  int start = 1000;
+  for (int i = 0; i < 20000; ++i) {
+    // cross a chromosome boundary
+    if (i == 12000) start = 50;
+    records.push_back(
+        makeRecord(i < 12000 ? "1" : "2", start, 1 + rand() % 30, i % 3 == 0));
+    start += rand() % 200;
+  }
+
+  {
+    // float32 round trip, identical text
+    MetaCovBinaryWriter w;
+    assert(w.open(fn, false) == 0);
+    for (size_t i = 0; i < records.size(); ++i) {
+      w.write(records[i]);
+    }
+    w.close();
+
+    MetaCovBinaryReader reader;
+    assert(reader.open(fn) == 0);
+    MetaCovRecord r;
+    size_t n = 0;
+    std::string s1, s2;
+    while (reader.readRecord(&r)) {
+      assert(n < records.size());
+      s1.clear();
+      s2.clear();
+      appendMetaCovText(records[n], &s1);
+      appendMetaCovText(r, &s2);
+      assert(s1 == s2);
+      ++n;
+    }
+    assert(n == records.size());
+
+    // region query returns the records starting in the region
+    const int beg = records[15000].getStartPos();
+    const int end = beg + 5000;
+    reader.setRegion("2", beg, end);
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < records.size(); ++i) {
+      if (records[i].chrom == "2" && records[i].getStartPos() >= beg &&
+          records[i].getStartPos() <= end) {
+        expected.push_back(i);
+      }
+    }
+    n = 0;
+    while (reader.readRecord(&r)) {
+      assert(n < expected.size());
+      assert(r.position == records[expected[n]].position);
+      ++n;
+    }
+    assert(n == expected.size() && n > 0);
+
+    reader.setRegion("3", 1, 100000);
+    assert(!reader.readRecord(&r));
+  }
+
+  {
+    // float16 keeps about 3 significant digits
+    MetaCovBinaryWriter w;
+    assert(w.open(fn, true) == 0);
+    for (size_t i = 0; i < 100; ++i) {
+      w.write(records[i]);
+    }
+    w.close();
+
+    MetaCovBinaryReader reader;
+    assert(reader.open(fn) == 0);
+    MetaCovRecord r;
+    size_t n = 0;
+    while (reader.readRecord(&r)) {
+      const MetaCovRecord& e = records[n];
+      assert(r.position == e.position);
+      assert(r.covXZ == e.covXZ && r.covZZ == e.covZZ);
+      for (size_t i = 0; i < r.covXX.size(); ++i) {
+        assert(fabs(r.covXX[i] - e.covXX[i]) <= 1e-3 * fabs(e.covXX[i]) + 1e-7);
+      }
+      ++n;
+    }
+    assert(n == 100);
+  }
+  remove(fn);
+  return 0;
+}
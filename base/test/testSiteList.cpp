@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IO.h"
+#include "SiteList.h"
+
+typedef std::pair<std::string, int> Site;
+
+// check SiteList against std::set for the queries in @param query
+void check(const SiteList& sl, const std::set<Site>& truth,
+           const std::vector<Site>& query) {
+  for (size_t i = 0; i < query.size(); ++i) {
+    assert(sl.contains(query[i].first, query[i].second) ==
+           (truth.count(query[i]) > 0));
+  }
+}
+
+int main(int argc, char* argv[]) {
+  srand(1);
+  const char* chroms[] = {"1", "2", "X"};
+  SiteList sl;
+  std::set<Site> truth;
+  assert(sl.empty());
+  for (int i = 0; i < 20000; ++i) {
+    Site s(chroms[rand() % 3], 1 + rand() % 100000);
+    sl.add(s.first, s.second);  // unsorted, with duplicates
+    truth.insert(s);
+  }
+  assert(sl.size() == truth.size());
+
+  std::vector<Site> query;
+  for (int c = 0; c < 4; ++c) {
+    for (int pos = 0; pos <= 100001; pos += 1 + rand() % 7) {
+      query.push_back(Site(c < 3 ? chroms[c] : "Y", pos));
+    }
+  }
+  // streaming order
+  check(sl, truth, query);
+  // repeated and backward queries
+  std::vector<Site> repeated(query.begin(), query.begin() + 1000);
+  repeated.insert(repeated.end(), query.begin(), query.begin() + 1000);
+  std::reverse(repeated.begin(), repeated.end());
+  check(sl, truth, repeated);
+  // random order
+  for (size_t i = query.size() - 1; i > 0; --i) {
+    std::swap(query[i], query[rand() % (i + 1)]);
+  }
+  check(sl, truth, query);
+
+  // load "chrom:pos" and "chrom pos" lines
+  {
+    FileWriter fw("testSiteList.sites");
+    fw.write("1:100\n");
+    fw.write("1\t50\n");
+    fw.write("chr2 300 extra\n");
+    fw.write("1:bad\n");
+    fw.write("3\t-1\n");
+    fw.write("1\t50\n");
+  }
+  SiteList fl;
+  assert(fl.loadSiteFile("testSiteList.sites") == 3);
+  assert(fl.contains("1", 50) && fl.contains("1", 100));
+  assert(fl.contains("chr2", 300) && !fl.contains("2", 300));
+  assert(!fl.contains("1", 75) && !fl.contains("3", 1));
+  fl.clear();
+  assert(fl.empty() && !fl.contains("1", 50));
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "base/BGZFReader.h"
+#include "base/IO.h"
+#include "base/TabixIndex.h"
+#include "base/TypeConversion.h"
+#include "tabix.h"
+
+// lines of a region read by tabix
+std::vector<std::string> tabixQuery(const char* fn, const std::string& region) {
+  std::vector<std::string> ret;
+  tabix_t* t = ti_open(fn, 0);
+  assert(t && ti_lazy_index_load(t) == 0);
+  int tid, beg, end, len;
+  if (ti_parse_region(t->idx, region.c_str(), &tid, &beg, &end) == 0) {
+    ti_iter_t iter = ti_queryi(t, tid, beg, end);
+    const char* s;
+    while ((s = ti_read(t, iter, &len)) != 0) ret.push_back(s);
+    ti_iter_destroy(iter);
+  }
+  ti_close(t);
+  return ret;
+}
+
+std::vector<std::string> query(const TabixIndex& idx, BGZFReader* fp,
+                               const std::string& chrom, int beg, int end) {
+  std::vector<std::string> ret;
+  TabixIndex::Iterator iter;
+  if (idx.query(chrom, beg, end, &iter) == 0) {
+    std::string line;
+    while (iter.readLine(fp, &line)) ret.push_back(line);
+  }
+  return ret;
+}
+
+int main() {
+  const char* fn = "test.tabixIndex.gz";
+  srand(1);
+  {
+    FileWriter fw(fn, BGZIP, 0, true);
+    fw.write("## comment\n");
+    const char* chroms[] = {"1", "2", "X"};
+    for (int c = 0; c < 3; ++c) {
+      int pos = 1;
+      for (int i = 0; i < 30000; ++i) {
+        std::string line = chroms[c];
+        line += '\t';
+        line += toString(pos);
+        line += '\t';
+        line += toString(rand());
+        line += '\n';
+        fw.write(line.c_str());
+        pos += rand() % (i % 100 == 0 ? 100000 : 50);
+      }
+    }
+  }
+
+  TabixIndex idx;
+  assert(0 == idx.open(fn));
+  BGZFReader fp;
+  assert(0 == fp.open(fn));
+
+  // same lines as tabix
+  const char* chroms[] = {"1", "2", "X", "Y"};
+  for (int i = 0; i < 200; ++i) {
+    const std::string chrom = chroms[rand() % 4];
+    const int beg = rand() % 3000000;
+    const int end = beg + rand() % (i % 10 == 0 ? 200000 : 2000);
+    const std::string region =
+        chrom + ":" + toString(beg) + "-" + toString(end);
+    assert(query(idx, &fp, chrom, beg, end) == tabixQuery(fn, region));
+  }
+
+  // neighbouring regions hit the cached blocks
+  {
+    BGZFReader r;
+    assert(0 == r.open(fn));
+    const std::vector<std::string> a = query(idx, &r, "1", 100000, 120000);
+    const uint64_t miss = r.getCacheMiss();
+    assert(a == query(idx, &r, "1", 100000, 120000));
+    assert(r.getCacheMiss() == miss);
+    assert(r.getCacheHit() > 0);
+  }
+
+  // without a budget, only the current block is kept
+  {
+    BGZFReader r(0);
+    assert(0 == r.open(fn));
+    assert(!query(idx, &r, "1", 100000, 5000000).empty());
+    const uint64_t miss = r.getCacheMiss();
+    query(idx, &r, "1", 100000, 5000000);
+    assert(r.getCacheMiss() > miss);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "base/IO.h"
+#include "base/TypeConversion.h"
+#include "tabix.h"
+
+std::string readFile(const std::string& fn) {
+  std::string s;
+  FILE* fp = fopen(fn.c_str(), "rb");
+  assert(fp);
+  int c;
+  while ((c = fgetc(fp)) != EOF) s.push_back((char)c);
+  fclose(fp);
+  return s;
+}
+
+// write a sorted file, and compare its index with the one built by tabix
+void check(const char* fn, int numThread, bool header, bool lastNewLine) {
+  {
+    FileWriter fw(fn, BGZIP, numThread, true);
+    if (header) {
+      fw.write("## comment\n");
+      fw.write("CHROM\tPOS\tVALUE\n");
+    }
+    const char* chroms[] = {"1", "2", "X"};
+    int n = 0;
+    for (int c = 0; c < 3; ++c) {
+      int pos = 1;
+      for (int i = 0; i < 30000; ++i) {
+        std::string line = chroms[c];
+        line += '\t';
+        line += toString(pos);
+        line += '\t';
+        line += toString(rand());
+        if (++n < 90000 || lastNewLine) line += '\n';
+        fw.write(line.c_str());
+        pos += rand() % (i % 100 == 0 ? 100000 : 50);
+      }
+    }
+  }
+  const std::string idx = readFile(std::string(fn) + ".tbi");
+  ti_conf_t conf = {0, 1, 2, 0, '#', 0};
+  assert(0 == ti_index_build(fn, &conf));
+  assert(idx == readFile(std::string(fn) + ".tbi"));
+}
+
+int main() {
+  srand(1);
+  check("test.tabixIndexBuilder.gz", 0, true, true);
+  check("test.tabixIndexBuilder.gz", 0, false, true);
+  check("test.tabixIndexBuilder.gz", 3, true, true);
+  check("test.tabixIndexBuilder.gz", 2, true, false);
+
+  // unsorted input does not leave an index
+  {
+    FileWriter fw("test.tabixIndexBuilder.gz", BGZIP, 0, true);
+    fw.write("1\t200\n1\t100\n");
+  }
+  FILE* fp = fopen("test.tabixIndexBuilder.gz.tbi", "r");
+  assert(!fp);
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "TypeConversion.h"
+#include <assert.h>
+#include <climits>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+  {
+    // test toStringWithComma
+    int x[] = {INT_MIN, -1234567890, -123456, -12345, -1000, -999, -1,
+               0, 1, 999, 1000, 12345, 123456, 1234567890, INT_MAX};
+    int n = sizeof(x)/ sizeof(x[0]);
+    for (int i = 0; i < n; ++i) {
+      printf("%-15d : %s\n", x[i], toStringWithComma(x[i]).c_str());
+    }
+  }
+
+  {
+    // test toString
+    std::vector<double> a;
+    a.push_back(1.1);
+    a.push_back(2.0);
+    std::string s = floatToString(a);
+    printf("%s\n", s.c_str());
+  }
+
+  {
+    // test appendToString and appendFloatToString
+    int x[] = {INT_MIN, -1234567890, -1000, -1, 0, 1, 999, 1000, INT_MAX};
+    for (size_t i = 0; i < sizeof(x) / sizeof(x[0]); ++i) {
+      std::string s;
+      appendToString(x[i], &s);
+      assert(s == toString(x[i]));
+    }
+    double y[] = {0.0, -0.0, 1.0, -1.0, 0.1, 1.0 / 3, -2.5e-8, 123456.0,
+                  999999.0, 999999.5, 1e6, -1234567.0, 6.02e23, 1e-300,
+                  HUGE_VAL, -HUGE_VAL, NAN};
+    for (size_t i = 0; i < sizeof(y) / sizeof(y[0]); ++i) {
+      std::string s;
+      appendFloatToString(y[i], &s);
+      assert(s == floatToString(y[i]));
+    }
+    for (int i = 0; i < 100000; ++i) {
+      const double d = (rand() - RAND_MAX / 2) * pow(10.0, rand() % 40 - 20);
+      std::string s;
+      appendFloatToString(d, &s);
+      assert(s == floatToString(d));
+      s.clear();
+      appendFloatToString((float)d, &s);
+      assert(s == toString((float)d));
+    }
+  }
+  return 0;
+}
@@ -132,6 +132,17 @@ BGenFile::BGenFile(const std::string& fn) : var(this->N) {
 }
 
 bool BGenFile::readRecord() {
+  // skip variants that are not in the allowed sites
+  do {
+    if (!readVariant()) {
+      return false;
+    }
+  } while (!this->allowedSite.empty() &&
+           !this->allowedSite.contains(var.chrom, (int)var.pos));
+  return true;
+}
+
+bool BGenFile::readVariant() {
   if (mode == BGEN_RANGE_MODE) {
     int file_pos, bytes;
     if (index.next(&file_pos, &bytes)) {
@@ -561,26 +572,7 @@ void BGenFile::setRangeMode() {
 }
 
 int BGenFile::setSiteFile(const std::string& fn) {
-  if (fn.empty()) return 0;
-
-  std::vector<std::string> fd;
-  LineReader lr(fn);
-  int pos;
-  std::string chromPos;
-  while (lr.readLineBySep(&fd, "\t ")) {
-    if (fd.empty()) continue;
-    if (fd[0].find(':') != std::string::npos) {
-      this->allowedSite.insert(fd[0]);
-      continue;
-    }
-    if (fd.size() >= 2 && str2int(fd[1], &pos) && pos > 0) {
-      chromPos = fd[0];
-      chromPos += ':';
-      chromPos += fd[1];
-      this->allowedSite.insert(chromPos);
-      continue;
-    }
-  }
+  this->allowedSite.loadSiteFile(fn);
   return 0;
 }
 
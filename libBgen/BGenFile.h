@@ -11,6 +11,7 @@
 
 #include "BGenIndex.h"
 #include "BGenVariant.h"
+#include "base/SiteList.h"
 
 // copied from libVcf/VCFConstant.h
 #define MISSING_GENOTYPE -9
@@ -89,6 +90,8 @@ class BGenFile {
   BGenFile& operator=(const BGenFile&);
 
  private:
+  // read the next variant without checking allowed sites
+  bool readVariant();
   bool parseLayout1();
   bool parseLayout2();
 
@@ -139,7 +142,7 @@ class BGenFile {
   std::vector<bool> sampleMask;     // true means exclusion
   std::vector<int> effectiveIndex;  // index of unmasked samples
   // allow chromosomal sites
-  std::set<std::string> allowedSite;
+  SiteList allowedSite;
 };  // class BGenFile
 
 #endif /* _BGENFILE_H_ */
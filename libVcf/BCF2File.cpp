@@ -0,0 +1,553 @@
+#include "BCF2File.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/IO.h"
+#include "base/TypeConversion.h"
+#include "base/Utils.h"
+
+namespace {
+// the size (in bytes) of each type of typed values
+const int typeSize[16] = {0, 1, 2, 4, 0, 4, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// read a little-endian value of type T at @param p
+template <typename T>
+inline T take(const uint8_t* p) {
+  T v;
+  memcpy(&v, p, sizeof(T));
+  return v;
+}
+
+// @return integer value of @param type at @param p
+inline int32_t takeInt(const uint8_t* p, int type) {
+  switch (type) {
+    case BCF2File::BCF_INT8:
+      return (int8_t)*p;
+    case BCF2File::BCF_INT16:
+      return take<int16_t>(p);
+    case BCF2File::BCF_INT32:
+      return take<int32_t>(p);
+  }
+  return 0;
+}
+
+// missing values are the smallest integers, and the next ones mark the end
+// of vectors
+inline bool isIntValue(int32_t v, int type) {
+  switch (type) {
+    case BCF2File::BCF_INT8:
+      return v > INT8_MIN + 1;
+    case BCF2File::BCF_INT16:
+      return v > INT16_MIN + 1;
+  }
+  return v > INT32_MIN + 1;
+}
+
+const uint32_t floatMissing = 0x7F800001;
+const uint32_t floatEndOfVector = 0x7F800002;
+
+/**
+ * Copy the text value at @param p, which has at most @param len characters
+ * (padded by NUL), to @param buf of @param bufLen bytes; longer values are
+ * truncated, which does not change numbers atoi() and atof() can hold
+ * @return @param buf
+ */
+inline const char* takeText(const uint8_t* p, int len, char* buf,
+                            int bufLen) {
+  if (len > bufLen - 1) len = bufLen - 1;
+  if (len < 0) len = 0;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
+  return buf;
+}
+
+/**
+ * Parse the type descriptor at @param p to @param type and @param size
+ * @return position after the descriptor, or NULL if it runs past @param end
+ */
+const uint8_t* parseType(const uint8_t* p, const uint8_t* end, int* type,
+                         int* size) {
+  if (p >= end) return NULL;
+  *type = *p & 0xF;
+  *size = *p >> 4;
+  ++p;
+  if (*size == 15) {  // the size follows as a typed integer
+    if (p >= end) return NULL;
+    const int t = *p & 0xF;
+    ++p;
+    if (p + typeSize[t] > end) return NULL;
+    *size = takeInt(p, t);
+    p += typeSize[t];
+  }
+  return p;
+}
+
+/**
+ * Parse the typed value at @param p to @param f
+ * @return position after the value, or NULL if it runs past @param end
+ */
+const uint8_t* parseTypedValue(const uint8_t* p, const uint8_t* end,
+                               BCF2File::Field* f) {
+  p = parseType(p, end, &f->type, &f->size);
+  if (!p || p + f->size * typeSize[f->type] > end) return NULL;
+  f->data = p;
+  return p + f->size * typeSize[f->type];
+}
+
+// @return the value of "@param key=" in the header line @param s like
+// ##INFO=<ID=DP,...>, or an empty string
+std::string getHeaderAttribute(const std::string& s, const char* key) {
+  const std::string k = key;
+  size_t b = s.find('<');
+  while (b != std::string::npos) {
+    ++b;
+    if (s.compare(b, k.size(), k) == 0 && s[b + k.size()] == '=') {
+      b += k.size() + 1;
+      return s.substr(b, s.find_first_of(",>", b) - b);
+    }
+    b = s.find(',', b);
+  }
+  return "";
+}
+
+// put @param name at @param idx (if not empty) or the end of @param dict
+void addToDictionary(const std::string& name, const std::string& idx,
+                     std::vector<std::string>* dict) {
+  if (idx.empty()) {
+    dict->push_back(name);
+    return;
+  }
+  const int i = atoi(idx);
+  if (i >= (int)dict->size()) dict->resize(i + 1);
+  (*dict)[i] = name;
+}
+}  // namespace
+
+BCF2File::BCF2File(const std::string& fn)
+    : fileName(fn),
+      tid(0),
+      pos(0),
+      rlen(0),
+      qual(0.0),
+      autoMergeRange(false),
+      mode(BCF_LINE_MODE),
+      chunkIdx(-1),
+      currOffset(0),
+      regionTid(-1),
+      regionBeg(0),
+      regionEnd(0) {
+  if (this->fp.open(fn) || this->readHeader()) {
+    fprintf(stderr, "Cannot open BCF file [ %s ]\n", fn.c_str());
+    exit(1);
+  }
+  this->sampleMask.resize(this->sampleName.size(), false);
+  buildEffectiveIndex();
+}
+
+bool BCF2File::isBCF2File(const std::string& fn) {
+  BGZFReader fp(0);
+  char magic[3];
+  if (fp.open(fn) || fp.read(magic, 3) != 3) return false;
+  // only compare major version, 2.1 and 2.2 use the same record layout
+  return magic[0] == 'B' && magic[1] == 'C' && magic[2] == 'F' &&
+         fp.read(magic, 1) == 1 && magic[0] == 2;
+}
+
+int BCF2File::readHeader() {
+  char magic[5];
+  if (this->fp.read(magic, 5) != 5 || strncmp(magic, "BCF\2", 4) ||
+      (magic[4] != 1 && magic[4] != 2)) {
+    fprintf(stderr, "File [ %s ] is not in BCF version 2.1 or 2.2\n",
+            this->fileName.c_str());
+    return -1;
+  }
+  uint32_t len;
+  if (this->fp.read(&len, 4) != 4) return -1;
+  this->header.resize(len);
+  if (len && this->fp.read(&this->header[0], len) != (int)len) return -1;
+  this->header.resize(strlen(this->header.c_str()));
+
+  // build dictionaries in the same order as bcf_hdr_parse() in htslib
+  std::vector<std::string> line;
+  std::vector<std::string> dict(1, "PASS");
+  std::vector<std::string> contig;
+  stringTokenize(this->header, '\n', &line);
+  for (size_t i = 0; i < line.size(); ++i) {
+    const std::string& s = line[i];
+    if (s.compare(0, 6, "#CHROM") == 0) {
+      std::vector<std::string> fd;
+      stringTokenize(s, '\t', &fd);
+      if (fd.size() > 9) {
+        this->sampleName.assign(fd.begin() + 9, fd.end());
+      }
+      continue;
+    }
+    const bool isContig = s.compare(0, 10, "##contig=<") == 0;
+    if (!isContig && s.compare(0, 8, "##INFO=<") &&
+        s.compare(0, 10, "##FILTER=<") && s.compare(0, 10, "##FORMAT=<")) {
+      continue;
+    }
+    const std::string name = getHeaderAttribute(s, "ID");
+    if (name.empty()) continue;
+    const std::string idx = getHeaderAttribute(s, "IDX");
+    if (isContig) {
+      addToDictionary(name, idx, &contig);
+    } else if (!this->dictionary.count(name)) {
+      // INFO and FORMAT fields of the same name share one entry
+      if (name != "PASS") addToDictionary(name, idx, &dict);
+      this->dictionary[name] = 0;
+    }
+  }
+  this->dictionary.clear();
+  for (size_t i = 0; i < dict.size(); ++i) {
+    if (!dict[i].empty()) this->dictionary[dict[i]] = i;
+  }
+  this->chromName = contig;
+  for (size_t i = 0; i < contig.size(); ++i) {
+    this->chromIndex[contig[i]] = i;
+  }
+  return 0;
+}
+
+int BCF2File::getKey(const char* tag) const {
+  std::map<std::string, int>::const_iterator it = this->dictionary.find(tag);
+  return it == this->dictionary.end() ? -1 : it->second;
+}
+
+bool BCF2File::readRecord() {
+  // skip variants that are not in the allowed sites
+  do {
+    if (!readVariant()) {
+      return false;
+    }
+  } while (!this->allowedSite.empty() &&
+           !this->allowedSite.contains(getChrom(), getPos()));
+  return true;
+}
+
+bool BCF2File::readVariant() {
+  if (this->mode == BCF_LINE_MODE) {
+    return loadRecord();
+  }
+
+  if (readRegionVariant()) return true;
+  // find valid region
+  for (; this->rangeIterator != this->range.end(); ++this->rangeIterator) {
+    std::map<std::string, int>::const_iterator it =
+        this->chromIndex.find(this->rangeIterator.getChrom());
+    if (it == this->chromIndex.end()) continue;
+    // the same as "chrom:beg-end" in tabix
+    this->regionTid = it->second;
+    this->regionBeg = this->rangeIterator.getBegin();
+    if (this->regionBeg > 0) --this->regionBeg;
+    this->regionEnd = this->rangeIterator.getEnd();
+    if (this->index.query(this->regionTid, this->regionBeg, this->regionEnd,
+                          &this->chunk)) {
+      continue;
+    }
+    this->chunkIdx = -1;
+    this->currOffset = 0;
+    if (readRegionVariant()) {
+      ++this->rangeIterator;
+      return true;
+    }
+  }
+  return false;
+}
+
+// same as hts_itr_next() in htslib
+bool BCF2File::readRegionVariant() {
+  const int nChunk = this->chunk.size();
+  while (nChunk > 0) {
+    if (this->currOffset == 0 ||
+        this->currOffset >= this->chunk[this->chunkIdx].second) {
+      // jump to the next chunk
+      if (this->chunkIdx == nChunk - 1) break;
+      if (this->chunkIdx < 0 || this->chunk[this->chunkIdx].second !=
+                                    this->chunk[this->chunkIdx + 1].first) {
+        // not adjacent chunks
+        if (this->fp.seek(this->chunk[this->chunkIdx + 1].first)) break;
+        this->currOffset = this->fp.tell();
+      }
+      ++this->chunkIdx;
+    }
+    if (!loadRecord()) break;
+    this->currOffset = this->fp.tell();
+    const int end = this->pos + (this->rlen > 0 ? this->rlen : 1);
+    if (this->tid != this->regionTid || this->pos >= this->regionEnd) {
+      break;  // no need to proceed
+    }
+    if (end > this->regionBeg) {
+      return true;
+    }
+  }
+  this->chunk.clear();  // finished
+  return false;
+}
+
+bool BCF2File::loadRecord() {
+  uint32_t len[2];  // l_shared and l_indiv
+  const int n = this->fp.read(len, sizeof(len));
+  if (n == 0) return false;  // file end
+  if (n != sizeof(len)) {
+    fprintf(stderr, "Truncated BCF record in [ %s ]\n",
+            this->fileName.c_str());
+    return false;
+  }
+  this->record.resize(len[0] + len[1]);
+  if (this->fp.read(this->record.data(), this->record.size()) !=
+          (int)this->record.size() ||
+      len[0] < 24 || len[0] > this->record.size() || !parseRecord(len[0])) {
+    fprintf(stderr, "Wrong BCF record in [ %s ]\n", this->fileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool BCF2File::parseRecord(const uint32_t sharedLen) {
+  const uint8_t* p = this->record.data();
+  const uint8_t* end = p + sharedLen;
+  // CHROM, POS, rlen, QUAL, n_info, n_allele, n_fmt and n_sample
+  this->tid = take<int32_t>(p);
+  this->pos = take<int32_t>(p + 4);
+  this->rlen = take<int32_t>(p + 8);
+  this->qual = take<float>(p + 12);
+  const int nInfo = take<uint16_t>(p + 16);
+  const int nAllele = take<uint16_t>(p + 18);
+  const uint32_t nFormatSample = take<uint32_t>(p + 20);
+  const int nSample = nFormatSample & 0xFFFFFF;
+  const int nFormat = nFormatSample >> 24;
+  if (this->tid < 0 || this->tid >= (int)this->chromName.size() ||
+      (nFormat && nSample != (int)this->sampleName.size())) {
+    return false;
+  }
+  p += 24;
+
+  Field f;
+  if (!(p = parseTypedValue(p, end, &f))) return false;
+  getString(f, &this->id);
+  if (this->id.empty()) this->id = ".";
+  this->allele.resize(nAllele);
+  for (int i = 0; i < nAllele; ++i) {
+    if (!(p = parseTypedValue(p, end, &f))) return false;
+    getString(f, &this->allele[i]);
+  }
+  if (!(p = parseTypedValue(p, end, &f))) return false;  // FILTER
+  this->info.resize(nInfo);
+  for (int i = 0; i < nInfo; ++i) {
+    if (!(p = parseTypedValue(p, end, &f)) || f.size != 1) return false;
+    this->info[i].key = takeInt(f.data, f.type);
+    if (!(p = parseTypedValue(p, end, &this->info[i]))) return false;
+  }
+
+  // FORMAT fields, each has a key, a type and values of all samples
+  p = end;
+  end = this->record.data() + this->record.size();
+  this->format.resize(nFormat);
+  for (int i = 0; i < nFormat; ++i) {
+    Field& fmt = this->format[i];
+    if (!(p = parseTypedValue(p, end, &f)) || f.size != 1) return false;
+    fmt.key = takeInt(f.data, f.type);
+    if (!(p = parseType(p, end, &fmt.type, &fmt.size))) return false;
+    fmt.data = p;
+    p += (size_t)nSample * fmt.size * typeSize[fmt.type];
+    if (p > end) return false;
+  }
+  return true;
+}
+
+bool BCF2File::isQualMissing() const {
+  uint32_t v;
+  memcpy(&v, &this->qual, sizeof(v));
+  return v == floatMissing;
+}
+
+const BCF2File::Field* BCF2File::getInfo(int key) const {
+  for (size_t i = 0; i < this->info.size(); ++i) {
+    if (this->info[i].key == key) return &this->info[i];
+  }
+  return NULL;
+}
+
+const BCF2File::Field* BCF2File::getFormat(int key) const {
+  for (size_t i = 0; i < this->format.size(); ++i) {
+    if (this->format[i].key == key) return &this->format[i];
+  }
+  return NULL;
+}
+
+int BCF2File::getInt(const Field& f, int idx) {
+  const uint8_t* p = f.data + idx * typeSize[f.type];
+  if (f.type == BCF_FLOAT) return (int)getDouble(f, idx);
+  if (f.type == BCF_CHAR) {
+    // same as VCFValue::toInt()
+    char buf[64];
+    return f.size > 0 ? atoi(takeText(p, f.size - idx % f.size, buf, 64)) : 0;
+  }
+  const int32_t v = takeInt(p, f.type);
+  return isIntValue(v, f.type) ? v : 0;
+}
+
+double BCF2File::getDouble(const Field& f, int idx) {
+  const uint8_t* p = f.data + idx * typeSize[f.type];
+  if (f.type == BCF_FLOAT) {
+    const uint32_t u = take<uint32_t>(p);
+    if (u == floatMissing || u == floatEndOfVector) return 0.0;
+    return take<float>(p);
+  }
+  if (f.type == BCF_CHAR) {
+    // same as VCFValue::toDouble()
+    char buf[64];
+    return f.size > 0 ? atof(takeText(p, f.size - idx % f.size, buf, 64))
+                      : 0.0;
+  }
+  const int32_t v = takeInt(p, f.type);
+  return isIntValue(v, f.type) ? v : 0.0;
+}
+
+void BCF2File::getString(const Field& f, std::string* s) {
+  if (f.type != BCF_CHAR) {
+    s->clear();
+    return;
+  }
+  s->assign((const char*)f.data, f.size);
+  s->resize(strlen(s->c_str()));  // strip padding
+}
+
+void BCF2File::getIncludedSampleName(std::vector<std::string>* p) const {
+  if (!p) return;
+  p->clear();
+  for (size_t i = 0; i != this->effectiveIndex.size(); ++i) {
+    p->push_back(this->sampleName[this->effectiveIndex[i]]);
+  }
+}
+
+//////////////////////////////////////////////////
+// Sample inclusion/exclusion
+void BCF2File::setPeopleMask(const std::string& s, bool b) {
+  if (s.empty()) return;
+  // as VCFRecord does, only included samples are tokenized by ','
+  std::vector<std::string> fd;
+  if (b) {
+    fd.push_back(s);
+  } else {
+    stringTokenize(s, ',', &fd);
+  }
+  for (size_t j = 0; j != fd.size(); ++j) {
+    bool found = false;
+    for (size_t i = 0; i != this->sampleName.size(); ++i) {
+      if (this->sampleName[i] == fd[j]) {
+        this->sampleMask[i] = b;
+        found = true;
+      }
+    }
+    if (!b && !found) {
+      fprintf(stderr, "Failed to include sample [ %s ] - not in BCF file.\n",
+              fd[j].c_str());
+    }
+  }
+  buildEffectiveIndex();
+}
+void BCF2File::setPeopleMaskFromFile(const char* fn, bool b) {
+  if (!fn || strlen(fn) == 0) {
+    return;
+  }
+  LineReader lr(fn);
+  std::vector<std::string> fd;
+  while (lr.readLineBySep(&fd, "\t ")) {
+    for (unsigned int i = 0; i < fd.size(); i++) {
+      setPeopleMask(fd[i], b);
+    }
+  }
+}
+void BCF2File::includePeople(const std::string& s) { setPeopleMask(s, false); }
+void BCF2File::includePeople(const std::vector<std::string>& v) {
+  for (size_t i = 0; i != v.size(); ++i) {
+    includePeople(v[i]);
+  }
+}
+void BCF2File::includePeopleFromFile(const char* fn) {
+  setPeopleMaskFromFile(fn, false);
+}
+void BCF2File::includeAllPeople() {
+  std::fill(this->sampleMask.begin(), this->sampleMask.end(), false);
+  buildEffectiveIndex();
+}
+void BCF2File::excludePeople(const std::string& s) { setPeopleMask(s, true); }
+void BCF2File::excludePeople(const std::vector<std::string>& v) {
+  for (size_t i = 0; i != v.size(); ++i) {
+    excludePeople(v[i]);
+  }
+}
+void BCF2File::excludePeopleFromFile(const char* fn) {
+  setPeopleMaskFromFile(fn, true);
+}
+void BCF2File::excludeAllPeople() {
+  std::fill(this->sampleMask.begin(), this->sampleMask.end(), true);
+  buildEffectiveIndex();
+}
+void BCF2File::buildEffectiveIndex() {
+  this->effectiveIndex.clear();
+  for (size_t i = 0; i != this->sampleMask.size(); ++i) {
+    if (this->sampleMask[i]) continue;
+    this->effectiveIndex.push_back(i);
+  }
+}
+
+//////////////////////////////////////////////////
+// Adjust range collections
+void BCF2File::enableAutoMerge() { this->autoMergeRange = true; }
+void BCF2File::disableAutoMerge() { this->autoMergeRange = false; }
+void BCF2File::setRangeFile(const char* fn) {
+  if (!fn || strlen(fn) == 0) return;
+  RangeList r;
+  r.addRangeFile(fn);
+  this->setRange(r);
+}
+// @param l is a string of range(s)
+void BCF2File::setRange(const char* chrom, int begin, int end) {
+  RangeList r;
+  r.addRange(chrom, begin, end);
+  this->setRange(r);
+}
+void BCF2File::setRange(const RangeList& rl) { this->setRangeList(rl); }
+void BCF2File::setRangeList(const std::string& l) {
+  if (l.empty()) return;
+
+  RangeList r;
+  r.addRangeList(l);
+  this->setRange(r);
+}
+// this function the entry point for all function add/change region list
+void BCF2File::setRangeList(const RangeList& rl) {
+  if (rl.size() == 0) return;
+
+  this->setRangeMode();
+
+  this->range.setRange(rl);
+  if (this->autoMergeRange) {
+    this->range.sort();
+  }
+  this->rangeIterator = this->range.begin();
+  this->chunk.clear();
+}
+
+void BCF2File::setRangeMode() {
+  if (this->mode == BCF_RANGE_MODE) return;
+  if (this->index.open(this->fileName)) {
+    fprintf(stderr,
+            "[ERROR] Cannot read BCF by range, please verify you have the "
+            "index file (or create one using bcftools index).\nQuitting...");
+    abort();
+  }
+  this->mode = BCF_RANGE_MODE;
+}
+
+int BCF2File::setSiteFile(const std::string& fn) {
+  this->allowedSite.loadSiteFile(fn);
+  return 0;
+}
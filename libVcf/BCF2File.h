@@ -0,0 +1,191 @@
+#ifndef _BCF2FILE_H_
+#define _BCF2FILE_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/BGZFReader.h"
+#include "base/CSIIndex.h"
+#include "base/RangeList.h"
+#include "base/SiteList.h"
+
+/**
+ * Read BCF2 files (BCF version 2.1 or 2.2, as written by bcftools and
+ * htslib) without converting records to VCF text.
+ *
+ * Site columns are decoded for each record; INFO and FORMAT fields are kept
+ * as typed binary arrays, so that callers decode only the fields they need
+ * (e.g. GT or DS) directly from the arrays.
+ * Reading by range uses the CSI index (.csi) of the file.
+ */
+class BCF2File {
+ public:
+  // types of typed values in the BCF2 specification
+  enum Type {
+    BCF_MISSING = 0,
+    BCF_INT8 = 1,
+    BCF_INT16 = 2,
+    BCF_INT32 = 3,
+    BCF_FLOAT = 5,
+    BCF_CHAR = 7
+  };
+  typedef enum {
+    BCF_LINE_MODE,  // read by line
+    BCF_RANGE_MODE  // read by range
+  } Mode;
+
+  /**
+   * A typed array: @var size values of type @var type per sample in
+   * FORMAT fields, or @var size values in total in INFO fields
+   */
+  struct Field {
+    int key;  // index in the string dictionary
+    int type;
+    int size;
+    const uint8_t* data;
+  };
+
+ public:
+  explicit BCF2File(const std::string& fn);
+  /**
+   * @return true if @param fn starts with the magic string of BCF2
+   */
+  static bool isBCF2File(const std::string& fn);
+
+  /**
+   * @return true: if a valid record is read
+   */
+  bool readRecord();
+
+  //////////////////////////////////////////////////
+  // Sample inclusion/exclusion
+  void includePeople(const std::string& s);
+  void includePeople(const std::vector<std::string>& v);
+  void includePeopleFromFile(const char* fn);
+  void includeAllPeople();
+  void excludePeople(const std::string& s);
+  void excludePeople(const std::vector<std::string>& v);
+  void excludePeopleFromFile(const char* fn);
+  void excludeAllPeople();
+  //////////////////////////////////////////////////
+  // Adjust range collections
+  void enableAutoMerge();
+  void disableAutoMerge();
+  void setRangeFile(const char* fn);
+  // @param l is a string of range(s)
+  void setRange(const char* chrom, int begin, int end);
+  void setRange(const RangeList& rl);
+  void setRangeList(const std::string& l);
+  // this function the entry point for all function add/change region list
+  void setRangeList(const RangeList& rl);
+
+  // which single-base chromosomal sites are allowed to read
+  int setSiteFile(const std::string& fn);
+
+ public:
+  const std::string& getHeader() const { return this->header; }
+  const std::vector<std::string>& getSampleName() const {
+    return this->sampleName;
+  }
+  void getIncludedSampleName(std::vector<std::string>* p) const;
+  int getNumEffectiveSample() const { return this->effectiveIndex.size(); }
+  // @return indices of included samples in the file, in file order
+  const std::vector<int>& getEffectiveIndex() const {
+    return this->effectiveIndex;
+  }
+  /**
+   * @return the index of @param tag in the string dictionary, or -1
+   */
+  int getKey(const char* tag) const;
+
+  // the current record
+  const std::string& getChrom() const { return this->chromName[this->tid]; }
+  int getPos() const { return this->pos + 1; }  // 1-based
+  const std::string& getID() const { return this->id; }
+  int getNumAllele() const { return this->allele.size(); }
+  const std::string& getAllele(int i) const { return this->allele[i]; }
+  bool isQualMissing() const;
+  float getQual() const { return this->qual; }
+  /**
+   * @return INFO or FORMAT field @param key of the current record, or NULL
+   */
+  const Field* getInfo(int key) const;
+  const Field* getFormat(int key) const;
+
+  /**
+   * Convert value @param idx of field @param f to an integer; missing
+   * values are 0, same as atoi(".") on VCF text.
+   * Character fields (Type=String in the header) are parsed as text by
+   * atoi(), where @param idx is the offset of the value in characters (e.g.
+   * sample j starts at j * f.size)
+   */
+  static int getInt(const Field& f, int idx);
+  /**
+   * Convert value @param idx of field @param f to double; missing values
+   * are 0.0, same as atof(".") on VCF text. Character fields are parsed by
+   * atof(), as in getInt()
+   */
+  static double getDouble(const Field& f, int idx);
+  static void getString(const Field& f, std::string* s);
+
+ private:
+  BCF2File(const BCF2File&);
+  BCF2File& operator=(const BCF2File&);
+
+ private:
+  int readHeader();
+  // read the next record in the file or in the current region, without
+  // checking allowed sites
+  bool readVariant();
+  bool readRegionVariant();
+  bool loadRecord();
+  bool parseRecord(const uint32_t sharedLen);
+
+  // sample inclusion/exclusion related
+  void setPeopleMask(const std::string& s, bool b);
+  void setPeopleMaskFromFile(const char* fn, bool b);
+  void buildEffectiveIndex();
+  void setRangeMode();
+
+ private:
+  std::string fileName;
+  BGZFReader fp;
+  std::string header;
+  std::vector<std::string> chromName;           // contig dictionary
+  std::map<std::string, int> chromIndex;        // reversed contig dictionary
+  std::map<std::string, int> dictionary;        // string dictionary
+  std::vector<std::string> sampleName;
+
+  // the current record
+  std::vector<uint8_t> record;  // l_shared + l_indiv bytes
+  int tid;
+  int pos;   // 0-based
+  int rlen;  // length of the reference allele (or up to INFO/END)
+  float qual;
+  std::string id;
+  std::vector<std::string> allele;
+  std::vector<Field> info;
+  std::vector<Field> format;
+
+  // reading by range
+  bool autoMergeRange;
+  Mode mode;
+  CSIIndex index;
+  RangeList range;
+  RangeList::iterator rangeIterator;
+  std::vector<CSIIndex::Chunk> chunk;  // chunks of the current region
+  int chunkIdx;                        // current chunk, -1 if not started
+  uint64_t currOffset;
+  int regionTid;
+  int regionBeg;  // 0-based, half open
+  int regionEnd;
+
+  std::vector<bool> sampleMask;     // true means exclusion
+  std::vector<int> effectiveIndex;  // index of unmasked samples
+  // allow chromosomal sites
+  SiteList allowedSite;
+};  // class BCF2File
+
+#endif /* _BCF2FILE_H_ */
@@ -293,26 +293,7 @@ void KGGInputFile::setRangeList(const RangeList& rl) {
 void KGGInputFile::setRangeMode() { warnUnsupported("setRangeMode"); }
 #endif
 int KGGInputFile::setSiteFile(const std::string& fn) {
-  if (fn.empty()) return 0;
-
-  std::vector<std::string> fd;
-  LineReader lr(fn);
-  int pos;
-  std::string chromPos;
-  while (lr.readLineBySep(&fd, "\t ")) {
-    if (fd.empty()) continue;
-    if (fd[0].find(':') != std::string::npos) {
-      this->allowedSite.insert(fd[0]);
-      continue;
-    }
-    if (fd.size() >= 2 && str2int(fd[1], &pos) && pos > 0) {
-      chromPos = fd[0];
-      chromPos += ':';
-      chromPos += fd[1];
-      this->allowedSite.insert(chromPos);
-      continue;
-    }
-  }
+  this->allowedSite.loadSiteFile(fn);
   return 0;
 }
 
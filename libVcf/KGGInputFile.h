@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "base/SiteList.h"
+
 class BufferedReader;
 
 class KGGInputFile {
@@ -120,7 +122,7 @@ class KGGInputFile {
   std::vector<bool> sampleMask;  // true means exclusion
   std::vector<int> effectiveIndex;
   // allow chromosomal sites
-  std::set<std::string> allowedSite;
+  SiteList allowedSite;
 };
 
 #endif /* _KGGINPUTFILE_H_ */
@@ -334,7 +334,10 @@ int PlinkInputFile::calculateMissing(std::vector<double>* imiss,
 int PlinkInputFile::readBED(unsigned char* buf, size_t n) {
   size_t nRead = 0;
   while (nRead < n) {
-    nRead += fread(buf + nRead, sizeof(unsigned char), n, this->fpBed);
+    size_t ret =
+        fread(buf + nRead, sizeof(unsigned char), n - nRead, this->fpBed);
+    if (ret == 0) break;  // truncated file or read error
+    nRead += ret;
   }
   return nRead;
 }
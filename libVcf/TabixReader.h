@@ -1,7 +1,10 @@
 #ifndef _TABIXREADER_H_
 #define _TABIXREADER_H_
 
+#include "base/BGZFReader.h"
+#include "base/Logger.h"
 #include "base/RangeList.h"
+#include "base/TabixIndex.h"
 #include "third/tabix/tabix.h"
 
 class TabixReader {
@@ -11,7 +14,8 @@ class TabixReader {
         hasIndex(false),
         readyToRead(false),
         tabixHandle(0),
-        ti_line(0) {
+        ti_line(0),
+        recordOffset(NULL) {
     open(fn);
   };
 
@@ -26,6 +30,18 @@ class TabixReader {
   bool good() const { return this->readyToRead; }
 
   bool readLine(std::string* line) {
+    char* s;
+    int len;
+    if (!readLineView(&s, &len)) return false;
+    line->assign(s, len);
+    return true;
+  }
+
+  /**
+   * Read a line without copying it. @param line points to an internal read
+   * buffer, which may be modified in place and is valid until the next read.
+   */
+  bool readLineView(char** line, int* len) {
     // openOK?
     if (cannotOpen) return false;
 
@@ -38,14 +54,17 @@ class TabixReader {
         if (!iter) return false;
       }
       if (!this->firstLine.empty()) {
-        (*line) = this->firstLine;
+        this->lineBuffer.swap(this->firstLine);
         this->firstLine.clear();
+        *line = &this->lineBuffer[0];
+        *len = this->lineBuffer.size();
         return true;
       }
       while ((ti_line = ti_read(this->tabixHandle, iter, &ti_line_len)) != 0) {
         // need to skip header here
         if ((int)(*ti_line) == idxconf->meta_char) continue;
-        (*line) = (ti_line);
+        *line = const_cast<char*>(ti_line);
+        *len = ti_line_len;
         return true;
       }
       return false;
@@ -54,43 +73,32 @@ class TabixReader {
     // read by region
     // check index
     assert(!range.empty());
-    if (!hasIndex) {
+    if (!hasIndex || openRegionReader()) {
       readyToRead = false;
       return false;
     }
 
-    if (iter) {
-      this->ti_line = ti_read(this->tabixHandle, iter, &ti_line_len);
-      if (this->ti_line) {
-        (*line) = ti_line;
-        return true;
-      }
+    if (readRegionLine()) {
+      *line = &this->regionLine[0];
+      *len = this->regionLine.size();
+      return true;
     }
 
     // find valid iter
     for (; this->rangeIterator != this->rangeEnd; ++rangeIterator) {
-      char rangeBuffer[128];
-      snprintf(rangeBuffer, 128, "%s:%u-%u",
-               this->rangeIterator.getChrom().c_str(),
-               this->rangeIterator.getBegin(), this->rangeIterator.getEnd());
-      rangeBuffer[127] = '\0';
-      int tid, beg, end;  // , len;
-      if (ti_parse_region(tabixHandle->idx, rangeBuffer, &tid, &beg, &end) !=
-          0) {
+      if (this->regionIndex.query(this->rangeIterator.getChrom(),
+                                  this->rangeIterator.getBegin(),
+                                  this->rangeIterator.getEnd(),
+                                  &this->regionIter)) {
         continue;
       }
-      ti_iter_destroy(iter);
-      iter = 0;
-      this->iter = ti_queryi(this->tabixHandle, tid, beg, end);
-      this->ti_line = ti_read(this->tabixHandle, this->iter, &ti_line_len);
-      if (ti_line) {
+      if (readRegionLine()) {
         ++rangeIterator;
-        (*line) = ti_line;
+        *line = &this->regionLine[0];
+        *len = this->regionLine.size();
         return true;
       }
     }
-    ti_iter_destroy(iter);
-    iter = 0;
 
     return false;
   };
@@ -106,6 +114,7 @@ class TabixReader {
   int setRange(const RangeList& r) {
     this->range.setRange(r);
     resetRangeIterator();
+    this->regionIter = TabixIndex::Iterator();
     if (this->iter) {
       ti_iter_destroy(iter);
       iter = 0;
@@ -120,6 +129,7 @@ class TabixReader {
   int addRange(const RangeList& r) {
     this->range.addRange(r);
     resetRangeIterator();
+    this->regionIter = TabixIndex::Iterator();
     if (this->iter) {
       ti_iter_destroy(iter);
       iter = 0;
@@ -127,6 +137,15 @@ class TabixReader {
     return 0;
   }
 
+  /**
+   * When reading by range, only read the records starting at @param offset, a
+   * sorted list of virtual file offsets (e.g. sites that pass filters in a
+   * VCFSiteIndex); NULL to read all records. @param offset is not copied.
+   */
+  void setRecordOffset(const std::vector<uint64_t>* offset) {
+    this->recordOffset = offset;
+  }
+
   /**
    * Some ranges may be overlapping, thus we merge those
    */
@@ -165,8 +184,32 @@ class TabixReader {
     // fpritnf(stderr, "done. Close index\n");
   };
 
+  /**
+   * Load the index and open the file again for reading by range, where data
+   * blocks are cached
+   * @return 0 if succeed
+   */
+  int openRegionReader() {
+    if (this->regionReader.isOpened()) return 0;
+    if (this->regionIndex.open(this->fileName) ||
+        this->regionReader.open(this->fileName)) {
+      this->regionReader.close();
+      return -1;
+    }
+    return 0;
+  }
+
+  bool readRegionLine() {
+    if (this->recordOffset) {
+      return this->regionIter.readLine(&this->regionReader, *this->recordOffset,
+                                       &this->regionLine);
+    }
+    return this->regionIter.readLine(&this->regionReader, &this->regionLine);
+  }
+
   int open(const std::string& fn) {
     ti_line = 0;
+    this->fileName = fn;
 
     // check file existance
     this->tabixHandle = ti_open(fn.c_str(), 0);
@@ -218,6 +261,18 @@ class TabixReader {
 
     closeIndex();
 
+    if (this->regionReader.isOpened()) {
+      // block cache statistics only go to the log file, if there is one
+      const BGZFReader& r = this->regionReader;
+      if (Logger::getHandle()) {
+        Logger::infoToFile(
+            "BGZF block cache: %llu hits, %llu misses (%.1f%% hit rate)",
+            (unsigned long long)r.getCacheHit(),
+            (unsigned long long)r.getCacheMiss(), 100.0 * r.getCacheHitRate());
+      }
+      this->regionReader.close();
+    }
+
     if (this->tabixHandle) {
       ti_close(this->tabixHandle);
       this->tabixHandle = 0;
@@ -250,6 +305,15 @@ class TabixReader {
 
   std::string header;
   std::string firstLine;
+  std::string lineBuffer;  // holds firstLine while it is being parsed
+
+  // reading by range
+  std::string fileName;
+  TabixIndex regionIndex;
+  TabixIndex::Iterator regionIter;
+  BGZFReader regionReader;
+  std::string regionLine;
+  const std::vector<uint64_t>* recordOffset;  // records to read, or NULL
 };
 
 #endif /* _TABIXREADER_H_ */
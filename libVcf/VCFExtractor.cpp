@@ -7,10 +7,10 @@ VCFExtractor::~VCFExtractor() {
     parRegion = NULL;
   }
 }
-bool VCFExtractor::passFilter() {
+bool VCFExtractor::passSiteFilter() {
   VCFRecord& r = this->getVCFRecord();
-  VCFPeople& people = r.getPeople();
   bool missing;
+  this->decoded = false;
 
   // quick checks: depth, qual, af
   if (checkSiteDepth() && useSiteDepthFromInfo()) {
@@ -45,67 +45,69 @@ bool VCFExtractor::passFilter() {
     }
   }
 
-  // shall we loop each individuals?
-  if ((checkSiteDepth() && !useSiteDepthFromInfo()) ||
-      (checkSiteFreq() && !useSiteFreqFromInfo()) || (checkSiteMAC()) ||
-      (isVariantSiteOnly())) {
-    // loop each individual and check
-    /* int dp = 0; */
-    /* int qual = 0; */
-    int mac = 0;
-    int ac = 0;
-    int an = 0;
-    double af = -1.0;
-    double nMiss = 0;  // number of missing
-    int gt = -9;
+  // check about sex chrom
+  if (!chromXRegionOK(r.getChrom(), r.getPos())) {
+    return false;
+  }
 
-    for (unsigned int i = 0; i < people.size(); i++) {
-      VCFIndividual* indv = people[i];
-      int GTidx = r.getFormatIndex("GT");
-      if (GTidx >= 0) {
-        gt = indv->get(0, &missing).getGenotype();  // [0] meaning the first
-                                                    // field of each individual
-      } else {
-        missing = true;
-      }
-      if (missing) {
-        nMiss++;
-      } else {
-        if (gt >= 0) {
-          an += 2;
-          ac += gt;
-        }
-      }
-    };
-    mac = (ac + ac > an) ? an - ac : ac;
-    af = an == 0 ? 0.0 : 1.0 * ac / an;
+  return true;
+}  // end passSiteFilter()
 
-    // check if it is variant site
-    if (this->isVariantSiteOnly() && ac == 0) {
-      return false;
-    };
+bool VCFExtractor::passFilter() {
+  // shall we loop each individuals?
+  if (!needGenotype()) {
+    return true;
+  }
 
-    // check site depth, freq, mac
-    if (!siteDepthOK(ac)) {
-      return false;
+  VCFRecord& r = this->getVCFRecord();
+  VCFPeople& people = r.getPeople();
+
+  // decode each individual once, and keep the genotypes for the caller
+  int ac = 0;
+  int an = 0;
+  const int GTidx = r.getFormatIndex("GT");
+  this->genotype.resize(people.size());
+  for (unsigned int i = 0; i < people.size(); i++) {
+    const int gt = GTidx >= 0 ? people[i]->justGet(GTidx).getGenotype()
+                              : MISSING_GENOTYPE;
+    this->genotype[i] = gt;
+    if (gt >= 0) {
+      an += 2;
+      ac += gt;
     }
+  };
+  this->decoded = true;
+  return alleleCountOK(ac, an);
+};  // end passFilter()
+
+bool VCFExtractor::needSiteIndex() const {
+  return checkSiteMAC() || isVariantSiteOnly() || requiredAnnotation();
+}
+
+// allele counts in the index are over all samples; MAC and AC of the included
+// samples cannot be larger, so sites failing here cannot pass passFilter()
+bool VCFExtractor::passSiteIndex(const VCFSiteIndex::Site& s) {
+  if (this->isVariantSiteOnly() && s.ac == 0) {
+    return false;
+  }
+  if (checkSiteMAC()) {
+    const int mac = (s.ac + s.ac > s.an) ? s.an - s.ac : s.ac;
     if (!siteMACOK(mac)) {
       return false;
     }
-    if (!siteFreqOK(af)) {
-      return false;
-    }
   }
-
-  // check about sex chrom
-  if (this->chromXExtraction == PAR) {
-    if (!parRegion) this->parRegion = new ParRegion;
-    if (!parRegion->isParRegion(r.getChrom(), r.getPos())) return false;
-  }
-  if (this->chromXExtraction == HEMI) {
-    if (!parRegion) this->parRegion = new ParRegion;
-    if (!parRegion->isHemiRegion(r.getChrom(), r.getPos())) return false;
+  if (requiredAnnotation()) {
+    if (s.anno < 0) return false;
+    if (this->annotationMatch.empty()) {
+      this->annotationMatch.resize(
+          this->getSiteIndex()->getAnnotation().size(), -1);
+    }
+    int& match = this->annotationMatch[s.anno];
+    if (match < 0) {
+      match = matchAnnotatoin(
+          this->getSiteIndex()->getAnnotation()[s.anno].c_str());
+    }
+    if (!match) return false;
   }
-
   return true;
-};  // end passFilter()
+}
@@ -1,10 +1,38 @@
 #include "VCFInputFile.h"
 #include "VCFFilter.h"
 #include <string>
+#include <vector>
 
+/**
+ * Read VCF records that pass the filters in two phases: site-level filters
+ * (QUAL, INFO fields, annotation, chromosome X region) run on the first
+ * columns, so sample columns of rejected sites are never parsed; then
+ * filters that need genotypes (site depth, frequency or MAC from genotypes,
+ * variant sites only) decode GT of all samples in one pass.
+ * When reading the whole file, a site index (VCFSiteIndex) is used if it
+ * exists, so that sites failing MAC, variant site or annotation filters are
+ * not read.
+ */
 class VCFExtractor : public VCFInputFile, public VCFSiteFilter {
  public:
-  VCFExtractor(const std::string& fn) : VCFInputFile(fn){};
+  VCFExtractor(const std::string& fn) : VCFInputFile(fn), decoded(false){};
   virtual ~VCFExtractor();
+  bool passSiteFilter();
   bool passFilter();
+  bool needSiteIndex() const;
+  bool passSiteIndex(const VCFSiteIndex::Site& site);
+  /**
+   * @return GT of the current record decoded by passFilter(), in the order
+   * of included people, or NULL if genotypes were not decoded
+   */
+  const std::vector<int>* getDecodedGenotype() const {
+    return this->decoded ? &this->genotype : NULL;
+  }
+
+ private:
+  bool decoded;               // whether @var genotype is for current record
+  std::vector<int> genotype;  // decoded GT of each included individual
+  // whether each annotation in the site index matches (1), does not match
+  // (0) or is not checked yet (-1)
+  std::vector<int> annotationMatch;
 };
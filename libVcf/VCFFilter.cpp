@@ -29,3 +29,37 @@ VCFSiteFilter::~VCFSiteFilter() {
     parRegion = NULL;
   }
 }
+
+bool VCFSiteFilter::alleleCountOK(int ac, int an) const {
+  const int mac = (ac + ac > an) ? an - ac : ac;
+  const double af = an == 0 ? 0.0 : 1.0 * ac / an;
+
+  // check if it is variant site
+  if (this->isVariantSiteOnly() && ac == 0) {
+    return false;
+  };
+
+  // check site depth, freq, mac
+  if (!siteDepthOK(ac)) {
+    return false;
+  }
+  if (!siteMACOK(mac)) {
+    return false;
+  }
+  if (!siteFreqOK(af)) {
+    return false;
+  }
+  return true;
+}
+
+bool VCFSiteFilter::chromXRegionOK(const std::string& chrom, int pos) {
+  if (this->chromXExtraction == PAR) {
+    if (!parRegion) this->parRegion = new ParRegion;
+    if (!parRegion->isParRegion(chrom, pos)) return false;
+  }
+  if (this->chromXExtraction == HEMI) {
+    if (!parRegion) this->parRegion = new ParRegion;
+    if (!parRegion->isHemiRegion(chrom, pos)) return false;
+  }
+  return true;
+}
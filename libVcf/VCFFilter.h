@@ -1,6 +1,8 @@
 #ifndef _VCFFILTER_H_
 #define _VCFFILTER_H_
 
+#include <string>
+
 #include "base/Regex.h"
 
 class ParRegion;
@@ -81,6 +83,21 @@ class VCFSiteFilter {
   bool matchAnnotatoin(const char* s) { return this->annoRegex.match(s); }
   bool isVariantSiteOnly() const { return this->onlyVariantSite; };
 
+  // whether the filters need genotypes of all samples (alleleCountOK())
+  bool needGenotype() const {
+    return (checkSiteDepth() && !useSiteDepthFromInfo()) ||
+           (checkSiteFreq() && !useSiteFreqFromInfo()) || checkSiteMAC() ||
+           isVariantSiteOnly();
+  }
+  /**
+   * Check variant site, site depth, MAC and frequency filters by @param ac
+   * alt alleles in @param an alleles of genotyped samples; site depth is
+   * checked against @param ac
+   */
+  bool alleleCountOK(int ac, int an) const;
+  // check if @param chrom:@param pos is in the chromosome X region to extract
+  bool chromXRegionOK(const std::string& chrom, int pos);
+
   void setParRegion(ParRegion* p) { this->parRegion = p; }
   void setExtractChromXParRegion() { this->chromXExtraction = PAR; }
 
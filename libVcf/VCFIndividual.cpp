@@ -6,17 +6,19 @@ char VCFIndividual::defaultValue[2] = {'.', '\0'};
 VCFValue VCFIndividual::defaultVCFValue(&(defaultValue[0]), 0, 0);
 
 void VCFIndividual::output(FileWriter* fp) const {
-  for (unsigned int i = 0; i < fdLen; ++i) {
+  const size_t n = size();
+  for (size_t i = 0; i < n; ++i) {
     if (i) fp->write(':');
-    this->fd[i].output(fp);
+    getField(i).output(fp);
   }
 }
 
 void VCFIndividual::toStr(std::string* fp) const {
   std::string s;
-  for (unsigned int i = 0; i < fdLen; ++i) {
+  const size_t n = size();
+  for (size_t i = 0; i < n; ++i) {
     if (i) fp->push_back(':');
-    this->fd[i].toStr(&s);
+    getField(i).toStr(&s);
     fp->append(s);
   }
 }
@@ -1,7 +1,6 @@
 #ifndef _VCFINDIVIDUAL_H_
 #define _VCFINDIVIDUAL_H_
 
-#include "VCFBuffer.h"
 #include "VCFFunction.h"
 #include "VCFValue.h"
 
@@ -9,53 +8,35 @@
 
 class FileWriter;
 
+/**
+ * Sample columns of the current VCF record, stored as flat arrays over all
+ * samples instead of per-sample containers. VCFRecord::parseIndividual()
+ * fills it in one pass, and each VCFIndividual is a view of one column.
+ *
+ * Field j of sample i spans [bound[k + j], bound[k + j + 1] - 1) of @var line,
+ * where k = i * stride, and j < numField[i].
+ */
+struct VCFSampleField {
+  VCFSampleField() : line(NULL), stride(1) {}
+  char* line;                 // parsed VCF line
+  int stride;                 // number of FORMAT fields + 1
+  std::vector<int> bound;     // field begins and column end of each sample
+  std::vector<int> numField;  // number of fields of each sample
+};
+
 // we assume format are always  GT:DP:GQ:GL
 class VCFIndividual {
  public:
-  // FUNC parseFunction[4];
-  VCFIndividual() : fdLen(0) {
+  VCFIndividual() : field(NULL), index(0) {
     this->include();  // by default, enable everyone
   }
   /**
-   * 0-base index for beg and end, e.g.
-   *     0 1 2  3
-   *     A B C \t
-   * beg = 0, end = 3 (line[end] = '\t' or line[end] = '\0')
-   *
-   * @return
+   * Make this individual the view of the @param index th sample column in
+   * @param field
    */
-  void parse(const VCFValue& vcfValue) {
-    // skip to next
-    if (!this->isInUse()) {
-      return;
-    }
-
-    this->parsed.attach(&vcfValue.line[vcfValue.beg],
-                        vcfValue.end - vcfValue.beg);
-
-    size_t idx = 0;
-    int beg = 0;
-    int ret;
-    while (true) {
-      if (idx == fdLen) {
-        // VCFValue v;
-        // fd.push_back(v);
-        ++fdLen;
-        fd.resize(fdLen);
-      }
-      VCFValue& v = fd[idx++];
-      ret = v.parseTill(this->parsed, beg, ':');
-      this->parsed[v.end] = '\0';
-      beg = v.end + 1;
-      if (ret == 1) {  // last element
-        break;
-      }
-    }
-    fdLen = idx;
-    if (fdLen == 0) {
-      fprintf(stderr, "Empty individual column - very strange!!\n");
-      fprintf(stderr, "vcfValue = %s\n", vcfValue.toStr());
-    }
+  void attach(const VCFSampleField* field, int index) {
+    this->field = field;
+    this->index = index;
   }
 
   const std::string& getName() const { return this->name; }
@@ -64,66 +45,66 @@ class VCFIndividual {
   void exclude() { this->inUse = false; }
   bool isInUse() { return this->inUse; }
 
-  const VCFValue& operator[](const unsigned int i) const
-      __attribute__((deprecated)) {
-    if (i >= fdLen) {
+  VCFValue operator[](const unsigned int i) const __attribute__((deprecated)) {
+    if (i >= size()) {
       FATAL("index out of bound!");
     }
-    return (this->fd[i]);
-  }
-  VCFValue& operator[](const unsigned int i) __attribute__((deprecated)) {
-    if (i >= fdLen) {
-      FATAL("index out of bound!");
-    }
-    return (this->fd[i]);
+    return getField(i);
   }
   /**
    * @param isMissing: index @param i does not exists. Not testing if the value
    * in ith field is missing
    */
-  const VCFValue& get(unsigned int i, bool* isMissing) const {
-    if (i >= fdLen) {
+  VCFValue get(unsigned int i, bool* isMissing) const {
+    if (i >= size()) {
       *isMissing = true;
       return VCFIndividual::defaultVCFValue;
     }
-    *isMissing = this->fd[i].isMissing();
-    return (this->fd[i]);
+    const VCFValue v = getField(i);
+    *isMissing = v.isMissing();
+    return v;
   }
   /**
    * @return VCFValue without checking missingness
    */
-  const VCFValue& justGet(unsigned int i) {
-    if (i >= fdLen) {
+  VCFValue justGet(unsigned int i) const {
+    if (i >= size()) {
       return VCFIndividual::defaultVCFValue;
     }
-    return (this->fd[i]);
+    return getField(i);
   }
 
-  // VCFValue& getSelf() { return this->self; }
-  // const VCFValue& getSelf() const { return this->self; }
-
-  size_t size() const { return this->fdLen; }
+  size_t size() const {
+    if (!this->field || this->index >= (int)this->field->numField.size()) {
+      return 0;
+    }
+    return this->field->numField[this->index];
+  }
   /**
    * dump the content of VCFIndividual column
    */
   void output(FILE* fp) const {
-    for (size_t i = 0; i < fdLen; ++i) {
+    const size_t n = size();
+    for (size_t i = 0; i < n; ++i) {
       if (i) fputc(':', fp);
-      this->fd[i].output(fp);
+      getField(i).output(fp);
     }
   }
   void output(FileWriter* fp) const;
   void toStr(std::string* s) const;
 
+ private:
+  VCFValue getField(unsigned int i) const {
+    const int* b = &this->field->bound[this->index * this->field->stride + i];
+    return VCFValue(this->field->line, b[0], b[1] - 1);
+  }
+
  private:
   bool inUse;
-  std::string name;  // id name
-  // VCFValue self;             // whole field for the individual (unparsed)
-  VCFBuffer parsed;          // store parsed string (where \0 added)
-  std::vector<VCFValue> fd;  // each field separated by ':', for optimizaiton,
-                             // do not use clear(), resize()
+  std::string name;             // id name
+  const VCFSampleField* field;  // sample columns of the current record
+  int index;                    // column index in @var field
 
-  size_t fdLen;  // number of elements in fd
   static VCFValue defaultVCFValue;
   static char defaultValue[2];
 };  // end VCFIndividual
@@ -112,7 +112,11 @@ void VCFInputFile::init(const char* fn) {
   this->fp = NULL;
   this->tabixReader = NULL;
   this->bcfReader = NULL;
+  this->siteIndex = NULL;
+  this->siteIndexPos = 0;
+  this->siteIndexChecked = false;
   this->autoMergeRange = false;
+  this->linePtr = "";
 
   // check whether file exists.
   FILE* fp = fopen(fn, "rb");
@@ -178,32 +182,91 @@ void VCFInputFile::close() {
     delete this->bcfReader;
     this->bcfReader = NULL;
   }
+  if (this->siteIndex) {
+    delete this->siteIndex;
+    this->siteIndex = NULL;
+  }
+}
+
+void VCFInputFile::openSiteIndex() {
+  this->siteIndexChecked = true;
+  if (!this->needSiteIndex()) return;
+  VCFSiteIndex* p = new VCFSiteIndex;
+  if (p->open(this->fileName)) {
+    delete p;
+    return;
+  }
+  this->siteIndex = p;
+  this->siteIndexPos = 0;
+}
+
+int VCFInputFile::readLineBySiteIndex(char** line) {
+  const std::vector<VCFSiteIndex::Site>& site = this->siteIndex->getSite();
+  while (this->siteIndexPos < site.size()) {
+    const VCFSiteIndex::Site& s = site[this->siteIndexPos++];
+    if (!this->passSiteIndex(s)) continue;
+    return this->siteIndex->readLine(s, line);
+  }
+  return 0;
+}
+
+void VCFInputFile::setRangeSiteIndex() {
+  this->openSiteIndex();
+  if (!this->siteIndex) return;
+
+  // ranges then only seek to these sites in their tabix chunks
+  const std::vector<VCFSiteIndex::Site>& site = this->siteIndex->getSite();
+  this->siteIndexOffset.clear();
+  for (size_t i = 0; i < site.size(); ++i) {
+    if (this->passSiteIndex(site[i])) {
+      this->siteIndexOffset.push_back(site[i].offset);
+    }
+  }
+  this->tabixReader->setRecordOffset(&this->siteIndexOffset);
 }
 
 bool VCFInputFile::readRecord() {
-  int nRead = 0;
+  // lines are parsed in place inside the buffer of the reader
+  char* s = NULL;
+  int len = 0;
   while (true) {
+    bool ok = false;
     if (this->mode == VCF_LINE_MODE) {
-      nRead = this->fp->readLine(&this->line);
+      if (!this->siteIndexChecked) {
+        this->openSiteIndex();
+      }
+      if (this->siteIndex) {
+        len = this->readLineBySiteIndex(&s);
+      } else if (!this->fp->readLineView(&s, &len)) {
+        len = 0;
+      }
+      ok = len > 0;
     } else if (this->mode == VCF_RANGE_MODE) {
-      nRead = this->tabixReader->readLine(&this->line);
+      if (!this->siteIndexChecked) {
+        this->setRangeSiteIndex();
+      }
+      ok = this->tabixReader->readLineView(&s, &len);
     } else if (this->mode == BCF_MODE) {
-      nRead = this->bcfReader->readLine(&this->line);
+      ok = this->bcfReader->readLine(&this->line);
+      s = &this->line[0];
+      len = this->line.size();
     }
-    if (!nRead) return false;
+    if (!ok) return false;
+    this->linePtr = s;
 
     // star parsing
     int ret;
-    this->record.attach(&this->line);
+    this->record.attach(s, len);
     ret = this->record.parseSite();
     if (ret) {
-      reportReadError(this->line);
+      reportReadError(std::string(s, len));
     }
     if (!this->isAllowedSite()) continue;
+    if (!this->passSiteFilter()) continue;
 
     ret = this->record.parseIndividual();
     if (ret) {
-      reportReadError(this->line);
+      reportReadError(std::string(s, len));
     }
     if (!this->passFilter()) continue;
 
@@ -281,26 +344,7 @@ void VCFInputFile::setRangeList(const RangeList& rl) {
 }
 
 int VCFInputFile::setSiteFile(const std::string& fn) {
-  if (fn.empty()) return 0;
-
-  std::vector<std::string> fd;
-  LineReader lr(fn);
-  int pos;
-  std::string chromPos;
-  while (lr.readLineBySep(&fd, "\t ")) {
-    if (fd.empty()) continue;
-    if (fd[0].find(':') != std::string::npos) {
-      this->allowedSite.insert(fd[0]);
-      continue;
-    }
-    if (fd.size() >= 2 && str2int(fd[1], &pos) && pos > 0) {
-      chromPos = fd[0];
-      chromPos += ':';
-      chromPos += fd[1];
-      this->allowedSite.insert(chromPos);
-      continue;
-    }
-  }
+  this->allowedSite.loadSiteFile(fn);
   return 0;
 }
 
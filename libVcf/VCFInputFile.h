@@ -4,6 +4,8 @@
 // #include "tabix.h"
 #include "VCFFilter.h"
 #include "VCFRecord.h"
+#include "VCFSiteIndex.h"
+#include "base/SiteList.h"
 
 class TabixReader;
 class BCFReader;
@@ -58,10 +60,25 @@ class VCFInputFile {
       fprintf(stderr, "Error line [ %s ]\n", line.c_str());
     }
   }
+  /**
+   * Check with VCFFilter to see if the current read site passed, using only
+   * the first columns (before any sample column is parsed)
+   */
+  virtual bool passSiteFilter() { return true; };
   /**
    * Check with VCFFilter to see if the current read line passed
    */
   virtual bool passFilter() { return true; };
+  /**
+   * Whether to read the file (as a whole or by range) through its site index
+   * (see VCFSiteIndex), if the index exists
+   */
+  virtual bool needSiteIndex() const { return false; };
+  /**
+   * Check if a site in the site index may pass filters; other sites are not
+   * read at all
+   */
+  virtual bool passSiteIndex(const VCFSiteIndex::Site& site) { return true; };
   /**
    * Check if the current read VCF site is allowed
    */
@@ -69,11 +86,8 @@ class VCFInputFile {
     // no restriction on allowed sites
     if (this->allowedSite.empty()) return true;
 
-    std::string chromPos = this->record.getChrom();
-    chromPos += ":";
-    chromPos += (this->record.getPosStr());
-    if (this->allowedSite.count(chromPos)) return true;
-    return false;
+    return this->allowedSite.contains(this->record.getChrom(),
+                                      this->record.getPos());
   }
   /**
    * @return true: a valid VCFRecord
@@ -113,12 +127,17 @@ class VCFInputFile {
   int updateId(const char* fn);
 
   VCFRecord& getVCFRecord() { return this->record; };
-  const char* getLine() const { return this->line.c_str(); };
+  const char* getLine() const { return this->linePtr; };
   const char* getFileName() const { return this->fileName.c_str(); };
+  // @return the site index in use, or NULL
+  const VCFSiteIndex* getSiteIndex() const { return this->siteIndex; };
   void getIncludedPeopleName(std::vector<std::string>* p);
 
  private:
   void setRangeMode();
+  void openSiteIndex();
+  int readLineBySiteIndex(char** line);
+  void setRangeSiteIndex();
 
  private:
   VCFHeader header;
@@ -140,14 +159,20 @@ class VCFInputFile {
 
   Mode mode;
   std::string line;
+  const char* linePtr;  // the line last read, owned by the reader
 
   // readers
   LineReader* fp;
   TabixReader* tabixReader;
   BCFReader* bcfReader;
+  VCFSiteIndex* siteIndex;  // used in VCF_LINE/RANGE_MODE if not NULL
+  size_t siteIndexPos;      // next site to check in the site index
+  bool siteIndexChecked;
+  // offsets of sites passing passSiteIndex(), used in VCF_RANGE_MODE
+  std::vector<uint64_t> siteIndexOffset;
 
   // allow chromosomal sites
-  std::set<std::string> allowedSite;
+  SiteList allowedSite;
 };
 
 #endif /* _VCFINPUTFILE_H_ */
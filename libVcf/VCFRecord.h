@@ -42,12 +42,12 @@ class VCFRecord {
 
   void attach(std::string* pVcfLine) {
     std::string& vcfLine = *pVcfLine;
+    attach(&vcfLine[0], (int)vcfLine.size());
+  }
+  // @param line needs to be '\0'-terminated and stay valid while parsing
+  void attach(char* line, int len) {
     this->vcfInfo.reset();
-    // this->parsed = vcfLine.c_str();
-    // this->self.line = this->parsed.c_str();
-    // this->self.beg = 0;
-    // this->self.end = this->parsed.size();
-    this->parsed.attach(&vcfLine[0], (int)vcfLine.size());
+    this->parsed.attach(line, len);
   }
 
   int parseSite() {
@@ -124,62 +124,72 @@ class VCFRecord {
     return 0;
   }
 
+  /**
+   * Split the sample columns by '\t' and ':' in one pass, and record their
+   * offsets in @var sampleField, which all VCFIndividual views share
+   */
   int parseIndividual() {
-    int ret;
-    // now comes each individual genotype
+    const int numSample = allIndv.size();
+    if (numSample == 0) {
+      fprintf(stderr, "VCF header have LESS people than VCF content!\n");
+      return -1;
+    }
+    int numFormat = 1;
+    for (int i = this->format.beg; i < this->format.end; ++i) {
+      if (this->parsed[i] == ':') ++numFormat;
+    }
+    VCFSampleField& f = this->sampleField;
+    f.line = this->parsed.getBuffer();
+    f.stride = numFormat + 1;
+    f.bound.resize(numSample * f.stride);
+    f.numField.resize(numSample);
+
+    // find all delimiters at once, then walk through them
+    char* line = f.line;
+    const int beg = this->format.end + 1;
+    const int len = this->parsed.size();
+    if ((int)this->delimiter.size() < len - beg + 1) {
+      this->delimiter.resize(len - beg + 1);
+    }
+    const int numDelimiter =
+        findAllChar(line + beg, len - beg, '\t', ':', &this->delimiter[0]);
+
+    int* bound = &f.bound[0];
     int idx = 0;  // peopleIdx
-    // VCFIndividual* p;
-    const int NumAllIndvSize = allIndv.size();
-    indv.resize(NumAllIndvSize);
-    int beg = this->format.end + 1;
-    while ((ret = indv[idx].parseTill(this->parsed, beg, '\t')) == 0) {
-      if (idx >= (int)NumAllIndvSize) {
+    int nField = 0;
+    bound[0] = beg;
+    for (int i = 0; i <= numDelimiter; ++i) {
+      const int p = i < numDelimiter ? beg + this->delimiter[i] : len;
+      if (line[p] == ':') {
+        // extra fields (not in FORMAT) are kept in the last field
+        if (nField + 1 < numFormat) {
+          line[p] = '\0';
+          bound[++nField] = p + 1;
+        }
+        continue;
+      }
+      line[p] = '\0';
+      bound[nField + 1] = p + 1;
+      f.numField[idx++] = nField + 1;
+      if (p == len) {
+        break;
+      }
+      if (idx == numSample) {
         fprintf(stderr,
                 "Expected %d individual but already have %d individual\n",
-                NumAllIndvSize, idx);
+                numSample, idx + 1);
         fprintf(stderr, "VCF header have LESS people than VCF content!\n");
         return -1;
       }
-
-      this->parsed[indv[idx].end] = '\0';
-
-      // defer parsing individual fields (e.g. GT,DS) later.
-      // p = this->allIndv[idx];
-      // p->parse(indv);
-
-      beg = indv[idx].end + 1;
-      idx++;
+      bound += f.stride;
+      bound[0] = p + 1;
+      nField = 0;
     }
 
-    // if ret == 1 menas reaches end of this->parsed
-    if (ret != 1) {
-      fputs("Parsing error in line: ", stderr);
-      this->parsed.output(stderr);
-      fputc('\n', stderr);
-      return -1;
-    } else {  // reach the end
-      this->parsed[indv[idx].end] = '\0';
-      // p = this->allIndv[idx];
-      // p->parse(indv);
-      // this->allIndv[idx]->parse();
-      idx++;
-    }
-
-    assert(idx == NumAllIndvSize);
-
-#pragma omp parallel for
-    for (int i = 0; i < idx; ++i) {
-      this->allIndv[i]->parse(indv[i]);
-    }
-
-    if (idx > NumAllIndvSize) {
-      fprintf(stderr, "Expected %d individual but already have %d individual\n",
-              NumAllIndvSize, idx);
-      REPORT("VCF header have MORE people than VCF content!");
-    } else if (idx < NumAllIndvSize) {
+    if (idx < numSample) {
       fprintf(stderr, "Expected %d individual but only have %d individual\n",
-              NumAllIndvSize, idx);
-      REPORT("VCF header have LESS people than VCF content!");
+              numSample, idx);
+      REPORT("VCF header have MORE people than VCF content!");
       return -1;
     }
 
@@ -207,6 +217,7 @@ class VCFRecord {
       int idx = i - 9;
       VCFIndividual* p = new VCFIndividual;
       this->allIndv[idx] = p;
+      p->attach(&this->sampleField, idx);
       p->setName(sa[i]);
     }
   }
@@ -468,7 +479,8 @@ class VCFRecord {
 
   VCFInfo vcfInfo;
 
-  std::vector<VCFValue> indv;  // store individual fields
+  VCFSampleField sampleField;  // offsets of all sample columns
+  std::vector<int> delimiter;  // offsets of '\t' and ':' in sample columns
 
   // indicates if getPeople() has been called
   bool hasAccess;
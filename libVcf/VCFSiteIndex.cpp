@@ -0,0 +1,247 @@
+#include "VCFSiteIndex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+
+#include "VCFConstant.h"
+#include "VCFRecord.h"
+
+static const char VSI_MAGIC[4] = {'V', 'S', 'I', '\1'};
+
+// each site is stored field by field as offset, ac, an, numMissing and anno,
+// so the file layout does not depend on the padding of VCFSiteIndex::Site
+static const size_t VSI_SITE_SIZE = sizeof(uint64_t) + 4 * sizeof(int32_t);
+// number of sites converted at a time
+static const size_t VSI_SITE_BATCH = 4096;
+
+static void encodeSite(const VCFSiteIndex::Site& s, char* p) {
+  memcpy(p, &s.offset, sizeof(uint64_t));
+  p += sizeof(uint64_t);
+  memcpy(p, &s.ac, sizeof(int32_t));
+  memcpy(p + 4, &s.an, sizeof(int32_t));
+  memcpy(p + 8, &s.numMissing, sizeof(int32_t));
+  memcpy(p + 12, &s.anno, sizeof(int32_t));
+}
+
+static void decodeSite(const char* p, VCFSiteIndex::Site* s) {
+  memcpy(&s->offset, p, sizeof(uint64_t));
+  p += sizeof(uint64_t);
+  memcpy(&s->ac, p, sizeof(int32_t));
+  memcpy(&s->an, p + 4, sizeof(int32_t));
+  memcpy(&s->numMissing, p + 8, sizeof(int32_t));
+  memcpy(&s->anno, p + 12, sizeof(int32_t));
+}
+
+// size and modification time identify a version of the VCF file
+static int getFileStamp(const std::string& fn, int64_t stamp[2]) {
+  struct stat st;
+  if (stat(fn.c_str(), &st)) {
+    return -1;
+  }
+  stamp[0] = st.st_size;
+  stamp[1] = st.st_mtime;
+  return 0;
+}
+
+int VCFSiteIndex::build(const std::string& fn) {
+  int64_t stamp[2];
+  if (getFileStamp(fn, stamp)) {
+    fprintf(stderr, "Cannot open VCF file [ %s ]\n", fn.c_str());
+    return -1;
+  }
+  BGZF* in = bgzf_open(fn.c_str(), "r");
+  if (!in) {
+    fprintf(stderr, "Cannot open VCF file [ %s ]\n", fn.c_str());
+    return -1;
+  }
+
+  std::vector<Site> site;
+  std::vector<std::string> annotation;
+  std::map<std::string, int> annotationIndex;
+  VCFRecord record;
+  bool headerLoaded = false;
+  kstring_t str = {0, 0, NULL};
+  std::string line;
+  int ret = 0;
+  uint64_t offset = bgzf_tell(in);
+  while (bgzf_getline(in, '\n', &str) >= 0) {
+    line.assign(str.s, str.l);
+    if (!headerLoaded) {
+      if (line.compare(0, 6, "#CHROM") == 0) {
+        record.createIndividual(line);
+        headerLoaded = true;
+      } else if (line.empty() || line[0] != '#') {
+        ret = -1;
+        break;
+      }
+      offset = bgzf_tell(in);
+      continue;
+    }
+    if (line.empty()) {
+      offset = bgzf_tell(in);
+      continue;
+    }
+    if (record.parse(&line)) {
+      ret = -1;
+      break;
+    }
+
+    Site s;
+    s.offset = offset;
+    s.ac = s.an = s.numMissing = 0;
+    s.anno = -1;
+
+    bool missing;
+    const VCFValue& v = record.getInfoTag("ANNO", &missing);
+    if (!missing) {
+      const std::string anno = v.toStr();
+      std::map<std::string, int>::const_iterator it =
+          annotationIndex.find(anno);
+      if (it == annotationIndex.end()) {
+        s.anno = annotation.size();
+        annotationIndex[anno] = s.anno;
+        annotation.push_back(anno);
+      } else {
+        s.anno = it->second;
+      }
+    }
+    VCFPeople& people = record.getPeople();
+    const int GTidx = record.getFormatIndex("GT");
+    for (size_t i = 0; i < people.size(); ++i) {
+      const int gt = GTidx >= 0 ? people[i]->justGet(GTidx).getGenotype()
+                                : MISSING_GENOTYPE;
+      if (gt >= 0) {
+        s.an += 2;
+        s.ac += gt;
+      } else {
+        s.numMissing++;
+      }
+    }
+    site.push_back(s);
+    offset = bgzf_tell(in);
+  }
+  free(str.s);
+  bgzf_close(in);
+  if (ret || !headerLoaded) {
+    fprintf(stderr, "Cannot index VCF file [ %s ]\n", fn.c_str());
+    return -1;
+  }
+
+  const std::string indexFileName = getIndexFileName(fn);
+  FILE* out = fopen(indexFileName.c_str(), "wb");
+  if (!out) {
+    fprintf(stderr, "Cannot create index file [ %s ]\n",
+            indexFileName.c_str());
+    return -1;
+  }
+  bool ok = fwrite(VSI_MAGIC, 1, 4, out) == 4 &&
+            fwrite(stamp, sizeof(int64_t), 2, out) == 2;
+  const int32_t numAnnotation = annotation.size();
+  ok = ok && fwrite(&numAnnotation, sizeof(int32_t), 1, out) == 1;
+  for (int i = 0; ok && i < numAnnotation; ++i) {
+    const int32_t len = annotation[i].size();
+    ok = fwrite(&len, sizeof(int32_t), 1, out) == 1 &&
+         fwrite(annotation[i].data(), 1, len, out) == (size_t)len;
+  }
+  const uint64_t numSite = site.size();
+  ok = ok && fwrite(&numSite, sizeof(uint64_t), 1, out) == 1;
+  std::vector<char> buf(VSI_SITE_BATCH * VSI_SITE_SIZE);
+  for (size_t i = 0; ok && i < numSite; i += VSI_SITE_BATCH) {
+    const size_t n = std::min(VSI_SITE_BATCH, (size_t)numSite - i);
+    for (size_t j = 0; j < n; ++j) {
+      encodeSite(site[i + j], &buf[j * VSI_SITE_SIZE]);
+    }
+    ok = fwrite(buf.data(), VSI_SITE_SIZE, n, out) == n;
+  }
+  if (fclose(out) || !ok) {
+    fprintf(stderr, "Cannot write index file [ %s ]\n",
+            indexFileName.c_str());
+    remove(indexFileName.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int VCFSiteIndex::open(const std::string& fn) {
+  close();
+  int64_t stamp[2];
+  if (getFileStamp(fn, stamp)) {
+    return -1;
+  }
+  FILE* in = fopen(getIndexFileName(fn).c_str(), "rb");
+  if (!in) {
+    return -1;
+  }
+  char magic[4];
+  int64_t indexStamp[2];
+  int32_t numAnnotation;
+  bool ok = fread(magic, 1, 4, in) == 4 && !memcmp(magic, VSI_MAGIC, 4) &&
+            fread(indexStamp, sizeof(int64_t), 2, in) == 2 &&
+            indexStamp[0] == stamp[0] && indexStamp[1] == stamp[1] &&
+            fread(&numAnnotation, sizeof(int32_t), 1, in) == 1 &&
+            numAnnotation >= 0;
+  if (ok) {
+    this->annotation.resize(numAnnotation);
+  }
+  for (int i = 0; ok && i < numAnnotation; ++i) {
+    int32_t len;
+    ok = fread(&len, sizeof(int32_t), 1, in) == 1 && len >= 0;
+    if (ok) {
+      this->annotation[i].resize(len);
+      ok = len == 0 || fread(&this->annotation[i][0], 1, len, in) == (size_t)len;
+    }
+  }
+  uint64_t numSite;
+  ok = ok && fread(&numSite, sizeof(uint64_t), 1, in) == 1;
+  if (ok) {
+    this->site.resize(numSite);
+    std::vector<char> buf(VSI_SITE_BATCH * VSI_SITE_SIZE);
+    for (size_t i = 0; ok && i < numSite; i += VSI_SITE_BATCH) {
+      const size_t n = std::min(VSI_SITE_BATCH, (size_t)numSite - i);
+      ok = fread(buf.data(), VSI_SITE_SIZE, n, in) == n;
+      for (size_t j = 0; ok && j < n; ++j) {
+        decodeSite(&buf[j * VSI_SITE_SIZE], &this->site[i + j]);
+      }
+    }
+  }
+  fclose(in);
+
+  if (ok) {
+    this->fp = bgzf_open(fn.c_str(), "r");
+    ok = this->fp != NULL;
+  }
+  if (!ok) {
+    close();
+    return -1;
+  }
+  this->buffer.l = this->buffer.m = 0;
+  this->buffer.s = NULL;
+  return 0;
+}
+
+void VCFSiteIndex::close() {
+  if (this->fp) {
+    bgzf_close(this->fp);
+    this->fp = NULL;
+    free(this->buffer.s);
+  }
+  this->site.clear();
+  this->annotation.clear();
+}
+
+int VCFSiteIndex::readLine(const Site& s, char** line) {
+  // consecutive records do not need to seek
+  if ((uint64_t)bgzf_tell(this->fp) != s.offset &&
+      bgzf_seek(this->fp, s.offset, SEEK_SET) < 0) {
+    return 0;
+  }
+  if (bgzf_getline(this->fp, '\n', &this->buffer) < 0) {
+    return 0;
+  }
+  *line = this->buffer.s;
+  return this->buffer.l;
+}
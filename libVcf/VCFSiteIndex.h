@@ -0,0 +1,74 @@
+#ifndef _VCFSITEINDEX_H_
+#define _VCFSITEINDEX_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "third/tabix/bgzf.h"
+
+/**
+ * A sidecar index (fileName + ".vsi") of a bgzipped VCF file. For each
+ * variant it stores the virtual file offset of the record, allele counts and
+ * the annotation, so readers can skip variants that cannot pass site filters
+ * without decompressing or parsing them.
+ *
+ * Allele counts are over all samples in the file, and use GT in the same way
+ * as VCFValue::getGenotype() (i.e. only bi-allelic genotypes are called).
+ * The index records the size and modification time of the VCF file, and it
+ * is not used once the VCF file changes.
+ */
+class VCFSiteIndex {
+ public:
+  struct Site {
+    uint64_t offset;     // virtual file offset of the record
+    int32_t ac;          // alternative allele count
+    int32_t an;          // number of called alleles
+    int32_t numMissing;  // number of samples without called genotypes
+    int32_t anno;        // index of INFO/ANNO in getAnnotation(), or -1
+  };
+
+ public:
+  VCFSiteIndex() : fp(NULL) {}
+  ~VCFSiteIndex() { close(); }
+
+  /**
+   * Scan the bgzipped VCF file @param fn and write its index
+   * @return 0 if succeed
+   */
+  static int build(const std::string& fn);
+  /**
+   * Load the index of the bgzipped VCF file @param fn
+   * @return 0 if succeed; -1 if there is no valid index for the current file
+   */
+  int open(const std::string& fn);
+  void close();
+
+  /**
+   * Read the record of @param site; @param line will point to the internal
+   * buffer, which may be modified in place and is valid until the next read
+   * @return the length of the line, or 0 at error
+   */
+  int readLine(const Site& site, char** line);
+
+  const std::vector<Site>& getSite() const { return this->site; }
+  // distinct INFO/ANNO values
+  const std::vector<std::string>& getAnnotation() const {
+    return this->annotation;
+  }
+  static std::string getIndexFileName(const std::string& fn) {
+    return fn + ".vsi";
+  }
+
+ private:
+  VCFSiteIndex(const VCFSiteIndex&);
+  VCFSiteIndex& operator=(const VCFSiteIndex&);
+
+ private:
+  std::vector<Site> site;
+  std::vector<std::string> annotation;
+  BGZF* fp;  // the VCF file
+  kstring_t buffer;
+};
+
+#endif /* _VCFSITEINDEX_H_ */
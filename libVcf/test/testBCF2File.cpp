@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "BCF2File.h"
+#include "VCFUtil.h"
+
+// GT is stored as (allele + 1) << 1 | phased, where 0 means missing
+int getGenotype(const BCF2File::Field& gt, int j) {
+  int g = 0;
+  for (int k = 0; k < gt.size; ++k) {
+    const int a = (BCF2File::getInt(gt, j * gt.size + k) >> 1) - 1;
+    if (a < 0) return MISSING_GENOTYPE;
+    g += a;
+  }
+  return g;
+}
+
+// dump sites and GT, GD of each sample
+std::vector<std::string> readBCF(const char* range, const char* exclude) {
+  BCF2File bin("test.v2.bcf");
+  if (range) bin.setRangeList(range);
+  if (exclude) bin.excludePeople(exclude);
+  const int keyGT = bin.getKey("GT");
+  const int keyGD = bin.getKey("GD");
+  const int keyANNO = bin.getKey("ANNO");
+  assert(keyGT >= 0 && keyGD >= 0 && keyANNO >= 0 && bin.getKey("XX") < 0);
+
+  std::vector<std::string> ret;
+  std::string anno;
+  while (bin.readRecord()) {
+    std::string s = bin.getChrom();
+    s += ':' + toString(bin.getPos()) + ' ' + bin.getID();
+    for (int i = 0; i < bin.getNumAllele(); ++i) {
+      s += ' ' + bin.getAllele(i);
+    }
+    s += ' ' + toString((int)bin.getQual());
+    const BCF2File::Field* f = bin.getInfo(keyANNO);
+    if (f) BCF2File::getString(*f, &anno);
+    s += ' ' + (f ? anno : std::string("."));
+
+    const BCF2File::Field* gt = bin.getFormat(keyGT);
+    const BCF2File::Field* gd = bin.getFormat(keyGD);
+    assert(gt && gd);
+    const std::vector<int>& index = bin.getEffectiveIndex();
+    for (size_t i = 0; i < index.size(); ++i) {
+      s += ' ' + toString(getGenotype(*gt, index[i])) + ':' +
+           toString(BCF2File::getInt(*gd, index[i] * gd->size));
+    }
+    ret.push_back(s);
+  }
+  return ret;
+}
+
+std::vector<std::string> readVCF(const char* range, const char* exclude) {
+  VCFInputFile vin("test.vcf.gz");
+  if (range) vin.setRangeList(range);
+  if (exclude) vin.excludePeople(exclude);
+
+  std::vector<std::string> ret;
+  bool missing;
+  while (vin.readRecord()) {
+    VCFRecord& r = vin.getVCFRecord();
+    std::string s = r.getChrom();
+    s += ':' + toString(r.getPos()) + ' ' + std::string(r.getID()) + ' ' +
+         std::string(r.getRef());
+    std::vector<std::string> alt;
+    stringTokenize(r.getAlt(), ',', &alt);
+    for (size_t i = 0; i < alt.size(); ++i) {
+      s += ' ' + alt[i];
+    }
+    s += ' ' + toString(r.getQualInt());
+    const std::string anno = r.getVCFInfo().getTag("ANNO", &missing).toStr();
+    s += ' ' + (missing ? std::string(".") : anno);
+
+    VCFPeople& people = r.getPeople();
+    const int GTidx = r.getFormatIndex("GT");
+    const int GDidx = r.getFormatIndex("GD");
+    for (size_t i = 0; i < people.size(); ++i) {
+      s += ' ' + toString(people[i]->justGet(GTidx).getGenotype()) + ':' +
+           toString(people[i]->justGet(GDidx).toInt());
+    }
+    ret.push_back(s);
+  }
+  return ret;
+}
+
+int main() {
+  assert(BCF2File::isBCF2File("test.v2.bcf"));
+  assert(!BCF2File::isBCF2File("test.vcf.gz"));
+
+  const char* range[] = {NULL, "1:196341364-196341449",
+                         "1:196341300-196341500,1:196341600-196341700",
+                         "1:1-100"};
+  const char* exclude[] = {NULL, "111410295"};
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      std::vector<std::string> expected = readVCF(range[i], exclude[j]);
+      std::vector<std::string> ret = readBCF(range[i], exclude[j]);
+      assert(ret == expected);
+      assert(i == 3 || !ret.empty());
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "VCFSiteIndex.h"
+#include "VCFUtil.h"
+
+void copyFile(const char* from, const char* to) {
+  FILE* in = fopen(from, "rb");
+  FILE* out = fopen(to, "wb");
+  assert(in && out);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    assert(n == fwrite(buf, 1, n, out));
+  }
+  fclose(in);
+  fclose(out);
+}
+
+// extract sites and their genotypes
+std::vector<std::string> extract(const char* fn, int mac, const char* anno,
+                                 bool excludePeople, const char* range,
+                                 bool* useIndex) {
+  VCFExtractor ve(fn);
+  if (range) ve.setRangeList(range);
+  if (mac) ve.setSiteMACMin(mac);
+  if (anno) ve.setAnnoType(anno);
+  if (excludePeople) ve.excludePeople("111410295,111416638");
+  std::vector<std::string> ret;
+  while (ve.readRecord()) {
+    VCFRecord& r = ve.getVCFRecord();
+    VCFPeople& people = r.getPeople();
+    std::string s = r.getChrom();
+    s += ':';
+    s += r.getPosStr();
+    for (size_t i = 0; i < people.size(); ++i) {
+      s += ' ';
+      s += people[i]->justGet(0).toStr();
+    }
+    ret.push_back(s);
+  }
+  *useIndex = ve.getSiteIndex() != NULL;
+  return ret;
+}
+
+int main() {
+  const char* fn = "testVCFSiteIndex.vcf.gz";
+  copyFile("test.vcf.gz", fn);
+  copyFile("test.vcf.gz.tbi", "testVCFSiteIndex.vcf.gz.tbi");
+  remove(VCFSiteIndex::getIndexFileName(fn).c_str());
+
+  const int mac[] = {0, 1, 2, 3, 0, 2};
+  const char* anno[] = {"intronic", NULL, NULL, NULL, "exonic", "intronic"};
+  // whole file, and ranges (overlapping, unsorted, and not in the file)
+  const char* range[] = {NULL,
+                         "1:196341300-196341700,1:196341800-196341900",
+                         "1:196341790-196341860,1:196341100-196341400",
+                         "1:196341700-196341720,2:1-100"};
+  std::vector<std::string> expected[48];
+  bool useIndex;
+  for (int i = 0; i < 48; ++i) {
+    expected[i] = extract(fn, mac[i % 6], anno[i % 6], i % 12 >= 6,
+                          range[i / 12], &useIndex);
+    assert(!useIndex);
+  }
+  assert(expected[4].empty());
+  assert(expected[12].size() == 9 && expected[13].size() == 1);
+  assert(expected[24].size() == 6 && expected[25].empty());
+  assert(expected[36].size() == 1 && expected[37].empty());
+
+  assert(0 == VCFSiteIndex::build(fn));
+  VCFSiteIndex index;
+  assert(0 == index.open(fn));
+  assert(index.getSite().size() == 14);
+  assert(index.getAnnotation().size() == 1 &&
+         index.getAnnotation()[0] == "intronic:KCNT2");
+  index.close();
+
+  for (int i = 0; i < 48; ++i) {
+    std::vector<std::string> ret = extract(fn, mac[i % 6], anno[i % 6],
+                                           i % 12 >= 6, range[i / 12],
+                                           &useIndex);
+    assert(useIndex);
+    assert(ret == expected[i]);
+  }
+  return 0;
+}
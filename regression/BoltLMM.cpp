@@ -115,7 +115,7 @@ class PlinkLoader {
   }
   ~PlinkLoader() {
     if (genotype_) {
-      delete[] genotype_;
+      free(genotype_);
       genotype_ = NULL;
     }
     if (stage_) {
@@ -213,7 +213,8 @@ class PlinkLoader {
     return 0;
   }
   int prepareGenotype() {
-    // load .bed file to the memory
+    // load .bed file to the memory once; all later passes (REML, CG solves,
+    // calibration) decode genotypes from this packed 2-bit store
 
     // convert to size_t is necessary
     // e.g. when Nstride_ * M2_ = 20000 * 123648 = 2.4 x 10^9
@@ -222,91 +223,90 @@ class PlinkLoader {
     // NOTE: in gdb, this type of error can be caught using:
     //       b 'std::bad_alloc::bad_alloc()'
     // fprintf(stderr, "Allocate unsigned char [ %d * %d]", Nstride_, M2_);
-    genotype_ = new unsigned char[Nstride_ * M2_];
-    pin_->readBED(genotype_, M_ * Nstride_);
+    void* mem = NULL;
+    if (posix_memalign(&mem, CacheLineSize, Nstride_ * M2_)) {
+      fprintf(stderr, "Cannot allocate memory for genotypes [ %zu x %zu ]!\n",
+              M2_, Nstride_);
+      return -1;
+    }
+    genotype_ = (unsigned char*)mem;
+    if ((size_t)pin_->readBED(genotype_, M_ * Nstride_) != M_ * Nstride_) {
+      fprintf(stderr, "Cannot read all genotypes from the PLINK BED file!\n");
+      return -1;
+    }
+    // padding markers are all homozygous reference
+    memset(genotype_ + M_ * Nstride_, 0, (M2_ - M_) * Nstride_);
 
-    // calculate maf, norms, build snpLookupTable
-    std::vector<int> alleleCount(256, 0);
-    std::vector<int> alleleCount2(256, 0);
-    std::vector<int> missingCount(256, 0);
+    // count each 2-bit genotype in one byte
+    int genoCount[256][4];
     for (int i = 0; i < 256; ++i) {
+      genoCount[i][0] = genoCount[i][1] = genoCount[i][2] = genoCount[i][3] =
+          0;
       for (int j = 0; j < 4; ++j) {
-        int g = (i & Mask[j]) >> Shift[j];
-        switch (g) {
-          case PlinkInputFile::HET:
-            alleleCount[i]++;
-            alleleCount2[i]++;
-            break;
-          case PlinkInputFile::HOM_ALT:
-            alleleCount[i] += 2;
-            alleleCount2[i] += 4;
-            break;
-          case PlinkInputFile::MISSING:
-            missingCount[i]++;
-        }
+        genoCount[i][(i & Mask[j]) >> Shift[j]]++;
       }
     }
-    unsigned char* p = genotype_;
-    for (size_t m = 0; m != M_; ++m) {
-      assert(p == (genotype_ + m * Nstride_));
-      int numAllele = 0;
-      int numAllele2 = 0;
-      int numMissing = 0;
+    // calculate maf, norms, build snpLookupTable in one pass
+    gNorm2_.resize(M2_);
+    gNorm2_.setZero();
+#pragma omp parallel for
+    for (int m = 0; m < (int)M_; ++m) {
+      const unsigned char* p = genotype_ + (size_t)m * Nstride_;
+      int n[4] = {0, 0, 0, 0};
+      for (size_t i = 0; i != Nstride_; ++i) {
+        const int* c = genoCount[p[i]];
+        n[0] += c[0];
+        n[1] += c[1];
+        n[2] += c[2];
+        n[3] += c[3];
+      }
       // NOTE: in PLINK when the number of samples are not multiple of 4
       // the remainder bits are 00 (homozygous REF)
-      // since we count alternative alleles, we do not need to deal with the
-      // remainder genotypes with special care.
-      for (size_t n = 0; n != Nstride_; ++n) {
-        numAllele += alleleCount[(*p)];
-        numAllele2 += alleleCount2[(*p)];
-        numMissing += missingCount[(*p)];
-        ++p;
-      }
+      n[PlinkInputFile::HOM_REF] -= Nstride_ * 4 - N_;
+
+      const int numMissing = n[PlinkInputFile::MISSING];
+      const int numAllele =
+          n[PlinkInputFile::HET] + 2 * n[PlinkInputFile::HOM_ALT];
+      const int numAllele2 =
+          n[PlinkInputFile::HET] + 4 * n[PlinkInputFile::HOM_ALT];
       double mean = 1.0 * numAllele / (N_ - numMissing);
-      double var = 1.0 *
-                   (numAllele2 * (N_ - numMissing) - numAllele * numAllele) /
+      double var = (1.0 * numAllele2 * (N_ - numMissing) -
+                    1.0 * numAllele * numAllele) /
                    (N_ - numMissing) / (N_ - numMissing - 1);
       double sd = sqrt(var);
+      Float4& table = snpLookupTable_[m];
       if (sd > 0) {
-        snpLookupTable_[m][PlinkInputFile::HOM_REF] = (0.0 - mean) / sd;
-        snpLookupTable_[m][PlinkInputFile::HET] = (1.0 - mean) / sd;
-        snpLookupTable_[m][PlinkInputFile::HOM_ALT] = (2.0 - mean) / sd;
-        snpLookupTable_[m][PlinkInputFile::MISSING] = 0.0;
+        table[PlinkInputFile::HOM_REF] = (0.0 - mean) / sd;
+        table[PlinkInputFile::HET] = (1.0 - mean) / sd;
+        table[PlinkInputFile::HOM_ALT] = (2.0 - mean) / sd;
+        table[PlinkInputFile::MISSING] = 0.0;
       } else {
-        snpLookupTable_[m][PlinkInputFile::HOM_REF] = 0.0;
-        snpLookupTable_[m][PlinkInputFile::HET] = 0.0;
-        snpLookupTable_[m][PlinkInputFile::HOM_ALT] = 0.0;
-        snpLookupTable_[m][PlinkInputFile::MISSING] = 0.0;
+        table[PlinkInputFile::HOM_REF] = 0.0;
+        table[PlinkInputFile::HET] = 0.0;
+        table[PlinkInputFile::HOM_ALT] = 0.0;
+        table[PlinkInputFile::MISSING] = 0.0;
       }
+      // squared norm of the standardized genotypes
+      double norm2 = 0.0;
+      for (int j = 0; j < 4; ++j) {
+        norm2 += n[j] * table[j] * table[j];
+      }
+      gNorm2_[m] = norm2;
     }
-    for (size_t m = M_ + 1; m != M2_; ++m) {
+    for (size_t m = M_; m != M2_; ++m) {
       snpLookupTable_[m][PlinkInputFile::HOM_REF] = 0.0;
       snpLookupTable_[m][PlinkInputFile::HET] = 0.0;
       snpLookupTable_[m][PlinkInputFile::HOM_ALT] = 0.0;
       snpLookupTable_[m][PlinkInputFile::MISSING] = 0.0;
     }
 
-    // prepare Z'X and gNorm2
-    zg_.resize(C_, M2_);
-    zg_.setZero();
-    gNorm2_.resize(M2_);
-    gNorm2_.setZero();
-
-    // load SNP in batches
-    for (size_t batch = 0; batch != NumBatch_; ++batch) {
-      loadSNPBatch(batch, stage_);
-      int lb = batch * BatchSize_;
-      int ub = std::min(lb + BatchSize_, M_);
+    // prepare Z'G from the packed genotypes
+    Eigen::MatrixXf gz(M2_, C_);
+    multiplyGenotypeTranspose(z_, gz);
+    zg_ = gz.transpose();
 
-      // gBatch/g: [BatchSize_ x N_]
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_, ub - lb);
-      zg_.block(0, lb, C_, ub - lb).noalias() = z_.transpose() * g;
-
-      // calculate squared norm of (I-Z'Z)X
-      gNorm2_.segment(lb, ub - lb) =
-          g.colwise().squaredNorm() -
-          zg_.block(0, lb, C_, ub - lb).colwise().squaredNorm();
-    }
+    // calculate squared norm of (I-Z'Z)X
+    gNorm2_ -= zg_.colwise().squaredNorm().transpose();
     return 0;
   }
   int projectCovariate(Eigen::MatrixXf* mat) {
@@ -351,7 +351,7 @@ class PlinkLoader {
       }
       const int remainder = N_ & 0x3;
       if (remainder) {
-        memcpy(p, table + *(g + Nstride_) * 4, sizeof(float) * remainder);
+        memcpy(p, table + *(g + strides) * 4, sizeof(float) * remainder);
         p += remainder;
       }
       assert(p == stage + (i - lb) * N_ + (N_));
@@ -394,7 +394,7 @@ class PlinkLoader {
       }
       const int remainder = N_ & 0x3;
       if (remainder) {
-        memcpy(p, table + *(g + Nstride_) * 4, sizeof(float) * remainder);
+        memcpy(p, table + *(g + strides) * 4, sizeof(float) * remainder);
         p += remainder;
       }
 #if 0
@@ -421,51 +421,6 @@ class PlinkLoader {
     }
     return 0;
   }
-  // load batch @param batch to gBatchSize_ [BatchSize_ * (N_ + C_)]
-  // for a given batch @param, marker [batch*BatchSize_, min(
-  // (batch+1)*BatchSize_, M_)]
-  // will be extracted and stored in gBatchSize_
-  int loadSNPWithNegCovBatch(size_t batch, float* stage) {
-    // #ifdef DEBUG
-    //     QuickTimer qt(__PRETTY_FUNCTION__);
-    // #endif
-    size_t lb = batch * BatchSize_;
-    size_t ub = lb + BatchSize_;  // std::min(lb + BatchSize_, M_);
-#pragma omp parallel for
-    for (size_t i = lb; i < ub; ++i) {
-      unsigned char* g = genotype_ + i * Nstride_;
-      float* p = stage + (i - lb) * (N_ + C_);
-      // build lookup table
-      float* table =
-          byte2genotype_ + omp_get_thread_num() * 256 * 4 * sizeof(float);
-      buildTable(i, table);
-      // look up normalized genotypes
-      const int strides = (N_ & ~0x3) >> 2;
-      for (int j = 0; j < strides; ++j) {
-        memcpy(p, table + *(g + j) * 4, sizeof(float) * 4);
-        p += 4;
-      }
-      const int remainder = N_ & 0x3;
-      if (remainder) {
-        memcpy(p, table + *(g + Nstride_) * 4, sizeof(float) * remainder);
-        p += remainder;
-      }
-#if 0
-      for (int j = 0; j < N_; ++j) {
-        const unsigned char gg = *(g + (j >> 2));
-        const int offset = j & 0x3;
-        *p = snpLookupTable_[i][(gg & Mask[offset]) >> Shift[offset]];
-        p++;
-      }
-#endif
-      for (size_t j = 0; j != C_; ++j) {
-        *p = -zg_(j, i);
-        p++;
-      }
-      assert(p == stage + (i - lb) * (N_ + C_) + (N_ + C_));
-    }
-    return 0;
-  }
   // load data in batches
   // @param nSnp into [nSnp * (N_+C_)]
   int loadRandomSNPWithCov(int nSnp, float* stage) {
@@ -493,7 +448,7 @@ class PlinkLoader {
       }
       const int remainder = N_ & 0x3;
       if (remainder) {
-        memcpy(p, table + *(g + Nstride_) * 4, sizeof(float) * remainder);
+        memcpy(p, table + *(g + strides) * 4, sizeof(float) * remainder);
         p += remainder;
       }
       assert(p == stage + (i) * (N_ + C_) + (N_));
@@ -512,9 +467,93 @@ class PlinkLoader {
     return 0;
   }
 
+  // Products between the standardized genotypes G [N x M2] and dense
+  // matrices with K columns (e.g. all right-hand sides of a CG solve).
+  // Genotypes are decoded from the packed BED data, tile by tile, with the
+  // per-marker lookup tables, so a tile of [TileSample x TileSNP] floats stays
+  // in cache; each tile is then multiplied with GEMM. Tiles are processed by
+  // OpenMP threads, and markers after M_ are treated as zeros.
+
+  // @param ret = G' * @param y
+  // y: [ N x K ], ret: [ M2 x K ]
+  void multiplyGenotypeTranspose(const Eigen::Ref<const Eigen::MatrixXf>& y,
+                                 Eigen::Ref<Eigen::MatrixXf> ret) {
+    assert((size_t)y.rows() == N_);
+    assert((size_t)ret.rows() == M2_ && ret.cols() == y.cols());
+    const int numTile = (M_ + TileSNP - 1) / TileSNP;
+#pragma omp parallel
+    {
+      Eigen::MatrixXf tile(TileSample, TileSNP);
+#pragma omp for schedule(dynamic)
+      for (int t = 0; t < numTile; ++t) {
+        const size_t m0 = (size_t)t * TileSNP;
+        const int nm = std::min(M_ - m0, (size_t)TileSNP);
+        ret.middleRows(m0, nm).setZero();
+        for (size_t s0 = 0; s0 < N_; s0 += TileSample) {
+          const int ns = std::min(N_ - s0, (size_t)TileSample);
+          decodeTile(m0, nm, s0, ns, tile.data());
+          ret.middleRows(m0, nm).noalias() +=
+              tile.topLeftCorner(ns, nm).transpose() * y.middleRows(s0, ns);
+        }
+      }
+    }
+    ret.bottomRows(M2_ - M_).setZero();
+  }
+  // @param ret = G * @param b
+  // b: [ M2 x K ], ret: [ N x K ]
+  void multiplyGenotype(const Eigen::Ref<const Eigen::MatrixXf>& b,
+                        Eigen::Ref<Eigen::MatrixXf> ret) {
+    assert((size_t)b.rows() == M2_);
+    assert((size_t)ret.rows() == N_ && ret.cols() == b.cols());
+    const int numTile = (N_ + TileSample - 1) / TileSample;
+#pragma omp parallel
+    {
+      Eigen::MatrixXf tile(TileSample, TileSNP);
+#pragma omp for schedule(dynamic)
+      for (int t = 0; t < numTile; ++t) {
+        const size_t s0 = (size_t)t * TileSample;
+        const int ns = std::min(N_ - s0, (size_t)TileSample);
+        ret.middleRows(s0, ns).setZero();
+        for (size_t m0 = 0; m0 < M_; m0 += TileSNP) {
+          const int nm = std::min(M_ - m0, (size_t)TileSNP);
+          decodeTile(m0, nm, s0, ns, tile.data());
+          ret.middleRows(s0, ns).noalias() +=
+              tile.topLeftCorner(ns, nm) * b.middleRows(m0, nm);
+        }
+      }
+    }
+  }
+
   const Eigen::MatrixXf& getPhenotype() const { return y_; }
+  const Eigen::MatrixXf& getZG() const { return zg_; }
   float* getStage() const { return stage_; }
 
+ private:
+  // decode markers [m0, m0 + nm) of samples [s0, s0 + ns) to @param out,
+  // a column major [ TileSample x nm ] matrix
+  // @param s0 should be a multiple of 4
+  void decodeTile(size_t m0, int nm, size_t s0, int ns, float* out) const {
+    assert((s0 & 0x3) == 0);
+    const int strides = ns >> 2;
+    const int remainder = ns & 0x3;
+    for (int i = 0; i < nm; ++i) {
+      const float* table = snpLookupTable_[m0 + i].x;
+      const unsigned char* g = genotype_ + (m0 + i) * Nstride_ + (s0 >> 2);
+      float* p = out + (size_t)i * TileSample;
+      for (int j = 0; j < strides; ++j) {
+        const unsigned char c = g[j];
+        p[0] = table[c & 0x3];
+        p[1] = table[(c >> 2) & 0x3];
+        p[2] = table[(c >> 4) & 0x3];
+        p[3] = table[c >> 6];
+        p += 4;
+      }
+      for (int j = 0; j < remainder; ++j) {
+        p[j] = table[(g[strides] >> Shift[j]) & 0x3];
+      }
+    }
+  }
+
  private:
   PlinkInputFile* pin_;
 
@@ -535,9 +574,8 @@ class PlinkLoader {
       snpLookupTable_;      // [M x 4] snpTable[i][j] store normalized values
   Eigen::VectorXf gNorm2_;  // vector norm of (g - Z Z' g)
 
-  // the BED file content
-  EIGEN_ALIGN16 unsigned char*
-      genotype_;  // PLINK genotype matrix, SNP major, 2 bits/genotype
+  // the BED file content, [ M2 x Nstride ] bytes aligned to a cache line
+  unsigned char* genotype_;  // PLINK genotype matrix, SNP major, 2 bits/genotype
 
   // centered and scaled genotyped in a batch,
   // allocated to be a matrix of [(N+C) x BatchSize_ ]
@@ -548,6 +586,10 @@ class PlinkLoader {
   static const int Mask[4];
   static const int Shift[4];
   static const float Plink2Geno[4];
+  // tile size used in multiplyGenotype() and multiplyGenotypeTranspose()
+  static const int TileSample = 2048;  // multiple of 4
+  static const int TileSNP = 64;
+  static const size_t CacheLineSize = 64;
   // this is for fast loading genotypes
   // each OpenMP threads takes a 256 x 4 memory lot
   EIGEN_ALIGN16 float* byte2genotype_;
@@ -555,6 +597,8 @@ class PlinkLoader {
 
 const int PlinkLoader::Mask[4] = {3, 3 << 2, 3 << 4, 3 << 6};
 const int PlinkLoader::Shift[4] = {0, 2, 4, 6};
+const int PlinkLoader::TileSample;
+const int PlinkLoader::TileSNP;
 // (HOM_REF, MISSING, HET, HOM_ALT) == (0, 1, 2, 3)
 const float PlinkLoader::Plink2Geno[4] = {0, -1, 1, 2};
 
@@ -590,14 +634,8 @@ class WorkingData {
       }
     }
     // calculate X* beta
-    x_beta_rand.setZero();
-    float* stage_ = pl.getStage();
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPWithCovBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_ + C_, BatchSize_);
-      x_beta_rand.noalias() +=
-          g * beta_rand.block(b * BatchSize_, 0, BatchSize_, MCtrial_);
-    }
+    pl.multiplyGenotype(beta_rand, x_beta_rand.topRows(N_));
+    x_beta_rand.bottomRows(C_).noalias() = pl.getZG() * beta_rand;
 
     for (size_t i = 0; i != N_; ++i) {
       for (size_t j = 0; j != MCtrial_; ++j) {
@@ -674,7 +712,9 @@ class BoltLMM::BoltLMMImpl {
 
     // project Z to G and
     // record mean and sd for each SNP
-    pl.prepareGenotype();
+    if (pl.prepareGenotype()) {
+      return -1;
+    }
 
     // get constants
     stage_ = pl.getStage();
@@ -997,14 +1037,10 @@ class BoltLMM::BoltLMMImpl {
     // *beta_hat = g_.transpose() * H_inv_y / M;
     // Done batch load x
     (*beta_hat).resize(M2_, MCtrial_ + 1);
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPWithCovBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g_z(stage_, N_ + C_, BatchSize_);
-      (*beta_hat).block(b * BatchSize_, 0, BatchSize_, MCtrial_ + 1).noalias() =
-          (g_z.topRows(N_).transpose() * H_inv_y.topRows(N_) -
-           g_z.bottomRows(C_).transpose() * H_inv_y.bottomRows(C_)) /
-          M_;
-    }
+    pl.multiplyGenotypeTranspose(H_inv_y.topRows(N_), *beta_hat);
+    (*beta_hat).noalias() -=
+        pl.getZG().transpose() * H_inv_y.bottomRows(C_);
+    (*beta_hat) /= M_;
     *e_hat = delta * H_inv_y;
   }
 
@@ -1166,22 +1202,12 @@ class BoltLMM::BoltLMMImpl {
     //
     // X_y: [X' -X'Z] [ M by (MCtrial+1) ]
     ret->resize(N_ + C_, y.cols());
-    ret->setZero();
-    Eigen::MatrixXf X_y =
-        Eigen::MatrixXf::Zero(M2_, y.cols());  // X' * y: [ M * (MCtrial + 1) ]
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPWithNegCovBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_ + C_, BatchSize_);
-      X_y.block(b * BatchSize_, 0, BatchSize_, y.cols()).noalias() =
-          g.transpose() * y;
-    }
+    Eigen::MatrixXf X_y(M2_, y.cols());  // X' * y: [ M * (MCtrial + 1) ]
+    pl.multiplyGenotypeTranspose(y.topRows(N_), X_y);
+    X_y.noalias() -= pl.getZG().transpose() * y.bottomRows(C_);
 
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPWithCovBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_ + C_, BatchSize_);
-      (*ret).noalias() +=
-          g * X_y.block(b * BatchSize_, 0, BatchSize_, y.cols());
-    }
+    pl.multiplyGenotype(X_y, ret->topRows(N_));
+    ret->bottomRows(C_).noalias() = pl.getZG() * X_y;
     const float invM = 1.0 / M_;
     (*ret) *= invM;
     (*ret).noalias() += delta * y;
@@ -1196,20 +1222,10 @@ class BoltLMM::BoltLMMImpl {
     // X: [X; Z'X] [ (N) x M ]
     //
     // X_y: [X'] [ M by (1) ]
-    Eigen::MatrixXf X_y =
-        Eigen::MatrixXf::Zero(M2_, y.cols());  // X' * y: [ M * (1) ]
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_, BatchSize_);
-      X_y.block(b * BatchSize_, 0, BatchSize_, y.cols()).noalias() =
-          g.transpose() * y;
-    }
-    for (size_t b = 0; b != NumBatch_; ++b) {
-      pl.loadSNPBatch(b, stage_);
-      Eigen::Map<Eigen::MatrixXf> g(stage_, N_, BatchSize_);
-      (*ret).noalias() +=
-          g * X_y.block(b * BatchSize_, 0, BatchSize_, y.cols());
-    }
+    Eigen::MatrixXf X_y(M2_, y.cols());  // X' * y: [ M * (1) ]
+    pl.multiplyGenotypeTranspose(y, X_y);
+    ret->resize(N_, y.cols());
+    pl.multiplyGenotype(X_y, *ret);
     const float invM = 1.0 / M_;
     (*ret) *= invM;
     const float eps = 1e-3;
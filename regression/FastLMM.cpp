@@ -551,6 +551,18 @@ class FastLMM::Impl {
             .sum() /
         this->sigma2;
   }
+  void GetCovXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
+                const EigenMatrix& kinshipU, const EigenMatrix& kinshipS,
+                FloatMatrixRef& out) {
+    REF_TO_EIGEN(g1, g1E);
+    REF_TO_EIGEN(g2, g2E);
+    REF_TO_EIGEN(out, outE);
+    assert(outE.rows() == g1E.cols() && outE.cols() == g2E.cols());
+    outE.noalias() =
+        g1E.transpose() *
+        ((this->lambda.array() + delta).inverse().matrix().asDiagonal() * g2E);
+    outE /= this->sigma2;
+  }
   void GetCovXZ(const std::vector<double>& g, const EigenMatrix& kinshipU,
                 const EigenMatrix& kinshipS, std::vector<double>* out) {
     // const Eigen::MatrixXf& U = kinshipU.mat;
@@ -778,6 +790,11 @@ void FastLMM::GetCovXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
                        float* out) {
   return this->impl->GetCovXX(g1, g2, kinshipU, kinshipS, out);
 }
+void FastLMM::GetCovXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
+                       const EigenMatrix& kinshipU, const EigenMatrix& kinshipS,
+                       FloatMatrixRef& out) {
+  return this->impl->GetCovXX(g1, g2, kinshipU, kinshipS, out);
+}
 void FastLMM::GetCovXZ(const std::vector<double>& g,
                        const EigenMatrix& kinshipU, const EigenMatrix& kinshipS,
                        std::vector<double>* out) {
@@ -72,6 +72,11 @@ class FastLMM {
   void GetCovXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
                 const EigenMatrix& kinshipU, const EigenMatrix& kinshipS,
                 float* out);
+  // covariance between each column of @param g1 and each column of @param g2
+  // @param out is a g1.ncol_ by g2.ncol_ matrix
+  void GetCovXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
+                const EigenMatrix& kinshipU, const EigenMatrix& kinshipS,
+                FloatMatrixRef& out);
   // NOTE: here assume @param g is transformed. e.g. U' * g
   void GetCovXZ(const std::vector<double>& g, const EigenMatrix& kinshipU,
                 const EigenMatrix& kinshipS, std::vector<double>* out);
@@ -1,6 +1,10 @@
 #include "GSLIntegration.h"
 
 #include <stdio.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
 #include <gsl/gsl_errno.h>
 
 Integration::Integration()
@@ -9,7 +13,8 @@ Integration::Integration()
       limit(1000),
       workspace(NULL),
       result(0.),
-      abserr(0.) {
+      abserr(0.),
+      numEval(0) {
   workspace = gsl_integration_workspace_alloc(limit);
 }
 
@@ -44,3 +49,151 @@ int Integration::integrateLU(gsl_function F, double lb, double ub) {
   gsl_set_error_handler(gsl_error);
   return ret;
 }
+
+namespace {
+// 21-point Kronrod nodes (positive half, the last one is the center) and
+// weights, and 10-point Gauss weights of nodes xgk[1], xgk[3], ..., xgk[9]
+// (same as QUADPACK qk21 and gsl_integration_qk21)
+const double xgk[11] = {
+    0.995657163025808080735527280689003, 0.973906528517171720077964012084452,
+    0.930157491355708226001207180059508, 0.865063366688984510732096688423493,
+    0.780817726586416897063717578345042, 0.679409568299024406234327365114874,
+    0.562757134668604683339000099272694, 0.433395394129247190799265943165784,
+    0.294392862701460198131126603103866, 0.148874338981631210884826001129720,
+    0.000000000000000000000000000000000};
+const double wgk[11] = {
+    0.011694638867371874278064396062192, 0.032558162307964727478818972459390,
+    0.054755896574351996031381300244580, 0.075039674810919952767043140916190,
+    0.093125454583697605535065465083366, 0.109387158802297641899210590325805,
+    0.123491976262065851077208980297122, 0.134709217311473325928054001771707,
+    0.142775938577060080797094273138717, 0.147739104901338491374841515972068,
+    0.149445554002916905664936468389821};
+const double wg[5] = {
+    0.066671344308688137593568809893332, 0.149451349150580593145776339657697,
+    0.219086362515982043995534934228163, 0.269266719309996355091226921569469,
+    0.295524224714752870173892994651338};
+const int NUM_NODE = 21;
+
+struct Segment {
+  double a;
+  double b;
+  double result;
+  double error;
+};
+
+bool largerError(const Segment& a, const Segment& b) {
+  return a.error > b.error;
+}
+
+// x of node @param k in [@param a, @param b]: center, then pairs of nodes
+double getNode(double a, double b, int k) {
+  const double center = 0.5 * (a + b);
+  const double halfLength = 0.5 * (b - a);
+  if (k == 0) return center;
+  return k % 2 ? center - halfLength * xgk[(k - 1) / 2]
+               : center + halfLength * xgk[(k - 1) / 2];
+}
+
+// apply the Gauss-Kronrod rule to integrand values @param f at the nodes of
+// segment @param s, and estimate the error in the same way as QUADPACK
+void applyRule(const double* f, Segment* s) {
+  const double halfLength = 0.5 * (s->b - s->a);
+  double resultKronrod = f[0] * wgk[10];
+  double resultGauss = 0.0;
+  double resultAbs = fabs(resultKronrod);
+  for (int j = 0; j < 10; ++j) {
+    const double sum = f[2 * j + 1] + f[2 * j + 2];
+    resultKronrod += wgk[j] * sum;
+    resultAbs += wgk[j] * (fabs(f[2 * j + 1]) + fabs(f[2 * j + 2]));
+    if (j % 2) resultGauss += wg[j / 2] * sum;
+  }
+  const double mean = resultKronrod * 0.5;
+  double resultAsc = wgk[10] * fabs(f[0] - mean);
+  for (int j = 0; j < 10; ++j) {
+    resultAsc +=
+        wgk[j] * (fabs(f[2 * j + 1] - mean) + fabs(f[2 * j + 2] - mean));
+  }
+  resultAbs *= fabs(halfLength);
+  resultAsc *= fabs(halfLength);
+
+  double error = fabs((resultKronrod - resultGauss) * halfLength);
+  if (resultAsc != 0.0 && error != 0.0) {
+    error = resultAsc * std::min(1.0, pow(200.0 * error / resultAsc, 1.5));
+  }
+  if (resultAbs > DBL_MIN / (50.0 * DBL_EPSILON)) {
+    error = std::max(50.0 * DBL_EPSILON * resultAbs, error);
+  }
+  s->result = resultKronrod * halfLength;
+  s->error = error;
+}
+}  // namespace
+
+int Integration::integrateParallelLU(gsl_function F, double lb, double ub) {
+  std::vector<Segment> done;     // segments that are not refined any more
+  std::vector<Segment> pending;  // segments to evaluate
+  Segment s = {lb, ub, 0.0, 0.0};
+  pending.push_back(s);
+  std::vector<double> f;
+  int ret = GSL_SUCCESS;
+  this->numEval = 0;
+  gsl_set_error_handler_off();
+
+  while (true) {
+    // evaluate all nodes of the pending segments at once
+    const int numPending = pending.size();
+    f.resize(numPending * NUM_NODE);
+#pragma omp parallel for
+    for (int k = 0; k < numPending * NUM_NODE; ++k) {
+      const Segment& p = pending[k / NUM_NODE];
+      f[k] = GSL_FN_EVAL(&F, getNode(p.a, p.b, k % NUM_NODE));
+    }
+    this->numEval += numPending * NUM_NODE;
+    for (int i = 0; i < numPending; ++i) {
+      applyRule(&f[i * NUM_NODE], &pending[i]);
+    }
+    done.insert(done.end(), pending.begin(), pending.end());
+    pending.clear();
+
+    this->result = 0.0;
+    this->abserr = 0.0;
+    for (size_t i = 0; i < done.size(); ++i) {
+      this->result += done[i].result;
+      this->abserr += done[i].error;
+    }
+    const double tol = std::max(epsabs, epsrel * fabs(this->result));
+    if (this->abserr <= tol) {
+      break;
+    }
+
+    // bisect the segments of the largest errors, until the errors of the
+    // other segments sum to no more than tol
+    std::sort(done.begin(), done.end(), largerError);
+    double excess = this->abserr - tol;
+    size_t numSplit = 0;
+    for (; numSplit < done.size() && excess > 0.0; ++numSplit) {
+      const Segment& d = done[numSplit];
+      const double mid = 0.5 * (d.a + d.b);
+      if (!(d.a < mid && mid < d.b)) break;  // too short to bisect
+      Segment left = {d.a, mid, 0.0, 0.0};
+      Segment right = {mid, d.b, 0.0, 0.0};
+      pending.push_back(left);
+      pending.push_back(right);
+      excess -= d.error;
+    }
+    done.erase(done.begin(), done.begin() + numSplit);
+    if (pending.empty()) {
+      ret = GSL_EROUND;  // segments cannot be bisected any more
+      break;
+    }
+    if (done.size() + pending.size() > limit) {
+      ret = GSL_EMAXITER;
+      break;
+    }
+  }
+  if (ret) {
+    fprintf(stderr, "Integration failed with a error [ %s ]\n",
+            gsl_strerror(ret));
+  }
+  gsl_set_error_handler(gsl_error);
+  return ret;
+}
@@ -12,6 +12,10 @@ class Integration {
   int integrate(gsl_function F);
   // integrate with (L)ower and (U)pper bound
   int integrateLU(gsl_function F, double lb, double ub);
+  // same as integrateLU(), but by globally adaptive 21-point Gauss-Kronrod
+  // rules, where @param F is evaluated at the nodes of all intervals to
+  // refine in parallel (@param F must be thread-safe)
+  int integrateParallelLU(gsl_function F, double lb, double ub);
   double getResult() const { return this->result; }
   // setters
   void setEpsAbs(double d) { this->epsabs = d; };
@@ -19,6 +23,8 @@ class Integration {
   void setLimit(int d) { this->limit = d; };
   // get an estimate of the absolute error
   double getAbsError() const { return this->abserr; }
+  // number of integrand evaluations in integrateParallelLU()
+  int getNumEval() const { return this->numEval; }
 
  private:
   // GSL stuffs
@@ -28,6 +34,7 @@ class Integration {
   gsl_integration_workspace* workspace;
   double result;
   double abserr;
+  int numEval;
 };
 
 #endif /* GSLINTEGRATION_H */
@@ -28,7 +28,8 @@ double MixtureChiSquare::getPvalue(double Q) {
   return pValue;
 }
 
-double sum(double* d, int n, int power) {
+// calculate sum of df[i] * d[i]^power
+double sum(double* d, int* df, int n, int power) {
   double r = 0.0;
   double tmp;
   for (int i = 0; i < n; ++i) {
@@ -36,16 +37,16 @@ double sum(double* d, int n, int power) {
     for (int j = 1; j < power; ++j) {
       tmp *= d[i];
     }
-    r += tmp;
+    r += df[i] * tmp;
   }
   return r;
 }
 
 double MixtureChiSquare::getLiuPvalue(double Q) {
-  const double c1 = sum(lambda, lambda_size, 1);
-  const double c2 = sum(lambda, lambda_size, 2);
-  const double c3 = sum(lambda, lambda_size, 3);
-  const double c4 = sum(lambda, lambda_size, 4);
+  const double c1 = sum(lambda, df, lambda_size, 1);
+  const double c2 = sum(lambda, df, lambda_size, 2);
+  const double c3 = sum(lambda, df, lambda_size, 3);
+  const double c4 = sum(lambda, df, lambda_size, 4);
   double s1 = c3 / c2 / sqrt(c2);
   double s2 = c4 / c2 / c2;
   const double muQ = c1;
@@ -82,6 +83,36 @@ double MixtureChiSquare::getLiuPvalue(double Q) {
   return q;
 }
 
+double MixtureChiSquare::getTieredPvalue(double Q, double cutoff,
+                                         Method* method) {
+  const double pLiu = getLiuPvalue(Q);
+  // Liu's method is exact for one lambda
+  if (lambda_size == 1 || pLiu > cutoff) {
+    *method = LIU;
+    return pLiu;
+  }
+
+  const double pValue = getPvalue(Q);
+  if (pValue <= 0.0 || pValue == 1.0) {
+    *method = LIU_FALLBACK;
+    return pLiu;
+  }
+  *method = DAVIES;
+  return pValue;
+}
+
+const char* MixtureChiSquare::getMethodName(Method method) {
+  switch (method) {
+    case LIU:
+      return "Liu";
+    case DAVIES:
+      return "Davies";
+    case LIU_FALLBACK:
+      return "LiuFallback";
+  }
+  return "NA";
+}
+
 void MixtureChiSquare::dumpLambda() const {
   for (int i = 0; i < lambda_size; ++i) {
     fprintf(stderr, "lambda[%d] = %g\n", i, lambda[i]);
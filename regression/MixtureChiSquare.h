@@ -4,6 +4,8 @@
 #include <cstddef>
 class MixtureChiSquare {
  public:
+  // method used to calculate a p-value
+  enum Method { LIU = 0, DAVIES = 1, LIU_FALLBACK = 2 };
   MixtureChiSquare() : sigma(0.0), lim(10000), acc(0.000001) {
     lambda = new double[10];
     noncen = new double[10];
@@ -24,13 +26,15 @@ class MixtureChiSquare {
     }
   }
   void reset() { this->lambda_size = 0; };
-  void addLambda(double l) {
+  void addLambda(double l) { addLambda(l, 1); };
+  // add @param l * ChiSquare(@param d)
+  void addLambda(double l, int d) {
     if (lambda_size + 1 == lambda_cap) {
       resize();
     };
     lambda[lambda_size] = l;
     noncen[lambda_size] = 0.0;
-    df[lambda_size] = 1;
+    df[lambda_size] = d;
     ++lambda_size;
   };
   void resize() {
@@ -55,6 +59,11 @@ class MixtureChiSquare {
   double getPvalue(double Q);
   // use Liu's method to calculate P-value
   double getLiuPvalue(double Q);  
+  // use Liu's method first, and use Davies's method only when Liu's P-value
+  // is not larger than @param cutoff. Fall back to Liu's method when Davies's
+  // method fails. @param method stores which method is used.
+  double getTieredPvalue(double Q, double cutoff, Method* method);
+  static const char* getMethodName(Method method);
   void dumpLambda() const;
 
  private:
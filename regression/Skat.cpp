@@ -3,6 +3,11 @@
 #include "EigenMatrixInterface.h"
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
 #include "MixtureChiSquare.h"
 
 // #define DEBUG
@@ -22,6 +27,11 @@ void MatrixSqrt(Eigen::MatrixXf& in, Eigen::MatrixXf* out);
 
 class Skat::SkatImpl {
  public:
+  SkatImpl()
+      : maxExactDim(2000), approxRank(100), approxOversample(10),
+        approxPowerIter(2), tailBound(false), tailSum(0.0), tailRank(0),
+        liuCutoff(1.0), method(MixtureChiSquare::LIU),
+        methodName(MixtureChiSquare::getMethodName(MixtureChiSquare::LIU)) {}
   void Reset() { this->pValue = -999.0; };
   int Fit(Vector& res_G,  // residual under NULL -- may change when permuting
           Vector& v_G,    // variance under NULL -- may change when permuting
@@ -47,40 +57,67 @@ class Skat::SkatImpl {
     G_to_Eigen(res_G, &res);
     this->Q = (this->K_sqrt * res).squaredNorm();
 
-    // calculate P0 = V - V X (X' V X)^(-1) X' V
+    // P0 = V - V X (X' V X)^(-1) X' V = V^0.5 (I - U U') V^0.5,
+    // where U is an orthonormal basis of V^0.5 X.
+    // Thus K_sqrt * P0 * K_sqrt' = Z * Z', Z = K_sqrt V^0.5 (I - U U'),
+    // and P0 (N by N) never needs to be formed.
     Eigen::VectorXf v;
     G_to_Eigen(v_G, &v);
-    if (this->nCovariate == 1) {
-      P0 = -v * v.transpose() / v.sum();
-      // printf("dim(P0) = %d, %d\n", P0.rows(), P0.cols());
-      // printf("dim(v) = %d\n", v.size());
-      P0.diagonal() += v;
-      // printf("dim(v) = %d\n", v.size());
-    } else {
-      Eigen::MatrixXf X;
-      G_to_Eigen(X_G, &X);
-      Eigen::MatrixXf XtV;  // X^t V
-      XtV.noalias() = X.transpose() * v.asDiagonal();
-      P0 = -XtV.transpose() * ((XtV * X).inverse()) * XtV;
-      P0.diagonal() += v;
-    }
-    // dump();
-    // Eigen::MatrixXf tmp = K_sqrt * P0 * K_sqrt.transpose();
-    // dumpToFile(tmp, "out.tmp");
+    Eigen::MatrixXf X;
+    G_to_Eigen(X_G, &X);
+    updateNullProjection(v, X);
+
+    Eigen::MatrixXf Z;
+    Z.noalias() = K_sqrt * v_sqrt.asDiagonal();
+    Eigen::MatrixXf ZU;
+    ZU.noalias() = Z * U;
+    Z.noalias() -= ZU * U.transpose();
+
     // eigen decomposition
-    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> es;
-    es.compute(K_sqrt * P0 * K_sqrt.transpose());
+    this->mixChiSq.reset();
+    if (std::min(nMarker, nPeople) <= this->maxExactDim) {
+      this->tailBound = false;
+      calculateExactLambda(Z);
+    } else {
+      this->tailBound = true;
+      calculateApproximateLambda(Z);
+    }
 
 #ifdef DEBUG
     std::ofstream k("K");
     k << K_sqrt;
     k.close();
 #endif
-    // std::ofstream p("P0");
-    // p << P0;
-    // p.close();
 
-    this->mixChiSq.reset();
+    // calculate p-value
+    if (this->tailBound) {
+      this->pValue = getTailBoundPvalue();
+    } else {
+      this->pValue = this->mixChiSq.getTieredPvalue(this->Q, this->liuCutoff,
+                                                    &this->method);
+    }
+    // e.g. "Davies", or "Davies+TailBound" when getTailBoundPvalue() is used
+    this->methodName = MixtureChiSquare::getMethodName(this->method);
+    if (this->tailBound) {
+      this->methodName += "+TailBound";
+    }
+    return 0;
+  };
+
+  /**
+   * Eigenvalues of Z * Z' (m by m) are the same as the non-zero eigenvalues
+   * of Z' * Z (N by N), so decompose the smaller one
+   */
+  void calculateExactLambda(const Eigen::MatrixXf& Z) {
+    Eigen::MatrixXf gram;
+    if (Z.rows() <= Z.cols()) {
+      gram.noalias() = Z * Z.transpose();
+    } else {
+      gram.noalias() = Z.transpose() * Z;
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> es;
+    es.compute(gram, Eigen::EigenvaluesOnly);
+
     int r_ub = std::min(nPeople, nMarker);
     int r = 0;  // es.eigenvalues().size();
     int eigen_len = es.eigenvalues().size();
@@ -92,13 +129,125 @@ class Skat::SkatImpl {
         break;
       }
     }
-    // calculate p-value
-    this->pValue = this->mixChiSq.getPvalue(this->Q);
-    if (this->pValue <= 0.0 || this->pValue == 1.0) {
-      this->pValue = this->mixChiSq.getLiuPvalue(this->Q);
+  }
+
+  /**
+   * When both dimensions are large, use a randomized range finder (Halko et
+   * al. 2011) for the top eigenvalues of Z * Z'.
+   * The remaining (tail) eigenvalues are not computed. They sum to
+   * trace(Z * Z') - sum(top eigenvalues), none exceeds the smallest computed
+   * one, and there are at most rank(Z) - (# top eigenvalues) of them.
+   * getTailBoundPvalue() uses these constraints.
+   */
+  void calculateApproximateLambda(const Eigen::MatrixXf& Z) {
+    const int l = std::min(this->approxRank + this->approxOversample,
+                           (int)std::min(Z.rows(), Z.cols()));
+    std::mt19937 rng(12345);
+    std::normal_distribution<float> norm;
+    Eigen::MatrixXf omega(Z.cols(), l);
+    for (int j = 0; j < l; ++j) {
+      for (int i = 0; i < Z.cols(); ++i) {
+        omega(i, j) = norm(rng);
+      }
     }
-    return 0;
-  };
+    Eigen::MatrixXf Y;
+    Y.noalias() = Z * omega;
+    Eigen::MatrixXf tmp;
+    for (int iter = 0; iter < this->approxPowerIter; ++iter) {
+      orthonormalize(&Y);
+      tmp.noalias() = Z.transpose() * Y;
+      Y.noalias() = Z * tmp;
+    }
+    orthonormalize(&Y);
+    Eigen::MatrixXf B;
+    B.noalias() = Y.transpose() * Z;
+    Eigen::MatrixXf gram;
+    gram.noalias() = B * B.transpose();
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> es;
+    es.compute(gram, Eigen::EigenvaluesOnly);
+
+    // trace(Z * Z') in double precision
+    double trace = 0.0;
+    for (int j = 0; j < Z.cols(); ++j) {
+      trace += Z.col(j).cast<double>().squaredNorm();
+    }
+
+    // keep top eigenvalues, oversampled ones are less accurate
+    const int eigen_len = es.eigenvalues().size();
+    const int k = std::min(this->approxRank, eigen_len);
+    double topSum = 0.0;
+    this->topLambda.clear();
+    for (int i = eigen_len - 1; i >= eigen_len - k; i--) {
+      if (es.eigenvalues()[i] > ZBOUND) {
+        this->topLambda.push_back(es.eigenvalues()[i]);
+        topSum += es.eigenvalues()[i];
+      } else {
+        break;
+      }
+    }
+    this->tailSum = trace - topSum;
+    // Z' = (I - U U') V^0.5 K_sqrt', so rank(Z) <= N - rank(U)
+    const int rank = std::min((int)Z.rows(), (int)(Z.cols() - U.cols()));
+    this->tailRank = rank - (int)this->topLambda.size();
+  }
+
+  /**
+   * P-value when only the top eigenvalues are known (see
+   * calculateApproximateLambda()). Among the tail eigenvalues allowed by
+   * their constraints, the extremes are:
+   *   (1) concentrated: as many eigenvalues equal to the smallest top one as
+   *       the tail sum allows, plus the remainder (largest variance);
+   *   (2) spread: the tail sum split equally over all tail eigenvalues
+   *       (smallest variance).
+   * Both are evaluated, and the larger P-value is reported, so a gene is
+   * never called more significant than either extreme.
+   */
+  double getTailBoundPvalue() {
+    const double smallest = this->topLambda.empty() ? 0.0 : topLambda.back();
+    if (this->tailSum <= ZBOUND || smallest <= ZBOUND) {
+      this->mixChiSq.reset();
+      for (size_t i = 0; i < this->topLambda.size(); ++i) {
+        this->mixChiSq.addLambda(this->topLambda[i]);
+      }
+      return this->mixChiSq.getTieredPvalue(this->Q, this->liuCutoff,
+                                            &this->method);
+    }
+
+    // (1) concentrated tail
+    this->mixChiSq.reset();
+    for (size_t i = 0; i < this->topLambda.size(); ++i) {
+      this->mixChiSq.addLambda(this->topLambda[i]);
+    }
+    const int numFull = (int)floor(this->tailSum / smallest);
+    if (numFull > 0) {
+      this->mixChiSq.addLambda(smallest, numFull);
+    }
+    const double remainder = this->tailSum - numFull * smallest;
+    if (remainder > ZBOUND) {
+      this->mixChiSq.addLambda(remainder);
+    }
+    MixtureChiSquare::Method concentratedMethod;
+    const double pConcentrated = this->mixChiSq.getTieredPvalue(
+        this->Q, this->liuCutoff, &concentratedMethod);
+
+    // (2) spread tail, using at least as many eigenvalues as in (1)
+    const int numSpread = std::max(this->tailRank, numFull + 1);
+    this->mixChiSq.reset();
+    for (size_t i = 0; i < this->topLambda.size(); ++i) {
+      this->mixChiSq.addLambda(this->topLambda[i]);
+    }
+    this->mixChiSq.addLambda(this->tailSum / numSpread, numSpread);
+    MixtureChiSquare::Method spreadMethod;
+    const double pSpread = this->mixChiSq.getTieredPvalue(
+        this->Q, this->liuCutoff, &spreadMethod);
+
+    if (pConcentrated >= pSpread) {
+      this->method = concentratedMethod;
+      return pConcentrated;
+    }
+    this->method = spreadMethod;
+    return pSpread;
+  }
 
   double GetQFromNewResidual(
       Vector& res_G)  // e.g. permuted residual under NULL
@@ -115,13 +264,67 @@ class Skat::SkatImpl {
 
   double GetQ() const { return this->Q; };
 
+  void SetLiuCutoff(double cutoff) { this->liuCutoff = cutoff; }
+  const char* GetPvalueMethod() const { return this->methodName.c_str(); }
+
+ private:
+  /**
+   * Recalculate V^0.5 and U only when the null model (@param v, @param X)
+   * changes, which usually happens once per analysis
+   */
+  void updateNullProjection(const Eigen::VectorXf& v,
+                            const Eigen::MatrixXf& X) {
+    if (v.size() == this->nullV.size() && X.rows() == this->nullX.rows() &&
+        X.cols() == this->nullX.cols() && v == this->nullV &&
+        X == this->nullX) {
+      return;
+    }
+    this->nullV = v;
+    this->nullX = X;
+    this->v_sqrt = v.cwiseSqrt();
+
+    Eigen::MatrixXf XtV;  // V^0.5 X
+    XtV.noalias() = this->v_sqrt.asDiagonal() * X;
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXf> qr(XtV);
+    const int rank = qr.rank();
+    this->U = qr.householderQ() * Eigen::MatrixXf::Identity(X.rows(), rank);
+  }
+  /**
+   * Replace @param m by an orthonormal basis of its columns
+   */
+  static void orthonormalize(Eigen::MatrixXf* m) {
+    Eigen::HouseholderQR<Eigen::MatrixXf> qr(*m);
+    *m = qr.householderQ() * Eigen::MatrixXf::Identity(m->rows(), m->cols());
+  }
+
  private:
   // Eigen::MatrixXf K;        // G * W * G'
   Eigen::MatrixXf K_sqrt;  // W^{0.5} * G' ----> K = K_sqrt' * K_sqrt
   Eigen::VectorXf w_sqrt;  // W^{0.5}
-  Eigen::MatrixXf P0;      // V - VX ( X' V X)^{-1} X V
   Eigen::VectorXf res;     // residual
 
+  // cached null projection
+  Eigen::VectorXf nullV;   // variance under NULL
+  Eigen::MatrixXf nullX;   // covariate
+  Eigen::VectorXf v_sqrt;  // V^{0.5}
+  Eigen::MatrixXf U;       // orthonormal basis of V^{0.5} X
+
+  // use randomized eigenvalues when min(nMarker, nPeople) > maxExactDim
+  int maxExactDim;
+  int approxRank;
+  int approxOversample;
+  int approxPowerIter;
+
+  // known eigenvalues and tail constraints of the randomized path
+  bool tailBound;  // true if getTailBoundPvalue() is used
+  std::vector<double> topLambda;  // top eigenvalues, in decreasing order
+  double tailSum;                 // sum of the other eigenvalues
+  int tailRank;                   // max number of the other eigenvalues
+
+  double liuCutoff;  // use Davies's method when Liu's P-value <= liuCutoff
+  MixtureChiSquare::Method method;
+  std::string methodName;
+
   int nPeople;
   int nMarker;
   int nCovariate;
@@ -158,6 +361,14 @@ double Skat::GetQ() const  // {return this->Q;};
   return this->skatImpl->GetQ();
 }
 
+void Skat::SetLiuCutoff(double cutoff) {
+  this->skatImpl->SetLiuCutoff(cutoff);
+}
+
+const char* Skat::GetPvalueMethod() const {
+  return this->skatImpl->GetPvalueMethod();
+}
+
 /**
  *     // NOTE: since @param may not be full rank, we will use SVD
  */
@@ -36,6 +36,11 @@ class Skat {
 
   double GetQ() const;  // {return this->Q;};
 
+  // Davies's method is used only when Liu's P-value <= @param cutoff
+  void SetLiuCutoff(double cutoff);
+  // name of the method used to calculate P-value (e.g. "Liu", "Davies")
+  const char* GetPvalueMethod() const;
+
  private:
   // don't copy
   Skat(const Skat& s);
@@ -3,6 +3,9 @@
 #include <Eigen/Cholesky>
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <vector>
 
 #include "gsl/gsl_cdf.h"      // use gsl_cdf_chisq_Q
@@ -42,6 +45,101 @@ struct Moment {
 double integrandDavies(double x, void* param);
 double integrandLiu(double x, void* param);
 
+/**
+ * Calculate eigenvalues of diag(@param d) + @param z * @param z' and store
+ * them in increasing order in @param values. @param d must be sorted in
+ * increasing order.
+ * Components that do not couple to the rank-one term are deflated, the
+ * remaining eigenvalues are roots of the secular equation
+ *   1 + sum_i z_i^2 / (d_i - x) = 0,
+ * found between consecutive poles by Newton's method, safeguarded by
+ * bisection. Each iteration costs O(m), and Newton's method usually
+ * converges in a few iterations, so the cost is about O(m^2) per call; in
+ * the worst case (bisection only) it is about 60 * m^2.
+ */
+static void getRankOneUpdateEigen(const Eigen::VectorXd& d,
+                                  const Eigen::VectorXd& z,
+                                  Eigen::VectorXd* values) {
+  const int n = d.size();
+  std::vector<double> dd(d.data(), d.data() + n);
+  std::vector<double> zz(z.data(), z.data() + n);
+  const double zNorm2 = z.squaredNorm();
+  const double tol =
+      8.0 * DBL_EPSILON * (std::max(fabs(d(0)), fabs(d(n - 1))) + zNorm2);
+
+  // (nearly) equal poles: rotate the rank-one weight onto the later one
+  for (int i = 0; i + 1 < n; ++i) {
+    if (dd[i + 1] - dd[i] <= tol) {
+      zz[i + 1] = hypot(zz[i], zz[i + 1]);
+      zz[i] = 0.0;
+    }
+  }
+
+  std::vector<double> out;
+  std::vector<double> poles;
+  std::vector<double> weights;
+  out.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    if (fabs(zz[i]) * sqrt(zNorm2) <= tol) {
+      out.push_back(dd[i]);
+    } else {
+      poles.push_back(dd[i]);
+      weights.push_back(zz[i] * zz[i]);
+    }
+  }
+
+  const int k = poles.size();
+  double weightSum = 0.0;
+  for (int i = 0; i < k; ++i) {
+    weightSum += weights[i];
+  }
+  std::vector<double> shifted(k);
+  for (int j = 0; j < k; ++j) {
+    // root j lies in (poles[j], poles[j + 1]), or above the last pole;
+    // search for x - poles[j] to keep precision near the lower pole
+    const double origin = poles[j];
+    for (int i = 0; i < k; ++i) {
+      shifted[i] = poles[i] - origin;
+    }
+    double lo = 0.0;
+    double hi = (j + 1 < k) ? shifted[j + 1] : weightSum;
+    double x = 0.5 * (lo + hi);
+    for (int iter = 0; iter < 200; ++iter) {
+      // f is increasing between poles, so its sign updates the bracket
+      double f = 1.0;
+      double df = 0.0;
+      for (int i = 0; i < k; ++i) {
+        const double r = 1.0 / (shifted[i] - x);
+        f += weights[i] * r;
+        df += weights[i] * r * r;
+      }
+      if (f < 0) {
+        lo = x;
+      } else if (f > 0) {
+        hi = x;
+      } else {
+        break;
+      }
+      // Newton step, or bisection when the step leaves the bracket
+      double next = x - f / df;
+      if (!(next > lo && next < hi)) {
+        next = 0.5 * (lo + hi);
+        if (next <= lo || next >= hi) break;
+      }
+      const bool converged = fabs(next - x) <= 2.0 * DBL_EPSILON * fabs(next);
+      x = next;
+      if (converged) break;
+    }
+    out.push_back(origin + x);
+  }
+
+  std::sort(out.begin(), out.end());
+  values->resize(n);
+  for (int i = 0; i < n; ++i) {
+    (*values)(i) = out[i];
+  }
+}
+
 class SkatO::SkatOImpl {
  public:
   SkatOImpl() {
@@ -49,6 +147,8 @@ class SkatO::SkatOImpl {
       rhosOriginal.push_back(1.0 * i / 10);
     }
     this->nRho = rhosOriginal.size();
+    this->liuCutoff = 1.0;
+    this->method = MixtureChiSquare::LIU;
   }
 
   void Reset() { this->pValue = -999.0; };
@@ -93,7 +193,12 @@ class SkatO::SkatOImpl {
     if (getEigen(W, &lambda)) {  // error can occur when lambda are all zeros
       return -1;
     }
-    this->pValue = getPvalDavies(Q, lambda);
+    this->mixChiSq.reset();
+    for (int i = 0; i < lambda.rows(); ++i) {
+      this->mixChiSq.addLambda(lambda(i, 0));
+    }
+    this->pValue =
+        this->mixChiSq.getTieredPvalue(Q, this->liuCutoff, &this->method);
     return 0;
   }
 
@@ -122,12 +227,6 @@ class SkatO::SkatOImpl {
 
     G = G * w.asDiagonal();
 
-    // set up R_rho
-    R_rhos.resize(nRho);
-    for (int i = 0; i < nRho; ++i) {
-      getRrho(rhos[i], &R_rhos[i], G.cols());
-    }
-
     double s2;
     if (isBinary()) {
       s2 = 1;
@@ -137,10 +236,14 @@ class SkatO::SkatOImpl {
     }
 
     // calculate Q
+    // with R_rho = (1 - rho) * I + rho * 1 1', the quadratic form
+    // v R_rho v' is (1 - rho) * |v|^2 + rho * (sum v)^2
+    const Eigen::VectorXd score = G.transpose() * res;
+    const double scoreNorm2 = score.squaredNorm();
+    const double scoreSum2 = score.sum() * score.sum();
     Qs.resize(nRho);
     for (int i = 0; i < nRho; ++i) {
-      Eigen::MatrixXd v = res.transpose() * G;
-      Qs[i] = (v * R_rhos[i] * v.transpose())(0, 0);
+      Qs[i] = (1.0 - rhos[i]) * scoreNorm2 + rhos[i] * scoreSum2;
       Qs[i] /= s2;
       Qs[i] /= 2.0;  // follow SKAT R package convention (divides 2)
     }
@@ -159,18 +262,32 @@ class SkatO::SkatOImpl {
     Z1 = Z1 / sqrt(2);  // follow SKAT R package convention (divides sqrt{2})
 
     // calculate labmda.rho
+    // eigenvalues of L' Z1' Z1 L (R_rho = L L') are those of
+    //   Lambda^0.5 Q' R_rho Q Lambda^0.5 = (1 - rho) Lambda + rho c c'
+    // where Z1' Z1 = Q Lambda Q' and c = Lambda^0.5 Q' 1, so one
+    // eigendecomposition serves all rho values.
+    es.compute(Z1.transpose() * Z1);
+    const Eigen::VectorXd d0 = es.eigenvalues().cwiseMax(0.0);
+    const Eigen::VectorXd c = d0.cwiseSqrt().cwiseProduct(
+        es.eigenvectors().colwise().sum().transpose());
     lambdas.resize(nRho);
+    moments.resize(nRho);
+    int nFailed = 0;
+#pragma omp parallel for reduction(+ : nFailed)
     for (int i = 0; i < nRho; ++i) {
-      Eigen::LLT<Eigen::MatrixXd> chol;
-      chol.compute(R_rhos[i]);  // R_rhos[i] = L * L^T
-      Eigen::MatrixXd Z2 = Z1 * chol.matrixL();
-      Eigen::MatrixXd K = Z2.transpose() * Z2;
-      if (getEigen(K, &lambdas[i])) {
+      Eigen::VectorXd values;
+      getRankOneUpdateEigen((1.0 - rhos[i]) * d0, sqrt(rhos[i]) * c, &values);
+      if (filterEigen(values, &lambdas[i])) {
         // error occured,
         // e.g. G is in the column space of Z => Z1 = 0 => K is all zeros
         //      this can happen when many covariates are used
-        return -1;
+        ++nFailed;
+        continue;
       }
+      getMoment(lambdas[i], &moments[i]);
+    }
+    if (nFailed) {
+      return -1;
     }
 
     // calculate some parameters (for Z(I-M)Z part)
@@ -201,12 +318,6 @@ class SkatO::SkatOImpl {
                     (z_bar.transpose() * Z1).array().square().sum() / z_norm;
     }
 
-    // calculate moments
-    moments.resize(nRho);
-    for (int i = 0; i < nRho; ++i) {
-      getMoment(lambdas[i], &moments[i]);
-    }
-
     // calculate p for each rho
     pvals.resize(nRho);
     for (int i = 0; i < nRho; ++i) {
@@ -232,27 +343,50 @@ class SkatO::SkatOImpl {
     }
 
     // integrate
+    prepareIntegrand();
+    // Liu's method is cheap, use it first, and only use Davies's method
+    // (much slower) when the gene may be significant.
+    // The integrands only read cached terms, so they are evaluated in
+    // parallel over the Gauss-Kronrod nodes.
+    // SKAT R integrates (1 - p(x)) * dchisq(x, 1) over x in [0, 40] and
+    // reports 1 - the integral. This is the same as integrating
+    // p(x) * dchisq(x, 1) and adding P(ChiSquare(1) > 40), but then the
+    // relative tolerance applies to the P-value itself.
+    const double upperX = 40.;
+    const double tail = gsl_cdf_chisq_Q(upperX, 1.0);
     Integration integration;
     integration.setEpsAbs(1e-25);
     integration.setEpsRel(
         0.0001220703);  // this is the default value of epsrel in R
                         // .Machine$double.eps^0.25
     gsl_function F;
-    F.function = integrandDavies;
+    F.function = integrandLiu;
     F.params = this;
-    if (integration.integrateLU(F, 0., 40.)) {
+    const bool liuFailed =
+        integration.integrateParallelLU(F, 0., sqrt(upperX)) != 0;
+    const double liuResult = integration.getResult() + tail;
 #ifdef DEBUG
+    if (liuFailed) {
       fprintf(stderr, "%s:%d integration failed\n", __FILE__, __LINE__);
+    }
 #endif
-      F.function = integrandLiu;
+    if (!liuFailed && liuResult > this->liuCutoff) {
+      this->method = MixtureChiSquare::LIU;
+      this->pValue = liuResult;
+    } else {
+      F.function = integrandDavies;
       F.params = this;
-      if (integration.integrateLU(F, 0., 40.)) {
+      if (integration.integrateParallelLU(F, 0., sqrt(upperX))) {
 #ifdef DEBUG
         fprintf(stderr, "%s:%d integration failed\n", __FILE__, __LINE__);
 #endif
+        this->method = MixtureChiSquare::LIU_FALLBACK;
+        this->pValue = liuResult;
+      } else {
+        this->method = MixtureChiSquare::DAVIES;
+        this->pValue = integration.getResult() + tail;
       }
-    };
-    this->pValue = 1.0 - integration.getResult();
+    }
 
     // verify p-values
     // SKAT R: "Since SKAT-O is between burden and SKAT, SKAT-O p-value should
@@ -279,51 +413,41 @@ class SkatO::SkatOImpl {
     return 0;
   }
 
-  double getPvalDavies(double Q, const Eigen::MatrixXd& lambda) {
-    double pval = 0.0;
-    this->mixChiSq.reset();
-    for (int i = 0; i < lambda.rows(); ++i) {
-      this->mixChiSq.addLambda(lambda(i, 0));
-    }
-    pval = this->mixChiSq.getPvalue(Q);
-    return pval;
-  }
-
-  double getPvalLiu(double Q, const Eigen::MatrixXd& lambda) {
-    double pval = 0.0;
-    this->mixChiSq.reset();
-    for (int i = 0; i < lambda.rows(); ++i) {
-      this->mixChiSq.addLambda(lambda(i, 0));
-    }
-    pval = this->mixChiSq.getLiuPvalue(Q);
-    return pval;
-  }
-
-  double computeIntegrandDavies(double x) {
-    double kappa = DBL_MAX;
-    for (int i = 0; i < nRho; ++i) {
-      double v = (Qs_minP[i] - taus[i] * x) / (1.0 - rhos[i]);
-      if (i == 0) {
-        kappa = v;
-      }
-      if (v < kappa) {
-        kappa = v;
-      }
-    }
+  // The integrands are in t = sqrt(x), where x ~ ChiSquare(1), so that
+  //   dchisq(x, 1) dx = 2 * dnorm(t) dt
+  // has no singularity at 0.
+  double computeIntegrandDavies(double t) {
+    double kappa = computeKappa(t * t);
     double temp;
-    if (kappa > lambda.sum() * 10000) {
+    if (kappa > this->kappaMax) {
       temp = 0.0;
     } else {
-      double Q = (kappa - MuQ) * sqrt(VarQ - VarZeta) / sqrt(VarQ) + MuQ;
-      temp = getPvalDavies(Q, lambda);
+      double Q = (kappa - MuQ) * this->daviesScale + MuQ;
+      temp = this->integrandMixChiSq.getPvalue(Q);
       if (temp <= 0.0 || temp == 1.0) {
-        temp = getPvalLiu(Q, lambda);
+        // cdflib keeps its state in static variables
+#pragma omp critical(SkatOLiuPvalue)
+        temp = this->integrandMixChiSq.getLiuPvalue(Q);
       }
     }
-    return (1.0 - temp) * gsl_ran_chisq_pdf(x, 1.0);
+    return temp * 2.0 * gsl_ran_ugaussian_pdf(t);
   }
 
-  double computeIntegrandLiu(double x) {
+  double computeIntegrandLiu(double t) {
+    double kappa = computeKappa(t * t);
+    double Q = (kappa - MuQ) * this->liuScale + Df;
+    return gsl_cdf_chisq_Q(Q, Df) * 2.0 * gsl_ran_ugaussian_pdf(t);
+  }
+  double GetPvalue() const { return this->pValue; };
+  double GetQ() const { return this->Q; };
+  double GetRho() const { return this->rho; }
+  void SetLiuCutoff(double cutoff) { this->liuCutoff = cutoff; }
+  const char* GetPvalueMethod() const {
+    return MixtureChiSquare::getMethodName(this->method);
+  }
+
+ private:
+  double computeKappa(double x) const {
     double kappa = DBL_MAX;
     for (int i = 0; i < nRho; ++i) {
       double v = (Qs_minP[i] - taus[i] * x) / (1.0 - rhos[i]);
@@ -331,24 +455,32 @@ class SkatO::SkatOImpl {
         kappa = v;
       }
     }
-    double Q = (kappa - MuQ) / sqrt(VarQ) * sqrt(2.0 * Df) + Df;
-    return (gsl_cdf_chisq_P(Q, Df) * gsl_ran_chisq_pdf(x, 1.0));
+    return kappa;
   }
-  double GetPvalue() const { return this->pValue; };
-  double GetQ() const { return this->Q; };
-  double GetRho() const { return this->rho; }
-
- private:
-  int getRrho(double rho, Eigen::MatrixXd* R, int dim) {
-    (*R).setConstant(dim, dim, rho);
-    for (int i = 0; i < dim; ++i) {
-      (*R)(i, i) = 1.0;
+  /**
+   * Cache the parts of the integrands that do not depend on the integration
+   * variable, so each integrand evaluation only computes kappa and one
+   * p-value.
+   */
+  void prepareIntegrand() {
+    this->kappaMax = lambda.sum() * 10000;
+    this->daviesScale = sqrt(VarQ - VarZeta) / sqrt(VarQ);
+    this->liuScale = sqrt(2.0 * Df) / sqrt(VarQ);
+    this->integrandMixChiSq.reset();
+    for (int i = 0; i < lambda.rows(); ++i) {
+      this->integrandMixChiSq.addLambda(lambda(i, 0));
     }
-    return 0;
   }
   int getEigen(Eigen::MatrixXd& k, Eigen::MatrixXd* lambda) {
     es.compute(k);
-    Eigen::VectorXd values = es.eigenvalues();
+    return filterEigen(es.eigenvalues(), lambda);
+  }
+  /**
+   * Keep eigenvalues (@param values, in increasing order) that are not
+   * negligible, and store them in decreasing order in @param lambda
+   * @return -1 if no eigenvalue is positive
+   */
+  int filterEigen(const Eigen::VectorXd& values, Eigen::MatrixXd* lambda) {
     int n = values.size();
     int numNonZero = 0;
     double sumNonZero = 0.;
@@ -466,7 +598,6 @@ class SkatO::SkatOImpl {
   Eigen::MatrixXd Z1;
   std::vector<double> rhos;
   std::vector<double> rhosOriginal;
-  std::vector<Eigen::MatrixXd> R_rhos;
   std::vector<Eigen::MatrixXd> lambdas;
   std::vector<Moment> moments;
   std::vector<double> Qs;
@@ -488,9 +619,18 @@ class SkatO::SkatOImpl {
   double Df;
   Eigen::MatrixXd lambda;
 
+  // cached terms of the integrands, see prepareIntegrand()
+  MixtureChiSquare integrandMixChiSq;
+  double kappaMax;
+  double daviesScale;
+  double liuScale;
+
   double pValue;
   double Q;
   double rho;
+
+  double liuCutoff;  // use Davies's method when Liu's P-value <= liuCutoff
+  MixtureChiSquare::Method method;
 };
 SkatO::SkatO() { this->skatoImpl = new SkatOImpl; }
 SkatO::~SkatO() { delete this->skatoImpl; }
@@ -523,6 +663,14 @@ double SkatO::GetQ() const { return this->skatoImpl->GetQ(); }
 
 double SkatO::GetRho() const { return this->skatoImpl->GetRho(); }
 
+void SkatO::SetLiuCutoff(double cutoff) {
+  this->skatoImpl->SetLiuCutoff(cutoff);
+}
+
+const char* SkatO::GetPvalueMethod() const {
+  return this->skatoImpl->GetPvalueMethod();
+}
+
 double integrandDavies(double x, void* param) {
   SkatO::SkatOImpl* p = (SkatO::SkatOImpl*)param;
   return p->computeIntegrandDavies(x);
@@ -37,6 +37,12 @@ class SkatO {
   double GetQ() const;
   double GetRho() const;
 
+  // Davies's method is used only when the P-value from Liu's method
+  // <= @param cutoff
+  void SetLiuCutoff(double cutoff);
+  // name of the method used to calculate P-value (e.g. "Liu", "Davies")
+  const char* GetPvalueMethod() const;
+
  private:
   // don't copy
   SkatO(const SkatO& s);
@@ -28,6 +28,9 @@ static double intl, ersm;
 static int count, r, lim;  static BOOL ndtsrt, fail;
 static int *n,*th; static real *lb,*nc;
 static jmp_buf env;
+/* one copy per thread, so qf() can be called in parallel */
+#pragma omp threadprivate(sigsq, lmax, lmin, mean, c, intl, ersm, count, r, \
+                          lim, ndtsrt, fail, n, th, lb, nc, env)
 
 
 real qf(real*,real*,int*,int,real,real,int,real,real*,int*);
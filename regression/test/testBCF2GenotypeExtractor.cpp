@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "base/Logger.h"
+#include "base/ParRegion.h"
+#include "libsrc/MathMatrix.h"
+#include "src/BCF2GenotypeExtractor.h"
+#include "src/Result.h"
+#include "src/VCFGenotypeExtractor.h"
+
+namespace parameter {
+bool FLAG_outputID = false;
+}
+Logger* logger = NULL;
+
+// the same sites and samples in both formats
+const char* bcfFile = "../../libVcf/test/test.v2.bcf";
+const char* vcfFile = "../../libVcf/test/test.vcf.gz";
+
+// apply the same settings to @param ge
+void setup(GenotypeExtractor* ge, ParRegion* parRegion, int option) {
+  ge->setParRegion(parRegion);
+  switch (option) {
+    case 1:  // GD filter and excluded samples
+      ge->setGDmin(50);
+      ge->excludePeople("111410295");
+      break;
+    case 2:  // site filters
+      ge->setSiteQualMin(30);
+      break;
+    case 3:  // MAC filter, with genotypes decoded for each site
+      ge->setSiteMACMin(1);
+      break;
+    case 4:  // included samples, which have no alt alleles
+      ge->excludeAllPeople();
+      ge->includePeople("111409786,111410303");
+      ge->setSiteFreqMin(0.01);
+      break;
+    case 5:  // frequency cutoffs
+      ge->setSiteFreqMin(0.05);
+      ge->setSiteFreqMax(0.5);
+      break;
+  }
+}
+
+bool sameMatrix(Matrix& a, Matrix& b) {
+  if (a.rows != b.rows || a.cols != b.cols) return false;
+  for (int i = 0; i < a.rows; ++i) {
+    for (int j = 0; j < a.cols; ++j) {
+      if (a[i][j] != b[i][j]) return false;
+    }
+  }
+  for (int j = 0; j < a.cols; ++j) {
+    if (std::string(a.GetColumnLabel(j)) != b.GetColumnLabel(j)) return false;
+  }
+  return true;
+}
+
+// @return number of extracted sites, which are checked to be the same
+int checkMultipleGenotype(int option) {
+  ParRegion parRegion;
+  BCF2GenotypeExtractor bcf(bcfFile);
+  VCFGenotypeExtractor vcf(vcfFile);
+  setup(&bcf, &parRegion, option);
+  setup(&vcf, &parRegion, option);
+
+  Matrix a, b;
+  assert(bcf.extractMultipleGenotype(&a) == GenotypeExtractor::SUCCEED);
+  assert(vcf.extractMultipleGenotype(&b) == GenotypeExtractor::SUCCEED);
+  assert(sameMatrix(a, b));
+  return a.cols;
+}
+
+// @return number of extracted sites, which are checked to be the same
+int checkSingleGenotype(int option, bool multiAllelic) {
+  ParRegion parRegion;
+  BCF2GenotypeExtractor bcf(bcfFile);
+  VCFGenotypeExtractor vcf(vcfFile);
+  setup(&bcf, &parRegion, option);
+  setup(&vcf, &parRegion, option);
+  if (multiAllelic) {
+    bcf.enableMultiAllelicMode();
+    vcf.enableMultiAllelicMode();
+  }
+
+  const char* key[] = {"CHROM", "POS", "REF", "ALT"};
+  Result ra, rb;
+  for (int i = 0; i < 4; ++i) {
+    ra.addHeader(key[i]);
+    rb.addHeader(key[i]);
+  }
+  Matrix a, b;
+  int n = 0;
+  while (true) {
+    const int ret = bcf.extractSingleGenotype(&a, &ra);
+    assert(ret == vcf.extractSingleGenotype(&b, &rb));
+    if (ret == GenotypeExtractor::FILE_END) break;
+    assert(sameMatrix(a, b));
+    for (int i = 0; i < 4; ++i) {
+      assert(ra[key[i]] == rb[key[i]]);
+    }
+    if (ret == GenotypeExtractor::SUCCEED) ++n;
+  }
+  return n;
+}
+
+int main() {
+  assert(checkMultipleGenotype(0) == 14);
+  assert(checkMultipleGenotype(1) == 14);
+  assert(checkMultipleGenotype(2) == 13);
+  assert(checkMultipleGenotype(3) == 1);
+  assert(checkMultipleGenotype(4) == 0);
+  assert(checkMultipleGenotype(5) == 1);
+
+  for (int option = 0; option < 6; ++option) {
+    assert(checkSingleGenotype(option, false) ==
+           checkSingleGenotype(option, true));
+  }
+  assert(checkSingleGenotype(3, true) == 1);
+  assert(checkSingleGenotype(4, false) == 0);
+  assert(checkSingleGenotype(5, false) == 1);
+  return 0;
+}
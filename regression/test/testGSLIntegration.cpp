@@ -0,0 +1,41 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include "GSLIntegration.h"
+
+double f(double x, void* param) {
+  if (x > 0) {
+    return (exp(-x));
+  }
+  return (exp(x));
+}
+
+// a kink at x = 1 and a singularity of the derivative at 0
+double g(double x, void* param) { return sqrt(x) + fabs(x - 1.0); }
+
+int main(int argc, char* argv[]) {
+  gsl_function F;
+  F.function = &f;
+
+  Integration integral;
+  if (integral.integrate(F)) {
+    return 1;
+  }
+
+  fprintf(stderr, "expected = %g\n", 2.0);
+  fprintf(stderr, "actual = %g\n", integral.getResult());
+
+  // parallel Gauss-Kronrod integration agrees with GSL
+  integral.setEpsRel(1e-10);
+  assert(0 == integral.integrateLU(F, -1.0, 3.0));
+  const double expected = 2.0 - exp(-1.0) - exp(-3.0);
+  assert(fabs(integral.getResult() - expected) < 1e-10);
+  assert(0 == integral.integrateParallelLU(F, -1.0, 3.0));
+  assert(fabs(integral.getResult() - expected) < 1e-10);
+
+  F.function = &g;
+  assert(0 == integral.integrateParallelLU(F, 0.0, 4.0));
+  assert(fabs(integral.getResult() - (16.0 / 3.0 + 5.0)) < 1e-9);
+  assert(integral.getNumEval() > 0);
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snp_hwe.c"
+#include "src/GenotypeCounter.h"
+
+// @return a counter of @param nHomRef, @param nHet, @param nHomAlt genotypes
+GenotypeCounter makeCounter(int nHomRef, int nHet, int nHomAlt) {
+  GenotypeCounter c;
+  for (int i = 0; i < nHomRef; ++i) c.add(0);
+  for (int i = 0; i < nHet; ++i) c.add(1);
+  for (int i = 0; i < nHomAlt; ++i) c.add(2);
+  c.add(-9);  // missing genotypes are not counted
+  return c;
+}
+
+int main() {
+  srand(1);
+  // cached P-values equal uncached ones, when numbers of genotypes change
+  // between calls as in MetaScore (all samples, cases, controls)
+  const int numGeno[] = {1000, 600, 400, 999, 5, 1000, 600, 400};
+  for (int iter = 0; iter < 20000; ++iter) {
+    const int n = numGeno[iter % 8];
+    // mostly rare variants, sometimes common ones
+    const int maxRare = iter % 10 == 0 ? n : 40;
+    const int nHet = rand() % (maxRare + 1) % (n + 1);
+    const int nHomAlt = rand() % (maxRare / 4 + 1) % (n - nHet + 1);
+    const int nHomRef = n - nHet - nHomAlt;
+    const GenotypeCounter c = makeCounter(nHomRef, nHet, nHomAlt);
+    assert(c.getHWE() == SNPHWE(nHet, nHomRef, nHomAlt));
+    // swapped homozygotes share the entry
+    const GenotypeCounter s = makeCounter(nHomAlt, nHet, nHomRef);
+    assert(s.getHWE() == SNPHWE(nHet, nHomAlt, nHomRef));
+  }
+
+  assert(makeCounter(0, 0, 0).getHWE() == 0.0);
+  return 0;
+}
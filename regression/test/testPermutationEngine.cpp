@@ -0,0 +1,83 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "src/PermutationEngine.h"
+
+// mean of each permuted phenotype; NaN for the first @var numNaN columns
+struct MeanStatistic {
+  explicit MeanStatistic(int numNaN) : numNaN(numNaN) {}
+  void operator()(const Eigen::MatrixXd& y, Eigen::VectorXd* stat) const {
+    *stat = y.colwise().mean().transpose();
+    for (int i = 0; i < numNaN && i < stat->size(); ++i) {
+      (*stat)(i) = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+  int numNaN;
+};
+
+int main() {
+  const int n = 50;
+  Vector y(n);
+  Eigen::VectorXd yE(n);
+  for (int i = 0; i < n; ++i) {
+    y[i] = yE(i) = i % 7;
+  }
+
+  // every column is a permutation of y
+  PermutationEngine engine(16, 1);
+  Eigen::MatrixXd a, b;
+  engine.generateBlock(yE, 0, &a);
+  assert(a.rows() == n && a.cols() == 16);
+  std::vector<double> sorted(yE.data(), yE.data() + n);
+  std::sort(sorted.begin(), sorted.end());
+  for (int j = 0; j < a.cols(); ++j) {
+    std::vector<double> col(a.col(j).data(), a.col(j).data() + n);
+    std::sort(col.begin(), col.end());
+    assert(col == sorted);
+  }
+
+  // same (seed, unit, block) gives the same permutations
+  PermutationEngine same(16, 1);
+  same.generateBlock(yE, 0, &b);
+  assert(a == b);
+  // other blocks, seeds and units differ
+  engine.generateBlock(yE, 1, &b);
+  assert(a != b);
+  PermutationEngine other(16, 2);
+  other.generateBlock(yE, 0, &b);
+  assert(a != b);
+  same.reset();
+  same.generateBlock(yE, 0, &b);
+  assert(a != b);
+
+  // failed permutations are replaced when failures are limited
+  PermutationEngine runner(128, 1);
+  {
+    Permutation perm(100, 0.05);
+    perm.init(1e10);  // never early stop
+    MeanStatistic stat(3);
+    assert(0 == runner.run(y, stat, &perm, 10));
+    assert(perm.getRemainingPerm() == 0);
+  }
+  // too many failures
+  {
+    Permutation perm(100, 0.05);
+    perm.init(1e10);
+    MeanStatistic stat(128);
+    assert(-1 == runner.run(y, stat, &perm, 10));
+  }
+  // without a limit, failures count towards the budget and the loop ends
+  {
+    Permutation perm(100, 0.05);
+    perm.init(1e10);
+    MeanStatistic stat(128);
+    assert(0 == runner.run(y, stat, &perm));
+    assert(perm.getRemainingPerm() == 100);
+  }
+  return 0;
+}
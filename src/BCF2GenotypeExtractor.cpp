@@ -0,0 +1,420 @@
+#include "BCF2GenotypeExtractor.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+#include "base/Argument.h"
+#include "base/Logger.h"
+#include "base/TypeConversion.h"
+#include "libVcf/BCF2File.h"
+#include "libVcf/VCFConstant.h"
+#include "libsrc/MathMatrix.h"
+#include "libsrc/MathVector.h"
+
+extern Logger* logger;
+
+BCF2GenotypeExtractor::BCF2GenotypeExtractor(const std::string& fn)
+    : GenotypeExtractor(fn), bcfIn(NULL) {
+  this->bcfIn = new BCF2File(fn);
+  this->keyGT = this->bcfIn->getKey("GT");
+  this->keyGD = this->bcfIn->getKey("GD");
+  this->keyGQ = this->bcfIn->getKey("GQ");
+  this->keyDP = this->bcfIn->getKey("DP");
+  this->keyAF = this->bcfIn->getKey("AF");
+  this->keyANNO = this->bcfIn->getKey("ANNO");
+}
+
+BCF2GenotypeExtractor::~BCF2GenotypeExtractor() {
+  if (this->bcfIn) {
+    delete this->bcfIn;
+    this->bcfIn = NULL;
+  }
+}
+
+bool BCF2GenotypeExtractor::readSite(Site* site) {
+  while (this->bcfIn->readRecord()) {
+    if (!this->passSiteFilter() || !this->passFilter()) continue;
+
+    // alt alleles, as "." if there are none, the same as in VCF text
+    const int numAllele = this->bcfIn->getNumAllele();
+    this->alt = numAllele > 1 ? this->bcfIn->getAllele(1) : ".";
+    for (int i = 2; i < numAllele; ++i) {
+      this->alt += ',';
+      this->alt += this->bcfIn->getAllele(i);
+    }
+    this->posStr = toString(this->bcfIn->getPos());
+
+    site->chrom = this->bcfIn->getChrom().c_str();
+    site->pos = this->bcfIn->getPos();
+    site->posStr = this->posStr.c_str();
+    site->id = this->bcfIn->getID().c_str();
+    site->ref = this->bcfIn->getAllele(0).c_str();
+    site->alt = this->alt.c_str();
+    site->numSample = this->bcfIn->getNumEffectiveSample();
+    return true;
+  }
+  return false;
+}
+
+namespace {
+/**
+ * Get the first two alleles of the GT value at @param p (@param size values
+ * of type T) as allele indices, or -1 if missing
+ * @return ploidy
+ */
+template <typename T>
+inline int decodeAllele(const uint8_t* p, const int size, int* a1, int* a2) {
+  // missing values are the smallest integers, and the next ones mark the
+  // end of vectors
+  const T endOfVector = std::numeric_limits<T>::min() + 1;
+  T v[2] = {0, 0};
+  int n = 0;
+  for (; n < size; ++n) {
+    T x;
+    memcpy(&x, p + n * sizeof(T), sizeof(T));
+    if (x == endOfVector) break;
+    if (n < 2) v[n] = x;
+  }
+  // (allele index + 1) << 1 | phased, and 0 for a missing allele
+  *a1 = n > 0 ? std::max((v[0] >> 1) - 1, -1) : -1;
+  *a2 = n > 1 ? std::max((v[1] >> 1) - 1, -1) : -1;
+  return n;
+}
+
+// same as VCFValue::getGenotype()
+inline int getGenotype(const int ploidy, const int a1, const int a2) {
+  if (a1 < 0 || a1 > 1) return MISSING_GENOTYPE;
+  if (ploidy == 1) return a1;
+  if (ploidy != 2 || a2 < 0 || a2 > 1) return MISSING_GENOTYPE;
+  return a1 + a2;
+}
+
+// same as VCFValue::getMaleNonParGenotype02()
+inline int getMaleNonParGenotype02(const int ploidy, const int a1,
+                                   const int a2) {
+  if (a1 < 0 || a1 > 1) return MISSING_GENOTYPE;
+  if (ploidy == 1) return a1 * 2;
+  if (a2 != a1) return MISSING_GENOTYPE;
+  return a1 * 2;
+}
+
+/**
+ * Check alleles in the same way as decodeAllele() in VCFGenotypeExtractor,
+ * so that alt allele k is counted (a1 == k) + (a2 == k) times
+ * @return false if the genotype is missing
+ */
+inline bool checkAllele(const int ploidy, const bool male, int* a1, int* a2) {
+  if (*a1 < 0) return false;
+  if (ploidy == 1) {
+    *a2 = male ? *a1 : -1;
+    return true;
+  }
+  if (*a2 < 0) return false;
+  if (male) return *a1 == *a2;
+  return ploidy == 2;
+}
+
+// the record-wise settings used by decodeGenotypeOf()
+struct DecodeParam {
+  const std::vector<int>* index;  // included samples
+  const std::vector<int>* sex;
+  bool hemiRegion;
+  bool multiAllelic;
+  int numAlt;  // number of alt alleles in multi-allelic mode
+  // GD and GQ fields, NULL if not checked
+  const BCF2File::Field* GD;
+  const BCF2File::Field* GQ;
+  int GDmin;
+  int GDmax;
+  int GQmin;
+  int GQmax;
+};
+
+// @return true if GD and GQ (if needed) of sample @param j are valid
+// if GD is missing, we will take GD = 0
+inline bool checkDepthQuality(const int j, const DecodeParam& param) {
+  if (param.GD) {
+    const int gd = BCF2File::getInt(*param.GD, j * param.GD->size);
+    if ((param.GDmin > 0 && gd < param.GDmin) ||
+        (param.GDmax > 0 && gd > param.GDmax)) {
+      return false;
+    }
+  }
+  if (param.GQ) {
+    const int gq = BCF2File::getInt(*param.GQ, j * param.GQ->size);
+    if ((param.GQmin > 0 && gq < param.GQmin) ||
+        (param.GQmax > 0 && gq > param.GQmax)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Decode GT of all samples from typed array @param gt of type T.
+ * In multi-allelic mode, GT is decoded once for all alt alleles, and
+ * @param geno stores param.numAlt columns of alt allele counts
+ */
+template <typename T>
+void decodeGenotypeOf(const BCF2File::Field& gt, const DecodeParam& param,
+                      double* geno) {
+  const std::vector<int>& index = *param.index;
+  const int n = index.size();
+  const size_t width = gt.size * sizeof(T);
+  if (param.multiAllelic) {
+    std::fill(geno, geno + n * param.numAlt, 0.0);
+  }
+  for (int i = 0; i < n; ++i) {
+    const int j = index[i];
+    int a1, a2;
+    const int ploidy = decodeAllele<T>(gt.data + j * width, gt.size, &a1, &a2);
+    const int sex = param.hemiRegion ? (*param.sex)[i] : PLINK_FEMALE;
+    const bool male = param.hemiRegion && sex == PLINK_MALE;
+    const bool unknownSex = param.hemiRegion && !male && sex != PLINK_FEMALE;
+    if (param.multiAllelic) {
+      if (unknownSex || !checkAllele(ploidy, male, &a1, &a2) ||
+          !checkDepthQuality(j, param)) {
+        for (int k = 0; k < param.numAlt; ++k) {
+          geno[k * n + i] = MISSING_GENOTYPE;
+        }
+        continue;
+      }
+      if (a1 > 0 && a1 <= param.numAlt) geno[(a1 - 1) * n + i] += 1.0;
+      if (a2 > 0 && a2 <= param.numAlt) geno[(a2 - 1) * n + i] += 1.0;
+      continue;
+    }
+
+    double g;
+    if (unknownSex) {
+      g = MISSING_GENOTYPE;
+    } else {
+      g = male ? getMaleNonParGenotype02(ploidy, a1, a2)
+               : getGenotype(ploidy, a1, a2);
+    }
+    if (!checkDepthQuality(j, param)) {
+      g = MISSING_GENOTYPE;
+    }
+    geno[i] = g;
+  }
+}
+
+// decode dosages of all samples from numeric field @param ds
+void decodeDosageOf(const BCF2File::Field& ds, const DecodeParam& param,
+                    double* geno) {
+  const std::vector<int>& index = *param.index;
+  const int n = index.size();
+  for (int i = 0; i < n; ++i) {
+    const int j = index[i];
+    double g = BCF2File::getDouble(ds, j * ds.size);
+    // for male hemi region, imputated dosage is usually between 0 and 1
+    // need to multiply by 2.0
+    if (param.hemiRegion && (*param.sex)[i] == PLINK_MALE) g *= 2.0;
+    if (!checkDepthQuality(j, param)) {
+      g = MISSING_GENOTYPE;
+    }
+    geno[i] = g;
+  }
+}
+
+// decode GT according to the integer type of @param gt
+void decodeGenotypeOf(const BCF2File::Field& gt, const DecodeParam& param,
+                      double* geno) {
+  switch (gt.type) {
+    case BCF2File::BCF_INT8:
+      decodeGenotypeOf<int8_t>(gt, param, geno);
+      return;
+    case BCF2File::BCF_INT16:
+      decodeGenotypeOf<int16_t>(gt, param, geno);
+      return;
+    case BCF2File::BCF_INT32:
+      decodeGenotypeOf<int32_t>(gt, param, geno);
+      return;
+  }
+  const int n = param.index->size();
+  std::fill(geno, geno + (param.multiAllelic ? n * param.numAlt : n),
+            MISSING_GENOTYPE);
+}
+}  // namespace
+
+void BCF2GenotypeExtractor::decodeGenotype(const bool useDosage,
+                                           const bool hemiRegion,
+                                           const int numAlt, double* geno) {
+  const int n = this->bcfIn->getNumEffectiveSample();
+  const BCF2File::Field* f = this->bcfIn->getFormat(
+      useDosage ? this->bcfIn->getKey(dosageTag.c_str()) : this->keyGT);
+  if (!f) {
+    logger->error("Cannot find %s field!",
+                  this->dosageTag.empty() ? "GT" : dosageTag.c_str());
+    std::fill(geno, geno + (numAlt > 0 ? n * numAlt : n), MISSING_GENOTYPE);
+    return;
+  }
+
+  const DecodeParam param = {
+      &this->bcfIn->getEffectiveIndex(),
+      this->sex,
+      hemiRegion,
+      numAlt > 0,
+      numAlt,
+      needGD ? this->bcfIn->getFormat(this->keyGD) : NULL,
+      needGQ ? this->bcfIn->getFormat(this->keyGQ) : NULL,
+      GDmin,
+      GDmax,
+      GQmin,
+      GQmax};
+  if (useDosage) {
+    decodeDosageOf(*f, param, geno);
+    return;
+  }
+  decodeGenotypeOf(*f, param, geno);
+}
+
+bool BCF2GenotypeExtractor::passSiteFilter() {
+  VCFSiteFilter& filter = this->siteFilter;
+  // quick checks: depth, qual, af
+  if (filter.checkSiteDepth() && filter.useSiteDepthFromInfo()) {
+    const BCF2File::Field* f = this->bcfIn->getInfo(this->keyDP);
+    if (!f || !filter.siteDepthOK(BCF2File::getInt(*f, 0))) {
+      return false;
+    }
+  }
+  if (filter.checkSiteQual()) {
+    const int qual =
+        this->bcfIn->isQualMissing() ? 0 : (int)this->bcfIn->getQual();
+    if (!filter.siteQualOK(qual)) {
+      return false;
+    }
+  }
+  if (filter.checkSiteFreq() && filter.useSiteFreqFromInfo()) {
+    const BCF2File::Field* f = this->bcfIn->getInfo(this->keyAF);
+    if (!f || !filter.siteFreqOK(BCF2File::getDouble(*f, 0))) {
+      return false;
+    }
+  }
+
+  // check annotation
+  if (filter.requiredAnnotation()) {
+    const BCF2File::Field* f = this->bcfIn->getInfo(this->keyANNO);
+    if (!f) return false;
+    std::string anno;
+    BCF2File::getString(*f, &anno);
+    if (!filter.matchAnnotatoin(anno.c_str())) {
+      return false;
+    }
+  }
+
+  // check about sex chrom
+  if (!filter.chromXRegionOK(this->bcfIn->getChrom(), this->bcfIn->getPos())) {
+    return false;
+  }
+  return true;
+}
+
+bool BCF2GenotypeExtractor::passFilter() {
+  const VCFSiteFilter& filter = this->siteFilter;
+  // shall we loop each individuals?
+  if (!filter.needGenotype()) {
+    return true;
+  }
+
+  const int n = this->bcfIn->getNumEffectiveSample();
+  std::vector<double>& geno = this->siteGenotype;
+  geno.resize(n);
+  const DecodeParam param = {&this->bcfIn->getEffectiveIndex(),
+                             NULL,
+                             false,
+                             false,
+                             0,
+                             NULL,
+                             NULL,
+                             0,
+                             0,
+                             0,
+                             0};
+  const BCF2File::Field* f = this->bcfIn->getFormat(this->keyGT);
+  if (f) {
+    decodeGenotypeOf(*f, param, geno.data());
+  } else {
+    std::fill(geno.begin(), geno.end(), MISSING_GENOTYPE);
+  }
+  int ac = 0;
+  int an = 0;
+  for (int i = 0; i < n; ++i) {
+    if (geno[i] >= 0) {
+      an += 2;
+      ac += geno[i];
+    }
+  }
+  return filter.alleleCountOK(ac, an);
+}
+
+void BCF2GenotypeExtractor::setSiteDepthMin(int d) {
+  this->siteFilter.setSiteDepthMin(d);
+}
+void BCF2GenotypeExtractor::setSiteDepthMax(int d) {
+  this->siteFilter.setSiteDepthMax(d);
+}
+
+void BCF2GenotypeExtractor::setSiteFile(const std::string& fn) {
+  this->bcfIn->setSiteFile(fn);
+}
+
+void BCF2GenotypeExtractor::setSiteQualMin(int q) {
+  this->siteFilter.setSiteQualMin(q);
+}
+void BCF2GenotypeExtractor::setSiteMACMin(int n) {
+  this->siteFilter.setSiteMACMin(n);
+}
+int BCF2GenotypeExtractor::setAnnoType(const std::string& s) {
+  return this->siteFilter.setAnnoType(s.c_str());
+}
+
+void BCF2GenotypeExtractor::setRange(const RangeList& l) {
+  this->bcfIn->setRange(l);
+}
+void BCF2GenotypeExtractor::setRangeList(const std::string& l) {
+  this->bcfIn->setRangeList(l);
+}
+void BCF2GenotypeExtractor::setRangeFile(const std::string& fn) {
+  this->bcfIn->setRangeFile(fn.c_str());
+}
+void BCF2GenotypeExtractor::includePeople(const std::string& v) {
+  this->bcfIn->includePeople(v);
+}
+void BCF2GenotypeExtractor::includePeople(const std::vector<std::string>& v) {
+  this->bcfIn->includePeople(v);
+}
+void BCF2GenotypeExtractor::includePeopleFromFile(const std::string& fn) {
+  this->bcfIn->includePeopleFromFile(fn.c_str());
+}
+void BCF2GenotypeExtractor::excludePeople(const std::string& v) {
+  this->bcfIn->excludePeople(v);
+}
+void BCF2GenotypeExtractor::excludePeople(const std::vector<std::string>& v) {
+  this->bcfIn->excludePeople(v);
+}
+void BCF2GenotypeExtractor::excludePeopleFromFile(const std::string& fn) {
+  this->bcfIn->excludePeopleFromFile(fn.c_str());
+}
+void BCF2GenotypeExtractor::excludePeople(
+    const std::vector<std::string>& sample, const std::vector<int>& index) {
+  for (size_t i = 0; i < index.size(); ++i) {
+    this->excludePeople(sample[i]);
+  }
+}
+
+void BCF2GenotypeExtractor::excludeAllPeople() {
+  this->bcfIn->excludeAllPeople();
+}
+void BCF2GenotypeExtractor::enableAutoMerge() {
+  this->bcfIn->enableAutoMerge();
+}
+void BCF2GenotypeExtractor::getPeopleName(std::vector<std::string>* p) {
+  *p = this->bcfIn->getSampleName();
+}
+
+void BCF2GenotypeExtractor::getIncludedPeopleName(
+    std::vector<std::string>* p) const {
+  this->bcfIn->getIncludedSampleName(p);
+}
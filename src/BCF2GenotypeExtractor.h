@@ -0,0 +1,77 @@
+#ifndef BCF2GENOTYPEEXTRACTOR_H
+#define BCF2GENOTYPEEXTRACTOR_H
+
+#include <string>
+#include <vector>
+
+#include "libVcf/VCFFilter.h"
+#include "src/GenotypeExtractor.h"
+
+class BCF2File;
+
+/**
+ * Extract genotypes from BCF2 files. GT (or dosage) values are decoded from
+ * the typed arrays of each record directly into the genotype buffer, with the
+ * same coding as VCFGenotypeExtractor on the equivalent VCF file.
+ */
+class BCF2GenotypeExtractor : public GenotypeExtractor {
+ public:
+  explicit BCF2GenotypeExtractor(const std::string& fn);
+  virtual ~BCF2GenotypeExtractor();
+
+ private:
+  BCF2GenotypeExtractor(const BCF2GenotypeExtractor&);
+  BCF2GenotypeExtractor& operator=(const BCF2GenotypeExtractor&);
+
+ public:
+  /* Site filters */
+  void setSiteDepthMin(int d);
+  void setSiteDepthMax(int d);
+
+  void setSiteFile(const std::string& fn);
+  void setSiteQualMin(int q);
+  void setSiteMACMin(int n);
+  int setAnnoType(const std::string& s);
+
+  void setRange(const RangeList& l);
+  void setRangeList(const std::string& l);
+  void setRangeFile(const std::string& fn);
+  void includePeople(const std::string& v);
+  void includePeople(const std::vector<std::string>& v);
+  void includePeopleFromFile(const std::string& fn);
+  void excludePeople(const std::string& v);
+  void excludePeopleFromFile(const std::string& fn);
+  void excludePeople(const std::vector<std::string>& sample);
+  void excludePeople(const std::vector<std::string>& sample,
+                     const std::vector<int>& index);
+  void excludeAllPeople();
+  void enableAutoMerge();
+  void getPeopleName(std::vector<std::string>* p);
+  void getIncludedPeopleName(std::vector<std::string>* p) const;
+
+ protected:
+  bool readSite(Site* site);
+  void decodeGenotype(const bool useDosage, const bool hemiRegion,
+                      const int numAlt, double* geno);
+
+ private:
+  // same filters as VCFExtractor::passSiteFilter() and passFilter()
+  bool passSiteFilter();
+  bool passFilter();
+
+ private:
+  BCF2File* bcfIn;
+  VCFSiteFilter siteFilter;
+  std::string posStr;               // position of the current site
+  std::string alt;                  // alt alleles of the current site
+  std::vector<double> siteGenotype;  // GT decoded by passFilter()
+  // keys of fields in the string dictionary
+  int keyGT;
+  int keyGD;
+  int keyGQ;
+  int keyDP;
+  int keyAF;
+  int keyANNO;
+};  // class BCF2GenotypeExtractor
+
+#endif /* BCF2GENOTYPEEXTRACTOR_H */
@@ -1,5 +1,7 @@
 #include "DataLoader.h"
 
+#include <string.h>
+
 #include <string>
 #include <vector>
 
@@ -709,27 +711,29 @@ int extractCovariate(const std::string& fn,
   int missingLines = 0;     // record how many lines has missing values
   std::vector<int> columnToExtract;
   std::vector<std::string> extractColumnName;
-  std::vector<std::string> fd;
+  std::vector<char*> fd;
+  std::string iid;
   LineReader lr(fn);
   int lineNo = 0;
   int fieldLen = 0;
-  while (lr.readLineBySep(&fd, "\t ")) {
+  while (lr.readLineViewBySep(&fd, "\t ")) {
     ++lineNo;
     if (lineNo == 1) {  // header line
-      fieldLen = fd.size();
+      const std::vector<std::string> header(fd.begin(), fd.end());
+      fieldLen = header.size();
       if (fieldLen < 2) {
         logger->error(
             "Insufficient column number (<2) in the first line of covariate "
             "file!");
         return -1;
       };
-      if (tolower(fd[0]) != "fid" || tolower(fd[1]) != "iid") {
+      if (tolower(header[0]) != "fid" || tolower(header[1]) != "iid") {
         logger->error("Covariate file header should begin with \"FID IID\"!");
         return -1;
       }
       std::map<std::string, int> headerMap;
-      makeMap(fd, &headerMap);
-      if (fd.size() != headerMap.size()) {
+      makeMap(header, &headerMap);
+      if (header.size() != headerMap.size()) {
         logger->error("Covariate file have duplicated header!");
         return -1;
       }
@@ -747,14 +751,14 @@ int extractCovariate(const std::string& fn,
           extractColumnName.push_back(covNameToUse[i]);
         }
       } else {
-        for (size_t i = 2; i < fd.size(); ++i) {
-          columnToExtract.push_back(headerMap[fd[i]]);
-          extractColumnName.push_back(fd[i]);
+        for (size_t i = 2; i < header.size(); ++i) {
+          columnToExtract.push_back(headerMap[header[i]]);
+          extractColumnName.push_back(header[i]);
         }
       }
     } else {  // body lines
       if (fd.empty() ||
-          (fd[0].empty() && fd.size() == 1)) {  // skip empty lines
+          (fd[0][0] == '\0' && fd.size() == 1)) {  // skip empty lines
         continue;
       }
       if ((int)fd.size() != fieldLen) {
@@ -764,20 +768,21 @@ int extractCovariate(const std::string& fn,
             lineNo);
         return -1;
       }
-      if (includeSampleSet.find(fd[1]) ==
+      iid = fd[1];
+      if (includeSampleSet.find(iid) ==
           includeSampleSet.end()) {  // does not have phenotype
-        noPhenotypeSample.push_back(fd[1]);
+        noPhenotypeSample.push_back(iid);
         continue;
       };
-      processed[fd[1]]++;
-      if (processed[fd[1]] > 1) {
+      processed[iid]++;
+      if (processed[iid] > 1) {
         logger->info("Duplicate sample [ %s ] in covariate file, skipping",
-                     fd[1].c_str());
+                     iid.c_str());
         continue;
       };
       int idx = (*mat).nrow();
       (*mat).resize(idx + 1, columnToExtract.size());
-      (*mat).setRowName(idx, fd[1]);
+      (*mat).setRowName(idx, iid);
 
       missingValueInLine = false;
       for (int i = 0; i < (int)columnToExtract.size(); ++i) {
@@ -793,13 +798,13 @@ int extractCovariate(const std::string& fn,
                   "Covariate file line [ %d ] has non-numerical value [ %s "
                   "], "
                   "we will impute to its mean",
-                  lineNo, fd[columnToExtract[i]].c_str());
+                  lineNo, fd[columnToExtract[i]]);
             } else if (handleMissingCov == DataLoader::COVARIATE_DROP) {
               logger->warn(
                   "Covariate file line [ %d ] has non-numerical value [ %s "
                   "], "
                   "we will skip this sample",
-                  lineNo, fd[columnToExtract[i]].c_str());
+                  lineNo, fd[columnToExtract[i]]);
             }
           }
           (*mat)[idx][i] = 0.0;  // will later be updated
@@ -991,14 +996,14 @@ int loadPedPhenotypeByColumn(const char* fn, std::map<std::string, double>* p,
   std::map<std::string, double>& pheno = *p;
   std::map<std::string, int> dup;  // duplicates
 
-  std::string line;
-  std::vector<std::string> fd;
+  std::vector<char*> fd;
+  std::string pid;
   LineReader lr(fn);
   int lineNo = 0;
   double v;
   int numMissingPhenotype = 0;
-  while (lr.readLine(&line)) {
-    stringNaturalTokenize(line, "\t ", &fd);
+  while (lr.readLineViewBySep(&fd, "\t ")) {
+    removeEmptyField(&fd);
     ++lineNo;
     if ((int)fd.size() < 5 + phenoCol) {
       logger->warn("Skip line %d (short of columns) in phenotype file [ %s ]",
@@ -1018,14 +1023,20 @@ int loadPedPhenotypeByColumn(const char* fn, std::map<std::string, double>* p,
         continue;
       }
     }
-    std::string& pid = fd[1];
+    pid = fd[1];
     if (pheno.count(pid) == 0) {
       // check missing
-      if (str2double(fd[5 + phenoCol - 1].c_str(), &v)) {
+      if (str2double(fd[5 + phenoCol - 1], &v)) {
         pheno[pid] = v;
       } else {
         ++numMissingPhenotype;
         if (numMissingPhenotype <= 10) {
+          // the line was split in place, so join its fields back
+          std::string line = fd[0];
+          for (size_t i = 1; i < fd.size(); ++i) {
+            line += '\t';
+            line += fd[i];
+          }
           logger->warn(
               "Skip: Missing or invalid phenotype type, skipping line %d [ "
               "%s "
@@ -1075,14 +1086,12 @@ int loadPedPhenotypeByHeader(const char* fn, std::map<std::string, double>* p,
     logger->error("Invalid header [ %s ]", phenoHeader);
     return -1;
   }
-  std::vector<std::string> fd;
-  std::string line;
+  std::vector<char*> fd;
   LineReader lr(fn);
   int lineNo = 0;
   int phenoCol = -1;
-  StringTokenizer token("\t ");
-  while (lr.readLine(&line)) {
-    token.naturalTokenize(line, &fd);
+  while (lr.readLineViewBySep(&fd, "\t ")) {
+    removeEmptyField(&fd);
     ++lineNo;
     // check header line
     if (fd.size() < 5) {
@@ -1100,7 +1109,7 @@ int loadPedPhenotypeByHeader(const char* fn, std::map<std::string, double>* p,
     }
     for (size_t i = 5; i < fd.size();
          ++i) {  // skip FID, IID, FatID, MatID, Sex
-      if (fd[i] != phenoHeader) continue;
+      if (strcmp(fd[i], phenoHeader)) continue;
       if (phenoCol < 0) {
         phenoCol = i - 5 + 1;  // will need to find nth phenotype
       } else {
@@ -1272,16 +1281,14 @@ int _loadSex(const std::string& fn,
   sex->assign(sex->size(), -9);
 
   LineReader lr(fn);
-  std::vector<std::string> fd;
+  std::vector<char*> fd;
   int nMale = 0;
   int nFemale = 0;
   int nUnknonw = 0;
   int idx;
   int s;
-  std::string line;
-  StringTokenizer token("\t ");
-  while (lr.readLine(&line)) {
-    token.naturalTokenize(line, &fd);
+  while (lr.readLineViewBySep(&fd, "\t ")) {
+    removeEmptyField(&fd);
     idx = index[fd[1]];
     if (idx < 0) continue;  // sample not in @param includedSample
     s = atoi(fd[4]);        // the 5th column is gender in PLINK PED file
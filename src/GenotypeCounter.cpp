@@ -2,15 +2,109 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
 #include "snp_hwe.c"
 
+/**
+ * Memoize exact HWE P-values by genotype counts.
+ * Rare variants share a handful of count configurations, so most lookups
+ * avoid SNPHWE() altogether. Values are what SNPHWE() returns, computed the
+ * first time a configuration is seen.
+ *  - tables hold configurations with few rare alleles, one table for each of
+ *    the most recent numbers of called genotypes (e.g. all samples, cases and
+ *    controls in MetaScore)
+ *  - a direct-mapped cache of bounded size holds the other configurations
+ * Lookups are serialized by a mutex, which also guards the static buffer in
+ * SNPHWE().
+ */
+class HWECache {
+ public:
+  HWECache() : nextTable(0), cache(CacheSize) {
+    for (int i = 0; i < NumTable; ++i) {
+      tableNumGeno[i] = -1;
+      table[i].resize((MaxTableRare + 1) * (MaxTableRare / 2 + 1), -1.0);
+    }
+  }
+  double get(int nHet, int nHom1, int nHom2) {
+    // P-value is symmetric in two homozygotes
+    const int nHomRare = nHom1 < nHom2 ? nHom1 : nHom2;
+    const int nHomCommon = nHom1 < nHom2 ? nHom2 : nHom1;
+    const int numGeno = nHet + nHomRare + nHomCommon;
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (nHet + 2 * nHomRare <= MaxTableRare) {
+      std::vector<double>& t = getTable(numGeno);
+      double& p = t[nHet * (MaxTableRare / 2 + 1) + nHomRare];
+      if (p < 0) {
+        p = SNPHWE(nHet, nHomRare, nHomCommon);
+      }
+      return p;
+    }
+
+    const unsigned int h = hash(nHet, nHomRare, nHomCommon);
+    Entry& e = cache[h & (CacheSize - 1)];
+    if (e.nHet != nHet || e.nHomRare != nHomRare ||
+        e.nHomCommon != nHomCommon) {
+      e.nHet = nHet;
+      e.nHomRare = nHomRare;
+      e.nHomCommon = nHomCommon;
+      e.pvalue = SNPHWE(nHet, nHomRare, nHomCommon);
+    }
+    return e.pvalue;
+  }
+
+ private:
+  /**
+   * @return the table of @param numGeno genotypes, replacing the tables in
+   * turn when there is none
+   */
+  std::vector<double>& getTable(int numGeno) {
+    for (int i = 0; i < NumTable; ++i) {
+      if (tableNumGeno[i] == numGeno) return table[i];
+    }
+    const int i = nextTable;
+    nextTable = (nextTable + 1) % NumTable;
+    std::fill(table[i].begin(), table[i].end(), -1.0);
+    tableNumGeno[i] = numGeno;
+    return table[i];
+  }
+  static unsigned int hash(int a, int b, int c) {
+    unsigned int h = (unsigned int)a * 0x9E3779B1u;
+    h ^= (unsigned int)b * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (unsigned int)c * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    return h ^ (h >> 15);
+  }
+
+  struct Entry {
+    Entry() : nHet(-1), nHomRare(-1), nHomCommon(-1), pvalue(0.0) {}
+    int nHet;
+    int nHomRare;
+    int nHomCommon;
+    double pvalue;
+  };
+
+  // tables cover nHet + 2 * nHomRare <= MaxTableRare
+  static const int MaxTableRare = 64;
+  static const int NumTable = 4;
+  static const int CacheSize = 1 << 16;  // must be power of 2
+
+  std::mutex lock;
+  int tableNumGeno[NumTable];  // number of genotypes each table is built for
+  std::vector<double> table[NumTable];
+  int nextTable;  // table to replace next
+  std::vector<Entry> cache;
+};
+
 double GenotypeCounter::getHWE() const {
+  static HWECache hweCache;
   double hweP = 0.0;
   if (nHomRef + nHet + nHomAlt == 0 ||
       (nHet < 0 || nHomRef < 0 || nHomAlt < 0)) {
     hweP = 0.0;
   } else {
-    hweP = SNPHWE(nHet, nHomRef, nHomAlt);
+    hweP = hweCache.get(nHet, nHomRef, nHomAlt);
   }
   return hweP;
 }
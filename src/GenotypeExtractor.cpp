@@ -1,5 +1,7 @@
 #include "GenotypeExtractor.h"
 
+#include <algorithm>
+
 #include "GenotypeCounter.h"
 #include "Result.h"
 
@@ -25,24 +27,213 @@ GenotypeExtractor::GenotypeExtractor(const std::string& fn)
       parRegion(NULL),
       sex(NULL),
       sampleSize(-1),
-      multiAllelicMode(false) {}
+      multiAllelicMode(false),
+      altAlleleToParse(-1) {}
 
 GenotypeExtractor::~GenotypeExtractor() {}
 
-// bool GenotypeExtractor::setSiteFreqMin(const double f) {
-//   if (f < 0.0 || f > 1.0) {
-//     return false;
-//   }
-//   this->freqMin = f - 1e-10;  // allow rounding error
-//   return true;
-// }
-// bool GenotypeExtractor::setSiteFreqMax(const double f) {
-//   if (f < 0.0 || f > 1.0) {
-//     return false;
-//   }
-//   this->freqMax = f + 1e-10;  // allow rounding error
-//   return true;
-// }
+int GenotypeExtractor::extractMultipleGenotype(Matrix* g) {
+  assert(g);
+  assert(g->rows >= 0 && g->cols >= 0);
+  g->Dimension(0, 0);
+  int row = 0;
+  this->genotype.clear();
+  this->altAlleleToParse = -1;
+
+  while (true) {
+    if (this->altAlleleToParse <= 0) {
+      if (!this->readNextSite()) {
+        // reached the end
+        break;
+      }
+    }
+    assert(this->altAlleleToParse > 0);
+    // parse alt allele one at a time
+    this->sampleSize = this->site.numSample;
+    row++;
+    this->variantName.resize(row);
+    this->counter.resize(row);
+    this->counter.back().reset();
+    this->hemiRegion.resize(row);
+
+    const bool useDosage = (!this->dosageTag.empty());
+    if (useDosage && multiAllelicMode) {
+      logger->error(
+          "Unsupported scenario: multiple mode and use dosage as "
+          "genotypes! - we will only use dosage");
+      this->altAlleleToParse = 1;
+    }
+    assert(this->parRegion);
+    const bool isHemiRegion =
+        this->parRegion->isHemiRegion(this->site.chrom, this->site.pos);
+    // e.g.: Loop each (selected) people in the same order as in the VCF
+    const int altAlleleGT = this->altAllele.size() - this->altAlleleToParse + 1;
+    const size_t offset = this->genotype.size();
+    this->genotype.resize(offset + sampleSize);
+    if (sampleSize) {
+      decodeSiteGenotype(useDosage, isHemiRegion, altAlleleGT,
+                         &this->genotype[offset]);
+    }
+    for (int i = 0; i < sampleSize; i++) {
+      this->counter.back().add(this->genotype[offset + i]);
+    }  // end for i
+
+    // check frequency cutoffs
+    const double maf = counter.back().getMAF();
+    if ((this->freqMin > 0. && this->freqMin > maf) ||
+        (this->freqMax > 0. && this->freqMax < maf)) {
+      // undo loaded contents
+      row--;
+      this->variantName.resize(row);
+      this->counter.resize(row);
+      this->hemiRegion.resize(row);
+      this->genotype.resize(this->genotype.size() - this->sampleSize);
+      this->altAlleleToParse--;
+      continue;
+    }
+
+    this->variantName.back() = this->site.chrom;
+    this->variantName.back() += ":";
+    this->variantName.back() += this->site.posStr;
+    if (multiAllelicMode) {
+      this->variantName.back() += this->site.ref;
+      this->variantName.back() += "/";
+      this->variantName.back() +=
+          altAllele[altAllele.size() - this->altAlleleToParse];
+    }
+    this->hemiRegion.back() = (isHemiRegion);
+
+    this->altAlleleToParse--;
+  }  // end while (this->readNextSite())
+
+  // now transpose (marker by people -> people by marker)
+  if (row > 0) {
+    assert((int)genotype.size() == this->sampleSize * row);
+    assign(this->genotype, sampleSize, row, g);
+    for (int i = 0; i < row; ++i) {
+      g->SetColumnLabel(i, variantName[i].c_str());
+    }
+  }
+  return SUCCEED;
+}  // end extractMultipleGenotype(Matrix* g)
+
+int GenotypeExtractor::extractSingleGenotype(Matrix* g, Result* b) {
+  this->genotype.clear();
+  Result& buf = *b;
+
+  if (this->altAlleleToParse <= 0) {
+    if (!this->readNextSite()) {
+      return FILE_END;
+    }
+  }
+  assert(this->altAlleleToParse >= 0);
+
+  buf.updateValue("CHROM", this->site.chrom);
+  buf.updateValue("POS", this->site.posStr);
+  if (FLAG_outputID) {
+    buf.updateValue("ID", this->site.id);
+  }
+  buf.updateValue("REF", this->site.ref);
+  buf.updateValue("ALT", altAllele[altAllele.size() - this->altAlleleToParse]);
+
+  this->sampleSize = this->site.numSample;
+  this->variantName.resize(1);
+  this->counter.resize(1);
+  this->counter.back().reset();
+  this->hemiRegion.resize(1);
+
+  const bool useDosage = (!this->dosageTag.empty());
+  bool isHemiRegion =
+      this->parRegion->isHemiRegion(this->site.chrom, this->site.pos);
+  // e.g.: Loop each (selected) people in the same order as in the VCF
+  const int altAlleleGT = this->altAllele.size() - this->altAlleleToParse + 1;
+  genotype.resize(sampleSize);
+  if (sampleSize) {
+    decodeSiteGenotype(useDosage, isHemiRegion, altAlleleGT, &genotype[0]);
+  }
+  for (int i = 0; i < sampleSize; i++) {
+    counter.back().add(genotype[i]);
+  }
+
+  // check frequency cutoffs
+  const double maf = counter[0].getMAF();
+  if ((this->freqMin > 0. && this->freqMin > maf) ||
+      (this->freqMax > 0. && this->freqMax < maf)) {
+    --this->altAlleleToParse;
+    return FAIL_FILTER;
+  }
+
+  variantName.back() = this->site.chrom;
+  variantName.back() += ':';
+  variantName.back() += this->site.posStr;
+  hemiRegion.back() = isHemiRegion;
+
+  assert((int)genotype.size() == sampleSize);
+  assign(genotype, sampleSize, 1, g);
+  g->SetColumnLabel(0, variantName.back().c_str());
+
+  --this->altAlleleToParse;
+  return SUCCEED;
+}  // end extractSingleGenotype()
+
+bool GenotypeExtractor::readSite(Site* site) { return false; }
+
+void GenotypeExtractor::decodeGenotype(const bool useDosage,
+                                       const bool hemiRegion, const int numAlt,
+                                       double* geno) {
+  const int n = this->site.numSample;
+  std::fill(geno, geno + (numAlt > 0 ? n * numAlt : n), MISSING_GENOTYPE);
+}
+
+bool GenotypeExtractor::readNextSite() {
+  if (!this->readSite(&this->site)) {
+    return false;
+  }
+  if (multiAllelicMode) {
+    stringTokenize(this->site.alt, ",", &this->altAllele);
+  } else {
+    this->altAllele.resize(1);
+    this->altAllele[0] = this->site.alt;
+  }
+  this->altAlleleToParse = this->altAllele.size();
+  this->altGenotype.clear();
+  return true;
+}
+
+void GenotypeExtractor::decodeSiteGenotype(const bool useDosage,
+                                           const bool hemiRegion,
+                                           const int alt, double* geno) {
+  // dosages are the same for all alt alleles
+  if (!multiAllelicMode || useDosage) {
+    decodeGenotype(useDosage, hemiRegion, 0, geno);
+    return;
+  }
+  // decode all alt alleles when the first one is requested
+  const int n = this->site.numSample;
+  const int numAlt = this->altAllele.size();
+  if (this->altGenotype.empty()) {
+    this->altGenotype.resize(numAlt * n);
+    decodeGenotype(useDosage, hemiRegion, numAlt, &this->altGenotype[0]);
+  }
+  assert(1 <= alt && alt <= numAlt);
+  std::copy(this->altGenotype.begin() + (alt - 1) * n,
+            this->altGenotype.begin() + alt * n, geno);
+}
+
+bool GenotypeExtractor::setSiteFreqMin(const double f) {
+  if (f < 0.0 || f > 1.0) {
+    return false;
+  }
+  this->freqMin = f - 1e-10;  // allow rounding error
+  return true;
+}
+bool GenotypeExtractor::setSiteFreqMax(const double f) {
+  if (f < 0.0 || f > 1.0) {
+    return false;
+  }
+  this->freqMax = f + 1e-10;  // allow rounding error
+  return true;
+}
 
 // void GenotypeExtractor::setSiteDepthMin(int d) {
 //   this->vin->setSiteDepthMin(d);
@@ -67,22 +258,22 @@ GenotypeExtractor::~GenotypeExtractor() {}
 //   if (this->GQmax > 0 && gq > this->GQmax) return false;
 //   return true;
 // }
-// void GenotypeExtractor::setGDmin(int m) {
-//   this->needGD = true;
-//   this->GDmin = m;
-// }
-// void GenotypeExtractor::setGDmax(int m) {
-//   this->needGD = true;
-//   this->GDmax = m;
-// }
-// void GenotypeExtractor::setGQmin(int m) {
-//   this->needGQ = true;
-//   this->GQmin = m;
-// }
-// void GenotypeExtractor::setGQmax(int m) {
-//   this->needGQ = true;
-//   this->GQmax = m;
-// }
+void GenotypeExtractor::setGDmin(int m) {
+  this->needGD = true;
+  this->GDmin = m;
+}
+void GenotypeExtractor::setGDmax(int m) {
+  this->needGD = true;
+  this->GDmax = m;
+}
+void GenotypeExtractor::setGQmin(int m) {
+  this->needGQ = true;
+  this->GQmin = m;
+}
+void GenotypeExtractor::setGQmax(int m) {
+  this->needGQ = true;
+  this->GQmax = m;
+}
 
 // void GenotypeExtractor::setSiteFile(const std::string& fn) {
 //   this->vin->setSiteFile(fn);
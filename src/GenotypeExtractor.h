@@ -28,27 +28,28 @@ class GenotypeExtractor {
   /**
    * @param g, store people by marker matrix
    * @return 0 for success
+   * By default, sites are read by readSite() and decoded by decodeGenotype()
    */
-  virtual int extractMultipleGenotype(Matrix* g) = 0;
+  virtual int extractMultipleGenotype(Matrix* g);
   /**
    * @return 0 for success
    * @return -2 for reach end.
    * @param g: people by 1 matrix, where column name is like "chr:pos"
    * @param b: extract information, e.g. "1\t100\tA\tC"
    */
-  virtual int extractSingleGenotype(Matrix* g, Result* b) = 0;
+  virtual int extractSingleGenotype(Matrix* g, Result* b);
 
   /* Site filters */
-  virtual bool setSiteFreqMin(const double f) = 0;
-  virtual bool setSiteFreqMax(const double f) = 0;
+  virtual bool setSiteFreqMin(const double f);
+  virtual bool setSiteFreqMax(const double f);
   virtual void setSiteDepthMin(int d) = 0;
   virtual void setSiteDepthMax(int d) = 0;
   // @return true if GD is valid
   // if GD is missing, we will take GD = 0
-  virtual void setGDmin(int m) = 0;
-  virtual void setGDmax(int m) = 0;
-  virtual void setGQmin(int m) = 0;
-  virtual void setGQmax(int m) = 0;
+  virtual void setGDmin(int m);
+  virtual void setGDmax(int m);
+  virtual void setGQmin(int m);
+  virtual void setGQmax(int m);
 
   virtual void setSiteFile(const std::string& fn) = 0;
   virtual void setSiteQualMin(int q) = 0;
@@ -117,6 +118,37 @@ class GenotypeExtractor {
   const static int FILE_END = -2;
   const static int FAIL_FILTER = -3;
 
+ protected:
+  // the current site, set by readSite() and valid until the next call
+  struct Site {
+    const char* chrom;
+    int pos;
+    const char* posStr;
+    const char* id;
+    const char* ref;
+    const char* alt;  // alt alleles separated by ','
+    int numSample;    // number of selected samples
+  };
+  /**
+   * Read the next site passing all site filters to @param site
+   * @return false at the end
+   */
+  virtual bool readSite(Site* site);
+  /**
+   * Decode genotypes (or dosages) of all selected samples at the current site
+   * to @param geno. If @param numAlt > 0, count each of the @param numAlt
+   * alt alleles, and store one column (of all samples) per alt allele
+   */
+  virtual void decodeGenotype(const bool useDosage, const bool hemiRegion,
+                              const int numAlt, double* geno);
+
+ private:
+  // read the next site and split its alt alleles
+  bool readNextSite();
+  // decode genotypes for alt allele @param alt (1-based) of the current site
+  void decodeSiteGenotype(const bool useDosage, const bool hemiRegion,
+                          const int alt, double* geno);
+
  protected:
   // VCFExtractor* vin;
   double freqMin;
@@ -145,10 +177,14 @@ class GenotypeExtractor {
   int sampleSize;                        // number of extracted vcf samples
   // for multiallelic
   bool multiAllelicMode;  // default is false
-#if 0
+
+ private:
+  Site site;
   std::vector<std::string> altAllele;  // store alt alleles
   int altAlleleToParse;                // number of alleles to parse
-#endif
+  // genotypes of all alt alleles (one column per alt allele) at the current
+  // site in multi-allelic mode, decoded when the first one is requested
+  std::vector<double> altGenotype;
 };  // class GenotypeExtractor
 
 #endif /* GENOTYPEEXTRACTOR_H */
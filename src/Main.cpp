@@ -18,9 +18,11 @@
 #include "base/TimeUtil.h"
 #include "base/Utils.h"
 #include "base/VersionChecker.h"
+#include "libVcf/BCF2File.h"
 #include "libsrc/MathMatrix.h"
 #include "libsrc/MathVector.h"
 
+#include "src/BCF2GenotypeExtractor.h"
 #include "src/BGenGenotypeExtractor.h"
 #include "src/DataConsolidator.h"
 #include "src/DataLoader.h"
@@ -419,6 +421,8 @@ ADD_BOOL_PARAMETER(hideCovar, "--hide-covar",
                    "Surpress output lines of covariates");
 ADD_DEFAULT_INT_PARAMETER(numThread, 1, "--numThread",
                           "Specify number of threads (default:1)");
+ADD_DEFAULT_INT_PARAMETER(seed, 12345, "--seed",
+                          "Random seed of permutation tests (default:12345)");
 ADD_BOOL_PARAMETER(outputID, "--outputID",
                    "Output VCF IDs in single-variant assocition results");
 ADD_BOOL_PARAMETER(help, "--help", "Print detailed help message");
@@ -506,7 +510,19 @@ int main(int argc, char** argv) {
 
   GenotypeExtractor* ge = NULL;
   if (!FLAG_inVcf.empty()) {
-    ge = new VCFGenotypeExtractor(FLAG_inVcf);
+    // BCF2 files are decoded natively; BCF1 files still go through samtools
+    if ((endsWith(FLAG_inVcf, ".bcf") || endsWith(FLAG_inVcf, ".bcf.gz")) &&
+        BCF2File::isBCF2File(FLAG_inVcf)) {
+      // conditional markers are loaded by VCFGenotypeExtractor
+      if (!FLAG_condition.empty()) {
+        logger->error("Cannot use --condition with BCF2 file [ %s ]",
+                      FLAG_inVcf.c_str());
+        exit(1);
+      }
+      ge = new BCF2GenotypeExtractor(FLAG_inVcf);
+    } else {
+      ge = new VCFGenotypeExtractor(FLAG_inVcf);
+    }
   } else if (!FLAG_inBgen.empty()) {
     ge = new BGenGenotypeExtractor(FLAG_inBgen, FLAG_inBgenSample);
   } else if (!FLAG_inKgg.empty()) {
@@ -884,6 +900,10 @@ int main(int argc, char** argv) {
   }
 
   ModelManager modelManager(FLAG_outPrefix);
+  // compress bgzipped (meta-analysis) outputs in background threads
+  if (FLAG_numThread > 1) {
+    modelManager.setNumCompressThread(FLAG_numThread);
+  }
   // set up models in qtl/binary modes
   if (dataLoader.isBinaryPhenotype()) {
     modelManager.setBinaryOutcome();
@@ -1128,7 +1148,7 @@ int main(int argc, char** argv) {
       ++variantProcessed;
       dc.consolidate(phenotypeMatrix, covariate, genotype);
 
-      buf.updateValue("N_INFORMATIVE", toString(genotype.rows));
+      buf.updateValue("N_INFORMATIVE", genotype.rows);
 
       // fit each model
       for (size_t m = 0; m != numModel; m++) {
@@ -419,7 +419,23 @@ class MetaCovBase {
   virtual int transformGenotype(FloatMatrixRef& out, DataConsolidator* dc) = 0;
   virtual int calculateXX(FloatMatrixRef& x1, FloatMatrixRef& x2,
                           float* covXX) = 0;
+  // calculate covariance between each column of @param x1 and each column of
+  // @param x2, store to @param covXX (a x1.ncol_ by x2.ncol_ matrix)
+  virtual int calculateXX(FloatMatrixRef& x1, FloatMatrixRef& x2,
+                          FloatMatrixRef& covXX) {
+    for (int j = 0; j < x2.ncol_; ++j) {
+      FloatMatrixRef x2Col(x2.memory_ + (size_t)j * x2.nrow_, x2.nrow_, 1);
+      for (int i = 0; i < x1.ncol_; ++i) {
+        FloatMatrixRef x1Col(x1.memory_ + (size_t)i * x1.nrow_, x1.nrow_, 1);
+        calculateXX(x1Col, x2Col,
+                    covXX.memory_ + (size_t)j * covXX.nrow_ + i);
+      }
+    }
+    return 0;
+  }
   virtual int calculateXZ(FloatMatrixRef& inGeno, FloatMatrixRef& outXZ) = 0;
+  // @return true if covXX is (*w) * x1' * x2 for a constant @param w
+  virtual bool getUniformWeight(float* w) { return false; }
 
   virtual int calculateZZ(Matrix* covZZ) = 0;
   bool needToFitNullModel;
@@ -477,6 +493,11 @@ class MetaCovFamQtl : public MetaCovBase {
     // (*covXX) /= nSample;
     return 0;
   }
+  int calculateXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
+                  FloatMatrixRef& covXX) {
+    metaCov.GetCovXX(g1, g2, *U, *S, covXX);
+    return 0;
+  }
   int calculateXZ(FloatMatrixRef& g, FloatMatrixRef& covXZ) {
     metaCov.GetCovXZ(g, *U, *S, covXZ);
     return 0;
@@ -547,6 +568,19 @@ class MetaCovUnrelatedQtl : public MetaCovBase {
     *covXX = x1E.col(0).dot(x2E.col(0)) / this->sigma2;
     return 0;
   }
+  int calculateXX(FloatMatrixRef& x1, FloatMatrixRef& x2,
+                  FloatMatrixRef& covXX) {
+    REF_TO_EIGEN(x1, x1E);
+    REF_TO_EIGEN(x2, x2E);
+    REF_TO_EIGEN(covXX, covXX_E);
+    covXX_E.noalias() = x1E.transpose() * x2E;
+    covXX_E /= this->sigma2;
+    return 0;
+  }
+  bool getUniformWeight(float* w) {
+    *w = 1.0 / this->sigma2;
+    return true;
+  }
   int calculateXZ(FloatMatrixRef& x, FloatMatrixRef& covXZ) {
     //     const int nc = this->cov.cols;
     //     (*covXZ).resize(nc);
@@ -654,6 +688,13 @@ class MetaCovFamBinary : public MetaCovBase {
     (*covXX) *= b * b;
     return 0;
   }
+  int calculateXX(FloatMatrixRef& g1, FloatMatrixRef& g2,
+                  FloatMatrixRef& covXX) {
+    metaCov.GetCovXX(g1, g2, *U, *S, covXX);
+    REF_TO_EIGEN(covXX, covXX_E);
+    covXX_E *= b * b;
+    return 0;
+  }
   int calculateXZ(FloatMatrixRef& g, FloatMatrixRef& covXZ) {
     metaCov.GetCovXZ(g, *U, *S, covXZ);
     // const int n = covXZ->size();
@@ -728,6 +769,14 @@ class MetaCovUnrelatedBinary : public MetaCovBase {
 
     return 0;
   }
+  int calculateXX(FloatMatrixRef& x1, FloatMatrixRef& x2,
+                  FloatMatrixRef& covX1X2) {
+    REF_TO_EIGEN(x1, x1E);
+    REF_TO_EIGEN(x2, x2E);
+    REF_TO_EIGEN(covX1X2, covXX_E);
+    covXX_E.noalias() = x1E.transpose() * (weight.asDiagonal() * x2E);
+    return 0;
+  }
   // covXZ = g' W Z where Z = (z1, z2, ... , zp)
   int calculateXZ(FloatMatrixRef& x, FloatMatrixRef& covXZ) {
     // const int nCov = cov.cols;
@@ -803,28 +852,36 @@ MetaCovTest::MetaCovTest(int windowSize)
       modelAuto(NULL),
       modelX(NULL),
       useBolt(false),
+      useCompactGenotype(false),
+      useBinaryOutput(false),
+      useHalfPrecision(false),
       fitOK(false),
       useFamilyModel(false),
       isHemiRegion(false) {
   this->modelName = "MetaCov";
+  this->numClosed = 0;
+  this->numPending = 0;
   this->indexResult = true;
   this->numVariant = 0;
   this->nSample = -1;
   this->fout = NULL;
   this->windowSize = windowSize;
-  result.addHeader("CHROM");
-  result.addHeader("START_POS");
-  result.addHeader("END_POS");
-  result.addHeader("NUM_MARKER");
-  result.addHeader("MARKER_POS");
-  result.addHeader("COV");
+  colChrom = result.addHeader("CHROM");
+  colStartPos = result.addHeader("START_POS", Result::INT_COLUMN);
+  colEndPos = result.addHeader("END_POS", Result::INT_COLUMN);
+  colNumMarker = result.addHeader("NUM_MARKER", Result::INT_COLUMN);
+  colMarkerPos = result.addHeader("MARKER_POS");
+  colCov = result.addHeader("COV");
 }
 MetaCovTest::~MetaCovTest() {
-  while (queue.size() > 0) {
-    printCovariance(fout, queue, isBinaryOutcome());
-    genoPool.deallocate(queue.front().geno);
-    genoCovPool.deallocate(queue.front().covXZ);
-    queue.pop_front();
+  // close all remaining windows
+  calculateCovariance();
+  for (; numClosed < queue.size(); ++numClosed) {
+    queue[numClosed].lastSeq = numVariant - 1;
+  }
+  printClosedWindow();
+  if (useBinaryOutput) {
+    binaryOut.close();
   }
   if (modelAuto) {
     delete modelAuto;
@@ -856,6 +913,16 @@ int MetaCovTest::fitWithGivenGenotype(Matrix& genotype, DataConsolidator* dc) {
     nCovariate = dc->getCovariate().cols + 1;  // intercept
     genoPool.setChunkSize(nSample);
     genoCovPool.setChunkSize(nCovariate);
+    // kinship-transformed genotypes are no longer hard calls
+    if (useCompactGenotype && (useFamilyModel || useBolt)) {
+      logger->warn(
+          "Compact genotype storage is only used for unrelated "
+          "individuals, falling back to float storage");
+      useCompactGenotype = false;
+    }
+    if (useCompactGenotype) {
+      compactGenoPool.setChunkSize(nSample);
+    }
   }
   if (nSample != genotype.rows) {
     fprintf(stderr, "Sample size changed at [ %s:%s ]\n",
@@ -891,8 +958,10 @@ int MetaCovTest::fitWithGivenGenotype(Matrix& genotype, DataConsolidator* dc) {
   }
   if (!model) return -1;
 
-  if (model->needToFitNullModel || dc->isPhenotypeUpdated() ||
-      dc->isCovariateUpdated()) {
+  const bool nullModelUpdated = model->needToFitNullModel ||
+                                dc->isPhenotypeUpdated() ||
+                                dc->isCovariateUpdated();
+  if (nullModelUpdated) {
     // copyCovariateAndIntercept(genotype.rows, covariate, &cov);
     fitOK = (0 == model->FitNullModel(genotype, dc));
     if (!fitOK) return -1;
@@ -910,80 +979,216 @@ int MetaCovTest::fitWithGivenGenotype(Matrix& genotype, DataConsolidator* dc) {
     // model->transformGenotype(&loci.geno, dc);
     // model->calculateXZ(loci.geno, &loci.covXZ);
     // const int numCovariate = dc->getCovariate().cols;
-    FloatMatrixRef x(genoPool.chunk(loci.geno), nSample, 1);
-    FloatMatrixRef xz(genoCovPool.chunk(loci.geno), 1, nCovariate);
+    float* g =
+        useCompactGenotype ? genoBuffer.data() : genoPool.chunk(loci.geno);
+    FloatMatrixRef x(g, nSample, 1);
+    FloatMatrixRef xz(genoCovPool.chunk(loci.covXZ), 1, nCovariate);
     model->transformGenotype(x, dc);
     if (nCovariate) {
       model->calculateXZ(x, xz);
     }
-    if (model->needToFitNullModel || dc->isPhenotypeUpdated() ||
-        dc->isCovariateUpdated()) {
+    if (nullModelUpdated) {
       model->calculateZZ(&this->covZZ);
       CholeskyInverseMatrix(this->covZZ, &this->covZZInv);
     }
   }
+  if (useCompactGenotype) {
+    compactGenoPool.store(loci.geno, genoBuffer.data());
+  }
   fitOK = true;
   return 0;
 }  // fitWithGivenGenotype
 
 void MetaCovTest::assignGenotype(Matrix& genotype, Genotype& genoIdx) {
-  genoIdx = genoPool.allocate();
-  float* p = genoPool.chunk(genoIdx);
+  float* p;
+  if (useCompactGenotype) {
+    genoIdx = compactGenoPool.allocate();
+    genoBuffer.resize(nSample);
+    p = genoBuffer.data();
+  } else {
+    genoIdx = genoPool.allocate();
+    p = genoPool.chunk(genoIdx);
+  }
   for (int i = 0; i < nSample; ++i) {
     p[i] = genotype[i][0];
   }
 }
 
+void MetaCovTest::loadGenotype(Genotype genoIdx, float* out) {
+  if (useCompactGenotype) {
+    compactGenoPool.load(genoIdx, out);
+  } else {
+    const float* p = genoPool.chunk(genoIdx);
+    std::copy(p, p + nSample, out);
+  }
+}
+
+void MetaCovTest::releaseGenotype(Genotype genoIdx) {
+  if (useCompactGenotype) {
+    compactGenoPool.deallocate(genoIdx);
+  } else {
+    genoPool.deallocate(genoIdx);
+  }
+}
+
+void MetaCovTest::calculateCovariance() {
+  if (numPending == 0) {
+    return;
+  }
+  const int numQueue = queue.size();
+  const int firstPending = numQueue - numPending;
+  const int firstPendingSeq = queue[firstPending].seq;
+  // skip closed windows that end before the pending variants
+  int firstRow = 0;
+  while (firstRow < firstPending &&
+         queue[firstRow].lastSeq < firstPendingSeq) {
+    ++firstRow;
+  }
+  const int numRow = numQueue - firstRow;
+
+  covBlock.resize(numRow, numPending);
+  float weight;
+  if (useCompactGenotype && model->getUniformWeight(&weight)) {
+    // x1' * x2 by counting genotype codes
+#pragma omp parallel for
+    for (int i = 0; i < numRow; ++i) {
+      for (int j = 0; j < numPending; ++j) {
+        covBlock(i, j) =
+            weight * compactGenoPool.dot(queue[firstRow + i].geno,
+                                         queue[firstPending + j].geno);
+      }
+    }
+  } else {
+    Eigen::MatrixXf pendingGeno(nSample, numPending);
+    for (int j = 0; j < numPending; ++j) {
+      loadGenotype(queue[firstPending + j].geno, pendingGeno.col(j).data());
+    }
+    FloatMatrixRef pendingRef(pendingGeno.data(), nSample, numPending);
+
+    // genotypes of consecutive variants are adjacent in genoPool unless the
+    // ring wraps around, so rows are multiplied in (usually one or two)
+    // contiguous segments. Compactly stored rows are decoded in tiles.
+    Eigen::MatrixXf segmentCov;
+    Eigen::MatrixXf tile;
+    for (int r = 0; r < numRow;) {
+      float* start;
+      int len = 1;
+      if (useCompactGenotype) {
+        len = std::min((int)CovBlockSize, numRow - r);
+        tile.resize(nSample, len);
+        for (int k = 0; k < len; ++k) {
+          loadGenotype(queue[firstRow + r + k].geno, tile.col(k).data());
+        }
+        start = tile.data();
+      } else {
+        start = genoPool.chunk(queue[firstRow + r].geno);
+        while (r + len < numRow &&
+               genoPool.chunk(queue[firstRow + r + len].geno) ==
+                   start + (size_t)len * nSample) {
+          ++len;
+        }
+      }
+      FloatMatrixRef rowRef(start, nSample, len);
+      segmentCov.resize(len, numPending);
+      FloatMatrixRef segmentRef(segmentCov.data(), len, numPending);
+      model->calculateXX(rowRef, pendingRef, segmentRef);
+      covBlock.middleRows(r, len) = segmentCov;
+      r += len;
+    }
+  }
+
+  // adjust for covariates
+  if (!useBolt && nCovariate) {
+    Eigen::MatrixXf rowXZ(numRow, nCovariate);
+    for (int i = 0; i < numRow; ++i) {
+      rowXZ.row(i) = Eigen::Map<Eigen::RowVectorXf>(
+          genoCovPool.chunk(queue[firstRow + i].covXZ), nCovariate);
+    }
+    Eigen::MatrixXf pendingXZ(numPending, nCovariate);
+    for (int j = 0; j < numPending; ++j) {
+      pendingXZ.row(j) = Eigen::Map<Eigen::RowVectorXf>(
+          genoCovPool.chunk(queue[firstPending + j].covXZ), nCovariate);
+    }
+    Eigen::MatrixXf covZZInvE;
+    G_to_Eigen(this->covZZInv, &covZZInvE);
+    covBlock.noalias() -= rowXZ * (covZZInvE * pendingXZ.transpose());
+  }
+
+  for (int i = 0; i < numRow; ++i) {
+    Loci& l = queue[firstRow + i];
+    for (int j = 0; j < numPending; ++j) {
+      const int seq = queue[firstPending + j].seq;
+      if (seq >= l.seq && seq <= l.lastSeq) {
+        l.covXX.push_back(covBlock(i, j));
+      }
+    }
+  }
+  numPending = 0;
+}
+
+void MetaCovTest::printClosedWindow() {
+  const int firstPendingSeq = numVariant - numPending;
+  while (numClosed > 0 && queue.front().lastSeq < firstPendingSeq) {
+    printCovariance(fout, queue, isBinaryOutcome());
+    releaseGenotype(queue.front().geno);
+    genoCovPool.deallocate(queue.front().covXZ);
+    queue.pop_front();
+    --numClosed;
+  }
+}
+
 int MetaCovTest::printCovariance(FileWriter* fp,
                                  const std::deque<Loci>& lociQueue,
                                  bool binaryOutcome) {
-  std::deque<Loci>::const_iterator iter = lociQueue.begin();
-
-  const size_t numMarker = lociQueue.size();
+  const Loci& front = lociQueue.front();
+  const size_t numMarker = front.covXX.size();
   position.resize(numMarker);
-  this->covXX.resize(numMarker);
-  float covX1X2;
-  for (int idx = 0; iter != lociQueue.end(); ++iter, ++idx) {
-    position[idx] = iter->pos.pos;
-    FloatMatrixRef frontGeno(genoPool.chunk(lociQueue.front().geno), nSample,
-                             1);
-    FloatMatrixRef frontGenoCov(genoCovPool.chunk(lociQueue.front().covXZ), 1,
-                                nCovariate);
-    if (!useBolt) {
-      FloatMatrixRef iterGeno(genoPool.chunk(iter->geno), nSample, 1);
-      // model->calculateXX(lociQueue.front().geno, iter->geno, &covX1X2);
-      model->calculateXX(frontGeno, iterGeno, &covX1X2);
-      // this->covXX[idx] = computeScaledXX(covX1X2, lociQueue.front().covXZ,
-      //                                    iter->covXZ, this->covZZInv);
-      FloatMatrixRef iterGenoCov(genoCovPool.chunk(iter->geno), 1, nCovariate);
-      this->covXX[idx] =
-          computeScaledXX(covX1X2, frontGenoCov, iterGenoCov, this->covZZInv);
+  for (size_t idx = 0; idx < numMarker; ++idx) {
+    position[idx] = lociQueue[idx].pos.pos;
+  }
 
-    } else {
-      // model->calculateXX(lociQueue.front().geno, iter->geno,
-      // &this->covXX[idx]);
-      FloatMatrixRef iterGeno(genoPool.chunk(iter->geno), nSample, 1);
-      model->calculateXX(frontGeno, iterGeno, &covX1X2);
-      this->covXX[idx] = covX1X2;
+  // divide n is by convention, no particular meaning.
+  // will divide n for covXX, covXZ and covZZ
+  const float scale = 1.0 / nSample;
+  if (useBinaryOutput) {
+    MetaCovRecord& r = binaryRecord;
+    r.chrom = front.pos.chrom;
+    r.position = position;
+    r.covXX.resize(numMarker);
+    for (size_t i = 0; i < numMarker; ++i) {
+      r.covXX[i] = front.covXX[i] * scale;
+    }
+    r.hasCovariate = outputGwama || binaryOutcome;
+    r.covXZ.clear();
+    r.covZZ.clear();
+    if (r.hasCovariate) {
+      const float* xz = genoCovPool.chunk(front.covXZ);
+      for (int i = 0; i < nCovariate; ++i) {
+        r.covXZ.push_back(xz[i] * scale);
+      }
+      for (int i = 0; i < covZZ.rows; ++i) {
+        for (int j = 0; j <= i; ++j) {
+          r.covZZ.push_back(covZZ[i][j] * scale);
+        }
+      }
     }
+    binaryOut.write(r);
+    return 0;
   }
 
-  result.updateValue("CHROM", lociQueue.front().pos.chrom);
-  result.updateValue("START_POS", lociQueue.front().pos.pos);
-  result.updateValue("END_POS", lociQueue.back().pos.pos);
-  result.updateValue("NUM_MARKER", (int)numMarker);
+  result.updateValueAt(colChrom, front.pos.chrom);
+  result.updateValueAt(colStartPos, front.pos.pos);
+  result.updateValueAt(colEndPos, lociQueue[numMarker - 1].pos.pos);
+  result.updateValueAt(colNumMarker, (int)numMarker);
 
   static std::string s;
   s.resize(0);
 
   appendToString(position, &s);
-  result.updateValue("MARKER_POS", s);
+  result.updateValueAt(colMarkerPos, s);
 
-  // divide n is by convention, no particular meaning.
-  // will divide n for covXX, covXZ and covZZ
-  const float scale = 1.0 / nSample;
   s.clear();
-  appendToString(this->covXX, scale, &s);
+  appendToString(front.covXX, scale, &s);
   if (outputGwama || binaryOutcome) {
     s += ':';
     FloatMatrixRef covXZMat(genoCovPool.chunk(lociQueue.front().covXZ),
@@ -993,7 +1198,7 @@ int MetaCovTest::printCovariance(FileWriter* fp,
     s += ':';
     appendToString(this->covZZ, scale, &s);
   }
-  result.updateValue("COV", s);
+  result.updateValueAt(colCov, s);
   result.writeValueLine(fp);
   return 0;
 }  // printCovariance
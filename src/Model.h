@@ -5,10 +5,13 @@
 #include <gsl/gsl_rng.h>
 
 #include <deque>
+#include <limits>
 
 #include "libsrc/MathMatrix.h"
 
 #include "base/Argument.h"
+#include "base/CompactGenotypePool.h"
+#include "base/MetaCovBinary.h"
 #include "base/ParRegion.h"
 #include "base/RingMemoryPool.h"
 #include "regression/MatrixRef.h"
@@ -41,6 +44,7 @@
 #include "src/ModelParser.h"
 #include "src/ModelUtil.h"
 #include "src/Permutation.h"
+#include "src/PermutationEngine.h"
 #include "src/Result.h"
 #include "src/Summary.h"
 
@@ -53,6 +57,7 @@
 #endif
 #include <omp.h>
 DECLARE_BOOL_PARAMETER(hideCovar);
+DECLARE_INT_PARAMETER(seed);
 
 extern SummaryHeader* g_SummaryHeader;
 
@@ -98,10 +103,10 @@ class SingleVariantWaldTest : public ModelFitter {
  public:
   SingleVariantWaldTest() : fitOK(false) {
     this->modelName = "SingleWald";
-    result.addHeader("Test");
-    result.addHeader("Beta");
-    result.addHeader("SE");
-    result.addHeader("Pvalue");
+    colTest = result.addHeader("Test");
+    colBeta = result.addHeader("Beta", Result::DOUBLE_COLUMN);
+    colSE = result.addHeader("SE", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -148,7 +153,7 @@ class SingleVariantWaldTest : public ModelFitter {
         continue;
       }
       siteInfo.writeValueTab(fp);
-      result.updateValue("Test", this->X.GetColumnLabel(i));
+      result.updateValueAt(colTest, this->X.GetColumnLabel(i));
       if (fitOK) {
         double beta, se, pval;
         if (!isBinaryOutcome()) {
@@ -161,9 +166,9 @@ class SingleVariantWaldTest : public ModelFitter {
           pval = logistic.GetAsyPvalue()[i];
         }
 
-        result.updateValue("Beta", beta);
-        result.updateValue("SE", se);
-        result.updateValue("Pvalue", pval);
+        result.updateValueAt(colBeta, beta);
+        result.updateValueAt(colSE, se);
+        result.updateValueAt(colPvalue, pval);
       }
       result.writeValueLine(fp);
     }
@@ -175,16 +180,18 @@ class SingleVariantWaldTest : public ModelFitter {
   LinearRegression linear;
   LogisticRegression logistic;
   bool fitOK;
+  // columns of result
+  int colTest, colBeta, colSE, colPvalue;
 };  // SingleVariantWaldTest
 
 class SingleVariantFirthTest : public ModelFitter {
  public:
   SingleVariantFirthTest() : fitOK(false) {
     this->modelName = "SingleFirth";
-    result.addHeader("Test");
-    result.addHeader("Beta");
-    result.addHeader("SE");
-    result.addHeader("Pvalue");
+    colTest = result.addHeader("Test");
+    colBeta = result.addHeader("Beta", Result::DOUBLE_COLUMN);
+    colSE = result.addHeader("SE", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -234,11 +241,11 @@ class SingleVariantFirthTest : public ModelFitter {
     for (int i = 1; i < this->X.cols; ++i) {
       siteInfo.writeValueTab(fp);
       result.clearValue();
-      result.updateValue("Test", this->X.GetColumnLabel(i));
+      result.updateValueAt(colTest, this->X.GetColumnLabel(i));
       if (fitOK) {
-        result.updateValue("Beta", firth.GetCovEst()[i]);
-        result.updateValue("SE", sqrt(firth.GetCovB()[i][i]));
-        result.updateValue("Pvalue", firth.GetAsyPvalue()[i]);
+        result.updateValueAt(colBeta, firth.GetCovEst()[i]);
+        result.updateValueAt(colSE, sqrt(firth.GetCovB()[i][i]));
+        result.updateValueAt(colPvalue, firth.GetAsyPvalue()[i]);
       }
       result.writeValueLine(fp);
     }
@@ -249,6 +256,8 @@ class SingleVariantFirthTest : public ModelFitter {
   Vector Y;  // phenotype
   FirthRegression firth;
   bool fitOK;
+  // columns of result
+  int colTest, colBeta, colSE, colPvalue;
 };  // SingleVariantFirthTest
 
 class SingleVariantScoreTest : public ModelFitter {
@@ -307,51 +316,52 @@ class SingleVariantScoreTest : public ModelFitter {
   // write result header
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeHeaderTab(fp);
-    result.addHeader("AF");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("STAT");
-    result.addHeader("DIRECTION");
-    result.addHeader("EFFECT");
-    result.addHeader("SE");
-    result.addHeader("PVALUE");
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colU = result.addHeader("U", Result::DOUBLE_COLUMN);
+    colV = result.addHeader("V", Result::DOUBLE_COLUMN);
+    colStat = result.addHeader("STAT", Result::DOUBLE_COLUMN);
+    colDirection = result.addHeader("DIRECTION");
+    colEffect = result.addHeader("EFFECT", Result::DOUBLE_COLUMN);
+    colSE = result.addHeader("SE", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("PVALUE", Result::DOUBLE_COLUMN);
     result.writeHeaderLine(fp);
   }
   // write model output
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     result.clearValue();
-    result.updateValue("AF", af);
+    result.updateValueAt(colAF, af);
     if (fitOK) {
       if (!isBinaryOutcome()) {
         const double u = linear.GetU()[0][0];
         const double v = linear.GetV()[0][0];
-        result.updateValue("U", u);
-        result.updateValue("V", v);
-        result.updateValue("STAT", linear.GetStat());
+        result.updateValueAt(colU, u);
+        result.updateValueAt(colV, v);
+        result.updateValueAt(colStat, linear.GetStat());
         if (u != 0) {
-          result.updateValue("DIRECTION", linear.GetU()[0][0] > 0 ? "+" : "-");
+          result.updateValueAt(colDirection,
+                               linear.GetU()[0][0] > 0 ? "+" : "-");
         }
         if (v > 0) {
-          result.updateValue("EFFECT", linear.GetBeta()[0][0]);
-          result.updateValue("SE", linear.GetSEBeta(0));
+          result.updateValueAt(colEffect, linear.GetBeta()[0][0]);
+          result.updateValueAt(colSE, linear.GetSEBeta(0));
         }
-        result.updateValue("PVALUE", linear.GetPvalue());
+        result.updateValueAt(colPvalue, linear.GetPvalue());
       } else {
         const double u = logistic.GetU()[0][0];
         const double v = logistic.GetV()[0][0];
-        result.updateValue("U", u);
-        result.updateValue("V", v);
-        result.updateValue("STAT", logistic.GetStat());
+        result.updateValueAt(colU, u);
+        result.updateValueAt(colV, v);
+        result.updateValueAt(colStat, logistic.GetStat());
         if (u != 0) {
-          result.updateValue("DIRECTION",
-                             logistic.GetU()[0][0] > 0 ? "+" : "-");
+          result.updateValueAt(colDirection,
+                               logistic.GetU()[0][0] > 0 ? "+" : "-");
         }
         if (v > 0) {
-          result.updateValue("EFFECT", u / v);
-          result.updateValue("SE", 1.0 / sqrt(v));
+          result.updateValueAt(colEffect, u / v);
+          result.updateValueAt(colSE, 1.0 / sqrt(v));
         }
-        result.updateValue("PVALUE", logistic.GetPvalue());
+        result.updateValueAt(colPvalue, logistic.GetPvalue());
       }
     }
     result.writeValueLine(fp);
@@ -369,6 +379,8 @@ class SingleVariantScoreTest : public ModelFitter {
   bool fitOK;
   bool needToFitNullModel;
   Matrix cov;
+  // columns of result
+  int colAF, colU, colV, colStat, colDirection, colEffect, colSE, colPvalue;
 };  // SingleVariantScoreTest
 
 class SingleVariantFisherExactTest : public ModelFitter {
@@ -393,15 +405,15 @@ class SingleVariantFisherExactTest : public ModelFitter {
   // write result header
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeHeaderTab(fp);
-    result.addHeader("N00");
-    result.addHeader("N01");
-    result.addHeader("N10");
-    result.addHeader("N11");
-    result.addHeader("CtrlAF");
-    result.addHeader("CaseAF");
-    result.addHeader("PvalueTwoSide");
-    result.addHeader("PvalueLess");
-    result.addHeader("PvalueGreater");
+    colN00 = result.addHeader("N00", Result::INT_COLUMN);
+    colN01 = result.addHeader("N01", Result::INT_COLUMN);
+    colN10 = result.addHeader("N10", Result::INT_COLUMN);
+    colN11 = result.addHeader("N11", Result::INT_COLUMN);
+    colCtrlAF = result.addHeader("CtrlAF", Result::DOUBLE_COLUMN);
+    colCaseAF = result.addHeader("CaseAF", Result::DOUBLE_COLUMN);
+    colPvalueTwoSide = result.addHeader("PvalueTwoSide", Result::DOUBLE_COLUMN);
+    colPvalueLess = result.addHeader("PvalueLess", Result::DOUBLE_COLUMN);
+    colPvalueGreater = result.addHeader("PvalueGreater", Result::DOUBLE_COLUMN);
     result.writeHeaderLine(fp);
   }
   // fitting model
@@ -463,24 +475,24 @@ class SingleVariantFisherExactTest : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK) {
-      result.updateValue("N00", model.Get00());
-      result.updateValue("N01", model.Get01());
-      result.updateValue("N10", model.Get10());
-      result.updateValue("N11", model.Get11());
+      result.updateValueAt(colN00, model.Get00());
+      result.updateValueAt(colN01, model.Get01());
+      result.updateValueAt(colN10, model.Get10());
+      result.updateValueAt(colN11, model.Get11());
 
       if (ctrlAN == 0) {
-        result.updateValue("CtrlAF", 0);
+        result.updateValueAt(colCtrlAF, 0);
       } else {
-        result.updateValue("CtrlAF", 1.0 * ctrlAC / ctrlAN);
+        result.updateValueAt(colCtrlAF, 1.0 * ctrlAC / ctrlAN);
       }
       if (caseAN == 0) {
-        result.updateValue("CaseAF", 0);
+        result.updateValueAt(colCaseAF, 0);
       } else {
-        result.updateValue("CaseAF", 1.0 * caseAC / caseAN);
+        result.updateValueAt(colCaseAF, 1.0 * caseAC / caseAN);
       }
-      result.updateValue("PvalueTwoSide", model.getPExactTwoSided());
-      result.updateValue("PvalueLess", model.getPExactOneSidedLess());
-      result.updateValue("PvalueGreater", model.getPExactOneSidedGreater());
+      result.updateValueAt(colPvalueTwoSide, model.getPExactTwoSided());
+      result.updateValueAt(colPvalueLess, model.getPExactOneSidedLess());
+      result.updateValueAt(colPvalueGreater, model.getPExactOneSidedGreater());
     }
     result.writeValueLine(fp);
   }
@@ -499,6 +511,9 @@ class SingleVariantFisherExactTest : public ModelFitter {
   int ctrlAN;
 
   bool fitOK;
+  // columns of result
+  int colN00, colN01, colN10, colN11, colCtrlAF, colCaseAF, colPvalueTwoSide,
+      colPvalueLess, colPvalueGreater;
 };  // SingleVariantFisherExactTest
 
 class SingleVariantDominantFisherExactTest
@@ -528,10 +543,10 @@ class SingleVariantFamilyScore : public ModelFitter {
         pvalue(-1.) {
     this->modelName = "FamScore";
     this->familyModel = true;
-    result.addHeader("AF");
-    result.addHeader("U.Stat");
-    result.addHeader("V.Stat");
-    result.addHeader("Pvalue");
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colUStat = result.addHeader("U.Stat", Result::DOUBLE_COLUMN);
+    colVStat = result.addHeader("V.Stat", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
     needToFitNullModel = true;
   }
   // fitting model
@@ -589,10 +604,10 @@ class SingleVariantFamilyScore : public ModelFitter {
     if (fitOK) {
       if (isBinaryOutcome()) {
       } else {
-        result.updateValue("AF", af);
-        result.updateValue("U.Stat", u);
-        result.updateValue("V.Stat", v);
-        result.updateValue("Pvalue", pvalue);
+        result.updateValueAt(colAF, af);
+        result.updateValueAt(colUStat, u);
+        result.updateValueAt(colVStat, v);
+        result.updateValueAt(colPvalue, pvalue);
       }
     }
     result.writeValueLine(fp);
@@ -610,6 +625,8 @@ class SingleVariantFamilyScore : public ModelFitter {
   double u;
   double v;
   double pvalue;
+  // columns of result
+  int colAF, colUStat, colVStat, colPvalue;
 };  // end SingleVariantFamilyScore
 
 class SingleVariantFamilyLRT : public ModelFitter {
@@ -623,10 +640,10 @@ class SingleVariantFamilyLRT : public ModelFitter {
         pvalue(-1.) {
     this->modelName = "FamLRT";
     this->familyModel = true;
-    result.addHeader("AF");
-    result.addHeader("NullLogLik");
-    result.addHeader("AltLogLik");
-    result.addHeader("Pvalue");
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colNullLogLik = result.addHeader("NullLogLik", Result::DOUBLE_COLUMN);
+    colAltLogLik = result.addHeader("AltLogLik", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
     needToFitNullModel = true;
   }
   // fitting model
@@ -682,10 +699,10 @@ class SingleVariantFamilyLRT : public ModelFitter {
     if (fitOK) {
       if (isBinaryOutcome()) {
       } else {
-        result.updateValue("AF", af);
-        result.updateValue("NullLogLik", nullLogLik);
-        result.updateValue("AltLogLik", altLogLik);
-        result.updateValue("Pvalue", pvalue);
+        result.updateValueAt(colAF, af);
+        result.updateValueAt(colNullLogLik, nullLogLik);
+        result.updateValueAt(colAltLogLik, altLogLik);
+        result.updateValueAt(colPvalue, pvalue);
       }
     }
     result.writeValueLine(fp);
@@ -703,6 +720,8 @@ class SingleVariantFamilyLRT : public ModelFitter {
   double nullLogLik;
   double altLogLik;
   double pvalue;
+  // columns of result
+  int colAF, colNullLogLik, colAltLogLik, colPvalue;
 };  // end SingleVariantFamilyLRT
 
 class SingleVariantFamilyGrammarGamma : public ModelFitter {
@@ -717,10 +736,10 @@ class SingleVariantFamilyGrammarGamma : public ModelFitter {
         pvalue(-1.) {
     this->modelName = "FamGrammarGamma";
     this->familyModel = true;
-    result.addHeader("AF");
-    result.addHeader("Beta");
-    result.addHeader("BetaVar");
-    result.addHeader("Pvalue");
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colBeta = result.addHeader("Beta", Result::DOUBLE_COLUMN);
+    colBetaVar = result.addHeader("BetaVar", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -776,10 +795,10 @@ class SingleVariantFamilyGrammarGamma : public ModelFitter {
     if (fitOK) {
       if (isBinaryOutcome()) {
       } else {
-        result.updateValue("AF", af);
-        result.updateValue("Beta", beta);
-        result.updateValue("BetaVar", betaVar);
-        result.updateValue("Pvalue", pvalue);
+        result.updateValueAt(colAF, af);
+        result.updateValueAt(colBeta, beta);
+        result.updateValueAt(colBetaVar, betaVar);
+        result.updateValueAt(colPvalue, pvalue);
       }
     }
     result.writeValueLine(fp);
@@ -797,20 +816,22 @@ class SingleVariantFamilyGrammarGamma : public ModelFitter {
   double beta;
   double betaVar;
   double pvalue;
+  // columns of result
+  int colAF, colBeta, colBetaVar, colPvalue;
 };  // SingleVariantFamilyGrammarGamma
 
 class CMCTest : public ModelFitter {
  public:
   CMCTest() : fitOK(false), numVariant(-1) {
     this->modelName = "CMC";
-    result.addHeader("NonRefSite");
+    colNonRefSite = result.addHeader("NonRefSite", Result::INT_COLUMN);
 #if 0
     result.addHeader("U.Stat");
     result.addHeader("V.Stat");
     result.addHeader("Effect");
     result.addHeader("SE");
 #endif
-    result.addHeader("Pvalue");
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -860,7 +881,7 @@ class CMCTest : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK) {
-      result.updateValue("NonRefSite", this->totalNonRefSite());
+      result.updateValueAt(colNonRefSite, this->totalNonRefSite());
       if (isBinaryOutcome()) {
 #if 0
         result.updateValue("U.Stat", logistic.GetUStat());
@@ -868,7 +889,7 @@ class CMCTest : public ModelFitter {
         result.updateValue("Effect", logistic.GetEffect());
         result.updateValue("SE"    , logistic.GetSE());
 #endif
-        result.updateValue("Pvalue", logistic.GetPvalue());
+        result.updateValueAt(colPvalue, logistic.GetPvalue());
       } else {
 #if 0
         result.updateValue("U.Stat", linear.GetUStat());
@@ -876,7 +897,7 @@ class CMCTest : public ModelFitter {
         result.updateValue("Effect", linear.GetEffect());
         result.updateValue("SE"    , linear.GetSE());
 #endif
-        result.updateValue("Pvalue", linear.GetPvalue());
+        result.updateValueAt(colPvalue, linear.GetPvalue());
       }
     }
     result.writeValueLine(fp);
@@ -899,16 +920,18 @@ class CMCTest : public ModelFitter {
   LinearRegressionScoreTest linear;
   bool fitOK;
   int numVariant;
+  // columns of result
+  int colNonRefSite, colPvalue;
 };  // CMCTest
 
 class CMCWaldTest : public ModelFitter {
  public:
   CMCWaldTest() : fitOK(false), numVariant(-1) {
     this->modelName = "CMCWald";
-    result.addHeader("NonRefSite");
-    result.addHeader("Beta");
-    result.addHeader("SE");
-    result.addHeader("Pvalue");
+    colNonRefSite = result.addHeader("NonRefSite", Result::INT_COLUMN);
+    colBeta = result.addHeader("Beta", Result::DOUBLE_COLUMN);
+    colSE = result.addHeader("SE", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -954,7 +977,7 @@ class CMCWaldTest : public ModelFitter {
     for (int i = 1; i < this->X.cols; ++i) {
       siteInfo.writeValueTab(fp);
       if (fitOK) {
-        result.updateValue("NonRefSite", this->totalNonRefSite());
+        result.updateValueAt(colNonRefSite, this->totalNonRefSite());
         double beta, se, pval;
         if (!isBinaryOutcome()) {
           beta = linear.GetCovEst()[i];
@@ -965,9 +988,9 @@ class CMCWaldTest : public ModelFitter {
           se = sqrt(logistic.GetCovB()[i][i]);
           pval = logistic.GetAsyPvalue()[i];
         }
-        result.updateValue("Beta", beta);
-        result.updateValue("SE", se);
-        result.updateValue("Pvalue", pval);
+        result.updateValueAt(colBeta, beta);
+        result.updateValueAt(colSE, se);
+        result.updateValueAt(colPvalue, pval);
       }
       result.writeValueLine(fp);
     }
@@ -991,15 +1014,17 @@ class CMCWaldTest : public ModelFitter {
   LinearRegression linear;
   bool fitOK;
   int numVariant;
+  // columns of result
+  int colNonRefSite, colBeta, colSE, colPvalue;
 };  // CMCWaldTest
 
 class ZegginiWaldTest : public ModelFitter {
  public:
   ZegginiWaldTest() : fitOK(false), numVariant(-1) {
     this->modelName = "ZegginiWald";
-    result.addHeader("Beta");
-    result.addHeader("SE");
-    result.addHeader("Pvalue");
+    colBeta = result.addHeader("Beta", Result::DOUBLE_COLUMN);
+    colSE = result.addHeader("SE", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1056,9 +1081,9 @@ class ZegginiWaldTest : public ModelFitter {
           se = sqrt(logistic.GetCovB()[i][i]);
           pval = logistic.GetAsyPvalue()[i];
         }
-        result.updateValue("Beta", beta);
-        result.updateValue("SE", se);
-        result.updateValue("Pvalue", pval);
+        result.updateValueAt(colBeta, beta);
+        result.updateValueAt(colSE, se);
+        result.updateValueAt(colPvalue, pval);
       }
       result.writeValueLine(fp);
     }
@@ -1071,19 +1096,21 @@ class ZegginiWaldTest : public ModelFitter {
   LinearRegression linear;
   bool fitOK;
   int numVariant;
+  // columns of result
+  int colBeta, colSE, colPvalue;
 };  // ZegginiWaldTest
 
 class CMCFisherExactTest : public ModelFitter {
  public:
   CMCFisherExactTest() : fitOK(false) {
     this->modelName = "CMCFisherExact";
-    result.addHeader("N00");
-    result.addHeader("N01");
-    result.addHeader("N10");
-    result.addHeader("N11");
-    result.addHeader("PvalueTwoSide");
-    result.addHeader("PvalueLess");
-    result.addHeader("PvalueGreater");
+    colN00 = result.addHeader("N00", Result::INT_COLUMN);
+    colN01 = result.addHeader("N01", Result::INT_COLUMN);
+    colN10 = result.addHeader("N10", Result::INT_COLUMN);
+    colN11 = result.addHeader("N11", Result::INT_COLUMN);
+    colPvalueTwoSide = result.addHeader("PvalueTwoSide", Result::DOUBLE_COLUMN);
+    colPvalueLess = result.addHeader("PvalueLess", Result::DOUBLE_COLUMN);
+    colPvalueGreater = result.addHeader("PvalueGreater", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1141,13 +1168,13 @@ class CMCFisherExactTest : public ModelFitter {
     siteInfo.writeValueTab(fp);
     result.clearValue();
     if (fitOK) {
-      result.updateValue("N00", model.Get00());
-      result.updateValue("N01", model.Get01());
-      result.updateValue("N10", model.Get10());
-      result.updateValue("N11", model.Get11());
-      result.updateValue("PvalueTwoSide", model.getPExactTwoSided());
-      result.updateValue("PvalueLess", model.getPExactOneSidedLess());
-      result.updateValue("PvalueGreater", model.getPExactOneSidedGreater());
+      result.updateValueAt(colN00, model.Get00());
+      result.updateValueAt(colN01, model.Get01());
+      result.updateValueAt(colN10, model.Get10());
+      result.updateValueAt(colN11, model.Get11());
+      result.updateValueAt(colPvalueTwoSide, model.getPExactTwoSided());
+      result.updateValueAt(colPvalueLess, model.getPExactOneSidedLess());
+      result.updateValueAt(colPvalueGreater, model.getPExactOneSidedGreater());
     }
     result.writeValueLine(fp);
   }
@@ -1160,13 +1187,16 @@ class CMCFisherExactTest : public ModelFitter {
   Matrix collapsedGenotype;
   Table2by2 model;
   bool fitOK;
+  // columns of result
+  int colN00, colN01, colN10, colN11, colPvalueTwoSide, colPvalueLess,
+      colPvalueGreater;
 };  // CMCFisherExactTest
 
 class ZegginiTest : public ModelFitter {
  public:
   ZegginiTest() : fitOK(false), numVariant(-1) {
     this->modelName = "Zeggini";
-    result.addHeader("Pvalue");
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1220,9 +1250,9 @@ class ZegginiTest : public ModelFitter {
     result.clearValue();
     if (fitOK) {
       if (isBinaryOutcome()) {
-        result.updateValue("Pvalue", logistic.GetPvalue());
+        result.updateValueAt(colPvalue, logistic.GetPvalue());
       } else {
-        result.updateValue("Pvalue", linear.GetPvalue());
+        result.updateValueAt(colPvalue, linear.GetPvalue());
       }
     }
     result.writeValueLine(fp);
@@ -1234,14 +1264,19 @@ class ZegginiTest : public ModelFitter {
   LinearRegressionScoreTest linear;
   bool fitOK;
   int numVariant;
+  // columns of result
+  int colPvalue;
 };  // ZegginiTest
 
 class MadsonBrowningTest : public ModelFitter {
  public:
   MadsonBrowningTest(int nPerm, double alpha)
-      : fitOK(false), numVariant(-1), perm(nPerm, alpha) {
+      : fitOK(false),
+        numVariant(-1),
+        perm(nPerm, alpha),
+        engine(128, FLAG_seed) {
     this->modelName = "MadsonBrowning";
-    result.addHeader("Pvalue");
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1278,25 +1313,15 @@ class MadsonBrowningTest : public ModelFitter {
     // record observed stat
     this->perm.init(logistic.GetStat());  // a chi-dist
 
-    int failed = 0;
-    while (this->perm.next()) {
-      permute(&this->pheno);
-      madsonBrowningCollapse(dc, genotype, pheno, &collapsedGenotype);
-      fitOK = logistic.TestCovariate(collapsedGenotype, pheno);
-      if (!fitOK) {
-        if (failed < 10) {
-          failed++;
-          continue;
-        } else {
-          fitOK = false;
-          return -1;
-        }
-      }
-      // record new stats
-      double pStat = logistic.GetStat();
-      this->perm.add(pStat);
-    }  // end permutation
-    return (fitOK ? 0 : -1);
+    // allow at most 10 failed permutations
+    BlockStatistic blockStat(genotype);
+    this->engine.reset();
+    if (this->engine.run(this->pheno, blockStat, &this->perm, 10)) {
+      fitOK = false;
+      return -1;
+    }
+    fitOK = true;
+    return 0;
   }
   void reset() {
     ModelFitter::reset();
@@ -1326,12 +1351,66 @@ class MadsonBrowningTest : public ModelFitter {
   }
 
  private:
+  /**
+   * Madsen-Browning weights depend on control allele frequencies. For a block
+   * of phenotypes, control allele counts, collapsed genotypes and the score
+   * statistics are all computed with matrix products.
+   * Failed score tests (no variation) are reported as NaN.
+   */
+  class BlockStatistic {
+   public:
+    explicit BlockStatistic(Matrix& genotype) {
+      G_to_Eigen(genotype, &this->geno);
+      this->nonMissing = (this->geno.array() >= 0.0).cast<double>();
+      this->genoNonMissing = this->geno.cwiseMax(0.0);
+    }
+    void operator()(const Eigen::MatrixXd& y, Eigen::VectorXd* stat) const {
+      const int n = y.rows();
+      const Eigen::MatrixXd isControl = (y.array() != 1.0).cast<double>();
+      // see getMarkerFrequencyFromControl()
+      const Eigen::MatrixXd ac = this->genoNonMissing.transpose() * isControl;
+      const Eigen::MatrixXd an = this->nonMissing.transpose() * isControl;
+      const Eigen::ArrayXXd freq =
+          (ac.array() + 1.0) / (2.0 * an.array() + 2.0);
+      const Eigen::MatrixXd weight =
+          (freq > 0.0 && freq < 1.0)
+              .select((freq * (1.0 - freq) * (double)n).sqrt().inverse(), 0.0);
+      const Eigen::MatrixXd collapsed = this->geno * weight;
+
+      // see LogisticRegressionScoreTest::TestCovariate(Vector& x, Vector& y)
+      const Eigen::RowVectorXd yMean = y.colwise().mean();
+      const Eigen::RowVectorXd sumS = collapsed.colwise().sum();
+      const Eigen::RowVectorXd sumS2 = collapsed.colwise().squaredNorm();
+      const Eigen::RowVectorXd sumSY =
+          (collapsed.array() * y.array()).colwise().sum();
+      stat->resize(y.cols());
+      for (int i = 0; i < y.cols(); ++i) {
+        const double U = sumSY(i) - yMean(i) * sumS(i);
+        const double V =
+            yMean(i) * (1.0 - yMean(i)) * (sumS2(i) - sumS(i) / n * sumS(i));
+        if (V < 1e-6 || U * U / V < 0) {
+          (*stat)(i) = std::numeric_limits<double>::quiet_NaN();
+          continue;
+        }
+        (*stat)(i) = U * U / V;
+      }
+    }
+
+   private:
+    Eigen::MatrixXd geno;
+    Eigen::MatrixXd genoNonMissing;
+    Eigen::MatrixXd nonMissing;
+  };
+
   Matrix collapsedGenotype;
   Vector pheno;
   LogisticRegressionScoreTest logistic;
   bool fitOK;
   int numVariant;
   Permutation perm;
+  PermutationEngine engine;
+  // columns of result
+  int colPvalue;
 };  // MadsonBrowningTest
 
 // Danyu Lin's method, using 1/sqrt(p(1-p)) as weight
@@ -1342,7 +1421,7 @@ class FpTest : public ModelFitter {
     this->modelName = "Fp";
     fitOK = false;
     numVariant = -1;
-    result.addHeader("Pvalue");
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1395,9 +1474,9 @@ class FpTest : public ModelFitter {
     siteInfo.writeValueTab(fp);
     if (fitOK) {
       if (isBinaryOutcome()) {
-        result.updateValue("Pvalue", logistic.GetPvalue());
+        result.updateValueAt(colPvalue, logistic.GetPvalue());
       } else {
-        result.updateValue("Pvalue", linear.GetPvalue());
+        result.updateValueAt(colPvalue, linear.GetPvalue());
       }
     }
     result.writeValueLine(fp);
@@ -1409,14 +1488,21 @@ class FpTest : public ModelFitter {
   LinearRegressionScoreTest linear;
   bool fitOK;
   int numVariant;
+  // columns of result
+  int colPvalue;
 };  // FpTest
 
 class RareCoverTest : public ModelFitter {
  public:
   RareCoverTest(int nPerm, double alpha)
-      : fitOK(false), numVariant(-1), stat(-1), perm(nPerm, alpha) {
+      : fitOK(false),
+        numVariant(-1),
+        stat(-1),
+        perm(nPerm, alpha),
+        engine(128, FLAG_seed) {
     this->modelName = "RareCover";
-    this->result.addHeader("NumIncludeMarker");
+    colNumIncludeMarker =
+        this->result.addHeader("NumIncludeMarker", Result::INT_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -1457,15 +1543,9 @@ class RareCoverTest : public ModelFitter {
     this->perm.init(this->stat);
 
     // permutation
-    double s;
-    std::set<int> permSelected;
-    while (this->perm.next()) {
-      this->genotype.Transpose(genotype);
-      permute(&pheno);
-
-      s = calculateStat(this->genotype, pheno, &permSelected);
-      this->perm.add(s);
-    }
+    BlockStatistic blockStat(this);
+    this->engine.reset();
+    this->engine.run(pheno, blockStat, &this->perm);
     fitOK = true;
     return (fitOK ? 0 : -1);
   }
@@ -1484,7 +1564,7 @@ class RareCoverTest : public ModelFitter {
     siteInfo.writeValueTab(fp);
     if (fitOK) {
       if (isBinaryOutcome()) {
-        result.updateValue("NumIncludeMarker", (int)this->selected.size());
+        result.updateValueAt(colNumIncludeMarker, (int)this->selected.size());
       }
     }
     result.writeValueTab(fp);
@@ -1496,7 +1576,7 @@ class RareCoverTest : public ModelFitter {
    * Here the genotype is: marker by people
    */
   double calculateStat(Matrix& genotype, Vector& phenotype,
-                       std::set<int>* selectedIndex) {
+                       std::set<int>* selectedIndex) const {
     std::set<int>& selected = *selectedIndex;
     selected.clear();
 
@@ -1535,7 +1615,8 @@ class RareCoverTest : public ModelFitter {
   /**
    * Calculate correlatio of (g + collapsed, pheno)
    */
-  double calculateCorrelation(Vector& g, Vector& collapsed, Vector& pheno) {
+  double calculateCorrelation(Vector& g, Vector& collapsed,
+                              Vector& pheno) const {
     double sum_g = 0.0;
     double sum_g2 = 0.0;
     double sum_p = 0.0;
@@ -1564,7 +1645,7 @@ class RareCoverTest : public ModelFitter {
     double corr = cov_gp / sqrt(v);
     return corr;
   }
-  void combine(Vector* c, Vector& v) {
+  void combine(Vector* c, Vector& v) const {
     int n = v.Length();
     for (int i = 0; i < n; ++i) {
       if ((*c)[i] + v[i] > 0) {
@@ -1574,24 +1655,53 @@ class RareCoverTest : public ModelFitter {
   }
 
  private:
+  /**
+   * RareCover selects markers greedily, so each permuted phenotype in a block
+   * is evaluated separately
+   */
+  class BlockStatistic {
+   public:
+    explicit BlockStatistic(RareCoverTest* model) : model(model) {}
+    void operator()(const Eigen::MatrixXd& y, Eigen::VectorXd* stat) const {
+      const int n = y.rows();
+      Vector pheno(n);
+      std::set<int> permSelected;
+      stat->resize(y.cols());
+      for (int j = 0; j < y.cols(); ++j) {
+        for (int i = 0; i < n; ++i) {
+          pheno[i] = y(i, j);
+        }
+        (*stat)(j) =
+            model->calculateStat(model->genotype, pheno, &permSelected);
+      }
+    }
+
+   private:
+    RareCoverTest* model;
+  };
+
   Matrix genotype;
   std::set<int> selected;
   bool fitOK;
   int numVariant;
   double stat;
   Permutation perm;
+  PermutationEngine engine;
+  // columns of result
+  int colNumIncludeMarker;
 };  // RareCoverTest
 
 class CMATTest : public ModelFitter {
  public:
-  CMATTest(int nPerm, double alpha) : perm(nPerm, alpha) {
+  CMATTest(int nPerm, double alpha)
+      : perm(nPerm, alpha), engine(128, FLAG_seed) {
     this->modelName = "CMAT";
-    N_A = N_U = m_A = m_U = M_A = M_U = 0;
     fitOK = false;
     stat = -1.;
   }
   // fitting model
   int fit(DataConsolidator* dc) {
+    Matrix& phenotype = dc->getPhenotype();
     Matrix& covariate = dc->getCovariate();
 
     if (!isBinaryOutcome()) {
@@ -1610,17 +1720,20 @@ class CMATTest : public ModelFitter {
     }
 
     // we use equal weight
-    this->stat = this->calculateStat(dc, &N_A, &N_U, &m_A, &m_U, &M_A, &M_U);
+    copyPhenotype(phenotype, &this->pheno);
+    BlockStatistic blockStat(dc);
+    Eigen::MatrixXd y(this->pheno.Length(), 1);
+    for (int i = 0; i < this->pheno.Length(); ++i) {
+      y(i, 0) = this->pheno[i];
+    }
+    Eigen::VectorXd obs;
+    blockStat(y, &obs);
+    this->stat = obs(0);
     this->perm.init(this->stat);
 
     // permutation part
-    double d1, d2, d3, d4, d5, d6;  // just used in permutation
-    while (this->perm.next()) {
-      permute(&pheno);
-      // record new stats
-      double pStat = this->calculateStat(dc, &d1, &d2, &d3, &d4, &d5, &d6);
-      this->perm.add(pStat);
-    }  // end permutation
+    this->engine.reset();
+    this->engine.run(this->pheno, blockStat, &this->perm);
     fitOK = true;
     return (fitOK ? 0 : -1);
   }
@@ -1642,79 +1755,67 @@ class CMATTest : public ModelFitter {
       this->perm.writeOutputLine(fp);
     }
   }
-  double calculateStat(DataConsolidator* dc, double* p_N_A, double* p_N_U,
-                       double* p_m_A, double* p_m_U, double* p_M_A,
-                       double* p_M_U) {
-    Matrix& phenotype = dc->getPhenotype();
-    copyPhenotype(phenotype, &this->pheno);
-    Matrix& genotype = dc->getGenotype();
 
-    double& N_A = *p_N_A;
-    double& N_U = *p_N_U;
-    double& m_A = *p_m_A;
-    double& m_U = *p_m_U;
-    double& M_A = *p_M_A;
-    double& M_U = *p_M_U;
-
-    N_A = 0;
-    N_U = 0;
-    m_A = 0;
-    m_U = 0;
-    M_A = 0;
-    M_U = 0;
-
-    for (int i = 0; i < pheno.Length(); ++i) {
-      if (phenotype[i] == 1) {
-        ++N_A;
-      } else {
-        ++N_U;
-      }
-    }
-    for (int i = 0; i < genotype.cols; ++i) {
-      // for each marker, get its allele frequency
-      double af = getMarkerFrequency(dc, i);
-      bool flip = false;
-      if (af > 0.5) {
-        flip = true;
+ private:
+  /**
+   * Calculate CMAT statistics for a block of phenotypes (1: case, otherwise
+   * control). Minor/major allele counts among cases and controls only depend
+   * on the phenotype through per-sample minor allele counts, so a block
+   * reduces to one matrix-vector product.
+   */
+  class BlockStatistic {
+   public:
+    explicit BlockStatistic(DataConsolidator* dc) {
+      Matrix& genotype = dc->getGenotype();
+      this->numMarker = genotype.cols;
+      this->minorCount = Eigen::VectorXd::Zero(genotype.rows);
+      for (int i = 0; i < genotype.cols; ++i) {
+        // for each marker, get its allele frequency
+        double af = getMarkerFrequency(dc, i);
+        bool flip = false;
+        if (af > 0.5) {
+          flip = true;
+        }
+        for (int j = 0; j < genotype.rows; ++j) {
+          this->minorCount(j) +=
+              (!flip) ? genotype[j][i] : (2.0 - genotype[j][i]);
+        }
       }
-      for (int j = 0; j < genotype.rows; ++j) {
-        if (phenotype[j] == 1) {
-          if (!flip) {
-            m_A += genotype[j][i];
-            M_A += (2.0 - genotype[j][i]);
-          } else {
-            m_A += (2.0 - genotype[j][i]);
-            M_A += genotype[j][i];
-          }
-        } else {
-          if (!flip) {
-            m_U += genotype[j][i];
-            M_U += (2.0 - genotype[j][i]);
-          } else {
-            m_U += (2.0 - genotype[j][i]);
-            M_U += genotype[j][i];
-          }
+      this->totalMinor = this->minorCount.sum();
+    }
+    void operator()(const Eigen::MatrixXd& y, Eigen::VectorXd* stat) const {
+      const Eigen::MatrixXd isCase = (y.array() == 1.0).cast<double>();
+      const Eigen::VectorXd m_A = isCase.transpose() * this->minorCount;
+      const Eigen::VectorXd N_A = isCase.colwise().sum().transpose();
+
+      const int nCol = y.cols();
+      stat->resize(nCol);
+      for (int i = 0; i < nCol; ++i) {
+        const double N_U = y.rows() - N_A(i);
+        const double m_U = this->totalMinor - m_A(i);
+        const double M_A = 2.0 * this->numMarker * N_A(i) - m_A(i);
+        const double M_U = 2.0 * this->numMarker * N_U - m_U;
+        if (N_A(i) + N_U == 0.0) {
+          (*stat)(i) = 0.0;
+          continue;
         }
+        (*stat)(i) = (N_A(i) + N_U) / (2 * N_A(i) * N_U * this->numMarker) *
+                     (m_A(i) * M_U - m_U * M_A) * (m_A(i) * M_U - m_U * M_A) /
+                     (m_A(i) + m_U) / (M_A + M_U);
       }
     }
-    if (N_A + N_U == 0.0) return 0.0;
-    int numMarker = genotype.cols;
-    return (N_A + N_U) / (2 * N_A * N_U * numMarker) * (m_A * M_U - m_U * M_A) *
-           (m_A * M_U - m_U * M_A) / (m_A + m_U) / (M_A + M_U);
-  }
 
- private:
-  double N_A;
-  double N_U;
-  double m_A;
-  double m_U;
-  double M_A;
-  double M_U;
+   private:
+    Eigen::VectorXd minorCount;  // per-sample minor allele count
+    double totalMinor;
+    int numMarker;
+  };
 
   Vector pheno;
   bool fitOK;
   double stat;
   Permutation perm;
+  PermutationEngine engine;
 };  // CMATTest
 
 #if 0
@@ -1738,7 +1839,11 @@ class UStatTest{
 class VariableThresholdPrice : public ModelFitter {
  public:
   VariableThresholdPrice(int nPerm, double alpha)
-      : fitOK(false), zmax(-1.), optimalFreq(-1), perm(nPerm, alpha) {
+      : fitOK(false),
+        zmax(-1.),
+        optimalFreq(-1),
+        perm(nPerm, alpha),
+        engine(128, FLAG_seed) {
     this->modelName = "VariableThresholdPrice";
   }
   // fitting model
@@ -1781,17 +1886,18 @@ class VariableThresholdPrice : public ModelFitter {
     }
 
     // begin permutation
-    this->perm.init(fabs(zmax));
-    double zPerm = 9999;
-    double optFreqPerm;
-
-    while (this->perm.next()) {
-      permute(&this->phenotype);
-      if (calculateZ(this->phenotype, this->sortedBurden, weight, &zPerm,
-                     &optFreqPerm))
-        continue;
-      this->perm.add(fabs(zPerm));
-    }
+    // evaluate the observed statistic the same way as permuted ones so that
+    // ties are counted consistently
+    BlockStatistic blockStat(this->sortedBurden);
+    Eigen::MatrixXd y(this->phenotype.Length(), 1);
+    for (int i = 0; i < this->phenotype.Length(); ++i) {
+      y(i, 0) = this->phenotype[i];
+    }
+    Eigen::VectorXd obs;
+    blockStat(y, &obs);
+    this->perm.init(obs(0));
+    this->engine.reset();
+    this->engine.run(this->phenotype, blockStat, &this->perm);
 
     fitOK = true;
     return 0;
@@ -1842,6 +1948,31 @@ class VariableThresholdPrice : public ModelFitter {
     return 0;
   }
 
+  /**
+   * Evaluate max_t |z_t| for a block of permuted phenotypes:
+   * z = scaledBurden * Y, where each row of scaledBurden is a collapsed
+   * genotype divided by its standard deviation
+   */
+  class BlockStatistic {
+   public:
+    explicit BlockStatistic(Matrix& sortedBurden) {
+      G_to_Eigen(sortedBurden, &this->scaledBurden);
+      for (int i = 0; i < sortedBurden.rows; ++i) {
+        const double sd = sqrt(getVariance(sortedBurden[i]));
+        if (sd != 0) {
+          this->scaledBurden.row(i) /= sd;
+        }
+      }
+    }
+    void operator()(const Eigen::MatrixXd& y, Eigen::VectorXd* stat) const {
+      const Eigen::MatrixXd z = this->scaledBurden * y;
+      *stat = z.cwiseAbs().colwise().maxCoeff().transpose();
+    }
+
+   private:
+    Eigen::MatrixXd scaledBurden;
+  };
+
   double calculateZthreshold(Vector& y, Vector& x, Vector& weight) {
     double ret = 0;
     int n = y.Length();
@@ -1871,6 +2002,7 @@ class VariableThresholdPrice : public ModelFitter {
   double optimalFreq;  // the frequency cutoff in unpermutated data which give
   // smallest pvalue
   Permutation perm;
+  PermutationEngine engine;
 };  // VariableThresholdPrice
 
 #if 0
@@ -1961,12 +2093,12 @@ class VTCMC : public ModelFitter {
  public:
   VTCMC() : fitOK(false), needToFitNullModel(true) {
     this->modelName = "VTCMC";
-    result.addHeader("MAF");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("OptimMAF");
-    result.addHeader("Effect");
-    result.addHeader("Pvalue");
+    colMAF = result.addHeader("MAF");
+    colU = result.addHeader("U");
+    colV = result.addHeader("V");
+    colOptimMAF = result.addHeader("OptimMAF", Result::DOUBLE_COLUMN);
+    colEffect = result.addHeader("Effect", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   int fit(DataConsolidator* dc) {
     Matrix& phenotype = dc->getPhenotype();
@@ -2011,7 +2143,7 @@ class VTCMC : public ModelFitter {
   // write result header
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeHeaderTab(fp);
-    result.addHeader("OptFreq");
+    colOptFreq = result.addHeader("OptFreq", Result::DOUBLE_COLUMN);
     result.writeHeaderLine(fp);
   }
   // write model output
@@ -2036,12 +2168,12 @@ class VTCMC : public ModelFitter {
       copyRowMatrix(logistic.GetU(), &U);
       copyRowMatrix(logistic.GetV(), &V);
     }
-    result.updateValue("MAF", floatToString(freq));
-    result.updateValue("U", floatToString(U));
-    result.updateValue("V", floatToString(V));
-    result.updateValue("OptimMAF", optimFreq);
-    result.updateValue("Effect", effect);
-    result.updateValue("Pvalue", pValue);
+    result.updateValueAt(colMAF, floatToString(freq));
+    result.updateValueAt(colU, floatToString(U));
+    result.updateValueAt(colV, floatToString(V));
+    result.updateValueAt(colOptimMAF, optimFreq);
+    result.updateValueAt(colEffect, effect);
+    result.updateValueAt(colPvalue, pValue);
 
     result.writeValueLine(fp);
   }
@@ -2088,6 +2220,8 @@ class VTCMC : public ModelFitter {
   LinearRegressionVT linear;
   bool fitOK;
   bool needToFitNullModel;
+  // columns of result
+  int colMAF, colU, colV, colOptimMAF, colEffect, colPvalue, colOptFreq;
 };
 
 /**
@@ -2111,14 +2245,14 @@ class AnalyticVT : public ModelFitter {
       this->familyModel = true;
     }
 
-    result.addHeader("MinMAF");
-    result.addHeader("MaxMAF");
-    result.addHeader("OptimMAF");
-    result.addHeader("OptimNumVar");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("Stat");
-    result.addHeader("Pvalue");
+    colMinMAF = result.addHeader("MinMAF", Result::DOUBLE_COLUMN);
+    colMaxMAF = result.addHeader("MaxMAF", Result::DOUBLE_COLUMN);
+    colOptimMAF = result.addHeader("OptimMAF", Result::DOUBLE_COLUMN);
+    colOptimNumVar = result.addHeader("OptimNumVar", Result::INT_COLUMN);
+    colU = result.addHeader("U", Result::DOUBLE_COLUMN);
+    colV = result.addHeader("V", Result::DOUBLE_COLUMN);
+    colStat = result.addHeader("Stat", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -2218,14 +2352,14 @@ class AnalyticVT : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK) {
-      result.updateValue("MinMAF", mvvt.getMinMAF());
-      result.updateValue("MaxMAF", mvvt.getMaxMAF());
-      result.updateValue("OptimMAF", mvvt.getOptimalMAF());
-      result.updateValue("OptimNumVar", mvvt.getOptimalNumVar());
-      result.updateValue("U", mvvt.getOptimalU());
-      result.updateValue("V", mvvt.getOptimalV());
-      result.updateValue("Stat", mvvt.getStat());
-      result.updateValue("Pvalue", mvvt.getPvalue());
+      result.updateValueAt(colMinMAF, mvvt.getMinMAF());
+      result.updateValueAt(colMaxMAF, mvvt.getMaxMAF());
+      result.updateValueAt(colOptimMAF, mvvt.getOptimalMAF());
+      result.updateValueAt(colOptimNumVar, mvvt.getOptimalNumVar());
+      result.updateValueAt(colU, mvvt.getOptimalU());
+      result.updateValueAt(colV, mvvt.getOptimalV());
+      result.updateValueAt(colStat, mvvt.getStat());
+      result.updateValueAt(colPvalue, mvvt.getPvalue());
     }
     result.writeValueLine(fp);
   }
@@ -2247,6 +2381,9 @@ class AnalyticVT : public ModelFitter {
   MultivariateVT mvvt;
   bool fitOK;
   bool needToFitNullModel;
+  // columns of result
+  int colMinMAF, colMaxMAF, colOptimMAF, colOptimNumVar, colU, colV, colStat,
+      colPvalue;
 };  // AnalyticVT
 
 class FamCMC : public ModelFitter {
@@ -2263,12 +2400,12 @@ class FamCMC : public ModelFitter {
         fitOK(false) {
     this->modelName = "FamCMC";
     this->familyModel = true;
-    result.addHeader("NumSite");
-    result.addHeader("AF");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("Effect");
-    result.addHeader("Pvalue");
+    colNumSite = result.addHeader("NumSite", Result::INT_COLUMN);
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colU = result.addHeader("U", Result::DOUBLE_COLUMN);
+    colV = result.addHeader("V", Result::DOUBLE_COLUMN);
+    colEffect = result.addHeader("Effect", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -2340,12 +2477,12 @@ class FamCMC : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK && !isBinaryOutcome()) {
-      result.updateValue("NumSite", numVariant);
-      result.updateValue("AF", af);
-      result.updateValue("U", u);
-      result.updateValue("V", v);
-      result.updateValue("Effect", effect);
-      result.updateValue("Pvalue", pvalue);
+      result.updateValueAt(colNumSite, numVariant);
+      result.updateValueAt(colAF, af);
+      result.updateValueAt(colU, u);
+      result.updateValueAt(colV, v);
+      result.updateValueAt(colEffect, effect);
+      result.updateValueAt(colPvalue, pvalue);
     }
     result.writeValueLine(fp);
   }
@@ -2365,6 +2502,8 @@ class FamCMC : public ModelFitter {
   double pvalue;
   FastLMM lmm;
   bool fitOK;
+  // columns of result
+  int colNumSite, colAF, colU, colV, colEffect, colPvalue;
 };
 
 class FamZeggini : public ModelFitter {
@@ -2381,12 +2520,12 @@ class FamZeggini : public ModelFitter {
         fitOK(false) {
     this->modelName = "FamZeggini";
     this->familyModel = true;
-    result.addHeader("NumSite");
-    result.addHeader("MeanBurden");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("Effect");
-    result.addHeader("Pvalue");
+    colNumSite = result.addHeader("NumSite", Result::INT_COLUMN);
+    colMeanBurden = result.addHeader("MeanBurden", Result::DOUBLE_COLUMN);
+    colU = result.addHeader("U", Result::DOUBLE_COLUMN);
+    colV = result.addHeader("V", Result::DOUBLE_COLUMN);
+    colEffect = result.addHeader("Effect", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -2455,12 +2594,12 @@ class FamZeggini : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK && !isBinaryOutcome()) {
-      result.updateValue("NumSite", numVariant);
-      result.updateValue("MeanBurden", af);
-      result.updateValue("U", u);
-      result.updateValue("V", v);
-      result.updateValue("Effect", effect);
-      result.updateValue("Pvalue", pvalue);
+      result.updateValueAt(colNumSite, numVariant);
+      result.updateValueAt(colMeanBurden, af);
+      result.updateValueAt(colU, u);
+      result.updateValueAt(colV, v);
+      result.updateValueAt(colEffect, effect);
+      result.updateValueAt(colPvalue, pvalue);
     }
     result.writeValueLine(fp);
   }
@@ -2480,6 +2619,8 @@ class FamZeggini : public ModelFitter {
   double pvalue;
   FastLMM lmm;
   bool fitOK;
+  // columns of result
+  int colNumSite, colMeanBurden, colU, colV, colEffect, colPvalue;
 };
 
 class FamFp : public ModelFitter {
@@ -2496,12 +2637,12 @@ class FamFp : public ModelFitter {
         fitOK(false) {
     this->modelName = "FamFp";
     this->familyModel = true;
-    result.addHeader("NumSite");
-    result.addHeader("AF");
-    result.addHeader("U");
-    result.addHeader("V");
-    result.addHeader("Effect");
-    result.addHeader("Pvalue");
+    colNumSite = result.addHeader("NumSite", Result::INT_COLUMN);
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colU = result.addHeader("U", Result::DOUBLE_COLUMN);
+    colV = result.addHeader("V", Result::DOUBLE_COLUMN);
+    colEffect = result.addHeader("Effect", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("Pvalue", Result::DOUBLE_COLUMN);
   }
   // fitting model
   int fit(DataConsolidator* dc) {
@@ -2573,12 +2714,12 @@ class FamFp : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (fitOK && !isBinaryOutcome()) {
-      result.updateValue("NumSite", numVariant);
-      result.updateValue("AF", af);
-      result.updateValue("U", u);
-      result.updateValue("V", v);
-      result.updateValue("Effect", effect);
-      result.updateValue("Pvalue", pvalue);
+      result.updateValueAt(colNumSite, numVariant);
+      result.updateValueAt(colAF, af);
+      result.updateValueAt(colU, u);
+      result.updateValueAt(colV, v);
+      result.updateValueAt(colEffect, effect);
+      result.updateValueAt(colPvalue, pvalue);
     }
     result.writeValueLine(fp);
   }
@@ -2598,18 +2739,22 @@ class FamFp : public ModelFitter {
   double pvalue;
   FastLMM lmm;
   bool fitOK;
+  // columns of result
+  int colNumSite, colAF, colU, colV, colEffect, colPvalue;
 };
 
 class SkatTest : public ModelFitter {
  public:
   /* SkatTest(const std::vector<std::string>& param) { */
-  SkatTest(int nPerm, double alpha, double beta1, double beta2)
+  SkatTest(int nPerm, double alpha, double beta1, double beta2,
+           double liuCutoff)
       : fitOK(false), pValue(-1.), stat(-1.), perm(nPerm, alpha) {
     this->usePermutation = nPerm > 0;
     this->beta1 = beta1;
     this->beta2 = beta2;
     this->modelName = "Skat";
     this->needToFitNullModel = true;
+    this->skat.SetLiuCutoff(liuCutoff);
   }
   void reset() {
     ModelFitter::reset();
@@ -2713,9 +2858,9 @@ class SkatTest : public ModelFitter {
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeHeaderTab(fp);
     if (!usePermutation)
-      fp->write("Q\tPvalue\n");
+      fp->write("Q\tPvalue\tPvalueMethod\n");
     else {
-      fp->write("Q\tPvalue\t");
+      fp->write("Q\tPvalue\tPvalueMethod\t");
       this->perm.writeHeader(fp);
       fp->write("\n");
     }
@@ -2724,14 +2869,15 @@ class SkatTest : public ModelFitter {
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (!fitOK) {
-      fp->write("NA\tNA");
+      fp->write("NA\tNA\tNA");
       if (usePermutation) {
         fp->write("\tNA\tNA\tNA\tNA\tNA\tNA");
       }
       fp->write("\n");
     } else {
       // binary outcome and quantative trait are similar output
-      fp->printf("%g\t%g", this->skat.GetQ(), this->pValue);
+      fp->printf("%g\t%g\t%s", this->skat.GetQ(), this->pValue,
+                 this->skat.GetPvalueMethod());
       if (usePermutation) {
         fp->write("\t");
         this->perm.writeOutput(fp);
@@ -2764,11 +2910,12 @@ class SkatTest : public ModelFitter {
 
 class SkatOTest : public ModelFitter {
  public:
-  SkatOTest(double beta1, double beta2) : fitOK(false) {
+  SkatOTest(double beta1, double beta2, double liuCutoff) : fitOK(false) {
     this->beta1 = beta1;
     this->beta2 = beta2;
     this->modelName = "SkatO";
     this->needToFitNullModel = true;
+    this->skato.SetLiuCutoff(liuCutoff);
   }
   void reset() {
     ModelFitter::reset();
@@ -2852,16 +2999,17 @@ class SkatOTest : public ModelFitter {
   // write result header
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeHeaderTab(fp);
-    fp->write("Q\trho\tPvalue\n");
+    fp->write("Q\trho\tPvalue\tPvalueMethod\n");
   }
   // write model output
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     siteInfo.writeValueTab(fp);
     if (!fitOK) {
-      fp->write("NA\tNA\tNA\n");
+      fp->write("NA\tNA\tNA\tNA\n");
     } else {
-      fp->printf("%g\t%g\t%g\n", this->skato.GetQ(), this->skato.GetRho(),
-                 this->skato.GetPvalue());
+      fp->printf("%g\t%g\t%g\t%s\n", this->skato.GetQ(),
+                 this->skato.GetRho(), this->skato.GetPvalue(),
+                 this->skato.GetPvalueMethod());
     }
   }
 
@@ -3254,20 +3402,21 @@ class MetaScoreTest : public ModelFitter {
   void writeHeader(FileWriter* fp, const Result& siteInfo) {
     //  In the header part, successfully estimated null model will be
     //  printed. So we have to defer printing header in the fit() function.
-    result.addHeader("AF");
-    result.addHeader("INFORMATIVE_ALT_AC");
-    result.addHeader("CALL_RATE");
-    result.addHeader("HWE_PVALUE");
-    result.addHeader("N_REF");
-    result.addHeader("N_HET");
-    result.addHeader("N_ALT");
-    result.addHeader("U_STAT");
-    result.addHeader("SQRT_V_STAT");
-    result.addHeader("ALT_EFFSIZE");
+    colAF = result.addHeader("AF", Result::DOUBLE_COLUMN);
+    colAltAC = result.addHeader("INFORMATIVE_ALT_AC", Result::DOUBLE_COLUMN);
+    colCallRate = result.addHeader("CALL_RATE", Result::DOUBLE_COLUMN);
+    colHwePvalue = result.addHeader("HWE_PVALUE", Result::DOUBLE_COLUMN);
+    colNumRef = result.addHeader("N_REF", Result::INT_COLUMN);
+    colNumHet = result.addHeader("N_HET", Result::INT_COLUMN);
+    colNumAlt = result.addHeader("N_ALT", Result::INT_COLUMN);
+    colUStat = result.addHeader("U_STAT", Result::DOUBLE_COLUMN);
+    colSqrtVStat = result.addHeader("SQRT_V_STAT", Result::DOUBLE_COLUMN);
+    colAltEffSize = result.addHeader("ALT_EFFSIZE", Result::DOUBLE_COLUMN);
     if (outputSE) {
-      result.addHeader("ALT_EFFSIZE_SE");
+      colAltEffSizeSE =
+          result.addHeader("ALT_EFFSIZE_SE", Result::DOUBLE_COLUMN);
     }
-    result.addHeader("PVALUE");
+    colPvalue = result.addHeader("PVALUE", Result::DOUBLE_COLUMN);
     return;
   }
 
@@ -3298,59 +3447,59 @@ class MetaScoreTest : public ModelFitter {
     result.clearValue();
     if (af >= 0.0) {
       if (!isBinaryOutcome()) {
-        result.updateValue("AF", af);
+        result.updateValueAt(colAF, af);
       } else {
         static char afString[128];
         snprintf(afString, 128, "%g:%g:%g", af, caseCounter.getAF(),
                  ctrlCounter.getAF());
-        result.updateValue("AF", afString);
+        result.updateValueAt(colAF, afString);
       }
     }
 
     if (!isBinaryOutcome()) {
-      result.updateValue("INFORMATIVE_ALT_AC", counter.getAC());
-      result.updateValue("CALL_RATE", counter.getCallRate());
-      result.updateValue("HWE_PVALUE", counter.getHWE());
-      result.updateValue("N_REF", counter.getNumHomRef());
-      result.updateValue("N_HET", counter.getNumHet());
-      result.updateValue("N_ALT", counter.getNumHomAlt());
+      result.updateValueAt(colAltAC, counter.getAC());
+      result.updateValueAt(colCallRate, counter.getCallRate());
+      result.updateValueAt(colHwePvalue, counter.getHWE());
+      result.updateValueAt(colNumRef, counter.getNumHomRef());
+      result.updateValueAt(colNumHet, counter.getNumHet());
+      result.updateValueAt(colNumAlt, counter.getNumHomAlt());
     } else {
       static const int buffLen = 128;
       static char buff[buffLen];
 
       snprintf(buff, 128, "%g:%g:%g", counter.getAC(), caseCounter.getAC(),
                ctrlCounter.getAC());
-      result.updateValue("INFORMATIVE_ALT_AC", buff);
+      result.updateValueAt(colAltAC, buff);
 
       snprintf(buff, 128, "%g:%g:%g", counter.getCallRate(),
                caseCounter.getCallRate(), ctrlCounter.getCallRate());
-      result.updateValue("CALL_RATE", buff);
+      result.updateValueAt(colCallRate, buff);
 
       snprintf(buff, 128, "%g:%g:%g", counter.getHWE(), caseCounter.getHWE(),
                ctrlCounter.getHWE());
-      result.updateValue("HWE_PVALUE", buff);
+      result.updateValueAt(colHwePvalue, buff);
 
       snprintf(buff, 128, "%d:%d:%d", counter.getNumHomRef(),
                caseCounter.getNumHomRef(), ctrlCounter.getNumHomRef());
-      result.updateValue("N_REF", buff);
+      result.updateValueAt(colNumRef, buff);
       snprintf(buff, 128, "%d:%d:%d", counter.getNumHet(),
                caseCounter.getNumHet(), ctrlCounter.getNumHet());
-      result.updateValue("N_HET", buff);
+      result.updateValueAt(colNumHet, buff);
       snprintf(buff, 128, "%d:%d:%d", counter.getNumHomAlt(),
                caseCounter.getNumHomAlt(), ctrlCounter.getNumHomAlt());
-      result.updateValue("N_ALT", buff);
+      result.updateValueAt(colNumAlt, buff);
     }
 
     if (fitOK) {
       const double u = model->GetU();
       const double v = model->GetV();
-      result.updateValue("U_STAT", u);
-      result.updateValue("SQRT_V_STAT", sqrt(v));
-      result.updateValue("ALT_EFFSIZE", model->GetEffect());
+      result.updateValueAt(colUStat, u);
+      result.updateValueAt(colSqrtVStat, sqrt(v));
+      result.updateValueAt(colAltEffSize, model->GetEffect());
       if (outputSE && v > 0.) {
-        result.updateValue("ALT_EFFSIZE_SE", model->GetEffectSE());
+        result.updateValueAt(colAltEffSizeSE, model->GetEffectSE());
       }
-      result.updateValue("PVALUE", model->GetPvalue());
+      result.updateValueAt(colPvalue, model->GetPvalue());
     }
     result.writeValueLine(fp);
   }
@@ -3863,6 +4012,10 @@ class MetaScoreTest : public ModelFitter {
   bool headerOutputted;
   bool outputGwama;
   bool outputSE;
+  // columns of result
+  int colAF, colAltAC, colCallRate, colHwePvalue, colNumRef, colNumHet,
+      colNumAlt, colUStat, colSqrtVStat, colAltEffSize, colAltEffSizeSE,
+      colPvalue;
 };  // MetaScoreTest
 
 class MetaDominantTest : public MetaScoreTest {
@@ -3912,6 +4065,9 @@ class MetaCovTest : public ModelFitter {
     Pos pos;
     Genotype geno;
     Covariate covXZ;
+    int seq;      // arrival order among variants kept in the window
+    int lastSeq;  // the last variant in the window starting from this one
+    std::vector<float> covXX;  // covariance to variants [seq, lastSeq]
     // Genotype geno;
     // std::vector<float> covXZ;  // cov(geno, covariate)
   };
@@ -3921,6 +4077,16 @@ class MetaCovTest : public ModelFitter {
   virtual ~MetaCovTest();
   virtual int setParameter(const ModelParser& parser) {
     this->outputGwama = parser.hasTag("gwama");
+    this->useCompactGenotype = parser.hasTag("compact");
+    std::string format;
+    parser.assign("format", &format, "text");
+    if (format == "binary" || format == "binary16") {
+      this->useBinaryOutput = true;
+      this->useHalfPrecision = (format == "binary16");
+    } else if (format != "text") {
+      fprintf(stderr, "Unknown MetaCov format [ %s ], use text instead\n",
+              format.c_str());
+    }
     return 0;
   }
   // fitting model
@@ -3937,74 +4103,69 @@ class MetaCovTest : public ModelFitter {
     }
 
     result.writeHeaderLine(fp);
+    if (useBinaryOutput) {
+      // covariances go to the binary file, the text file keeps the header
+      const std::string fn = getPrefix() + "." + getModelName() + ".bin";
+      if (binaryOut.open(fn, useHalfPrecision)) {
+        fprintf(stderr, "Cannot open [ %s ], use text output instead\n",
+                fn.c_str());
+        useBinaryOutput = false;
+      }
+    }
   }
   // write model output
   void writeOutput(FileWriter* fp, const Result& siteInfo) {
     this->fout = fp;
-    while (queue.size() && getWindowSize(queue, loci) > windowSize) {
-      printCovariance(fout, queue, isBinaryOutcome());
-      genoPool.deallocate(queue.front().geno);
-      genoCovPool.deallocate(queue.front().covXZ);
-      queue.pop_front();
+    // a window is closed when the new variant is too far from its first
+    // variant. Its covariances are printed once they are all calculated.
+    while (numClosed < queue.size() &&
+           getWindowSize(queue[numClosed], loci) > windowSize) {
+      queue[numClosed].lastSeq = numVariant - 1;
+      ++numClosed;
     }
     if (fitOK) {
+      loci.seq = numVariant;
+      loci.lastSeq = INT_MAX;
       queue.push_back(loci);
       ++numVariant;
+      ++numPending;
+    }
+    if (numPending >= CovBlockSize) {
+      calculateCovariance();
     }
+    printClosedWindow();
     // result.writeValueLine(fp);
   }
 
  private:
   void assignGenotype(Matrix& genotype, Genotype& genoIdx);
+  // copy (or decode) stored genotype @param genoIdx to @param out
+  void loadGenotype(Genotype genoIdx, float* out);
+  void releaseGenotype(Genotype genoIdx);
   /**
    * @return max integer if different chromosome; or return difference between
    * head and tail locus.
    */
-  int getWindowSize(const std::deque<Loci>& loci, const Loci& newOne) {
-    if (loci.size() == 0) {
-      return 0;
-    }
-
-    const Loci& head = loci.front();
-    const Loci& tail = newOne;
-
+  int getWindowSize(const Loci& head, const Loci& tail) {
     if (head.pos.chrom != tail.pos.chrom) {
       return INT_MAX;
     } else {
       return abs(tail.pos.pos - head.pos.pos);
     }
   }
-  // X is symmetric matrix
-  // return: a' * X * b
-  // = \sum_i \sum_j a_i * X_{ij} * b_j
-  // = \sum_i {a_i * X_ii * b_i + \sum_{j!=i} (a_i * b_j + a_j *b_i) * X_{ij}
-  float computeQuadraticForm(FloatMatrixRef& a, Matrix& X, FloatMatrixRef& b) {
-    // const int n = X.rows;
-    // float s = 0.;
-    // for (int i = 0; i < n; ++i) {
-    //   s += a[i] * X[i][i] * b[i];
-    //   for (int j = 0; j < i; ++j) {
-    //     s += (a[i] * b[j] + a[j] * b[i]) * X[i][j];
-    //   }
-    // }
-    // return s;
-
-    Eigen::MatrixXf XE;
-    G_to_Eigen(X, &XE);
-    REF_TO_EIGEN(a, aE);
-    REF_TO_EIGEN(b, bE);
-    return (aE.transpose() * XE * bE)(0, 0);
-  }
-  // return = covX1X2 - covX1Z' * covZZInv * covX2Z
-  float computeScaledXX(const float covX1X2, FloatMatrixRef& covX1Z,
-                        FloatMatrixRef& covX2Z, Matrix& covZZInv) {
-    float ret = covX1X2;
-    if (covX1Z.ncol_) {
-      ret -= computeQuadraticForm(covX1Z, covZZInv, covX2Z);
-    }
-    // fprintf(stderr, "%d: ret = %g\n", __LINE__, ret);
-    return ret;
-  }
+  /**
+   * Calculate covariance between the pending variants (the last numPending
+   * variants in the queue) and every variant whose window reaches them, in
+   * blocks instead of one pair at a time:
+   *   cov(X1, X2) = X1' W X2 - cov(X1, Z) * covZZInv * cov(Z, X2)
+   * where the first term is one matrix product and the second is a rank-C
+   * update (C = number of covariates)
+   */
+  void calculateCovariance();
+  /**
+   * print closed windows whose covariances are all calculated
+   */
+  void printClosedWindow();
   /**
    * @return 0
    * print the covariance for the front of loci to the rest of loci
@@ -4015,7 +4176,7 @@ class MetaCovTest : public ModelFitter {
     std::string& s = *out;
     for (size_t i = 0; i < position.size(); ++i) {
       if (i) s += ',';
-      s += toString(position[i]);
+      ::appendToString(position[i], &s);
     }
   }
   void appendToString(const std::vector<float>& vec, const float scale,
@@ -4023,7 +4184,7 @@ class MetaCovTest : public ModelFitter {
     std::string& s = *out;
     for (size_t i = 0; i < vec.size(); ++i) {
       if (i) s += ',';
-      s += toString(vec[i] * scale);
+      appendFloatToString(vec[i] * scale, &s);
     }
   }
   void appendToString(FloatMatrixRef& vec, const float scale,
@@ -4032,7 +4193,7 @@ class MetaCovTest : public ModelFitter {
     std::string& s = *out;
     for (int i = 0; i < n; ++i) {
       if (i) s += ',';
-      s += toString(vec.memory_[i] * scale);
+      appendFloatToString(vec.memory_[i] * scale, &s);
     }
   }
   void appendToString(Matrix& mat, const float scale, std::string* out) {
@@ -4043,7 +4204,7 @@ class MetaCovTest : public ModelFitter {
     for (int i = 0; i < mat.rows; ++i) {
       for (int j = 0; j <= i; ++j) {
         if (i || j) s += ',';
-        s += floatToString(mat[i][j] * scale);
+        appendFloatToString(mat[i][j] * scale, &s);
       }
     }
   }
@@ -4061,9 +4222,23 @@ class MetaCovTest : public ModelFitter {
   bool useBolt;
 
  private:
+  // variants are calculated in blocks of this size
+  static const int CovBlockSize = 64;
   std::deque<Loci> queue;
+  size_t numClosed;  // the first numClosed variants in queue are closed
+  int numPending;    // the last numPending variants in queue are not
+                     // calculated yet
   RingMemoryPool genoPool;     // store genotypes
   RingMemoryPool genoCovPool;  // store G'Z , e.g. genotype * covariate)
+  // store genotypes as 2-bit codes or 8-bit dosages instead of genoPool
+  bool useCompactGenotype;
+  CompactGenotypePool compactGenoPool;
+  std::vector<float> genoBuffer;  // genotype being fitted in compact mode
+  // write covariances in binary format (see MetaCovBinary.h)
+  bool useBinaryOutput;
+  bool useHalfPrecision;
+  MetaCovBinaryWriter binaryOut;
+  MetaCovRecord binaryRecord;
   int numVariant;
   int nSample;
   int nCovariate;
@@ -4072,7 +4247,7 @@ class MetaCovTest : public ModelFitter {
   int windowSize;
   Loci loci;
   bool fitOK;
-  std::vector<float> covXX;
+  Eigen::MatrixXf covBlock;  // covariance between queue and pending variants
   Matrix covZZ;
   Matrix covZZInv;
   bool useFamilyModel;
@@ -4080,6 +4255,8 @@ class MetaCovTest : public ModelFitter {
   bool isHemiRegion;  // is the variant tested in hemi region
   std::vector<int> position;
   bool outputGwama;
+  // columns of result
+  int colChrom, colStartPos, colEndPos, colNumMarker, colMarkerPos, colCov;
 };  // MetaCovTest
 
 class MetaDominantCovTest : public MetaCovTest {
@@ -4809,9 +4986,9 @@ class MultipleTraitScoreTest : public ModelFitter {
     // result.addHeader("DIRECTION");
     // result.addHeader("EFFECT");
     // result.addHeader("SE");
-    result.addHeader("U_STAT");
-    result.addHeader("V_STAT");
-    result.addHeader("PVALUE");
+    colUStat = result.addHeader("U_STAT", Result::DOUBLE_COLUMN);
+    colVStat = result.addHeader("V_STAT", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("PVALUE", Result::DOUBLE_COLUMN);
     result.writeHeaderLine(fp);
     this->fp = fp;
   }
@@ -4879,9 +5056,9 @@ class MultipleTraitScoreTest : public ModelFitter {
           formatValue(linear.GetV(i), &vstat);
           formatValue(linear.GetPvalue(i), &pvalue);
 
-          result.updateValue("U_STAT", ustat);
-          result.updateValue("V_STAT", vstat);
-          result.updateValue("PVALUE", pvalue);
+          result.updateValueAt(colUStat, ustat);
+          result.updateValueAt(colVStat, vstat);
+          result.updateValueAt(colPvalue, pvalue);
 
           result.writeValueLine(fp);
         }
@@ -4917,6 +5094,8 @@ class MultipleTraitScoreTest : public ModelFitter {
   FileWriter* fp;
   std::vector<std::string> sites;
   // Matrix cov;
+  // columns of result
+  int colUStat, colVStat, colPvalue;
 };  // MultipleTraitScoreTest
 
 class FastMultipleTraitScoreTest : public ModelFitter {
@@ -4994,9 +5173,9 @@ class FastMultipleTraitScoreTest : public ModelFitter {
     // result.addHeader("DIRECTION");
     // result.addHeader("EFFECT");
     // result.addHeader("SE");
-    result.addHeader("U_STAT");
-    result.addHeader("V_STAT");
-    result.addHeader("PVALUE");
+    colUStat = result.addHeader("U_STAT", Result::DOUBLE_COLUMN);
+    colVStat = result.addHeader("V_STAT", Result::DOUBLE_COLUMN);
+    colPvalue = result.addHeader("PVALUE", Result::DOUBLE_COLUMN);
     result.writeHeaderLine(fp);
     this->fp = fp;
   }
@@ -5064,9 +5243,9 @@ class FastMultipleTraitScoreTest : public ModelFitter {
           formatValue(linear.GetV(i), &vstat);
           formatValue(linear.GetPvalue(i), &pvalue);
 
-          result.updateValue("U_STAT", ustat);
-          result.updateValue("V_STAT", vstat);
-          result.updateValue("PVALUE", pvalue);
+          result.updateValueAt(colUStat, ustat);
+          result.updateValueAt(colVStat, vstat);
+          result.updateValueAt(colPvalue, pvalue);
 
           result.writeValueLine(fp);
         }
@@ -5102,6 +5281,8 @@ class FastMultipleTraitScoreTest : public ModelFitter {
   FileWriter* fp;
   std::vector<std::string> sites;
   // Matrix cov;
+  // columns of result
+  int colUStat, colVStat, colPvalue;
 };  // FastMultipleTraitScoreTest
 
 class DumpModel : public ModelFitter {
@@ -3,7 +3,6 @@
 #include "src/Model.h"
 #include "src/ModelFitter.h"
 #include "src/ModelParser.h"
-#include "src/TabixUtil.h"
 
 #include "src/DataConsolidator.h"
 #include "src/LinearAlgebra.h"
@@ -166,24 +165,33 @@ int ModelManager::create(const std::string& modelType,
     }
   } else if (modelType == "kernel") {
     if (modelName == "skat") {
-      double beta1, beta2;
+      double beta1, beta2, liuCutoff;
       parser.assign("nPerm", &nPerm, 10000)
           .assign("alpha", &alpha, 0.05)
           .assign("beta1", &beta1, 1.0)
-          .assign("beta2", &beta2, 25.0);
-      model.push_back(new SkatTest(nPerm, alpha, beta1, beta2));
+          .assign("beta2", &beta2, 25.0)
+          .assign("liuCutoff", &liuCutoff, 0.1);
+      model.push_back(new SkatTest(nPerm, alpha, beta1, beta2, liuCutoff));
       logger->info(
           "SKAT test significance will be evaluated using %d permutations at "
           "alpha = %g weight = Beta[beta1 = %.2f, beta2 = %.2f]",
           nPerm, alpha, beta1, beta2);
+      logger->info(
+          "SKAT test will use Davies method when Liu's P-value <= %g",
+          liuCutoff);
     } else if (modelName == "skato") {
-      double beta1, beta2;
-      parser.assign("beta1", &beta1, 1.0).assign("beta2", &beta2, 25.0);
-      model.push_back(new SkatOTest(beta1, beta2));
+      double beta1, beta2, liuCutoff;
+      parser.assign("beta1", &beta1, 1.0)
+          .assign("beta2", &beta2, 25.0)
+          .assign("liuCutoff", &liuCutoff, 0.1);
+      model.push_back(new SkatOTest(beta1, beta2, liuCutoff));
       logger->info(
           "SKAT-O test significance will be evaluated using weight = "
           "Beta[beta1 = %.2f, beta2 = %.2f]",
           beta1, beta2);
+      logger->info(
+          "SKAT-O test will use Davies method when Liu's P-value <= %g",
+          liuCutoff);
     } else if (modelName == "kbac") {
       parser.assign("nPerm", &nPerm, 10000).assign("alpha", &alpha, 0.05);
       model.push_back(new KBACTest(nPerm, alpha));
@@ -287,7 +295,8 @@ int ModelManager::create(const std::string& modelType,
     s += model[i]->getModelName();
     if (model[i]->needToIndexResult()) {
       s += ".assoc.gz";
-      fOuts.push_back(new FileWriter(s.c_str(), BGZIP));
+      fOuts.push_back(
+          new FileWriter(s.c_str(), BGZIP, numCompressThread, true));
       fileToIndex.push_back(s);
     } else {
       s += ".assoc";
@@ -316,9 +325,10 @@ void ModelManager::close() {
 }
 
 void ModelManager::createIndex() {
-  // index bgzipped meta-analysis outputs
+  // bgzipped meta-analysis outputs are indexed while they are written, so
+  // only check the index files here
   for (size_t i = 0; i < fileToIndex.size(); ++i) {
-    if (tabixIndexFile(fileToIndex[i])) {
+    if (!fileExists(fileToIndex[i] + ".tbi")) {
       logger->error("Tabix index failed on file [ %s ]",
                     fileToIndex[i].c_str());
     }
@@ -9,7 +9,8 @@ class ModelParser;
 class ModelFitter;
 class ModelManager {
  public:
-  ModelManager(const std::string& prefix) : prefix(prefix) {}
+  ModelManager(const std::string& prefix)
+      : prefix(prefix), numCompressThread(0) {}
   ~ModelManager() { this->close(); }
   const std::vector<ModelFitter*>& getModel() { return this->model; }
   const std::vector<FileWriter*>& getResultFile() { return this->fOuts; }
@@ -32,6 +33,11 @@ class ModelManager {
    */
   void setBinaryOutcome() { this->binaryOutcome = true; }
   void setQuantitativeOutcome() { this->binaryOutcome = false; }
+  /**
+   * Compress bgzipped outputs asynchronously using @param n threads per file
+   * (0: compress in the calling thread)
+   */
+  void setNumCompressThread(int n) { this->numCompressThread = n; }
 
  private:
   void createIndex();
@@ -42,6 +48,7 @@ class ModelManager {
   std::vector<FileWriter*> fOuts;
   std::vector<std::string> fileToIndex;
   bool binaryOutcome;
+  int numCompressThread;
 };
 
 #endif
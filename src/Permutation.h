@@ -92,6 +92,10 @@ class Permutation {
       numEqual++;
     }
   };
+  /**
+   * @return number of permutations still allowed before reaching numPerm
+   */
+  int getRemainingPerm() const { return this->numPerm - this->actualPerm; };
   double getPvalue() const {
     if (this->actualPerm == 0) return 1.0;
     return 1.0 * (this->numX + 0.5 * this->numEqual) / this->actualPerm;
@@ -0,0 +1,136 @@
+#ifndef _PERMUTATIONENGINE_H_
+#define _PERMUTATIONENGINE_H_
+
+#include <omp.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "third/eigen/Eigen/Core"
+
+#include "libsrc/MathVector.h"
+#include "src/Permutation.h"
+
+/**
+ * Shared permutation driver for permutation-based burden tests.
+ *
+ * Instead of permuting one phenotype and refitting a statistic per draw,
+ * the engine produces blocks of permuted phenotypes (an N by B matrix, one
+ * permutation per column) and asks a block statistic to evaluate all B
+ * columns at once, so linear statistics reduce to one matrix product.
+ * Blocks are distributed over OpenMP threads. Each block uses its own random
+ * stream seeded by (seed, unit, blockIndex), so results do not depend on the
+ * number of threads, and each unit (e.g. gene) gets different permutations.
+ *
+ * A block statistic is any object providing
+ *   void operator()(const Eigen::MatrixXd& permutedY, Eigen::VectorXd* stat)
+ * which fills @param stat with one statistic per column. It is called
+ * concurrently from several threads and must not modify shared state.
+ * Non-finite statistics are treated as failed permutations, which are
+ * replaced by new ones as the sequential permutation loops did.
+ */
+class PermutationEngine {
+ public:
+  explicit PermutationEngine(int blockSize = 128, unsigned int seed = 12345)
+      : blockSize(blockSize), seed(seed), unit(0), numBlock(0) {}
+  /**
+   * Permute @param y repeatedly and feed statistics to @param perm until
+   * perm->next() is false.
+   * @param maxFailure: stop and return -1 when more than this number of
+   * permutations fail (negative value means no limit, and then failed
+   * permutations count towards the budget, so that a statistic that is never
+   * finite cannot loop forever)
+   * @return 0 if succeed
+   */
+  template <typename BlockStatistic>
+  int run(Vector& y, BlockStatistic& blockStat, Permutation* perm,
+          int maxFailure = -1) {
+    const int n = y.Length();
+    Eigen::VectorXd yE(n);
+    for (int i = 0; i < n; ++i) {
+      yE(i) = y[i];
+    }
+
+    const int nThread = omp_get_max_threads();
+    std::vector<Eigen::VectorXd> stats(nThread);
+    int failed = 0;
+    int charged = 0;  // failed permutations counted towards the budget
+    while (perm->next() && perm->getRemainingPerm() > charged) {
+      // do not generate much more permutations than allowed
+      const int remain = perm->getRemainingPerm() - charged;
+      int nBlock = (remain + blockSize - 1) / blockSize;
+      if (nBlock > nThread) nBlock = nThread;
+      if (nBlock < 1) nBlock = 1;
+
+#pragma omp parallel for
+      for (int b = 0; b < nBlock; ++b) {
+        Eigen::MatrixXd permutedY;
+        generateBlock(yE, this->numBlock + b, &permutedY);
+        blockStat(permutedY, &stats[b]);
+      }
+      this->numBlock += nBlock;
+
+      // consume statistics in block order, so that adaptive stopping behaves
+      // the same as a sequential loop
+      for (int b = 0; b < nBlock; ++b) {
+        for (int i = 0; i < stats[b].size(); ++i) {
+          if (!perm->next() || perm->getRemainingPerm() <= charged) return 0;
+          if (!std::isfinite(stats[b](i))) {
+            ++failed;
+            if (maxFailure < 0) {
+              ++charged;
+            } else if (failed > maxFailure) {
+              return -1;
+            }
+            continue;
+          }
+          perm->add(stats[b](i));
+        }
+      }
+    }
+    return 0;
+  }
+  /**
+   * Fill @param out with blockSize permutations of @param y, using the random
+   * stream of block @param blockIndex
+   */
+  void generateBlock(const Eigen::VectorXd& y, int blockIndex,
+                     Eigen::MatrixXd* out) const {
+    const int n = y.size();
+    std::seed_seq seq{this->seed, this->unit, (unsigned int)blockIndex};
+    std::mt19937 rng(seq);
+    std::vector<int> idx(n);
+    for (int i = 0; i < n; ++i) {
+      idx[i] = i;
+    }
+
+    out->resize(n, this->blockSize);
+    for (int b = 0; b < this->blockSize; ++b) {
+      // Fisher-Yates shuffle on indices, continued from previous column
+      for (int i = n - 1; i >= 1; --i) {
+        std::uniform_int_distribution<int> pick(0, i);
+        std::swap(idx[i], idx[pick(rng)]);
+      }
+      for (int i = 0; i < n; ++i) {
+        (*out)(i, b) = y(idx[i]);
+      }
+    }
+  }
+  /**
+   * Call this before permuting a new unit (e.g. a new gene), so that each
+   * unit uses its own random streams
+   */
+  void reset() {
+    ++this->unit;
+    this->numBlock = 0;
+  }
+
+ private:
+  int blockSize;
+  unsigned int seed;
+  unsigned int unit;  // number of reset() calls
+  int numBlock;       // number of blocks generated since last reset()
+};  // class PermutationEngine
+
+#endif /* _PERMUTATIONENGINE_H_ */
@@ -1,71 +1,130 @@
 #ifndef _RESULT_H_
 #define _RESULT_H_
 
+#include <string>
+#include <vector>
+
 #include "base/IO.h"
-#include "base/OrderedMap.h"
 #include "base/TypeConversion.h"
 
 /**
- * Store key-value pair for minimal typing
- * Internally, all keys and values are strings
- * Memory layout:
- *  key1 -> val, val, val....
- *  key2 -> val, val, val....
- *           ^    ^    ^
- *           |    |    |
- *           L1   L2   L3
- *           We assume updating data are performed layer by layer
- *           If cross layout updating value happened, we will generate an error.
+ * Store one row of results for minimal typing
+ * Columns and their types are fixed by addHeader(), and each row is kept in a
+ * typed buffer indexed by column:
+ *  key1    key2    key3 ...
+ *  int     double  string ...
+ * Numbers are only formatted when the row is written, the same way as
+ * toString() and floatToString(), e.g. '%g' for doubles.
+ * In hot loops, look up the column index once (the return value of
+ * addHeader(), or getColumn()) and update values with updateValueAt().
  */
 class Result {
  public:
-  Result() : defaultValue("NA"){};
-  void addHeader(const char* key) { data[key] = defaultValue; }
-  void addHeader(const std::string& key) { data[key] = defaultValue; }
+  /**
+   * Type of the values in a column.
+   * A value of another type is formatted to text when it is updated.
+   */
+  enum ColumnType { STRING_COLUMN = 0, INT_COLUMN, DOUBLE_COLUMN };
+
+  Result() : defaultValue("NA"), nextColumn(0){};
+  /**
+   * @return column index of @param key
+   */
+  int addHeader(const char* key, ColumnType type = STRING_COLUMN) {
+    int col = findColumn(key);
+    if (col < 0) {
+      col = keys.size();
+      keys.push_back(key);
+      types.push_back(type);
+      values.push_back(Cell());
+    } else {
+      types[col] = type;
+      values[col].state = Cell::EMPTY;
+    }
+    return col;
+  }
+  int addHeader(const std::string& key, ColumnType type = STRING_COLUMN) {
+    return addHeader(key.c_str(), type);
+  }
 
-  bool existHeader(const char* key) {
-    if (!data.find(key)) {
+  bool existHeader(const char* key) const {
+    if (findColumn(key) < 0) {
       fprintf(stderr, "Cannot find [ %s ] in result header...\n", key);
       return false;
     }
     return true;
   }
-  bool existHeader(const std::string& key) { return existHeader(key.c_str()); }
+  bool existHeader(const std::string& key) const {
+    return existHeader(key.c_str());
+  }
+  /**
+   * @return column index of @param key, or -1 if it does not exist
+   */
+  int getColumn(const char* key) const { return findColumn(key); }
+  int getColumn(const std::string& key) const {
+    return findColumn(key.c_str());
+  }
+
   void updateValue(const char* key, const char* val) {
-    if (!existHeader(key)) {
-      return;
-    }
-    data[key] = val;
+    const int col = getColumnToUpdate(key);
+    if (col >= 0) updateValueAt(col, val);
   }
   void updateValue(const char* key, const std::string& val) {
-    if (!existHeader(key)) {
-      return;
-    }
-    data[key] = val;
+    const int col = getColumnToUpdate(key);
+    if (col >= 0) updateValueAt(col, val);
   }
   void updateValue(const std::string& key, const std::string& val) {
-    if (!existHeader(key)) {
-      return;
-    }
-    data[key] = val;
+    updateValue(key.c_str(), val);
   }
   void updateValue(const char* key, const int val) {
-    if (!existHeader(key)) {
+    const int col = getColumnToUpdate(key);
+    if (col >= 0) updateValueAt(col, val);
+  }
+  void updateValue(const char* key, const double val) {
+    const int col = getColumnToUpdate(key);
+    if (col >= 0) updateValueAt(col, val);
+  }
+
+  /**
+   * Update the value of column @param col, which must be a valid index
+   */
+  void updateValueAt(int col, const char* val) {
+    Cell& c = values[col];
+    c.state = Cell::TEXT;
+    c.text = val;
+  }
+  void updateValueAt(int col, const std::string& val) {
+    Cell& c = values[col];
+    c.state = Cell::TEXT;
+    c.text = val;
+  }
+  void updateValueAt(int col, const int val) {
+    Cell& c = values[col];
+    if (types[col] == INT_COLUMN) {
+      c.state = Cell::NUMBER;
+      c.intValue = val;
       return;
     }
-    data[key] = toString(val);
+    c.state = Cell::TEXT;
+    c.text.clear();
+    appendToString(val, &c.text);
   }
-  void updateValue(const char* key, const double val) {
-    if (!existHeader(key)) {
+  void updateValueAt(int col, const double val) {
+    Cell& c = values[col];
+    if (types[col] == DOUBLE_COLUMN) {
+      c.state = Cell::NUMBER;
+      c.doubleValue = val;
       return;
     }
-    data[key] = floatToString(val);
+    c.state = Cell::TEXT;
+    c.text.clear();
+    appendFloatToString(val, &c.text);
   }
 
   void clearValue() {
-    int n = data.size();
+    int n = values.size();
     for (int i = 0; i < n; ++i) {
-      this->data.valueAt(i) = defaultValue;
+      this->values[i].state = Cell::EMPTY;
     }
   }
 
@@ -75,12 +134,12 @@ class Result {
    * Write the keys separated by '\t'
    */
   void writeHeader(FILE* fp) const {
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         fputc('\t', fp);
       }
-      fputs(data.keyAt(i).c_str(), fp);
+      fputs(keys[i].c_str(), fp);
     }
   }
   void writeHeaderTab(FILE* fp) const {
@@ -97,13 +156,9 @@ class Result {
    * Write the values separated by '\t'
    */
   void writeValue(FILE* fp) const {
-    int n = data.size();
-    for (int i = 0; i < n; ++i) {
-      if (i) {
-        fputc('\t', fp);
-      }
-      fputs(data.valueAt(i).c_str(), fp);
-    }
+    std::string s;
+    writeValue(&s);
+    fputs(s.c_str(), fp);
   }
   void writeValueTab(FILE* fp) const {
     writeValue(fp);
@@ -119,12 +174,12 @@ class Result {
    * Write the keys separated by '\t'
    */
   void writeHeader(FileWriter* fp) const {
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         fp->write('\t');
       }
-      fp->write(data.keyAt(i).c_str());
+      fp->write(keys[i].c_str());
     }
   }
   void writeHeaderTab(FileWriter* fp) const {
@@ -141,21 +196,19 @@ class Result {
    * Write the values separated by '\t'
    */
   void writeValue(FileWriter* fp) const {
-    int n = data.size();
-    for (int i = 0; i < n; ++i) {
-      if (i) {
-        fp->write('\t');
-      }
-      fp->write(data.valueAt(i).c_str());
-    }
+    std::string s;
+    writeValue(&s);
+    fp->write(s.c_str());
   }
   void writeValueTab(FileWriter* fp) const {
-    writeValue(fp);
-    fp->write('\t');
+    std::string s;
+    writeValueTab(&s);
+    fp->write(s.c_str());
   }
   void writeValueLine(FileWriter* fp) const {
-    writeValue(fp);
-    fp->write('\n');
+    std::string s;
+    writeValueLine(&s);
+    fp->write(s.c_str());
   }
 
   //////////////////////////////////////////////////
@@ -164,12 +217,12 @@ class Result {
    * Write the keys separated by '\t'
    */
   void writeHeader(std::string* fp) const {
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         fp->push_back('\t');
       }
-      fp->append(data.keyAt(i));
+      fp->append(keys[i]);
     }
   }
   void writeHeaderTab(std::string* fp) const {
@@ -186,12 +239,12 @@ class Result {
    * Write the values separated by '\t'
    */
   void writeValue(std::string* fp) const {
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         fp->push_back('\t');
       }
-      fp->append(data.valueAt(i));
+      appendValue(i, fp);
     }
   }
   void writeValueTab(std::string* fp) const {
@@ -208,44 +261,115 @@ class Result {
    */
   std::string joinHeader() const {
     std::string s;
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         s += '\t';
       }
-      s += data.keyAt(i);
+      s += keys[i];
     }
     return s;
   }
 
   std::string joinValue(const char c = '\t') const {
     std::string s;
-    int n = data.size();
+    int n = keys.size();
     for (int i = 0; i < n; ++i) {
       if (i) {
         s += c;
       }
-      s += data.valueAt(i);
+      appendValue(i, &s);
+    }
+    return s;
+  }
+
+  /**
+   * @return the formatted value of @param key, or "NA"
+   */
+  std::string operator[](const std::string& key) const {
+    return (*this)[key.c_str()];
+  }
+  std::string operator[](const char* key) const {
+    std::string s;
+    const int col = findColumn(key);
+    if (col >= 0) {
+      appendValue(col, &s);
+    } else {
+      s = defaultValue;
     }
     return s;
   }
 
-  const std::string& operator[](const std::string& key) const {
-    if (data.find(key)) {
-      return data[key];
+ private:
+  /**
+   * @return column index of @param key, or -1 if it does not exist
+   */
+  int findColumn(const char* key) const {
+    const int n = keys.size();
+    for (int i = 0; i < n; ++i) {
+      if (keys[i] == key) {
+        return i;
+      }
     }
-    return defaultValue;
+    return -1;
   }
-  const std::string& operator[](const char* key) const {
-    if (data.find(key)) {
-      return data[key];
+  /**
+   * @return the column of @param key to update, or -1 if it does not exist.
+   * Values are usually updated in the order of columns, so try the column
+   * after the last updated one before searching all columns.
+   */
+  int getColumnToUpdate(const char* key) {
+    const int n = keys.size();
+    int col = nextColumn;
+    if (col >= n || keys[col] != key) {
+      col = findColumn(key);
+    }
+    if (col < 0) {
+      fprintf(stderr, "Cannot find [ %s ] in result header...\n", key);
+      return -1;
+    }
+    nextColumn = col + 1;
+    return col;
+  }
+  /**
+   * Format the value of column @param col and append it to @param s
+   */
+  void appendValue(int col, std::string* s) const {
+    const Cell& c = values[col];
+    switch (c.state) {
+      case Cell::NUMBER:
+        if (types[col] == INT_COLUMN) {
+          appendToString(c.intValue, s);
+        } else {
+          appendFloatToString(c.doubleValue, s);
+        }
+        break;
+      case Cell::TEXT:
+        s->append(c.text);
+        break;
+      default:
+        s->append(defaultValue);
+        break;
     }
-    return defaultValue;
   }
 
  private:
-  OrderedMap<std::string, std::string> data;
+  // value of one column in the row buffer
+  struct Cell {
+    // EMPTY is written as "NA"; NUMBER has the type of its column
+    enum State { EMPTY = 0, NUMBER, TEXT };
+    Cell() : state(EMPTY), intValue(0), doubleValue(0.0) {}
+    State state;
+    int intValue;
+    double doubleValue;
+    std::string text;
+  };
+
+  std::vector<std::string> keys;
+  std::vector<ColumnType> types;
+  std::vector<Cell> values;
   std::string defaultValue;
+  int nextColumn;  // guess of the next column to update
 };
 
 #endif /* _RESULT_H_ */
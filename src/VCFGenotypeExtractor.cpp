@@ -1,7 +1,7 @@
 #include "VCFGenotypeExtractor.h"
 
-#include "GenotypeCounter.h"
-#include "Result.h"
+#include <stdint.h>
+#include <algorithm>
 
 #include "base/Argument.h"
 #include "base/Logger.h"
@@ -9,12 +9,10 @@
 #include "libsrc/MathMatrix.h"
 #include "libsrc/MathVector.h"
 
-DECLARE_BOOL_PARAMETER(outputID);
-
 extern Logger* logger;
 
 VCFGenotypeExtractor::VCFGenotypeExtractor(const std::string& fn)
-    : GenotypeExtractor(fn), vin(NULL), altAlleleToParse(-1) {
+    : GenotypeExtractor(fn), vin(NULL) {
   this->vin = new VCFExtractor(fn.c_str());
 }
 
@@ -25,206 +23,20 @@ VCFGenotypeExtractor::~VCFGenotypeExtractor() {
   }
 }
 
-int VCFGenotypeExtractor::extractMultipleGenotype(Matrix* g) {
-  assert(g);
-  assert(g->rows >= 0 && g->cols >= 0);
-  g->Dimension(0, 0);
-  int row = 0;
-  this->genotype.clear();
-  this->altAlleleToParse = -1;
-
-  while (true) {
-    if (this->altAlleleToParse <= 0) {
-      if (!this->vin->readRecord()) {
-        // reached the end
-        break;
-      } else {
-        const char* alt = this->vin->getVCFRecord().getAlt();
-        if (multiAllelicMode) {
-          parseAltAllele(alt);
-          this->altAlleleToParse = altAllele.size();
-        } else {
-          this->altAllele.resize(1);
-          this->altAllele[0] = alt;
-          this->altAlleleToParse = 1;
-        }
-      }
-    }
-    assert(this->altAlleleToParse > 0);
-    // parse alt allele one at a time
-    VCFRecord& r = this->vin->getVCFRecord();
-    VCFPeople& people = r.getPeople();
-    VCFIndividual* indv;
-
-    this->sampleSize = people.size();
-    row++;
-    this->variantName.resize(row);
-    this->counter.resize(row);
-    this->counter.back().reset();
-    this->hemiRegion.resize(row);
-
-    // get GT index and cannot assume it is a constant across variants
-    int genoIdx;
-    const bool useDosage = (!this->dosageTag.empty());
-    if (useDosage) {
-      genoIdx = r.getFormatIndex(dosageTag.c_str());
-    } else {
-      genoIdx = r.getFormatIndex("GT");
-    }
-    if (useDosage && multiAllelicMode) {
-      logger->error(
-          "Unsupported scenario: multiple mode and use dosage as "
-          "genotypes! - we will only use dosage");
-      this->altAlleleToParse = 1;
-    }
-    const int GDidx = r.getFormatIndex("GD");
-    const int GQidx = r.getFormatIndex("GQ");
-    assert(this->parRegion);
-    const bool isHemiRegion =
-        this->parRegion->isHemiRegion(r.getChrom(), r.getPos());
-    // e.g.: Loop each (selected) people in the same order as in the VCF
-    double geno;
-    const int altAlleleGT = this->altAllele.size() - this->altAlleleToParse + 1;
-    for (int i = 0; i < sampleSize; i++) {
-      indv = people[i];
-      if (multiAllelicMode) {
-        geno =
-            getGenotypeForAltAllele(*indv, useDosage, isHemiRegion, (*sex)[i],
-                                    genoIdx, GDidx, GQidx, altAlleleGT);
-      } else {
-        geno = getGenotype(*indv, useDosage, isHemiRegion, (*sex)[i], genoIdx,
-                           GDidx, GQidx);
-      }
-      this->genotype.push_back(geno);
-      this->counter.back().add(geno);
-    }  // end for i
-
-    // check frequency cutoffs
-    const double maf = counter.back().getMAF();
-    if ((this->freqMin > 0. && this->freqMin > maf) ||
-        (this->freqMax > 0. && this->freqMax < maf)) {
-      // undo loaded contents
-      row--;
-      this->variantName.resize(row);
-      this->counter.resize(row);
-      this->hemiRegion.resize(row);
-      this->genotype.resize(this->genotype.size() - this->sampleSize);
-      this->altAlleleToParse--;
-      continue;
-    }
-
-    this->variantName.back() = r.getChrom();
-    this->variantName.back() += ":";
-    this->variantName.back() += r.getPosStr();
-    if (multiAllelicMode) {
-      this->variantName.back() += r.getRef();
-      this->variantName.back() += "/";
-      this->variantName.back() +=
-          altAllele[altAllele.size() - this->altAlleleToParse];
-    }
-    this->hemiRegion.back() = (isHemiRegion);
-
-    this->altAlleleToParse--;
-  }  // end while (this->vin->readRecord())
-
-  // now transpose (marker by people -> people by marker)
-  if (row > 0) {
-    assert((int)genotype.size() == this->sampleSize * row);
-    assign(this->genotype, sampleSize, row, g);
-    for (int i = 0; i < row; ++i) {
-      g->SetColumnLabel(i, variantName[i].c_str());
-    }
-  }
-  return SUCCEED;
-}  // end VCFGenotypeExtractor
-
-int VCFGenotypeExtractor::extractSingleGenotype(Matrix* g, Result* b) {
-  this->genotype.clear();
-  Result& buf = *b;
-
-  if (this->altAlleleToParse <= 0) {
-    if (!this->vin->readRecord()) {
-      return FILE_END;
-    } else {
-      const char* alt = this->vin->getVCFRecord().getAlt();
-      if (multiAllelicMode) {
-        parseAltAllele(alt);
-        this->altAlleleToParse = altAllele.size();
-      } else {
-        this->altAllele.resize(1);
-        this->altAllele[0] = alt;
-        this->altAlleleToParse = 1;
-      }
-    }
+bool VCFGenotypeExtractor::readSite(Site* site) {
+  if (!this->vin->readRecord()) {
+    return false;
   }
-  assert(this->altAlleleToParse >= 0);
   VCFRecord& r = this->vin->getVCFRecord();
-  VCFPeople& people = r.getPeople();
-  VCFIndividual* indv;
-
-  buf.updateValue("CHROM", r.getChrom());
-  buf.updateValue("POS", r.getPosStr());
-  if (FLAG_outputID) {
-    buf.updateValue("ID", r.getID());
-  }
-  buf.updateValue("REF", r.getRef());
-  buf.updateValue("ALT", altAllele[altAllele.size() - this->altAlleleToParse]);
-
-  // genotype.Dimension(people.size(), 1);
-  this->sampleSize = people.size();
-  this->variantName.resize(1);
-  this->counter.resize(1);
-  this->counter.back().reset();
-  this->hemiRegion.resize(1);
-
-  // get GT index. if you are sure the index will not change, call this
-  // function only once!
-  const bool useDosage = (!this->dosageTag.empty());
-  int genoIdx;
-  if (useDosage) {
-    genoIdx = r.getFormatIndex(dosageTag.c_str());
-  } else {
-    genoIdx = r.getFormatIndex("GT");
-  }
-  const int GDidx = r.getFormatIndex("GD");
-  const int GQidx = r.getFormatIndex("GQ");
-  bool isHemiRegion = this->parRegion->isHemiRegion(r.getChrom(), r.getPos());
-  // e.g.: Loop each (selected) people in the same order as in the VCF
-  double geno;
-  const int altAlleleGT = this->altAllele.size() - this->altAlleleToParse + 1;
-  for (int i = 0; i < sampleSize; i++) {
-    indv = people[i];
-    if (multiAllelicMode) {
-      geno = getGenotypeForAltAllele(*indv, useDosage, isHemiRegion, (*sex)[i],
-                                     genoIdx, GDidx, GQidx, altAlleleGT);
-    } else {
-      geno = getGenotype(*indv, useDosage, isHemiRegion, (*sex)[i], genoIdx,
-                         GDidx, GQidx);
-    }
-    genotype.push_back(geno);
-    counter.back().add(geno);
-  }
-
-  // check frequency cutoffs
-  const double maf = counter[0].getMAF();
-  if ((this->freqMin > 0. && this->freqMin > maf) ||
-      (this->freqMax > 0. && this->freqMax < maf)) {
-    --this->altAlleleToParse;
-    return FAIL_FILTER;
-  }
-
-  variantName.back() = r.getChrom();
-  variantName.back() += ':';
-  variantName.back() += r.getPosStr();
-  hemiRegion.back() = isHemiRegion;
-
-  assert((int)genotype.size() == sampleSize);
-  assign(genotype, sampleSize, 1, g);
-  g->SetColumnLabel(0, variantName.back().c_str());
-
-  --this->altAlleleToParse;
-  return SUCCEED;
-}  // end extractSingleGenotype()
+  site->chrom = r.getChrom();
+  site->pos = r.getPos();
+  site->posStr = r.getPosStr();
+  site->id = r.getID();
+  site->ref = r.getRef();
+  site->alt = r.getAlt();
+  site->numSample = r.getPeople().size();
+  return true;
+}
 
 int loadMarkerFromVCF(const std::string& fileName, const std::string& marker,
                       std::vector<std::string>* rowLabel, Matrix* genotype) {
@@ -276,21 +88,6 @@ int loadMarkerFromVCF(const std::string& fileName, const std::string& marker,
   return 0;
 }
 
-bool VCFGenotypeExtractor::setSiteFreqMin(const double f) {
-  if (f < 0.0 || f > 1.0) {
-    return false;
-  }
-  this->freqMin = f - 1e-10;  // allow rounding error
-  return true;
-}
-bool VCFGenotypeExtractor::setSiteFreqMax(const double f) {
-  if (f < 0.0 || f > 1.0) {
-    return false;
-  }
-  this->freqMax = f + 1e-10;  // allow rounding error
-  return true;
-}
-
 void VCFGenotypeExtractor::setSiteDepthMin(int d) {
   this->vin->setSiteDepthMin(d);
 }
@@ -314,23 +111,6 @@ bool VCFGenotypeExtractor::checkGQ(VCFIndividual& indv, int gqIdx) {
   if (this->GQmax > 0 && gq > this->GQmax) return false;
   return true;
 }
-void VCFGenotypeExtractor::setGDmin(int m) {
-  this->needGD = true;
-  this->GDmin = m;
-}
-void VCFGenotypeExtractor::setGDmax(int m) {
-  this->needGD = true;
-  this->GDmax = m;
-}
-void VCFGenotypeExtractor::setGQmin(int m) {
-  this->needGQ = true;
-  this->GQmin = m;
-}
-void VCFGenotypeExtractor::setGQmax(int m) {
-  this->needGQ = true;
-  this->GQmax = m;
-}
-
 void VCFGenotypeExtractor::setSiteFile(const std::string& fn) {
   this->vin->setSiteFile(fn);
 }
@@ -389,95 +169,255 @@ void VCFGenotypeExtractor::getIncludedPeopleName(
   return;
 }
 
-void VCFGenotypeExtractor::parseAltAllele(const char* s) {
-  stringTokenize(s, ",", &altAllele);
+const std::vector<int>* VCFGenotypeExtractor::getDecodedGenotype(
+    const bool useDosage, const bool hemiRegion, const int numAlt,
+    const int genoIdx) const {
+  // VCFExtractor decodes GT in the same way as getGenotype() when there is no
+  // special coding (dosage, alt alleles, hemizygous region or GD/GQ filters)
+  if (useDosage || numAlt > 0 || hemiRegion || genoIdx < 0 || needGD ||
+      needGQ) {
+    return NULL;
+  }
+  return this->vin->getDecodedGenotype();
 }
 
-double VCFGenotypeExtractor::getGenotype(VCFIndividual& indv,
-                                         const bool useDosage,
-                                         const bool hemiRegion, const int sex,
-                                         const int genoIdx, const int GDidx,
-                                         const int GQidx) {
-  double ret;
-  if (genoIdx >= 0) {
-    if (useDosage) {
-      if (!hemiRegion) {
-        ret = (indv.justGet(genoIdx).toDouble());
-      } else {
-        // for male hemi region, imputated dosage is usually between 0 and 1
-        // need to multiply by 2.0
-        if (sex == PLINK_MALE) {
-          ret = (indv.justGet(genoIdx).toDouble() * 2.0);
-        } else {
-          ret = (indv.justGet(genoIdx).toDouble());
-        }
-      }
-    } else {  // use hard-coded genotypes
-      if (!hemiRegion) {
-        ret = (indv.justGet(genoIdx).getGenotype());
-      } else {
-        if (sex == PLINK_MALE) {
-          ret = (indv.justGet(genoIdx).getMaleNonParGenotype02());
-        } else if (sex == PLINK_FEMALE) {
-          ret = (indv.justGet(genoIdx).getGenotype());
-        } else {
-          ret = (MISSING_GENOTYPE);
-        }
-      }
+namespace {
+/**
+ * Decode GT. The common diploid genotypes (0/0, 0/1, 1|1, ...) are read
+ * directly, other cases are left to VCFValue::getGenotype()
+ */
+inline int decodeGT(const VCFValue& v) {
+  const char* s = v.line + v.beg;
+  if (v.end - v.beg == 3 && (s[1] == '/' || s[1] == '|')) {
+    const unsigned int a1 = s[0] - '0';
+    const unsigned int a2 = s[2] - '0';
+    if (a1 <= 1 && a2 <= 1) {
+      return a1 + a2;
     }
-    if (!checkGD(indv, GDidx) || !checkGQ(indv, GQidx)) {
+    if (s[0] == '.' && s[2] == '.') {
       return MISSING_GENOTYPE;
+    }
+  }
+  return v.getGenotype();
+}
+
+/**
+ * Decode dosage such as "0.95" as an integer and a power of 10. The result
+ * is identical to atof(), as both numbers are exact in double when there are
+ * at most 15 digits; other cases (exponents, too many digits, ...) are left
+ * to VCFValue::toDouble()
+ */
+inline double decodeDosage(const VCFValue& v) {
+  static const double pow10[] = {1e0, 1e1, 1e2,  1e3,  1e4,  1e5,
+                                 1e6, 1e7, 1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15};
+  const char* s = v.line + v.beg;
+  const char* end = v.line + v.end;
+  const bool negative = (s != end && *s == '-');
+  if (negative) ++s;
+  int64_t value = 0;
+  int numDigit = 0;
+  int numDecimal = -1;  // -1: no decimal point yet
+  for (; s != end; ++s) {
+    const unsigned int d = *s - '0';
+    if (d <= 9) {
+      value = value * 10 + d;
+      ++numDigit;
+      if (numDecimal >= 0) ++numDecimal;
+    } else if (*s == '.' && numDecimal < 0) {
+      numDecimal = 0;
     } else {
-      return ret;
+      break;
     }
+  }
+  if (s != end || numDigit == 0 || numDigit > 15) {
+    return v.toDouble();
+  }
+  double ret = value;
+  if (numDecimal > 0) ret /= pow10[numDecimal];
+  return negative ? -ret : ret;
+}
+
+/**
+ * Get the alleles of GT in the same way as VCFValue::countAltAllele() (or
+ * countMaleNonParAltAllele2() if @param male), so that alt allele k is
+ * counted (*a1 == k) + (*a2 == k) times; -1 means no allele
+ * @return false if the genotype is missing
+ */
+inline bool decodeAllele(const VCFValue& v, const bool male, int* a1,
+                         int* a2) {
+  const char* s = v.line + v.beg;
+  const int len = v.end - v.beg;
+  if (s[0] == '.') return false;
+  if (s[0] < '0' || (!male && s[0] > '9')) {
+    REPORT("Wrong genotype detected. [1]");
+  }
+  *a1 = (male && s[0] < '0') ? 0 : s[0] - '0';
+  if (len == 1) {  // haploid
+    *a2 = male ? *a1 : -1;
+    return true;
+  }
+  if (male) {
+    if (len == 2 || s[2] == '.') return false;
+    if (s[2] < '0') REPORT("Wrong genotype detected. [2]");
+    *a2 = s[2] < '0' ? 0 : s[2] - '0';
+    return *a1 == *a2;
+  }
+  if (s[1] != '|' && s[1] != '/') return false;
+  if (len == 2) {
+    REPORT("Wrong genotype length = 2");
+    return false;
+  }
+  if (s[2] == '.') return false;
+  if (s[2] < '0' || s[2] > '9') {
+    REPORT("Wrong genotype detected. [2]");
+    *a2 = -1;
   } else {
-    logger->error("Cannot find %s field!",
-                  this->dosageTag.empty() ? "GT" : dosageTag.c_str());
-    return MISSING_GENOTYPE;
+    *a2 = s[2] - '0';
   }
+  return len == 3;
 }
 
-double VCFGenotypeExtractor::getGenotypeForAltAllele(
-    VCFIndividual& indv, const bool useDosage, const bool hemiRegion,
-    const int sex, const int genoIdx, const int GDidx, const int GQidx,
-    const int alt) {
-  double ret;
-  if (genoIdx >= 0) {
-    if (useDosage) {
-      if (!hemiRegion) {
-        ret = (indv.justGet(genoIdx).toDouble());
-      } else {
-        // for male hemi region, imputated dosage is usually between 0 and 1
-        // need to multiply by 2.0
-        if (sex == PLINK_MALE) {
-          ret = (indv.justGet(genoIdx).toDouble() * 2.0);
-        } else {
-          ret = (indv.justGet(genoIdx).toDouble());
-        }
-      }
-    } else {  // use hard-coded genotypes
-      if (!hemiRegion) {
-        ret = indv.justGet(genoIdx).countAltAllele(alt);
-      } else {
-        if (sex == PLINK_MALE) {
-          // ret = (indv.justGet(genoIdx).getMaleNonParGenotype02());
-          ret = (indv.justGet(genoIdx).countMaleNonParAltAllele2(alt));
-        } else if (sex == PLINK_FEMALE) {
-          // ret = (indv.justGet(genoIdx).getGenotype());
-          ret = indv.justGet(genoIdx).countAltAllele(alt);
-        } else {
-          ret = (MISSING_GENOTYPE);
+// the record-wise settings used by decodeGenotypeOf()
+struct DecodeParam {
+  VCFPeople* people;
+  const std::vector<int>* sex;
+  int genoIdx;
+  int GDidx;
+  int GQidx;
+  int numAlt;  // number of alt alleles in multi-allelic mode
+  int GDmin;
+  int GDmax;
+  int GQmin;
+  int GQmax;
+};
+
+// @return true if GD and GQ (if needed) are valid
+// if GD is missing, we will take GD = 0
+template <bool NeedGD, bool NeedGQ>
+inline bool checkDepthQuality(const VCFIndividual& indv,
+                              const DecodeParam& param) {
+  if (NeedGD) {
+    const int gd = indv.justGet(param.GDidx).toInt();
+    if ((param.GDmin > 0 && gd < param.GDmin) ||
+        (param.GDmax > 0 && gd > param.GDmax)) {
+      return false;
+    }
+  }
+  if (NeedGQ) {
+    const int gq = indv.justGet(param.GQidx).toInt();
+    if ((param.GQmin > 0 && gq < param.GQmin) ||
+        (param.GQmax > 0 && gq > param.GQmax)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Decode genotypes of all samples. Each combination of the flags gets its own
+ * loop, so the checks below are resolved at compile time.
+ * In multi-allelic mode, GT is decoded once for all alt alleles, and
+ * @param geno stores param.numAlt columns of alt allele counts
+ */
+template <bool UseDosage, bool HemiRegion, bool NeedGD, bool NeedGQ,
+          bool MultiAllelic>
+void decodeGenotypeOf(const DecodeParam& param, double* geno) {
+  VCFPeople& people = *param.people;
+  const int n = people.size();
+  if (MultiAllelic) {
+    std::fill(geno, geno + n * param.numAlt, 0.0);
+  }
+  for (int i = 0; i < n; ++i) {
+    const VCFIndividual& indv = *people[i];
+    const VCFValue v = indv.justGet(param.genoIdx);
+    const int sex = HemiRegion ? (*param.sex)[i] : PLINK_FEMALE;
+    const bool male = HemiRegion && sex == PLINK_MALE;
+    if (MultiAllelic) {
+      int a1, a2;
+      if ((HemiRegion && !male && sex != PLINK_FEMALE) ||
+          !decodeAllele(v, male, &a1, &a2) ||
+          !checkDepthQuality<NeedGD, NeedGQ>(indv, param)) {
+        for (int k = 0; k < param.numAlt; ++k) {
+          geno[k * n + i] = MISSING_GENOTYPE;
         }
+        continue;
       }
+      if (a1 > 0 && a1 <= param.numAlt) geno[(a1 - 1) * n + i] += 1.0;
+      if (a2 > 0 && a2 <= param.numAlt) geno[(a2 - 1) * n + i] += 1.0;
+      continue;
     }
-    if (!checkGD(indv, GDidx) || !checkGQ(indv, GQidx)) {
-      return MISSING_GENOTYPE;
+
+    double g;
+    if (UseDosage) {
+      g = decodeDosage(v);
+      // for male hemi region, imputated dosage is usually between 0 and 1
+      // need to multiply by 2.0
+      if (male) g *= 2.0;
+    } else if (HemiRegion && !male && sex != PLINK_FEMALE) {
+      g = MISSING_GENOTYPE;
     } else {
-      return ret;
+      g = male ? v.getMaleNonParGenotype02() : decodeGT(v);
     }
-  } else {
+    if (!checkDepthQuality<NeedGD, NeedGQ>(indv, param)) {
+      g = MISSING_GENOTYPE;
+    }
+    geno[i] = g;
+  }
+}
+
+typedef void (*DecodeFunc)(const DecodeParam& param, double* geno);
+
+/**
+ * Pick decodeGenotypeOf<flag[0], ..., flag[4]> by setting one flag at a time
+ */
+template <int N, bool... Flag>
+struct DecodeFuncChooser {
+  static DecodeFunc choose(const bool* flag) {
+    return *flag ? DecodeFuncChooser<N - 1, Flag..., true>::choose(flag + 1)
+                 : DecodeFuncChooser<N - 1, Flag..., false>::choose(flag + 1);
+  }
+};
+template <bool... Flag>
+struct DecodeFuncChooser<0, Flag...> {
+  static DecodeFunc choose(const bool* flag) {
+    return decodeGenotypeOf<Flag...>;
+  }
+};
+}  // namespace
+
+void VCFGenotypeExtractor::decodeGenotype(const bool useDosage,
+                                          const bool hemiRegion,
+                                          const int numAlt, double* geno) {
+  VCFRecord& r = this->vin->getVCFRecord();
+  VCFPeople& people = r.getPeople();
+  const int n = people.size();
+  // get GT index and cannot assume it is a constant across variants
+  const int genoIdx =
+      r.getFormatIndex(useDosage ? dosageTag.c_str() : "GT");
+  if (genoIdx < 0) {
     logger->error("Cannot find %s field!",
                   this->dosageTag.empty() ? "GT" : dosageTag.c_str());
-    return MISSING_GENOTYPE;
+    std::fill(geno, geno + (numAlt > 0 ? n * numAlt : n), MISSING_GENOTYPE);
+    return;
+  }
+  const std::vector<int>* decoded =
+      getDecodedGenotype(useDosage, hemiRegion, numAlt, genoIdx);
+  if (decoded) {
+    std::copy(decoded->begin(), decoded->begin() + n, geno);
+    return;
   }
+
+  const bool flag[] = {useDosage, hemiRegion, needGD, needGQ, numAlt > 0};
+  const DecodeParam param = {&people,
+                             this->sex,
+                             genoIdx,
+                             r.getFormatIndex("GD"),
+                             r.getFormatIndex("GQ"),
+                             numAlt,
+                             GDmin,
+                             GDmax,
+                             GQmin,
+                             GQmax};
+  DecodeFuncChooser<5>::choose(flag)(param, geno);
 }
@@ -14,6 +14,7 @@
 // class Result;
 class VCFExtractor;
 class VCFIndividual;
+class VCFRecord;
 // class GenotypeCounter;
 
 /**
@@ -35,32 +36,13 @@ class VCFGenotypeExtractor : public GenotypeExtractor {
   VCFGenotypeExtractor& operator=(const VCFGenotypeExtractor&);
 
  public:
-  /**
-   * @param g, store people by marker matrix
-   * @return 0 for success
-   */
-  int extractMultipleGenotype(Matrix* g);
-  /**
-   * @return 0 for success
-   * @return -2 for reach end.
-   * @param g: people by 1 matrix, where column name is like "chr:pos"
-   * @param b: extract information, e.g. "1\t100\tA\tC"
-   */
-  int extractSingleGenotype(Matrix* g, Result* b);
-
   /* Site filters */
-  bool setSiteFreqMin(const double f);
-  bool setSiteFreqMax(const double f);
   void setSiteDepthMin(int d);
   void setSiteDepthMax(int d);
   // @return true if GD is valid
   // if GD is missing, we will take GD = 0
   bool checkGD(VCFIndividual& indv, int gdIdx);
   bool checkGQ(VCFIndividual& indv, int gqIdx);
-  void setGDmin(int m);
-  void setGDmax(int m);
-  void setGQmin(int m);
-  void setGQmax(int m);
 
   void setSiteFile(const std::string& fn);
   void setSiteQualMin(int q);
@@ -101,17 +83,12 @@ class VCFGenotypeExtractor : public GenotypeExtractor {
   // void enableClaytonCoding() { this->claytonCoding = true; }
   // void disableClaytonCoding() { this->claytonCoding = false; }
 
-  // check how many alt alleles at this site
-  void parseAltAllele(const char* s);
-  // extract genotype for @param indv
-  inline double getGenotype(VCFIndividual& indv, const bool useDosage,
-                            const bool hemiRegion, const int sex,
-                            const int genoIdx, const int GDidx,
-                            const int GQidx);
-  double getGenotypeForAltAllele(VCFIndividual& indv, const bool useDosage,
-                                 const bool hemiRegion, const int sex,
-                                 const int genoIdx, const int GDidx,
-                                 const int GQidx, const int alt);
+  // @return GT already decoded by the site filters if they can be used as
+  // genotypes, otherwise NULL
+  const std::vector<int>* getDecodedGenotype(const bool useDosage,
+                                             const bool hemiRegion,
+                                             const int numAlt,
+                                             const int genoIdx) const;
 
   // assign extracted genotype @param from to a @param nrow by @param ncol
   // output matrix @param to
@@ -119,10 +96,13 @@ class VCFGenotypeExtractor : public GenotypeExtractor {
   // to);
   // void enableMultiAllelicMode() { this->multiAllelicMode = true; }
 
+ protected:
+  bool readSite(Site* site);
+  void decodeGenotype(const bool useDosage, const bool hemiRegion,
+                      const int numAlt, double* geno);
+
  private:
   VCFExtractor* vin;
-  std::vector<std::string> altAllele;  // store alt alleles
-  int altAlleleToParse;                // number of alleles to parse
-};                                     // class VCFGenotypeExtractor
+};  // class VCFGenotypeExtractor
 
 #endif /* VCFGENOTYPEEXTRACTOR_H */
@@ -0,0 +1,108 @@
+/*
+ * metaCov2text: convert binary MetaCov outputs (--meta cov[format=binary])
+ * to the text format
+ */
+#include <string>
+
+#include "base/Argument.h"
+#include "base/IO.h"
+#include "base/Logger.h"
+#include "base/MetaCovBinary.h"
+#include "base/RangeList.h"
+
+#define PROGRAM "metaCov2text"
+#define VERSION "20170601"
+void welcome() {
+#ifdef NDEBUG
+  fprintf(stderr, "Thank you for using %s (version %s, git tag %s)\n", PROGRAM,
+          VERSION, GIT_VERSION);
+#else
+  fprintf(stderr, "Thank you for using %s (version %s-Debug, git tag %s)\n",
+          PROGRAM, VERSION, GIT_VERSION);
+#endif
+  fprintf(stderr, "\n");
+}
+
+////////////////////////////////////////////////
+BEGIN_PARAMETER_LIST()
+ADD_PARAMETER_GROUP("Input/Output")
+ADD_STRING_PARAMETER(in, "--in", "Input binary MetaCov file (.MetaCov.bin)")
+ADD_STRING_PARAMETER(header, "--header",
+                     "Copy header lines from the text MetaCov file "
+                     "(.MetaCov.assoc.gz)")
+ADD_STRING_PARAMETER(out, "--out",
+                     "Output file name (stdout by default; .gz for gzip)")
+ADD_PARAMETER_GROUP("Region")
+ADD_STRING_PARAMETER(rangeList, "--rangeList",
+                     "Specify region to output, e.g. 1:100-200,2:300-400")
+ADD_PARAMETER_GROUP("Other Function")
+ADD_BOOL_PARAMETER(help, "--help", "Print detailed help message")
+END_PARAMETER_LIST();
+
+Logger* logger = NULL;
+int main(int argc, char** argv) {
+  PARSE_PARAMETER(argc, argv);
+  if (FLAG_help) {
+    PARAMETER_HELP();
+    return 0;
+  }
+
+  welcome();
+  PARAMETER_STATUS();
+
+  if (FLAG_REMAIN_ARG.size() > 0) {
+    fprintf(stderr, "Unparsed arguments: ");
+    for (unsigned int i = 0; i < FLAG_REMAIN_ARG.size(); i++) {
+      fprintf(stderr, " %s", FLAG_REMAIN_ARG[i].c_str());
+    }
+    fprintf(stderr, "\n");
+    abort();
+  }
+  REQUIRE_STRING_PARAMETER(FLAG_in, "Please provide input file using: --in");
+
+  MetaCovBinaryReader reader;
+  if (reader.open(FLAG_in)) {
+    fprintf(stderr, "Cannot open [ %s ]\n", FLAG_in.c_str());
+    return 1;
+  }
+  FileWriter fout(FLAG_out.empty() ? "stdout" : FLAG_out);
+
+  std::string line;
+  if (!FLAG_header.empty()) {
+    LineReader lr(FLAG_header);
+    while (lr.readLine(&line) > 0) {
+      if (line.empty() || line[0] != '#') break;
+      fout.write(line.c_str());
+      fout.write('\n');
+    }
+  }
+  fout.write("CHROM\tSTART_POS\tEND_POS\tNUM_MARKER\tMARKER_POS\tCOV\n");
+
+  RangeList rangeList;
+  if (!FLAG_rangeList.empty()) {
+    rangeList.addRangeList(FLAG_rangeList);
+  }
+  MetaCovRecord r;
+  if (rangeList.empty()) {
+    while (reader.readRecord(&r)) {
+      line.clear();
+      appendMetaCovText(r, &line);
+      line += '\n';
+      fout.write(line.c_str());
+    }
+  } else {
+    std::string chrom;
+    unsigned int beg, end;
+    for (size_t i = 0; i < rangeList.size(); ++i) {
+      rangeList.obtainRange(i, &chrom, &beg, &end);
+      reader.setRegion(chrom, beg, end);
+      while (reader.readRecord(&r)) {
+        line.clear();
+        appendMetaCovText(r, &line);
+        line += '\n';
+        fout.write(line.c_str());
+      }
+    }
+  }
+  return 0;
+}
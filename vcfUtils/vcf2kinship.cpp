@@ -50,6 +50,18 @@ class EmpiricalKinship {
   std::vector<int>* sex;
 };
 
+/**
+ * Tiles (ti, tj), tj <= ti, of the lower triangle are numbered row by row.
+ * @return the @param p th tile in @param ti and @param tj
+ */
+static void getLowerTriangleTile(int p, int* ti, int* tj) {
+  int i = (int)((sqrt(8.0 * p + 1.0) - 1.0) / 2.0);
+  while (i * (i + 1) / 2 > p) --i;
+  while ((i + 1) * (i + 2) / 2 <= p) ++i;
+  *ti = i;
+  *tj = p - i * (i + 1) / 2;
+}
+
 /**
  * IBSKinship matrix and use probability to impute kinship
  * Kinship for marker j
@@ -134,31 +146,51 @@ class IBSKinshipImpute : public EmpiricalKinship {
  * 0   2   1   0
  * 1   1   2   1
  * 2   0   1   2
+ *
+ * Genotypes of a block of sites are packed to bits, 64 sites per word, with
+ * three planes per sample: non-missing, genotype >= 1 and genotype >= 2.
+ * Then for a pair of samples, the number of sites both observed is
+ * popcount(v1 & v2), and the sum of |g1 - g2| is the popcount of the XOR of
+ * the other two planes over these sites.
  */
 class IBSKinship : public EmpiricalKinship {
  public:
-  IBSKinship() : n(0) {}
+  IBSKinship() : n(0), numSample(0), numBuffered(0) {}
   // missing genotype is less than 0.0
   int addGenotype(const std::vector<double>& g) {
     if (n == 0) {
+      numSample = g.size();
       k.resize(g.size(), g.size());
       k.zero();
       count.resize(g.size(), g.size());
       count.zero();
+      bits.assign(numSample * NumPlane * BlockWord, 0);
+      numBuffered = 0;
     }
-    ++n;
     for (size_t i = 0; i < g.size(); ++i) {
-      for (size_t j = 0; j <= i; ++j) {
-        if (g[i] >= 0 || g[j] >= 0) {
-          k[i][j] += 2.0 - abs((int)g[i] - (int)g[j]);
-          ++count[i][j];
-        }
+      // check validity
+      if (g[i] > 2) {
+        return -1;
       }
     }
+    ++n;
+    const int w = numBuffered >> 6;
+    const uint64_t bit = (uint64_t)1 << (numBuffered & 63);
+    for (size_t i = 0; i < g.size(); ++i) {
+      if (g[i] < 0) continue;
+      uint64_t* p = &bits[i * NumPlane * BlockWord + w];
+      p[0] |= bit;
+      if (g[i] >= 1) p[BlockWord] |= bit;
+      if (g[i] >= 2) p[2 * BlockWord] |= bit;
+    }
+    if (++numBuffered == BlockWord * 64) {
+      flush();
+    }
     return 0;
   }
   void calculate() {
     if (n == 0) return;
+    flush();
     for (int i = 0; i < k.ncol(); ++i) {
       for (int j = 0; j <= i; ++j) {
         if (count[i][j] > 0) {
@@ -173,13 +205,132 @@ class IBSKinship : public EmpiricalKinship {
   void clear() {
     n = 0;
     k.clear();
+    count.clear();
+    bits.clear();
+    numBuffered = 0;
   }
 
  private:
+  // add buffered sites to k and count, by tiles of sample pairs
+  void flush() {
+    if (numBuffered == 0) return;
+    const int numWord = (numBuffered + 63) >> 6;
+    const int numTile = (numSample + TileSize - 1) / TileSize;
+    const int numPair = numTile * (numTile + 1) / 2;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int p = 0; p < numPair; ++p) {
+      int ti, tj;
+      getLowerTriangleTile(p, &ti, &tj);
+      const int i0 = ti * TileSize;
+      const int j0 = tj * TileSize;
+      const int i1 = std::min(i0 + TileSize, numSample);
+      const int j1 = std::min(j0 + TileSize, numSample);
+      for (int i = i0; i < i1; ++i) {
+        const uint64_t* b1 = &bits[(size_t)i * NumPlane * BlockWord];
+        const int jEnd = (ti == tj) ? i + 1 : j1;
+        for (int j = j0; j < jEnd; ++j) {
+          const uint64_t* b2 = &bits[(size_t)j * NumPlane * BlockWord];
+          int both = 0;
+          int diff = 0;
+          for (int w = 0; w < numWord; ++w) {
+            const uint64_t v = b1[w] & b2[w];
+            both += __builtin_popcountll(v);
+            diff += __builtin_popcountll((b1[BlockWord + w] ^
+                                          b2[BlockWord + w]) & v) +
+                    __builtin_popcountll((b1[2 * BlockWord + w] ^
+                                          b2[2 * BlockWord + w]) & v);
+          }
+          k[i][j] += 2 * both - diff;
+          count[i][j] += both;
+        }
+      }
+    }
+    std::fill(bits.begin(), bits.end(), 0);
+    numBuffered = 0;
+  }
+
+ private:
+  static const int NumPlane = 3;   // non-missing, >= 1, >= 2
+  static const int BlockWord = 8;  // 64-site words per block
+  static const int TileSize = 64;  // samples per tile
   SimpleMatrix k;
   SimpleMatrix count;
   int n;
+  int numSample;
+  std::vector<uint64_t> bits;  // [ numSample x NumPlane x BlockWord ]
+  int numBuffered;             // number of buffered sites
 };  // IBSKinship
+const int IBSKinship::TileSize;
+
+/**
+ * Accumulate the lower triangle of K += G * G' for standardized genotypes G.
+ * Sites are buffered as columns of a [ N x BlockSize ] block, and each full
+ * block is added to K as a symmetric rank-k update computed by tiles with
+ * matrix products, instead of one rank-1 update per site.
+ */
+class KinshipBlockUpdater {
+ public:
+  KinshipBlockUpdater() : numSite(0) {}
+  void add(const std::vector<double>& g, SimpleMatrix* k) {
+    if ((size_t)block.rows() != g.size()) {
+      block.resize(g.size(), BlockSize);
+      numSite = 0;
+    }
+    std::copy(g.begin(), g.end(), block.col(numSite).data());
+    if (++numSite == BlockSize) {
+      flush(k);
+    }
+  }
+  // add buffered sites to @param k
+  void flush(SimpleMatrix* k) {
+    if (numSite == 0) return;
+    const int n = block.rows();
+    const int numTile = (n + TileSize - 1) / TileSize;
+    const int numPair = numTile * (numTile + 1) / 2;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+          prod;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (int p = 0; p < numPair; ++p) {
+        int ti, tj;
+        getLowerTriangleTile(p, &ti, &tj);
+        const int i0 = ti * TileSize;
+        const int j0 = tj * TileSize;
+        const int ni = std::min(TileSize, n - i0);
+        const int nj = std::min(TileSize, n - j0);
+        prod.noalias() = block.block(i0, 0, ni, numSite) *
+                         block.block(j0, 0, nj, numSite).transpose();
+        for (int i = 0; i < ni; ++i) {
+          double* row = &(*k)[i0 + i][j0];
+          const int nc = (ti == tj) ? i + 1 : nj;
+          for (int j = 0; j < nc; ++j) {
+            row[j] += prod(i, j);
+          }
+        }
+      }
+    }
+    numSite = 0;
+  }
+  void clear() {
+    block.resize(0, 0);
+    numSite = 0;
+  }
+
+ private:
+  static const int BlockSize = 512;  // sites per update
+  static const int TileSize = 256;   // samples per tile
+  Eigen::MatrixXd block;             // [ N x BlockSize ]
+  int numSite;                       // number of buffered sites
+};
+const int KinshipBlockUpdater::BlockSize;
+const int KinshipBlockUpdater::TileSize;
 
 /**
  * BaldingNicolsKinship matrix
@@ -229,22 +380,14 @@ class BaldingNicolsKinship : public EmpiricalKinship {
         geno[i] *= scale;
       }
     }
-    const size_t numG = g.size();
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (size_t i = 0; i < numG; ++i) {
-      if (geno[i] == 0.0) continue;  // skip missing marker
-      for (size_t j = 0; j <= i; ++j) {
-        k[i][j] += (geno[i] * geno[j]);
-      }
-    }
+    updater.add(geno, &k);
 
     ++n;
     return 0;
   }
   void calculate() {
     if (n == 0) return;
+    updater.flush(&k);
     for (int i = 0; i < k.ncol(); ++i) {
       for (int j = 0; j <= i; ++j) {
         k[i][j] /= n;
@@ -257,11 +400,13 @@ class BaldingNicolsKinship : public EmpiricalKinship {
   void clear() {
     n = 0;
     k.clear();
+    updater.clear();
   }
 
  private:
   SimpleMatrix k;
   std::vector<double> geno;
+  KinshipBlockUpdater updater;
   int n;
 };  // Balding-Nicols matrix
 
@@ -337,21 +482,13 @@ class BaldingNicolsKinshipForX : public EmpiricalKinship {
       }
     }
 
-    const size_t numG = g.size();
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (size_t i = 0; i < numG; ++i) {
-      if (geno[i] == 0.0) continue;  // skip missing marker
-      for (size_t j = 0; j <= i; ++j) {
-        k[i][j] += geno[i] * geno[j];
-      }
-    }
+    updater.add(geno, &k);
     ++n;
     return 0;
   }
   void calculate() {
     if (n == 0) return;
+    updater.flush(&k);
     for (int i = 0; i < k.ncol(); ++i) {
       for (int j = 0; j <= i; ++j) {
         k[i][j] /= n;
@@ -365,11 +502,13 @@ class BaldingNicolsKinshipForX : public EmpiricalKinship {
   void clear() {
     n = 0;
     k.clear();
+    updater.clear();
   }
 
  private:
   SimpleMatrix k;
   std::vector<double> geno;
+  KinshipBlockUpdater updater;
   int n;
 };  // Balding-Nicols matrix for sex chromosome
 
@@ -0,0 +1,61 @@
+/*
+ * vcfSiteIndex: create the site index (.vsi) of a bgzipped VCF file, so that
+ * rvtest can skip variants failing --siteMACMin or --annoType without reading
+ * them
+ */
+#include <string>
+
+#include "base/Argument.h"
+#include "base/Logger.h"
+#include "libVcf/VCFSiteIndex.h"
+
+#define PROGRAM "vcfSiteIndex"
+#define VERSION "20170701"
+void welcome() {
+#ifdef NDEBUG
+  fprintf(stderr, "Thank you for using %s (version %s, git tag %s)\n", PROGRAM,
+          VERSION, GIT_VERSION);
+#else
+  fprintf(stderr, "Thank you for using %s (version %s-Debug, git tag %s)\n",
+          PROGRAM, VERSION, GIT_VERSION);
+#endif
+  fprintf(stderr, "\n");
+}
+
+////////////////////////////////////////////////
+BEGIN_PARAMETER_LIST()
+ADD_PARAMETER_GROUP("Input/Output")
+ADD_STRING_PARAMETER(inVcf, "--inVcf", "Input bgzipped VCF file (.vcf.gz)")
+ADD_PARAMETER_GROUP("Other Function")
+ADD_BOOL_PARAMETER(help, "--help", "Print detailed help message")
+END_PARAMETER_LIST();
+
+Logger* logger = NULL;
+int main(int argc, char** argv) {
+  PARSE_PARAMETER(argc, argv);
+  if (FLAG_help) {
+    PARAMETER_HELP();
+    return 0;
+  }
+
+  welcome();
+  PARAMETER_STATUS();
+
+  if (FLAG_REMAIN_ARG.size() > 0) {
+    fprintf(stderr, "Unparsed arguments: ");
+    for (unsigned int i = 0; i < FLAG_REMAIN_ARG.size(); i++) {
+      fprintf(stderr, " %s", FLAG_REMAIN_ARG[i].c_str());
+    }
+    fprintf(stderr, "\n");
+    abort();
+  }
+  REQUIRE_STRING_PARAMETER(FLAG_inVcf,
+                           "Please provide input file using: --inVcf");
+
+  if (VCFSiteIndex::build(FLAG_inVcf)) {
+    return 1;
+  }
+  fprintf(stderr, "Site index [ %s ] created.\n",
+          VCFSiteIndex::getIndexFileName(FLAG_inVcf).c_str());
+  return 0;
+}